@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 
 #include "AlgorithmCiftiSeparate.h"
+#include "BlockedDot.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
 #include "VolumeFile.h"
@@ -30,7 +31,13 @@
 #include "CaretOMP.h"
 #include "FileInformation.h"
 #include "CaretPointer.h"
-#include "dot_wrapper.h"
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <utility>
 #include <algorithm>
@@ -223,11 +230,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
+    CaretArray<int> indexReverse(numRows, -1);
+    vector<int> chunkIndices;
     for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numRows) endrow = numRows;
         outRows.resize(endrow - startrow);
+        chunkIndices.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -238,41 +248,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
+            chunkIndices[i - startrow] = i;
+            indexReverse[i] = i - startrow;
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
-                {
-                    if (j >= myrow)//if so, only compute one half, and store both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
-        }
+        computeChunk(chunkIndices, indexReverse, outRows, fisherZ, !cacheFullInput);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], i);
+            indexReverse[i] = -1;
         }
         if (!cacheFullInput)
         {
@@ -410,12 +393,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
         }
     }
     CaretArray<int> indexReverse(numRows, -1);
+    vector<int> chunkIndices;
     for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numSelected) endrow = numSelected;
         outRows.resize(endrow - startrow);
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        chunkIndices.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -426,38 +410,10 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
-            indexReverse[ciftiIndexList[i].first] = i;
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
-                {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
+            chunkIndices[i - startrow] = ciftiIndexList[i].first;
+            indexReverse[ciftiIndexList[i].first] = i - startrow;
         }
+        computeChunk(chunkIndices, indexReverse, outRows, fisherZ, !cacheFullInput);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
@@ -517,30 +473,225 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoiPtr, rightRoiPtr, cerebRoiPtr, volRoiPtr, weights, fisherZ, memLimitGB, noDemean, covariance);//HACK: pass through our progress object
 }
 
-float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+class AlgorithmCiftiCorrelation::RowPrefetcher : public QThread
+{//bounded ring of demeaned row blocks, filled in file order by this thread, so workers don't wait on a lock while a row is read from disk
+public:
+    struct Block
+    {
+        int m_index, m_start, m_count;
+        vector<float> m_storage;
+        vector<const float*> m_rows;//may point into the cache instead of storage
+        vector<float> m_rrs;
+    };
+private:
+    AlgorithmCiftiCorrelation* m_parent;
+    vector<Block> m_blocks;
+    vector<int> m_free;
+    deque<int> m_ready;
+    bool m_finished;
+    AString m_error;
+    QMutex m_mutex;//only held while moving block indices between lists, never during reading
+    QWaitCondition m_readyCondition, m_freeCondition;
+public:
+    RowPrefetcher(AlgorithmCiftiCorrelation* parent, const int& numBlocks)
+    {
+        m_parent = parent;
+        m_finished = false;
+        m_blocks.resize(numBlocks);
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            m_blocks[i].m_index = i;
+            m_blocks[i].m_storage.resize(MOVING_BLOCK * (int64_t)m_parent->m_numCols);
+            m_blocks[i].m_rows.resize(MOVING_BLOCK);
+            m_blocks[i].m_rrs.resize(MOVING_BLOCK);
+            m_free.push_back(i);
+        }
+    }
+    
+    void run()
+    {
+        const int numRows = m_parent->m_inputCifti->getNumberOfRows();
+        try
+        {
+            for (int curRow = 0; curRow < numRows; curRow += MOVING_BLOCK)
+            {
+                int index;
+                {
+                    QMutexLocker locked(&m_mutex);
+                    while (m_free.empty()) m_freeCondition.wait(&m_mutex);
+                    index = m_free.back();
+                    m_free.pop_back();
+                }
+                Block& myBlock = m_blocks[index];
+                myBlock.m_start = curRow;
+                myBlock.m_count = min((int)MOVING_BLOCK, numRows - curRow);
+                for (int i = 0; i < myBlock.m_count; ++i)
+                {
+                    myBlock.m_rows[i] = m_parent->getRow(curRow + i, myBlock.m_rrs[i], myBlock.m_storage.data() + i * (int64_t)m_parent->m_numCols);
+                }
+                QMutexLocker locked(&m_mutex);
+                m_ready.push_back(index);
+                m_readyCondition.wakeOne();
+            }
+        } catch (CaretException& e) {
+            QMutexLocker locked(&m_mutex);
+            m_error = e.whatString();
+        } catch (std::exception& e) {//nothing may escape a QThread, and the workers must still be woken
+            QMutexLocker locked(&m_mutex);
+            m_error = e.what();
+        } catch (...) {
+            QMutexLocker locked(&m_mutex);
+            m_error = "caught unknown exception type";
+        }
+        QMutexLocker locked(&m_mutex);
+        m_finished = true;
+        m_readyCondition.wakeAll();
+    }
+    
+    ///returns NULL when there are no more rows
+    Block* acquire()
+    {
+        QMutexLocker locked(&m_mutex);
+        while (m_ready.empty() && !m_finished) m_readyCondition.wait(&m_mutex);
+        if (m_ready.empty()) return NULL;
+        int index = m_ready.front();
+        m_ready.pop_front();
+        return &(m_blocks[index]);
+    }
+    
+    void release(Block* myBlock)
+    {
+        QMutexLocker locked(&m_mutex);
+        m_free.push_back(myBlock->m_index);
+        m_freeCondition.wakeOne();
+    }
+    
+    const AString& getError() const { return m_error; }
+};
+
+void AlgorithmCiftiCorrelation::computeChunk(const vector<int>& chunkIndices, const CaretArray<int>& chunkReverse, vector<CaretArray<float> >& outRows, const bool& fisherZ,
+                                             const bool& streamInput)
+{//chunkIndices are the cifti rows of the output rows in memory, chunkReverse maps a cifti row to its position in the chunk, or -1
+    const int numRows = m_inputCifti->getNumberOfRows();
+    const int rowLength = getRowLength();
+    if (streamInput)
+    {
+#ifdef CARET_OMP
+        int numThreads = omp_get_max_threads();
+#else
+        int numThreads = 1;
+#endif
+        RowPrefetcher myPrefetcher(this, PREFETCH_BLOCKS_PER_THREAD * numThreads);
+        myPrefetcher.start();
+#pragma omp CARET_PAR
+        {
+            vector<float> packedPanel(BlockedDot::packedPanelSize(rowLength));
+            vector<double> dots(MOVING_BLOCK * BlockedDot::PANEL_WIDTH);
+            RowPrefetcher::Block* myBlock;
+            while ((myBlock = myPrefetcher.acquire()) != NULL)
+            {
+                computeBlock(myBlock->m_start, myBlock->m_count, myBlock->m_rows.data(), myBlock->m_rrs.data(), chunkIndices, chunkReverse, outRows, fisherZ, packedPanel, dots);
+                myPrefetcher.release(myBlock);
+            }
+        }
+        myPrefetcher.wait();
+        if (!myPrefetcher.getError().isEmpty())
+        {
+            throw AlgorithmException("error reading input rows: " + myPrefetcher.getError());
+        }
+    } else {//everything is already in memory, no need to serialize anything
+#pragma omp CARET_PAR
+        {
+            vector<const float*> movingRows(MOVING_BLOCK);
+            vector<float> movingRrs(MOVING_BLOCK);
+            vector<float> packedPanel(BlockedDot::packedPanelSize(rowLength));
+            vector<double> dots(MOVING_BLOCK * BlockedDot::PANEL_WIDTH);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int blockStart = 0; blockStart < numRows; blockStart += MOVING_BLOCK)
+            {
+                int blockCount = min((int)MOVING_BLOCK, numRows - blockStart);
+                for (int i = 0; i < blockCount; ++i)
+                {
+                    movingRows[i] = getRow(blockStart + i, movingRrs[i]);
+                }
+                computeBlock(blockStart, blockCount, movingRows.data(), movingRrs.data(), chunkIndices, chunkReverse, outRows, fisherZ, packedPanel, dots);
+            }
+        }
+    }
+}
+
+void AlgorithmCiftiCorrelation::computeBlock(const int& blockStart, const int& blockCount, const float* const* movingRows, const float* movingRrs,
+                                             const vector<int>& chunkIndices, const CaretArray<int>& chunkReverse, vector<CaretArray<float> >& outRows, const bool& fisherZ,
+                                             vector<float>& packedPanel, vector<double>& dots)
+{
+    const int chunkSize = (int)chunkIndices.size();
+    const int rowLength = getRowLength();
+    const float* panelRows[BlockedDot::PANEL_WIDTH];
+    float panelRrs[BlockedDot::PANEL_WIDTH];
+    int firstNeeded = chunkSize;//symmetric part: moving rows that are also output rows only need the upper triangle
+    for (int i = 0; i < blockCount; ++i)
+    {
+        int reverse = chunkReverse[blockStart + i];
+        if (reverse == -1)
+        {
+            firstNeeded = 0;
+            break;
+        }
+        if (reverse < firstNeeded) firstNeeded = reverse;
+    }
+    for (int panelStart = firstNeeded - firstNeeded % BlockedDot::PANEL_WIDTH; panelStart < chunkSize; panelStart += BlockedDot::PANEL_WIDTH)
+    {
+        int panelCount = min((int)BlockedDot::PANEL_WIDTH, chunkSize - panelStart);
+        for (int j = 0; j < panelCount; ++j)
+        {
+            panelRows[j] = getRow(chunkIndices[panelStart + j], panelRrs[j]);
+        }
+        BlockedDot::packPanel(panelRows, panelCount, rowLength, packedPanel.data());
+        BlockedDot::panelDots(movingRows, blockCount, packedPanel.data(), rowLength, dots.data());
+        for (int i = 0; i < blockCount; ++i)
+        {
+            int myrow = blockStart + i;
+            int reverse = chunkReverse[myrow];
+            const double* myDots = dots.data() + i * BlockedDot::PANEL_WIDTH;
+            for (int j = 0; j < panelCount; ++j)
+            {
+                int outIndex = panelStart + j;
+                if (reverse != -1)//check whether we are in the output memory area
+                {
+                    if (outIndex >= reverse)//if so, only compute one half, and store both places
+                    {
+                        outRows[outIndex][myrow] = finishCorrelation(myDots[j], movingRrs[i], panelRrs[j], myrow == chunkIndices[outIndex], fisherZ);
+                        outRows[reverse][chunkIndices[outIndex]] = outRows[outIndex][myrow];
+                    }
+                } else {
+                    outRows[outIndex][myrow] = finishCorrelation(myDots[j], movingRrs[i], panelRrs[j], false, fisherZ);
+                }
+            }
+        }
+    }
+}
+
+float AlgorithmCiftiCorrelation::finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ)
 {
     double r;
-    if (row1 == row2 && !m_covariance)
+    if (sameRow && !m_covariance)
     {
         r = 1.0;//short circuit for same row
     } else {
         if (m_weightedMode)
-        {
-            int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = sddot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
+        {//these have already had the weighted row means subtracted out, and weights applied
             if (m_covariance)
             {
                 if (m_binaryWeights)
                 {
-                    r = accum / numWeights;
+                    r = accum / m_weightIndexes.size();
                 } else {
                     r = accum / rrs1;//NOTE: will equal rrs2 as it only depends on weights, and is not square root
                 }
             } else {
                 r = accum / (rrs1 * rrs2);//as do these
             }
-        } else {
-            double accum = sddot(row1, row2, m_numCols);//these have already had the row means subtracted out
+        } else {//these have already had the row means subtracted out
             if (m_covariance)
             {
                 r = accum / m_numCols;
@@ -564,6 +715,12 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
     return r;
 }
 
+int AlgorithmCiftiCorrelation::getRowLength()
+{
+    if (m_weightedMode) return (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
+    return m_numCols;
+}
+
 void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>* weights, const bool& noDemean, const bool& covariance)
 {
     m_noDemean = noDemean;
@@ -638,27 +795,27 @@ void AlgorithmCiftiCorrelation::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, float* scratch)
 {
-    float* ret;
+    const float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
     if (m_rowInfo[ciftiIndex].m_cacheIndex != -1)
     {
         ret = m_rowCache[m_rowInfo[ciftiIndex].m_cacheIndex].m_row.data();
     } else {
-        CaretAssert(!mustBeCached);
-        if (mustBeCached)//largely so it doesn't give warning about unused when compiled in release
+        CaretAssert(scratch != NULL);
+        if (scratch == NULL)//largely so it doesn't give warning about unused when compiled in release
         {
             throw AlgorithmException("something very bad happened, notify the developers");
         }
-        ret = getTempRow();
-        m_inputCifti->getRow(ret, ciftiIndex);
+        m_inputCifti->getRow(scratch, ciftiIndex);
         if (!m_rowInfo[ciftiIndex].m_haveCalculated)
         {
-            computeRowStats(ret, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
+            computeRowStats(scratch, m_rowInfo[ciftiIndex].m_mean, m_rowInfo[ciftiIndex].m_rootResidSqr);
             m_rowInfo[ciftiIndex].m_haveCalculated = true;
         }
-        doSubtract(ret, m_rowInfo[ciftiIndex].m_mean);
+        doSubtract(scratch, m_rowInfo[ciftiIndex].m_mean);
+        ret = scratch;
     }
     rootResidSqr = m_rowInfo[ciftiIndex].m_rootResidSqr;
     return ret;
@@ -710,7 +867,7 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
             {
                 accum += m_weights[i];
             }
-            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so must not divide by both in correlate() in covariance mode
+            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so must not divide by both in finishCorrelation() in covariance mode
         }
     } else {
         if (m_weightedMode)
@@ -769,40 +926,17 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
     }
 }
 
-float* AlgorithmCiftiCorrelation::getTempRow()
-{
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRows.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
-    {
-        m_tempRows.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
-        {
-            m_tempRows[i] = CaretArray<float>(m_numCols);
-        }
-    }
-    return m_tempRows[threadNum].getArray();
-#else
-    if (m_tempRows.size() == 0)
-    {
-        m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRows[0].getArray();
-#endif
-}
-
 int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cacheFullInput)
 {
     int numRows = m_inputCifti->getNumberOfRows();
     int inrowBytes = m_numCols * sizeof(float), outrowBytes = numRows * sizeof(float);
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * m_numCols * 4;//count in-memory input against the total too
+    int64_t perThreadBytes = (int64_t)inrowBytes * (PREFETCH_BLOCKS_PER_THREAD * MOVING_BLOCK + BlockedDot::PANEL_WIDTH);//prefetched moving rows that aren't references to cache, and a packed panel
 #ifdef CARET_OMP
-    targetBytes -= inrowBytes * omp_get_max_threads();
+    targetBytes -= perThreadBytes * omp_get_max_threads();
 #else
-    targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+    targetBytes -= perThreadBytes;
 #endif
     targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
     int64_t perRowBytes = inrowBytes + outrowBytes;//cache and memory collation for output rows
@@ -30,6 +30,12 @@ namespace caret {
     class AlgorithmCiftiCorrelation : public AbstractAlgorithm
     {
         AlgorithmCiftiCorrelation();
+        enum
+        {
+            MOVING_BLOCK = 64,//number of moving rows each thread takes at once, so the cached rows are streamed once per block instead of once per row
+            PREFETCH_BLOCKS_PER_THREAD = 2//size of the prefetch ring, in blocks per worker thread
+        };
+        class RowPrefetcher;//reads and demeans moving rows in its own thread when the input isn't fully cached
         struct CacheRow
         {
             int m_ciftiIndex;
@@ -48,7 +54,6 @@ namespace caret {
         };
         std::vector<CacheRow> m_rowCache;
         std::vector<RowInfo> m_rowInfo;
-        std::vector<CaretArray<float> > m_tempRows;//reuse return values in getRow instead of reallocating
         std::vector<float> m_weights;
         std::vector<int> m_weightIndexes;
         bool m_binaryWeights, m_weightedMode, m_noDemean, m_covariance;
@@ -59,9 +64,14 @@ namespace caret {
         void computeRowStats(const float* row, float& mean, float& rootResidSqr);
         void doSubtract(float* row, const float& mean);
         void clearCache();
-        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
-        float* getTempRow();
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        const float* getRow(const int& ciftiIndex, float& rootResidSqr, float* scratch = NULL);//if scratch is NULL, the row must be cached
+        int getRowLength();
+        float finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ);
+        void computeChunk(const std::vector<int>& chunkIndices, const CaretArray<int>& chunkReverse, std::vector<CaretArray<float> >& outRows, const bool& fisherZ,
+                          const bool& streamInput);
+        void computeBlock(const int& blockStart, const int& blockCount, const float* const* movingRows, const float* movingRrs,
+                          const std::vector<int>& chunkIndices, const CaretArray<int>& chunkReverse, std::vector<CaretArray<float> >& outRows, const bool& fisherZ,
+                          std::vector<float>& packedPanel, std::vector<double>& dots);
         void init(const CiftiFile* input, const std::vector<float>* weights, const bool& noDemean, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
@@ -476,15 +476,20 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             cacheRows(rowsToCache);
         }
         int numSurfNodes = mySurf->getNumberOfNodes();
+        vector<int32_t> excludeRoots(endpos - startpos);
+        for (int i = startpos; i < endpos; ++i)
+        {
+            excludeRoots[i - startpos] = myMap[i].m_surfaceNode;
+        }
+        vector<vector<float> > excludeDists;
+        GeodesicHelper::getNodesToGeoDistBatch(myGeoBase, excludeRoots, surfExclude, excludeNodes, excludeDists);
+        excludeDists.clear();
 #pragma omp CARET_PAR
         {
-            vector<float> distances;
-            CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
 #pragma omp CARET_FOR
             for (int i = startpos; i < endpos; ++i)
             {
                 vector<int32_t>& excludeRef = excludeNodes[i - startpos];
-                myGeoHelp->getNodesToGeoDist(myMap[i].m_surfaceNode, surfExclude, excludeRef, distances);
                 vector<bool>& lookupRef = roiLookup[i - startpos];
                 lookupRef.resize(numSurfNodes);
                 for (int j = 0; j < numSurfNodes; ++j)
@@ -134,24 +134,35 @@ AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* m
         int64_t chunkEnd = chunkStart + chunkSize;
         if (chunkEnd > m_numRowsA) chunkEnd = m_numRowsA;
         cacheRowsA(chunkStart, chunkEnd);
+        int numA = (int)(chunkEnd - chunkStart);
+        vector<const float*> rowsA(numA);
+        vector<float> rrsA(numA);
+        for (int j = 0; j < numA; ++j)
+        {
+            rowsA[j] = getCachedRowA(chunkStart + j, rrsA[j]);
+        }
+        int rowLength = (int)(m_weightedMode ? m_weightIndexes.size() : m_numCols);//because we compacted the data in the row to not include any zero weights
         int64_t counter = 0;
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int64_t i = 0; i < m_numRowsB; ++i)
+#pragma omp CARET_PAR
         {
-            float rrsB;
-            int64_t indB;
-            const float* rowB;
-#pragma omp critical
+            vector<double> dots(numA);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < m_numRowsB; ++i)
             {
-                indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
-                ++counter;
-                rowB = getRowB(indB, rrsB);
-            }
-            for (int indA = chunkStart; indA < chunkEnd; ++indA)
-            {
-                float rrsA;
-                const float* rowA = getCachedRowA(indA, rrsA);
-                outscratch[indA - chunkStart][indB] = correlate(rowA, rrsA, rowB, rrsB, fisherZ);
+                float rrsB;
+                int64_t indB;
+                const float* rowB;
+#pragma omp critical
+                {
+                    indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
+                    ++counter;
+                    rowB = getRowB(indB, rrsB);
+                }
+                sddot_batch(rowB, rowsA.data(), numA, rowLength, dots.data());//one B row against every cached A row, so the B row is loaded once per group of A rows
+                for (int j = 0; j < numA; ++j)
+                {
+                    outscratch[j][indB] = correlate(dots[j], rrsA[j], rrsB, fisherZ);
+                }
             }
         }
         for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
@@ -242,18 +253,9 @@ int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
     return ret;
 }
 
-float AlgorithmCiftiCrossCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+float AlgorithmCiftiCrossCorrelation::correlate(const double& accum, const float& rrs1, const float& rrs2, const bool& fisherZ)
 {
-    double r;
-    if (m_weightedMode)
-    {
-        int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-        double accum = sddot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
-        r = accum / (rrs1 * rrs2);//as do these
-    } else {
-        double accum = sddot(row1, row2, m_numCols);//these have already had the row means subtracted out
-        r = accum / (rrs1 * rrs2);
-    }
+    double r = accum / (rrs1 * rrs2);//rows have already had the (weighted) row means subtracted out, and weights applied, as do the rrs values
     if (fisherZ)
     {
         if (r > 0.999999) r = 0.999999;//prevent inf
@@ -63,7 +63,7 @@ namespace caret {
         const float* getCachedRowA(const int64_t& ciftiIndex, float& rootResidSqr);//retrieve already cached rows
         const float* getRowB(const int64_t& ciftiIndex, float& rootResidSqr);
         void adjustRow(float* row, RowInfo& info);
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        float correlate(const double& accum, const float& rrs1, const float& rrs2, const bool& fisherZ);//accum is the dot product of the adjusted rows
         void cacheRowsA(const int64_t& begin, const int64_t& end);//grabs the rows and does whatever it needs to, using as much IO bandwidth and CPU resources as available/needed
     protected:
         static float getSubAlgorithmWeight();
@@ -29,6 +29,7 @@
 #include "AlgorithmMetricResample.h"
 #include "AlgorithmVolumeAffineResample.h"
 #include "AlgorithmVolumeWarpfieldResample.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "LabelFile.h"
 #include "MetricFile.h"
@@ -702,6 +703,112 @@ namespace
             }
         }
     }
+    
+    void streamSurfaceColumnResample(const CiftiFile* myCiftiIn, const StructureEnum::Enum& myStruct, CiftiFile* myCiftiOut,
+                                     const SurfaceResamplingHelper* surfResamp, const bool& surfLargest)
+    {//apply the resampling weights as a sparse matrix directly to the rows of the structure, a block of rows at a time, instead of separate/resample/replace
+        const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
+        const CiftiBrainModelsMap& inModels = myInputXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN), &outModels = myCiftiOut->getCiftiXML().getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+        vector<CiftiBrainModelsMap::SurfaceMap> inMap = inModels.getSurfaceMap(myStruct), outMap = outModels.getSurfaceMap(myStruct);
+        vector<int64_t> nodeToInRow(inModels.getSurfaceNumberOfNodes(myStruct), -1);
+        for (int64_t j = 0; j < (int64_t)inMap.size(); ++j)
+        {
+            nodeToInRow[inMap[j].m_surfaceNode] = inMap[j].m_ciftiIndex;
+        }
+        int64_t outMapSize = (int64_t)outMap.size();
+        vector<int64_t> opStart(outMapSize + 1, 0), opRow;//each output row is a weighted sum of input rows
+        vector<float> opWeight;
+        if (surfResamp == NULL)
+        {//same mesh, just copy the rows that exist
+            for (int64_t j = 0; j < outMapSize; ++j)
+            {
+                int64_t inRow = nodeToInRow[outMap[j].m_surfaceNode];
+                if (inRow != -1)
+                {
+                    opRow.push_back(inRow);
+                    opWeight.push_back(1.0f);
+                }
+                opStart[j + 1] = (int64_t)opRow.size();
+            }
+        } else {
+            vector<int64_t> nodeStart;
+            vector<int> nodeList;
+            vector<float> weightList;
+            surfResamp->getSparseWeights(nodeStart, nodeList, weightList, surfLargest);
+            for (int64_t j = 0; j < outMapSize; ++j)
+            {
+                int node = outMap[j].m_surfaceNode;
+                for (int64_t k = nodeStart[node]; k < nodeStart[node + 1]; ++k)
+                {
+                    int64_t inRow = nodeToInRow[nodeList[k]];
+                    if (inRow != -1)//helper was given the cifti ROI, so this shouldn't happen
+                    {
+                        opRow.push_back(inRow);
+                        opWeight.push_back(weightList[k]);
+                    }
+                }
+                opStart[j + 1] = (int64_t)opRow.size();
+            }
+        }
+        int64_t rowLength = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        const int64_t maxBlockFloats = ((int64_t)1) << 24;//64MB of input and output rows per block, but always at least one output row
+        vector<int64_t> inRowSlot(myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN), -1), blockInRows;
+        vector<float> inBlock, outBlock;
+        int64_t blockStart = 0;
+        while (blockStart < outMapSize)
+        {
+            int64_t blockEnd = blockStart;
+            while (blockEnd < outMapSize)
+            {
+                int64_t newRows = opStart[blockEnd + 1] - opStart[blockEnd];//upper bound, some may already be in the block
+                if (blockEnd > blockStart && ((int64_t)blockInRows.size() + newRows + blockEnd - blockStart + 1) * rowLength > maxBlockFloats) break;
+                for (int64_t k = opStart[blockEnd]; k < opStart[blockEnd + 1]; ++k)
+                {
+                    if (inRowSlot[opRow[k]] == -1)
+                    {
+                        inRowSlot[opRow[k]] = (int64_t)blockInRows.size();
+                        blockInRows.push_back(opRow[k]);
+                    }
+                }
+                ++blockEnd;
+            }
+            inBlock.resize(blockInRows.size() * rowLength);
+            for (int64_t i = 0; i < (int64_t)blockInRows.size(); ++i)
+            {
+                myCiftiIn->getRow(inBlock.data() + i * rowLength, blockInRows[i]);
+            }
+            outBlock.resize((blockEnd - blockStart) * rowLength);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t j = blockStart; j < blockEnd; ++j)
+            {
+                float* outRow = outBlock.data() + (j - blockStart) * rowLength;
+                vector<double> accum(rowLength, 0.0);//same accumulation as resampleNormal, so results match the separate/resample path
+                for (int64_t k = opStart[j]; k < opStart[j + 1]; ++k)
+                {
+                    const float* inRow = inBlock.data() + inRowSlot[opRow[k]] * rowLength;
+                    double weight = opWeight[k];
+                    for (int64_t t = 0; t < rowLength; ++t)
+                    {
+                        accum[t] += inRow[t] * weight;
+                    }
+                }
+                for (int64_t t = 0; t < rowLength; ++t)
+                {
+                    outRow[t] = accum[t];
+                }
+            }
+            for (int64_t j = blockStart; j < blockEnd; ++j)
+            {
+                myCiftiOut->setRow(outBlock.data() + (j - blockStart) * rowLength, outMap[j].m_ciftiIndex);
+            }
+            for (int64_t i = 0; i < (int64_t)blockInRows.size(); ++i)
+            {
+                inRowSlot[blockInRows[i]] = -1;
+            }
+            blockInRows.clear();
+            blockStart = blockEnd;
+        }
+    }
 }
 
 AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const int& direction, const CiftiFile* myTemplate, const int& templateDir,
@@ -981,6 +1088,33 @@ void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn,
         }
         AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, direction, myStruct, newUse);
     } else {
+        //without dilation, each new row only depends on a few old rows, so stream it instead of separating the whole structure
+        //dilation needs every row of the structure on the surface at once, so it still goes through separate/resample/replace below
+        //ALONG_ROW never gets here, the constructors already resample it one row at a time with processRowSurface
+        if (direction == CiftiXML::ALONG_COLUMN && surfdilatemm <= 0.0f)
+        {
+            if (curSphere == NULL)
+            {
+                streamSurfaceColumnResample(myCiftiIn, myStruct, myCiftiOut, NULL, surfLargest);
+                return;
+            }
+            const CiftiBrainModelsMap& inModels = myInputXML.getBrainModelsMap(direction);
+            vector<CiftiBrainModelsMap::SurfaceMap> inMap = inModels.getSurfaceMap(myStruct);
+            vector<float> tempRoi(curSphere->getNumberOfNodes(), 0.0f);
+            for (int j = 0; j < (int)inMap.size(); ++j)
+            {
+                tempRoi[inMap[j].m_surfaceNode] = 1.0f;
+            }
+            const float* curAreasPtr = NULL, *newAreasPtr = NULL;
+            if (curAreas != NULL && newAreas != NULL)
+            {
+                curAreasPtr = curAreas->getValuePointerForColumn(0);
+                newAreasPtr = newAreas->getValuePointerForColumn(0);
+            }
+            SurfaceResamplingHelper surfResamp(mySurfMethod, curSphere, newSphere, curAreasPtr, newAreasPtr, tempRoi.data());
+            streamSurfaceColumnResample(myCiftiIn, myStruct, myCiftiOut, &surfResamp, surfLargest);
+            return;
+        }
         MetricFile origMetric, origROI;
         AlgorithmCiftiSeparate(NULL, myCiftiIn, direction, myStruct, &origMetric, &origROI);
         MetricFile newMetric, newDilate, resampleROI, *newUse = &newMetric;
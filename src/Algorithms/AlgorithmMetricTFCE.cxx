@@ -23,14 +23,14 @@
 
 #include "AlgorithmMetricSmoothing.h"
 #include "CaretAssert.h"
-#include "CaretHeap.h"
 #include "CaretOMP.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
+#include "TFCEUnionFind.h"
 #include "TopologyHelper.h"
 
 #include <cmath>
-#include <set>
+#include <fstream>
 #include <vector>
 
 using namespace caret;
@@ -72,6 +72,12 @@ OperationParameters* AlgorithmMetricTFCE::getParameters()
     OptionalParameter* corrAreaOpt = ret->createOptionalParameter(8, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
     corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
     
+    OptionalParameter* signFlipOpt = ret->createOptionalParameter(9, "-sign-flip-null", "do a one-sample test across columns, and generate its null distribution by random sign flipping");
+    signFlipOpt->addIntegerParameter(1, "num-flips", "the number of random sign flips to do");
+    signFlipOpt->addStringParameter(2, "null-out", "output - text file for the maximum and minimum TFCE value of each sign flip");//fake the output formatting
+    OptionalParameter* seedOpt = signFlipOpt->createOptionalParameter(3, "-seed", "set the random seed");
+    seedOpt->addIntegerParameter(1, "seed", "the seed (default 0)");
+    
     ret->setHelpText(
         AString("Threshold-free cluster enhancement is a method to increase the relative value of regions that would form clusters in a standard thresholding test.  ") +
         "This is accomplished by evaluating the integral of:\n\n" +
@@ -80,6 +86,9 @@ OperationParameters* AlgorithmMetricTFCE::getParameters()
         "Negative values are similarly enhanced by negating the data, running the same process, and negating the result.\n\n" +
         "When using -presmooth with -corrected-areas, note that it is an approximate correction within the smoothing algorithm (the TFCE correction is exact).  " +
         "Doing smoothing on individual surfaces before averaging/TFCE is preferred, when possible, in order to better tie the smoothing kernel size to the original feature size.\n\n" +
+        "When -sign-flip-null is specified, the columns of the input are treated as subjects, and the output is a single column containing the TFCE of the one-sample t-statistic across them.  " +
+        "For each sign flip, a random subset of the columns is negated, the t-statistic is recomputed and TFCE is run on it, and the maximum and minimum values are written as one line of the text file.  " +
+        "The random sign flips are generated from the seed and the flip number together, so the output doesn't depend on the number of threads.\n\n" +
         "The TFCE method is explained in: Smith SM, Nichols TE., \"Threshold-free cluster enhancement: addressing problems of smoothing, threshold dependence and localisation in cluster inference.\" Neuroimage. 2009 Jan 1;44(1):83-98. PMID: 18501637"
     );
     return ret;
@@ -126,17 +135,97 @@ void AlgorithmMetricTFCE::useParameters(OperationParameters* myParams, ProgressO
     {
         corrAreaMetric = corrAreaOpt->getMetric(1);
     }
-    AlgorithmMetricTFCE(myProgObj, mySurf, myMetric, myMetricOut, presmooth, myRoi, param_e, param_h, columnNum, corrAreaMetric);
+    int numFlips = 0, flipSeed = 0;
+    AString nullTextName;
+    OptionalParameter* signFlipOpt = myParams->getOptionalParameter(9);
+    if (signFlipOpt->m_present)
+    {
+        numFlips = (int)signFlipOpt->getInteger(1);
+        if (numFlips < 1) throw AlgorithmException("number of sign flips must be positive");
+        nullTextName = signFlipOpt->getString(2);
+        OptionalParameter* seedOpt = signFlipOpt->getOptionalParameter(3);
+        if (seedOpt->m_present)
+        {
+            flipSeed = (int)seedOpt->getInteger(1);
+        }
+    }
+    ofstream nullOut;
+    if (numFlips > 0)
+    {//open it before doing the work, so a bad path fails early
+        nullOut.open(nullTextName.toLocal8Bit().constData());
+        if (!nullOut) throw AlgorithmException("failed to open text file for output");
+    }
+    vector<float> nullMax, nullMin;
+    AlgorithmMetricTFCE(myProgObj, mySurf, myMetric, myMetricOut, presmooth, myRoi, param_e, param_h, columnNum, corrAreaMetric, numFlips, &nullMax, &nullMin, flipSeed);
+    if (numFlips > 0)
+    {
+        for (int flip = 0; flip < numFlips; ++flip)
+        {
+            nullOut << nullMax[flip] << "\t" << nullMin[flip] << endl;
+        }
+        if (!nullOut) throw AlgorithmException("failed to write null distribution to text file");
+    }
+}
+
+namespace
+{
+    void signFlipTStat(const vector<const float*>& columns, const vector<char>& negated, const int& numNodes, double* meanScratch, double* varScratch, float* statOut)
+    {//two passes, mean then squared deviations, because the sum of squares minus n * mean^2 loses precision when the mean is large compared to the spread
+        int numSubjects = (int)columns.size();
+        for (int i = 0; i < numNodes; ++i) meanScratch[i] = 0.0;
+        for (int j = 0; j < numSubjects; ++j)
+        {
+            const float* columnData = columns[j];
+            if (negated[j])
+            {
+                for (int i = 0; i < numNodes; ++i) meanScratch[i] -= columnData[i];
+            } else {
+                for (int i = 0; i < numNodes; ++i) meanScratch[i] += columnData[i];
+            }
+        }
+        for (int i = 0; i < numNodes; ++i)
+        {
+            meanScratch[i] /= numSubjects;
+            varScratch[i] = 0.0;
+        }
+        for (int j = 0; j < numSubjects; ++j)
+        {
+            const float* columnData = columns[j];
+            double sign = (negated[j] ? -1.0 : 1.0);
+            for (int i = 0; i < numNodes; ++i)
+            {
+                double deviation = sign * columnData[i] - meanScratch[i];
+                varScratch[i] += deviation * deviation;
+            }
+        }
+        for (int i = 0; i < numNodes; ++i)
+        {
+            double variance = varScratch[i] / (numSubjects - 1);
+            if (variance > 0.0)
+            {
+                statOut[i] = (float)(meanScratch[i] / sqrt(variance / numSubjects));
+            } else {
+                statOut[i] = 0.0f;
+            }
+        }
+    }
 }
 
 AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, const float& presmooth,
-                                         const MetricFile* myRoi, const float& param_e, const float& param_h, const int& columnNum, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj)
+                                         const MetricFile* myRoi, const float& param_e, const float& param_h, const int& columnNum, const MetricFile* corrAreaMetric,
+                                         const int& numFlips, vector<float>* nullMaxOut, vector<float>* nullMinOut, const int& flipSeed) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (mySurf->getNumberOfNodes() != myMetric->getNumberOfNodes()) throw AlgorithmException("metric and surface have different number of vertices");
     if (myRoi != NULL && mySurf->getNumberOfNodes() != myRoi->getNumberOfNodes()) throw AlgorithmException("roi metric and surface have different number of vertices");
     if (corrAreaMetric != NULL && mySurf->getNumberOfNodes() != corrAreaMetric->getNumberOfNodes()) throw AlgorithmException("corrected area metric and surface have different number of vertices");
     if (columnNum < -1 || columnNum >= myMetric->getNumberOfColumns()) throw AlgorithmException("invalid column specified");
+    if (numFlips < 0) throw AlgorithmException("number of sign flips must not be negative");
+    if (numFlips > 0)
+    {
+        if (columnNum != -1) throw AlgorithmException("sign flipping can't be used on a single column");
+        if (myMetric->getNumberOfColumns() < 2) throw AlgorithmException("sign flipping requires at least 2 columns");
+    }
     const float* roiData = NULL, *areaData = NULL;
     vector<float> surfAreaData;
     if (corrAreaMetric == NULL)
@@ -147,6 +236,60 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         areaData = corrAreaMetric->getValuePointerForColumn(0);
     }
     if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(0);
+    CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();
+    if (numFlips > 0)
+    {
+        if (nullMaxOut == NULL || nullMinOut == NULL) throw AlgorithmException("sign flipping requires outputs for the null distribution");
+        const MetricFile* toUse = myMetric;
+        MetricFile postSmooth;
+        if (presmooth > 0.0f)
+        {
+            AlgorithmMetricSmoothing(NULL, mySurf, myMetric, presmooth, &postSmooth, myRoi, false, false, -1, corrAreaMetric);
+            toUse = &postSmooth;
+        }
+        int numNodes = mySurf->getNumberOfNodes();
+        int numCols = myMetric->getNumberOfColumns();
+        vector<const float*> columns(numCols);
+        for (int j = 0; j < numCols; ++j)
+        {
+            columns[j] = toUse->getValuePointerForColumn(j);
+        }
+        vector<float>& nullMax = *nullMaxOut, &nullMin = *nullMinOut;
+        nullMax.resize(numFlips);
+        nullMin.resize(numFlips);
+        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
+        myMetricOut->setStructure(mySurf->getStructure());
+        myMetricOut->setMapName(0, "TFCE of one-sample t-statistic");
+#pragma omp CARET_PAR
+        {
+            TFCEUnionFind workspace;
+            vector<double> meanScratch(numNodes), varScratch(numNodes);
+            vector<float> statData(numNodes), outcol(numNodes);
+            vector<char> negated(numCols, 0);
+#pragma omp CARET_SINGLE
+            {
+                signFlipTStat(columns, negated, numNodes, meanScratch.data(), varScratch.data(), statData.data());
+                processColumn(myHelper, statData.data(), outcol.data(), roiData, param_e, param_h, areaData, workspace);
+                myMetricOut->setValuesForColumn(0, outcol.data());
+            }//implicit barrier, so the other threads wait instead of starting on flips, but the unflipped statistic is only as much work as one flip
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int flip = 0; flip < numFlips; ++flip)
+            {
+                tfceSignFlips(flipSeed, flip, negated);
+                signFlipTStat(columns, negated, numNodes, meanScratch.data(), varScratch.data(), statData.data());
+                processColumn(myHelper, statData.data(), outcol.data(), roiData, param_e, param_h, areaData, workspace);
+                float maxVal = 0.0f, minVal = 0.0f;
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    if (outcol[i] > maxVal) maxVal = outcol[i];
+                    if (outcol[i] < minVal) minVal = outcol[i];
+                }
+                nullMax[flip] = maxVal;
+                nullMin[flip] = minVal;
+            }
+        }
+        return;
+    }
     if (columnNum == -1)
     {
         const MetricFile* toUse = myMetric;
@@ -161,11 +304,12 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         myMetricOut->setStructure(mySurf->getStructure());
 #pragma omp CARET_PAR
         {
+            TFCEUnionFind workspace;
             vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
 #pragma omp CARET_FOR
             for (int col = 0; col < numCols; ++col)
             {
-                processColumn(mySurf, toUse->getValuePointerForColumn(col), outcol.data(), roiData, param_e, param_h, areaData);
+                processColumn(myHelper, toUse->getValuePointerForColumn(col), outcol.data(), roiData, param_e, param_h, areaData, workspace);
                 myMetricOut->setValuesForColumn(col, outcol.data());
                 myMetricOut->setMapName(col, myMetric->getMapName(col));
             }
@@ -182,25 +326,21 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         }
         myMetricOut->setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
         myMetricOut->setStructure(mySurf->getStructure());
+        TFCEUnionFind workspace;
         vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
-        processColumn(mySurf, toUse->getValuePointerForColumn(useCol), outcol.data(), roiData, param_e, param_h, areaData);
+        processColumn(myHelper, toUse->getValuePointerForColumn(useCol), outcol.data(), roiData, param_e, param_h, areaData, workspace);
         myMetricOut->setValuesForColumn(0, outcol.data());
         myMetricOut->setMapName(0, myMetric->getMapName(columnNum));
     }
 }
 
-void AlgorithmMetricTFCE::processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
+void AlgorithmMetricTFCE::processColumn(const TopologyHelper* myHelper, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData,
+                                        TFCEUnionFind& workspace)
 {
-    int numNodes = mySurf->getNumberOfNodes();
+    int numNodes = myHelper->getNumberOfNodes();
     vector<double> accum(numNodes, 0.0);
-    CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();
-    tfce_pos(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData);
-    vector<float> negData(numNodes);
-    for (int i = 0; i < numNodes; ++i)
-    {
-        negData[i] = -colData[i];
-    }
-    tfce_pos(myHelper, negData.data(), accum.data(), roiData, param_e, param_h, areaData);//negatives and positives don't overlap, so reuse the accum array
+    tfce(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData, workspace, false);//positives
+    tfce(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData, workspace, true);//negatives - negatives and positives don't overlap, so reuse the accum array
     for (int i = 0; i < numNodes; ++i)
     {
         if (roiData == NULL || roiData[i] > 0.0f)
@@ -217,159 +357,32 @@ void AlgorithmMetricTFCE::processColumn(const SurfaceFile* mySurf, const float*
     }
 }
 
-namespace
-{//hidden namespace just to make sure things don't collide
-    struct Cluster
-    {
-        double accumVal, totalArea;
-        vector<int> members;
-        float lastVal;
-        bool first;
-        Cluster()
-        {
-            first = true;
-            accumVal = 0.0;
-            totalArea = 0.0;
-        }
-        void addMember(const int& node, const float& val, const float& area, const float& param_e, const float& param_h)
-        {
-            update(val, param_e, param_h);
-            members.push_back(node);
-            totalArea += area;
-        }
-        void update(const float& bottomVal, const float& param_e, const float& param_h)
-        {
-            if (first)
-            {
-                lastVal = bottomVal;
-                first = false;
-            } else {
-                if (bottomVal != lastVal)//skip computing if there is no difference
-                {
-                    CaretAssert(bottomVal < lastVal);
-                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
-                    double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
-                    accumVal += newSlice;
-                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
-                }
-            }
-        }
-    };
-    
-    int allocCluster(vector<Cluster>& clusterList, set<int>& deadClusters)
-    {
-        if (deadClusters.empty())
-        {
-            clusterList.push_back(Cluster());
-            return (int)(clusterList.size() - 1);
-        } else {
-            set<int>::iterator iter = deadClusters.begin();
-            int ret = *iter;
-            deadClusters.erase(iter);
-            clusterList[ret] = Cluster();//reinitialize
-            return ret;
-        }
-    }
-}
-
-void AlgorithmMetricTFCE::tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
+void AlgorithmMetricTFCE::tfce(const TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData,
+                               TFCEUnionFind& workspace, const bool& negate)
 {
     int numNodes = myHelper->getNumberOfNodes();
-    vector<int> membership(numNodes, -1);//int is enough as long as numNodes is fine as an int, for obvious reasons
-    vector<Cluster> clusterList;
-    set<int> deadClusters;//to allow reallocation without changing indices
-    CaretSimpleMaxHeap<int, float> nodeHeap;
+    workspace.reset(numNodes, param_e, param_h);
     for (int i = 0; i < numNodes; ++i)
     {
-        if ((roiData == NULL || roiData[i] > 0.0f) && colData[i] > 0.0f)
-        {
-            nodeHeap.push(i, colData[i]);
-        }
-    }
-    while (!nodeHeap.isEmpty())
-    {
-        float value;
-        int node = nodeHeap.pop(&value);
-        const vector<int32_t>& neighbors = myHelper->getNodeNeighbors(node);
-        int numNeigh = (int)neighbors.size();
-        set<int> touchingClusters;
-        for (int i = 0; i < numNeigh; ++i)
-        {
-            if (membership[neighbors[i]] != -1)
-            {
-                touchingClusters.insert(membership[neighbors[i]]);
-            }
-        }
-        int numTouching = (int)touchingClusters.size();
-        switch (numTouching)
+        if (roiData == NULL || roiData[i] > 0.0f)
         {
-            case 0://make new cluster
-            {
-                int newCluster = allocCluster(clusterList, deadClusters);
-                clusterList[newCluster].addMember(node, value, areaData[node], param_e, param_h);
-                membership[node] = newCluster;
-                break;
-            }
-            case 1://add to cluster
-            {
-                int whichCluster = *(touchingClusters.begin());
-                clusterList[whichCluster].addMember(node, value, areaData[node], param_e, param_h);
-                membership[node] = whichCluster;
-                accumData[node] -= clusterList[whichCluster].accumVal;//the accum value is the current amount less than the peak value that the edge of the cluster has (this node is on the edge)
-                break;//so, when the cluster merges or reaches 0, we add the accum value to every member and zero the accum value of the merged cluster, and we get the correct value in the end (with far fewer flops than integrating everywhere)
-            }
-            default://merge all touching clusters
+            float value = (negate ? -colData[i] : colData[i]);
+            if (value > 0.0f)
             {
-                int mergedIndex = -1, biggestSize = 0;//find the biggest cluster (in number of members) and use as merged cluster, for optimization purposes
-                for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if ((int)clusterList[*iter].members.size() > biggestSize)
-                    {
-                        mergedIndex = *iter;
-                        biggestSize = (int)clusterList[*iter].members.size();
-                    }
-                }
-                CaretAssertVectorIndex(clusterList, mergedIndex);
-                Cluster& mergedCluster = clusterList[mergedIndex];
-                mergedCluster.update(value, param_e, param_h);//recalculate to align cluster bottoms
-                for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if (*iter != mergedIndex)//if we are the largest cluster, don't modify the per-vertex accum for members, so merges between small and large clusters are cheap
-                    {
-                        Cluster& thisCluster = clusterList[*iter];
-                        thisCluster.update(value, param_e, param_h);//recalculate to align cluster bottoms
-                        int numMembers = (int)thisCluster.members.size();
-                        double correctionVal = thisCluster.accumVal - mergedCluster.accumVal;//fix the accum values in the side cluster so we can add the merged cluster's accum to everything at the end
-                        for (int j = 0; j < numMembers; ++j)//add the correction value to every member so that we have the current integrated values correct
-                        {
-                            accumData[thisCluster.members[j]] += correctionVal;//apply the correction
-                            membership[thisCluster.members[j]] = mergedIndex;//change the membership lookup
-                        }
-                        mergedCluster.members.insert(mergedCluster.members.end(), thisCluster.members.begin(), thisCluster.members.end());//copy all members
-                        mergedCluster.totalArea += thisCluster.totalArea;
-                        deadClusters.insert(*iter);//kill it
-                        vector<int>().swap(clusterList[*iter].members);//also try to deallocate member list
-                    }
-                }
-                mergedCluster.addMember(node, value, areaData[node], param_e, param_h);//will not trigger recomputation, we already recomputed at this value
-                accumData[node] -= mergedCluster.accumVal;//the vertex they merge on must not get the peak value of the cluster, obviously, so again, record its difference from peak
-                membership[node] = mergedIndex;
-                break;//NOTE: do not reset the accum value of the merged cluster, we specifically avoided modifying the per-vertex accum for its members, so the cluster accum is still in play
+                workspace.addCandidate(i, value);
             }
         }
     }
-    int listSize = (int)clusterList.size();//final cleanup of accum values
-    for (int i = 0; i < listSize; ++i)
+    const vector<pair<float, int64_t> >& order = workspace.sortCandidates();//highest first, the union-find integrates each cluster down to each new value as it is touched
+    int64_t numCandidates = (int64_t)order.size();
+    for (int64_t i = 0; i < numCandidates; ++i)
     {
-        if (deadClusters.find(i) != deadClusters.end()) continue;//ignore clusters that don't exist
-        Cluster& thisCluster = clusterList[i];
-        thisCluster.update(0.0f, param_e, param_h);//update to include the to-zero slice
-        int numMembers = (int)thisCluster.members.size();
-        for (int j = 0; j < numMembers; ++j)
-        {
-            accumData[thisCluster.members[j]] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
-        }
+        int node = (int)order[i].second;
+        int32_t numNeigh = 0;
+        const int32_t* neighbors = myHelper->getNodeNeighbors(node, numNeigh);
+        workspace.addElement(node, order[i].first, areaData[node], neighbors, numNeigh);
     }
+    workspace.finish(accumData);
 }
 
 float AlgorithmMetricTFCE::getAlgorithmInternalWeight()
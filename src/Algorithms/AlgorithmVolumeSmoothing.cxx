@@ -25,11 +25,185 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <vector>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    struct RecursiveGaussian
+    {//fourth order recursive gaussian (Deriche), as a causal and an anticausal filter whose outputs are summed, cost per sample doesn't depend on sigma
+        double m_n[4], m_m[5], m_d[5];//causal numerator, anticausal numerator (m_m[0] is unused), shared denominator (m_d[0] is always 1)
+        void init(const double& sigma)
+        {//sigma is in samples, the impulse response for x >= 0 is the sum of (A * cos(W * x / sigma) + B * sin(W * x / sigma)) * exp(L * x / sigma) over two sets of coefficients fit to a gaussian
+            const double A[2] = { 1.3530, -0.3531 }, B[2] = { 1.8151, 0.0902 }, W[2] = { 0.6681, 2.0787 }, L[2] = { -1.3932, -1.3732 };
+            complex<double> poles[4], resid[4];
+            for (int i = 0; i < 2; ++i)
+            {
+                poles[2 * i] = exp(complex<double>(L[i], W[i]) / sigma);
+                poles[2 * i + 1] = conj(poles[2 * i]);
+                resid[2 * i] = complex<double>(A[i], -B[i]) / 2.0;
+                resid[2 * i + 1] = conj(resid[2 * i]);
+            }
+            complex<double> denom[5] = { 1.0, 0.0, 0.0, 0.0, 0.0 }, numer[4] = { 0.0, 0.0, 0.0, 0.0 };
+            for (int p = 0; p < 4; ++p)
+            {//expand the product of (1 - pole * z^-1)
+                for (int k = p + 1; k > 0; --k)
+                {
+                    denom[k] -= poles[p] * denom[k - 1];
+                }
+            }
+            for (int p = 0; p < 4; ++p)
+            {//partial fractions back to a single numerator: sum of residue times the product of the other factors
+                complex<double> partial[4] = { 1.0, 0.0, 0.0, 0.0 };
+                int order = 0;
+                for (int o = 0; o < 4; ++o)
+                {
+                    if (o == p) continue;
+                    ++order;
+                    for (int k = order; k > 0; --k)
+                    {
+                        partial[k] -= poles[o] * partial[k - 1];
+                    }
+                }
+                for (int k = 0; k < 4; ++k)
+                {
+                    numer[k] += resid[p] * partial[k];
+                }
+            }
+            m_d[0] = 1.0;
+            for (int k = 1; k < 5; ++k) m_d[k] = denom[k].real();//conjugate pairs, so the imaginary parts cancel
+            for (int k = 0; k < 4; ++k) m_n[k] = numer[k].real();
+            m_m[0] = 0.0;
+            for (int k = 1; k < 4; ++k) m_m[k] = m_n[k] - m_d[k] * m_n[0];//mirror image of the causal response, without the center sample
+            m_m[4] = -m_d[4] * m_n[0];
+            double dsum = 0.0, total = 0.0;
+            for (int k = 0; k < 5; ++k) dsum += m_d[k];
+            for (int k = 0; k < 4; ++k) total += m_n[k];
+            for (int k = 1; k < 5; ++k) total += m_m[k];
+            double scale = dsum / total;//normalize to unit sum, not strictly needed since we divide by the smoothed weights
+            for (int k = 0; k < 4; ++k) m_n[k] *= scale;
+            for (int k = 1; k < 5; ++k) m_m[k] *= scale;
+        }
+    };
+    
+    //filters "width" interleaved lines from "in" to "out", sample m of line t is at [m * stride + t], everything outside the lines is treated as zero
+    //ring must hold 4 * width, zeroRow must hold width zeros
+    void recursiveFilterLines(const float* in, float* out, const int64_t& length, const int64_t& stride, const int64_t& width, const RecursiveGaussian& coefs,
+                              double* ring, const float* zeroRow)
+    {
+        const double* n = coefs.m_n, *mm = coefs.m_m, *d = coefs.m_d;
+        for (int64_t t = 0; t < 4 * width; ++t) ring[t] = 0.0;
+        for (int64_t m = 0; m < length; ++m)//causal, the ring row for m holds the output for m - 4 until it is overwritten
+        {
+            const float* x0 = in + m * stride;
+            const float* x1 = (m >= 1 ? x0 - stride : zeroRow);
+            const float* x2 = (m >= 2 ? x0 - 2 * stride : zeroRow);
+            const float* x3 = (m >= 3 ? x0 - 3 * stride : zeroRow);
+            double* y0 = ring + (m & 3) * width;
+            const double* y1 = ring + ((m - 1) & 3) * width;
+            const double* y2 = ring + ((m - 2) & 3) * width;
+            const double* y3 = ring + ((m - 3) & 3) * width;
+            float* outRow = out + m * stride;
+            for (int64_t t = 0; t < width; ++t)
+            {
+                double val = n[0] * x0[t] + n[1] * x1[t] + n[2] * x2[t] + n[3] * x3[t] - d[1] * y1[t] - d[2] * y2[t] - d[3] * y3[t] - d[4] * y0[t];
+                y0[t] = val;
+                outRow[t] = (float)val;
+            }
+        }
+        for (int64_t t = 0; t < 4 * width; ++t) ring[t] = 0.0;
+        for (int64_t m = length - 1; m >= 0; --m)//anticausal, same trick going backwards, added to the causal output
+        {
+            const float* x1 = (m + 1 < length ? in + (m + 1) * stride : zeroRow);
+            const float* x2 = (m + 2 < length ? in + (m + 2) * stride : zeroRow);
+            const float* x3 = (m + 3 < length ? in + (m + 3) * stride : zeroRow);
+            const float* x4 = (m + 4 < length ? in + (m + 4) * stride : zeroRow);
+            double* y0 = ring + (m & 3) * width;
+            const double* y1 = ring + ((m + 1) & 3) * width;
+            const double* y2 = ring + ((m + 2) & 3) * width;
+            const double* y3 = ring + ((m + 3) & 3) * width;
+            float* outRow = out + m * stride;
+            for (int64_t t = 0; t < width; ++t)
+            {
+                double val = mm[1] * x1[t] + mm[2] * x2[t] + mm[3] * x3[t] + mm[4] * x4[t] - d[1] * y1[t] - d[2] * y2[t] - d[3] * y3[t] - d[4] * y0[t];
+                y0[t] = val;
+                outRow[t] += (float)val;
+            }
+        }
+    }
+    
+    //same normalized convolution as the direct method: smooth the masked data and the mask, then divide
+    //the result is in outFrame, the other three arrays are scratch space of the frame size
+    void smoothFrameRecursive(const float* inFrame, const vector<int64_t>& myDims, const float* roiFrame, const RecursiveGaussian coefs[3], const float& minWeight, const bool& fixZeros,
+                              float* outFrame, float* scratchFrame, float* scratchWeights, float* scratchWeights2)
+    {
+        const int64_t rowSize = myDims[0], planeSize = myDims[0] * myDims[1];
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)
+        {
+            for (int64_t index = k * planeSize; index < (k + 1) * planeSize; ++index)
+            {
+                if ((roiFrame == NULL || roiFrame[index] > 0.0f) && (!fixZeros || inFrame[index] != 0.0f))
+                {
+                    outFrame[index] = inFrame[index];
+                    scratchWeights[index] = 1.0f;
+                } else {
+                    outFrame[index] = 0.0f;
+                    scratchWeights[index] = 0.0f;
+                }
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)//smooth along i axis, one line at a time
+        {
+            double ring[4];
+            float zeroRow[1] = { 0.0f };
+            for (int j = 0; j < myDims[1]; ++j)
+            {
+                int64_t base = k * planeSize + j * rowSize;
+                recursiveFilterLines(outFrame + base, scratchFrame + base, myDims[0], 1, 1, coefs[0], ring, zeroRow);
+                recursiveFilterLines(scratchWeights + base, scratchWeights2 + base, myDims[0], 1, 1, coefs[0], ring, zeroRow);
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)//now j, filtering all rows of a plane together so the inner loop is along i
+        {
+            vector<double> ring(4 * rowSize);
+            vector<float> zeroRow(rowSize, 0.0f);
+            int64_t base = k * planeSize;
+            recursiveFilterLines(scratchFrame + base, outFrame + base, myDims[1], rowSize, rowSize, coefs[1], ring.data(), zeroRow.data());
+            recursiveFilterLines(scratchWeights2 + base, scratchWeights + base, myDims[1], rowSize, rowSize, coefs[1], ring.data(), zeroRow.data());
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int j = 0; j < myDims[1]; ++j)//and finally k
+        {
+            vector<double> ring(4 * rowSize);
+            vector<float> zeroRow(rowSize, 0.0f);
+            int64_t base = j * rowSize;
+            recursiveFilterLines(outFrame + base, scratchFrame + base, myDims[2], planeSize, rowSize, coefs[2], ring.data(), zeroRow.data());
+            recursiveFilterLines(scratchWeights + base, scratchWeights2 + base, myDims[2], planeSize, rowSize, coefs[2], ring.data(), zeroRow.data());
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)
+        {
+            for (int64_t index = k * planeSize; index < (k + 1) * planeSize; ++index)
+            {
+                if ((roiFrame == NULL || roiFrame[index] > 0.0f) && scratchWeights2[index] >= minWeight)
+                {
+                    outFrame[index] = scratchFrame[index] / scratchWeights2[index];
+                } else {
+                    outFrame[index] = 0.0f;
+                }
+            }
+        }
+    }
+}
+
 //makes the program issue warning only once per launch, prevents repeated calls by other algorithms from spamming
 bool AlgorithmVolumeSmoothing::haveWarned = false;
 
@@ -60,13 +234,19 @@ OperationParameters* AlgorithmVolumeSmoothing::getParameters()
     OptionalParameter* subvolSelect = ret->createOptionalParameter(6, "-subvolume", "select a single subvolume to smooth");
     subvolSelect->addStringParameter(1, "subvol", "the subvolume number or name");
     
+    OptionalParameter* methodSelect = ret->createOptionalParameter(7, "-method", "select how to compute the smoothing, default DIRECT");
+    methodSelect->addStringParameter(1, "method", "DIRECT or RECURSIVE");
+    
     ret->setHelpText(
         AString("Gaussian smoothing for volumes.  By default, smooths all subvolumes with no ROI, if ROI is given, only ") +
         "positive voxels in the ROI volume have their values used, and all other voxels are set to zero.  Smoothing a non-orthogonal volume will " +
         "be significantly slower, because the operation cannot be separated into 1-dimensional smoothings without distorting the kernel shape.\n\n" +
         "The -fix-zeros option causes the smoothing to not use an input value if it is zero, but still write a smoothed value to the voxel.  " +
         "This is useful for zeros that indicate lack of information, preventing them from pulling down the intensity of nearby voxels, while " +
-        "giving the zero an extrapolated value."
+        "giving the zero an extrapolated value.\n\n" +
+        "The DIRECT method convolves with the gaussian kernel truncated at 3 sigma, so it takes longer as the kernel gets larger.  " +
+        "The RECURSIVE method uses a recursive filter that approximates the gaussian and takes the same time for any kernel size, it requires an orthogonal volume.  " +
+        "Its results differ slightly from DIRECT, mostly because the kernel is not truncated, the difference is smallest when the kernel is at least 2 voxels along every axis."
     );
     return ret;
 }
@@ -94,10 +274,25 @@ void AlgorithmVolumeSmoothing::useParameters(OperationParameters* myParams, Prog
             throw AlgorithmException("invalid subvolume specified");
         }
     }
-    AlgorithmVolumeSmoothing(myProgObj, myVol, myKernel, myOutVol, roiVol, fixZeros, subvolNum);
+    Method myMethod = DIRECT;
+    OptionalParameter* methodSelect = myParams->getOptionalParameter(7);
+    if (methodSelect->m_present)
+    {
+        AString methodName = methodSelect->getString(1);
+        if (methodName == "DIRECT")
+        {
+            myMethod = DIRECT;
+        } else if (methodName == "RECURSIVE") {
+            myMethod = RECURSIVE;
+        } else {
+            throw AlgorithmException("unknown smoothing method name");
+        }
+    }
+    AlgorithmVolumeSmoothing(myProgObj, myVol, myKernel, myOutVol, roiVol, fixZeros, subvolNum, myMethod);
 }
 
-AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros, const int& subvol) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros,
+                                                   const int& subvol, const Method& method) : AbstractAlgorithm(myProgObj)
 {
     CaretAssert(inVol != NULL);
     CaretAssert(outVol != NULL);
@@ -116,7 +311,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     {
         throw AlgorithmException("kernel too small");
     }
-    CaretArray<float> scratchFrame(myDims[0] * myDims[1] * myDims[2]);//it could be faster to preinitialize with zeros, then generate a usable voxels list if there is a small ROI...
+    int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
     float kernBox = kernel * 3.0f;
     vector<vector<float> > volSpace = inVol->getSform();
     Vector3D ivec, jvec, kvec, origin, ijorth, jkorth, kiorth;
@@ -124,14 +319,77 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     ivec[1] = volSpace[1][0]; jvec[1] = volSpace[1][1]; kvec[1] = volSpace[1][2]; origin[1] = volSpace[1][3];
     ivec[2] = volSpace[2][0]; jvec[2] = volSpace[2][1]; kvec[2] = volSpace[2][2]; origin[2] = volSpace[2][3];
     const float ORTH_TOLERANCE = 0.001f;//tolerate this much deviation from orthogonal (dot product divided by product of lengths) to use orthogonal assumptions to smooth
-    if (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE)
-    {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
-        CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights(myDims[0] * myDims[1] * myDims[2]), scratchWeights2(myDims[0] * myDims[1] * myDims[2]), scratchFrame3;
+    bool isOrthogonal = (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE);
+    float ispace = ivec.length(), jspace = jvec.length(), kspace = kvec.length();
+    float minSigma = min(kernel / ispace, min(kernel / jspace, kernel / kspace));//kernel sigma in voxels along the shortest axis
+    bool useRecursive = false;
+    switch (method)
+    {
+        case DIRECT:
+            break;
+        case RECURSIVE:
+            if (!isOrthogonal) throw AlgorithmException("the RECURSIVE method requires an orthogonal volume");
+            if (minSigma < 0.5f) throw AlgorithmException("the RECURSIVE method requires a kernel of at least half the voxel spacing");
+            useRecursive = true;
+            break;
+    }
+    int numFrames;//do all frame bookkeeping first, so that the frames can be smoothed in parallel
+    if (subvol == -1)
+    {
+        vector<int64_t> origDims = inVol->getOriginalDimensions();
+        outVol->reinitialize(origDims, volSpace, myDims[4]);
+        for (int s = 0; s < myDims[3]; ++s)
+        {
+            outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
+        }
+        numFrames = (int)(myDims[3] * myDims[4]);
+    } else {
+        vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
+        newDims.resize(3);
+        newDims[0] = origDims[0];
+        newDims[1] = origDims[1];
+        newDims[2] = origDims[2];
+        outVol->reinitialize(newDims, volSpace, myDims[4]);
+        outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
+        numFrames = (int)myDims[4];
+    }
+    bool parallelFrames = false;//with enough frames, give each thread whole frames, otherwise let the threads split up each frame
+#ifdef CARET_OMP
+    parallelFrames = (numFrames >= omp_get_max_threads());
+#endif
+    if (useRecursive)
+    {
+        RecursiveGaussian coefs[3];
+        coefs[0].init(kernel / ispace);
+        coefs[1].init(kernel / jspace);
+        coefs[2].init(kernel / kspace);
+        float minWeight = 0.5f;//the smoothed mask never reaches exactly zero, so set zero where the direct method's kernel box would have found no data
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float spacing = (axis == 0 ? ispace : (axis == 1 ? jspace : kspace));
+            minWeight *= exp(-4.5f) * spacing / (kernel * sqrt(2.0f * 3.14159265f));//normalized kernel value at 3 sigma
+        }
+        const float* roiFrame = NULL;
         if (roiVol != NULL)
         {
-            scratchFrame3 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
+            roiFrame = roiVol->getFrame();
+        }
+#pragma omp CARET_PAR if(parallelFrames)
+        {
+            vector<float> outFrame(frameSize), scratchFrame(frameSize), scratchWeights(frameSize), scratchWeights2(frameSize);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int f = 0; f < numFrames; ++f)
+            {
+                int c = (int)(f % myDims[4]);
+                int inBrick = (subvol == -1 ? (int)(f / myDims[4]) : subvol), outBrick = (subvol == -1 ? inBrick : 0);
+                smoothFrameRecursive(inVol->getFrame(inBrick, c), myDims, roiFrame, coefs, minWeight, fixZeros, outFrame.data(), scratchFrame.data(), scratchWeights.data(), scratchWeights2.data());
+#pragma omp critical
+                {
+                    outVol->setFrame(outFrame.data(), outBrick, c);//setFrame also clears cached statistics
+                }
+            }
         }
-        float ispace = ivec.length(), jspace = jvec.length(), kspace = kvec.length();
+    } else if (isOrthogonal) {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
         int irange = (int)floor(kernBox / ispace);
         int jrange = (int)floor(kernBox / jspace);
         int krange = (int)floor(kernBox / kspace);
@@ -157,45 +415,34 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
             float tempf = kspace * (k - krange) / kernel;
             kweights[k] = exp(-tempf * tempf / 2.0f);
         }
-        if (subvol == -1)
+        vector<int> lists[3];
+        if (roiVol != NULL)
         {
-            vector<int64_t> origDims = inVol->getOriginalDimensions();
-            outVol->reinitialize(origDims, volSpace, myDims[4]);
-            vector<int> lists[3];
-            for (int s = 0; s < myDims[3]; ++s)
-            {
-                outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    const float* inFrame = inVol->getFrame(s, c);
-                    if (roiVol == NULL)
-                    {
-                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    } else {
-                        smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    }
-                    outVol->setFrame(scratchFrame, s, c);
-                }
+            buildROILists(myDims, inVol, roiVol, irange, jrange, lists);
+        }
+#pragma omp CARET_PAR if(parallelFrames)
+        {
+            CaretArray<float> scratchFrame(frameSize, 0.0f), scratchFrame2(frameSize, 0.0f), scratchWeights(frameSize, 0.0f), scratchWeights2(frameSize, 0.0f), scratchFrame3;
+            if (roiVol != NULL)
+            {//the ROI lists only visit voxels that can get data, so everything else must start as zero
+                scratchFrame3 = CaretArray<float>(frameSize, 0.0f);
             }
-        } else {
-            vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
-            newDims.resize(3);
-            newDims[0] = origDims[0];
-            newDims[1] = origDims[1];
-            newDims[2] = origDims[2];
-            outVol->reinitialize(newDims, volSpace, myDims[4]);
-            vector<int> lists[3];
-            outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
-            for (int c = 0; c < myDims[4]; ++c)
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int f = 0; f < numFrames; ++f)
             {
-                const float* inFrame = inVol->getFrame(subvol, c);
+                int c = (int)(f % myDims[4]);
+                int inBrick = (subvol == -1 ? (int)(f / myDims[4]) : subvol), outBrick = (subvol == -1 ? inBrick : 0);
+                const float* inFrame = inVol->getFrame(inBrick, c);
                 if (roiVol == NULL)
                 {
                     smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 } else {
                     smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 }
-                outVol->setFrame(scratchFrame, 0, c);
+#pragma omp critical
+                {
+                    outVol->setFrame(scratchFrame, outBrick, c);
+                }
             }
         }
     } else {
@@ -241,34 +488,20 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                 }
             }
         }
-        if (subvol == -1)
+#pragma omp CARET_PAR if(parallelFrames)
         {
-            vector<int64_t> origDims = inVol->getOriginalDimensions();
-            outVol->reinitialize(origDims, volSpace, myDims[4]);
-            for (int s = 0; s < myDims[3]; ++s)
+            CaretArray<float> scratchFrame(frameSize);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int f = 0; f < numFrames; ++f)
             {
-                outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
-                for (int c = 0; c < myDims[4]; ++c)
+                int c = (int)(f % myDims[4]);
+                int inBrick = (subvol == -1 ? (int)(f / myDims[4]) : subvol), outBrick = (subvol == -1 ? inBrick : 0);
+                smoothFrameNonOrth(inVol->getFrame(inBrick, c), myDims, scratchFrame, inVol, roiVol, weights, irange, jrange, krange, fixZeros);
+#pragma omp critical
                 {
-                    const float* inFrame = inVol->getFrame(s, c);
-                    smoothFrameNonOrth(inFrame, myDims, scratchFrame, inVol, roiVol, weights, irange, jrange, krange, fixZeros);
-                    outVol->setFrame(scratchFrame, s, c);
+                    outVol->setFrame(scratchFrame, outBrick, c);
                 }
             }
-        } else {
-            vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
-            newDims.resize(3);
-            newDims[0] = origDims[0];
-            newDims[1] = origDims[1];
-            newDims[2] = origDims[2];
-            outVol->reinitialize(newDims, volSpace, myDims[4]);
-            outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
-            for (int c = 0; c < myDims[4]; ++c)
-            {
-                const float* inFrame = inVol->getFrame(subvol, c);
-                smoothFrameNonOrth(inFrame, myDims, scratchFrame, inVol, roiVol, weights, irange, jrange, krange, fixZeros);
-                outVol->setFrame(scratchFrame, 0, c);
-            }
         }
     }
 }
@@ -361,222 +594,167 @@ void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t>
     }
 }
 
-void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchFrame3,
-                                              CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, vector<int> lists[3],
-                                              const VolumeFile* inVol, const VolumeFile* roiVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
-                                              int irange, int jrange, int krange, const bool& fixZeros)
-{//optimized for orthogonal, plus lists of voxels for ROI smoothing
-    if (lists[0].size() == 0)
-    {//this is our first time into this function, we must populate the lists
-        const float* roiFrame = roiVol->getFrame();
-        CaretArray<int> markROI(myDims[0] * myDims[1] * myDims[2], 0);//need a temporary array to sort out ROI zeros from -fix-zeros zeros
+void AlgorithmVolumeSmoothing::buildROILists(const vector<int64_t>& myDims, const VolumeFile* inVol, const VolumeFile* roiVol, const int& irange, const int& jrange, vector<int> lists[3])
+{//find the voxels each pass of smoothFrameROI needs to visit, only marks in parallel, then collects the lists in order so no locking is needed
+    const float* roiFrame = roiVol->getFrame();
+    CaretArray<int> markROI(myDims[0] * myDims[1] * myDims[2], 0);//bitwise so i can track all 3 lists separately in one array
 #pragma omp CARET_PARFOR
-        for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
+    for (int k = 0; k < myDims[2]; ++k)
+    {
+        for (int j = 0; j < myDims[1]; ++j)
         {
-            for (int j = 0; j < myDims[1]; ++j)
+            int64_t baseInd = inVol->getIndex(0, j, k, 0);
+            for (int i = 0; i < myDims[0]; ++i)//keep voxels whose i-kernel intersects the ROI
             {
-                for (int i = 0; i < myDims[0]; ++i)//don't test whether intermediate voxel is insode ROI, or we lose some data
+                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
+                if (imin < 0) imin = 0;
+                if (imax > myDims[0]) imax = myDims[0];
+                for (int ikern = imin; ikern < imax; ++ikern)
                 {
-                    int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                    if (imin < 0) imin = 0;
-                    if (imax > myDims[0]) imax = myDims[0];
-                    float sum = 0.0f, weightsum = 0.0f;
-                    int64_t baseInd = inVol->getIndex(0, j, k, 0);
-                    int64_t curInd = baseInd + i;
-                    bool used = false;
-                    for (int ikern = imin; ikern < imax; ++ikern)
+                    if (roiFrame[baseInd + ikern] > 0.0f)
                     {
-                        int64_t thisIndex = baseInd + ikern;
-                        if (roiFrame[thisIndex] > 0.0f)//only test source and final voxels for being in ROI
-                        {
-                            if (!used)//keep a list of voxels whose i-kernel intersects the ROI
-                            {
-                                used = true;
-                                markROI[curInd] = 1;
-#pragma omp critical
-                                {
-                                    lists[0].push_back(i);
-                                    lists[0].push_back(j);
-                                    lists[0].push_back(k);
-                                }
-                            }
-                            if (!fixZeros || inFrame[thisIndex] != 0.0f)
-                            {
-                                float weight = iweights[ikern - i + irange];
-                                weightsum += weight;
-                                sum += weight * inFrame[thisIndex];
-                            }
-                        }
+                        markROI[baseInd + i] = 1;
+                        break;
                     }
-                    scratchWeights[curInd] = weightsum;
-                    scratchFrame3[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
                 }
             }
         }
+    }
 #pragma omp CARET_PARFOR
-        for (int k = 0; k < myDims[2]; ++k)//now j
+    for (int k = 0; k < myDims[2]; ++k)//j-kernels stay within a k plane, so threads never touch each other's marks
+    {
+        for (int i = 0; i < myDims[0]; ++i)
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            int64_t baseInd = inVol->getIndex(i, 0, k);
+            for (int j = 0; j < myDims[1]; ++j)//skip voxels whose j-kernels only touch i-kernel results that are always 0/0
             {
-                for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
+                int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
+                if (jmin < 0) jmin = 0;
+                if (jmax > myDims[1]) jmax = myDims[1];
+                for (int jkern = jmin; jkern < jmax; ++jkern)
                 {
-                    int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-                    if (jmin < 0) jmin = 0;
-                    if (jmax > myDims[1]) jmax = myDims[1];
-                    float sum = 0.0f, weightsum = 0.0f;
-                    int64_t baseInd = inVol->getIndex(i, 0, k);
-                    int64_t curInd = baseInd + j * myDims[0];
-                    bool used = false;
-                    for (int jkern = jmin; jkern < jmax; ++jkern)
+                    if ((markROI[baseInd + jkern * myDims[0]] & 1) == 1)
                     {
-                        int64_t thisIndex = baseInd + jkern * myDims[0];//DO NOT test for this source voxel being outside ROI, or you will skip good data
-                        if ((markROI[thisIndex] & 1) == 1)
-                        {//skip voxels whose i-kernels don't touch the ROI, they will always have 0/0
-                            if (!used)
-                            {
-                                used = true;
-                                markROI[curInd] |= 2;//bitwise so i can track all 3 lists separately in one array
-#pragma omp critical
-                                {
-                                    lists[1].push_back(i);
-                                    lists[1].push_back(j);
-                                    lists[1].push_back(k);
-                                }
-                            }
-                            float weight = jweights[jkern - j + jrange];
-                            weightsum += weight * scratchWeights[thisIndex];
-                            sum += weight * scratchFrame3[thisIndex];
-                        }
+                        markROI[baseInd + j * myDims[0]] |= 2;
+                        break;
                     }
-                    scratchWeights2[curInd] = weightsum;
-                    scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
                 }
             }
         }
-#pragma omp CARET_PARFOR
-        for (int j = 0; j < myDims[1]; ++j)//and finally k
+    }
+    for (int k = 0; k < myDims[2]; ++k)
+    {
+        for (int j = 0; j < myDims[1]; ++j)
         {
             for (int i = 0; i < myDims[0]; ++i)
             {
-                for (int k = 0; k < myDims[2]; ++k)//ditto
+                int64_t curInd = inVol->getIndex(i, j, k);
+                if ((markROI[curInd] & 1) != 0)
                 {
-                    int64_t baseInd = inVol->getIndex(i, j, 0);
-                    int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                    if (roiFrame[curInd] > 0.0f)
-                    {
-#pragma omp critical
-                        {
-                            lists[2].push_back(i);//third list is a little different, since we don't output stuff outside the ROI, we can drop the voxels that "grew" from the ROI
-                            lists[2].push_back(j);//we do need to calculate those grown voxels, though, since we use some of them within the k-kernel
-                            lists[2].push_back(k);
-                        }
-                        int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                        if (kmin < 0) kmin = 0;
-                        if (kmax > myDims[2]) kmax = myDims[2];
-                        float sum = 0.0f, weightsum = 0.0f;
-                        for (int kkern = kmin; kkern < kmax; ++kkern)
-                        {
-                            int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];//ditto
-                            float weight = kweights[kkern - k + krange];
-                            weightsum += weight * scratchWeights2[thisIndex];
-                            sum += weight * scratchFrame2[thisIndex];
-                        }
-                        if (weightsum != 0.0f)
-                        {
-                            scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                        } else {
-                            scratchFrame[curInd] = 0.0f;
-                        }
-                    } else {
-                        scratchFrame[curInd] = 0.0f;
-                    }
+                    lists[0].push_back(i);
+                    lists[0].push_back(j);
+                    lists[0].push_back(k);
                 }
-            }
-        }
-        if (lists[0].size() == 0)
-        {
-            lists[0].push_back(-1);//to keep it from scanning the ROI again when the ROI has no voxels, slightly hacky
-        }
-    } else {//lists already made, use them
-        const float* roiFrame = roiVol->getFrame();
-        int64_t ibasesize = (int64_t)lists[0].size();
-        if (ibasesize < 3) return;//handle the case of empty ROI here (ibasesize will be 1)
-        int64_t jbasesize = (int64_t)lists[1].size();
-        int64_t kbasesize = (int64_t)lists[2].size();
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int ibase = 0; ibase < ibasesize; ibase += 3)
-        {
-            int i = lists[0][ibase];
-            int j = lists[0][ibase + 1];
-            int k = lists[0][ibase + 2];
-            int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-            if (imin < 0) imin = 0;
-            if (imax > myDims[0]) imax = myDims[0];
-            float sum = 0.0f, weightsum = 0.0f;
-            int64_t baseInd = inVol->getIndex(0, j, k, 0);
-            int64_t curInd = baseInd + i;
-            for (int ikern = imin; ikern < imax; ++ikern)
-            {
-                int64_t thisIndex = baseInd + ikern;
-                if (roiFrame[thisIndex] > 0.0f && (!fixZeros || inFrame[thisIndex] != 0.0f))
+                if ((markROI[curInd] & 2) != 0)
                 {
-                    float weight = iweights[ikern - i + irange];
-                    weightsum += weight;
-                    sum += weight * inFrame[thisIndex];
+                    lists[1].push_back(i);
+                    lists[1].push_back(j);
+                    lists[1].push_back(k);
+                }
+                if (roiFrame[curInd] > 0.0f)
+                {
+                    lists[2].push_back(i);//third list is a little different, since we don't output stuff outside the ROI, we can drop the voxels that "grew" from the ROI
+                    lists[2].push_back(j);//we do need to calculate those grown voxels, though, since we use some of them within the k-kernel
+                    lists[2].push_back(k);
                 }
             }
-            scratchWeights[curInd] = weightsum;
-            scratchFrame3[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
         }
+    }
+}
+
+void AlgorithmVolumeSmoothing::smoothFrameROI(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchFrame3,
+                                              CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, const vector<int> lists[3],
+                                              const VolumeFile* inVol, const VolumeFile* roiVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
+                                              int irange, int jrange, int krange, const bool& fixZeros)
+{//optimized for orthogonal, plus lists of voxels for ROI smoothing, the scratch arrays must start zeroed
+    const float* roiFrame = roiVol->getFrame();
+    int64_t ibasesize = (int64_t)lists[0].size();
+    if (ibasesize == 0) return;//empty ROI, output stays zero
+    int64_t jbasesize = (int64_t)lists[1].size();
+    int64_t kbasesize = (int64_t)lists[2].size();
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int jbase = 0; jbase < jbasesize; jbase += 3)
-        {
-            int i = lists[1][jbase];
-            int j = lists[1][jbase + 1];
-            int k = lists[1][jbase + 2];
-            int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-            if (jmin < 0) jmin = 0;
-            if (jmax > myDims[1]) jmax = myDims[1];
-            float sum = 0.0f, weightsum = 0.0f;
-            int64_t baseInd = inVol->getIndex(i, 0, k);
-            int64_t curInd = baseInd + j * myDims[0];
-            for (int jkern = jmin; jkern < jmax; ++jkern)
+    for (int ibase = 0; ibase < ibasesize; ibase += 3)
+    {
+        int i = lists[0][ibase];
+        int j = lists[0][ibase + 1];
+        int k = lists[0][ibase + 2];
+        int imin = i - irange, imax = i + irange + 1;//one-after array size convention
+        if (imin < 0) imin = 0;
+        if (imax > myDims[0]) imax = myDims[0];
+        float sum = 0.0f, weightsum = 0.0f;
+        int64_t baseInd = inVol->getIndex(0, j, k, 0);
+        int64_t curInd = baseInd + i;
+        for (int ikern = imin; ikern < imax; ++ikern)
+        {
+            int64_t thisIndex = baseInd + ikern;
+            if (roiFrame[thisIndex] > 0.0f && (!fixZeros || inFrame[thisIndex] != 0.0f))
             {
-                int64_t thisIndex = baseInd + jkern * myDims[0];//DO NOT test for this source voxel having zero data, or it will skip good data
-                float weight = jweights[jkern - j + jrange];
-                weightsum += weight * scratchWeights[thisIndex];
-                sum += weight * scratchFrame3[thisIndex];
+                float weight = iweights[ikern - i + irange];
+                weightsum += weight;
+                sum += weight * inFrame[thisIndex];
             }
-            scratchWeights2[curInd] = weightsum;
-            scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
         }
+        scratchWeights[curInd] = weightsum;
+        scratchFrame3[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
+    }
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int kbase = 0; kbase < kbasesize; kbase += 3)
-        {
-            int i = lists[2][kbase];
-            int j = lists[2][kbase + 1];
-            int k = lists[2][kbase + 2];
-            int64_t baseInd = inVol->getIndex(i, j, 0);
-            int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-            int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-            if (kmin < 0) kmin = 0;
-            if (kmax > myDims[2]) kmax = myDims[2];
-            float sum = 0.0f, weightsum = 0.0f;
-            for (int kkern = kmin; kkern < kmax; ++kkern)
-            {
-                int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];//ditto
-                float weight = kweights[kkern - k + krange];
-                weightsum += weight * scratchWeights2[thisIndex];
-                sum += weight * scratchFrame2[thisIndex];
-            }
-            if (weightsum != 0.0f)
-            {
-                scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-            } else {
-                scratchFrame[curInd] = 0.0f;
-            }
-        }//the frame should be zeroed outside the ROI already due to the first time through
+    for (int jbase = 0; jbase < jbasesize; jbase += 3)
+    {
+        int i = lists[1][jbase];
+        int j = lists[1][jbase + 1];
+        int k = lists[1][jbase + 2];
+        int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
+        if (jmin < 0) jmin = 0;
+        if (jmax > myDims[1]) jmax = myDims[1];
+        float sum = 0.0f, weightsum = 0.0f;
+        int64_t baseInd = inVol->getIndex(i, 0, k);
+        int64_t curInd = baseInd + j * myDims[0];
+        for (int jkern = jmin; jkern < jmax; ++jkern)
+        {
+            int64_t thisIndex = baseInd + jkern * myDims[0];//DO NOT test for this source voxel having zero data, or it will skip good data
+            float weight = jweights[jkern - j + jrange];
+            weightsum += weight * scratchWeights[thisIndex];
+            sum += weight * scratchFrame3[thisIndex];
+        }
+        scratchWeights2[curInd] = weightsum;
+        scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
     }
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int kbase = 0; kbase < kbasesize; kbase += 3)
+    {
+        int i = lists[2][kbase];
+        int j = lists[2][kbase + 1];
+        int k = lists[2][kbase + 2];
+        int64_t baseInd = inVol->getIndex(i, j, 0);
+        int64_t curInd = baseInd + k * myDims[0] * myDims[1];
+        int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
+        if (kmin < 0) kmin = 0;
+        if (kmax > myDims[2]) kmax = myDims[2];
+        float sum = 0.0f, weightsum = 0.0f;
+        for (int kkern = kmin; kkern < kmax; ++kkern)
+        {
+            int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];//ditto
+            float weight = kweights[kkern - k + krange];
+            weightsum += weight * scratchWeights2[thisIndex];
+            sum += weight * scratchFrame2[thisIndex];
+        }
+        if (weightsum != 0.0f)
+        {
+            scratchFrame[curInd] = sum / weightsum;//NOW we can divide
+        } else {
+            scratchFrame[curInd] = 0.0f;
+        }
+    }//the frame is zeroed outside the ROI when the scratch arrays are allocated
 }
 
 void AlgorithmVolumeSmoothing::smoothFrameNonOrth(const float* inFrame, const vector<int64_t>& myDims, CaretArray<float>& scratchFrame, const VolumeFile* inVol, const VolumeFile* roiVol, const CaretArray<float**>& weights, const int& irange, const int& jrange, const int& krange, const bool& fixZeros)
@@ -23,13 +23,12 @@
 
 #include "AlgorithmVolumeSmoothing.h"
 #include "CaretAssert.h"
-#include "CaretHeap.h"
 #include "CaretOMP.h"
+#include "TFCEUnionFind.h"
 #include "VolumeFile.h"
-#include "VoxelIJK.h"
 
 #include <cmath>
-#include <set>
+#include <fstream>
 #include <vector>
 
 using namespace caret;
@@ -66,12 +65,21 @@ OperationParameters* AlgorithmVolumeTFCE::getParameters()
     OptionalParameter* subvolSelect = ret->createOptionalParameter(6, "-subvolume", "select a single subvolume");
     subvolSelect->addStringParameter(1, "subvolume", "the subvolume number or name");
     
+    OptionalParameter* signFlipOpt = ret->createOptionalParameter(7, "-sign-flip-null", "do a one-sample test across subvolumes, and generate its null distribution by random sign flipping");
+    signFlipOpt->addIntegerParameter(1, "num-flips", "the number of random sign flips to do");
+    signFlipOpt->addStringParameter(2, "null-out", "output - text file for the maximum and minimum TFCE value of each sign flip");//fake the output formatting
+    OptionalParameter* seedOpt = signFlipOpt->createOptionalParameter(3, "-seed", "set the random seed");
+    seedOpt->addIntegerParameter(1, "seed", "the seed (default 0)");
+    
     ret->setHelpText(
         AString("Threshold-free cluster enhancement is a method to increase the relative value of regions that would form clusters in a standard thresholding test.  ") +
         "This is accomplished by evaluating the integral of:\n\n" +
         "e(h, p)^E * h^H * dh\n\n" +
         "at each vertex p, where h ranges from 0 to the maximum value in the data, and e(h, p) is the extent of the cluster containing vertex p at threshold h.  " +
         "Negative values are similarly enhanced by negating the data, running the same process, and negating the result.\n\n" +
+        "When -sign-flip-null is specified, the subvolumes of the input are treated as subjects, and the output is a single subvolume containing the TFCE of the one-sample t-statistic across them.  " +
+        "For each sign flip, a random subset of the subvolumes is negated, the t-statistic is recomputed and TFCE is run on it, and the maximum and minimum values are written as one line of the text file.  " +
+        "Using the same seed with the same input reproduces the null distribution exactly, regardless of how many threads are used.\n\n" +
         "This method is explained in: Smith SM, Nichols TE., \"Threshold-free cluster enhancement: addressing problems of smoothing, threshold dependence and localisation in cluster inference.\" Neuroimage. 2009 Jan 1;44(1):83-98. PMID: 18501637"
     );
     return ret;
@@ -111,11 +119,85 @@ void AlgorithmVolumeTFCE::useParameters(OperationParameters* myParams, ProgressO
             throw AlgorithmException("invalid subvolume specified");
         }
     }
-    AlgorithmVolumeTFCE(myProgObj, myVol, myVolOut, presmooth, myRoi, param_e, param_h, subvolNum);
+    int numFlips = 0, flipSeed = 0;
+    AString nullTextName;
+    OptionalParameter* signFlipOpt = myParams->getOptionalParameter(7);
+    if (signFlipOpt->m_present)
+    {
+        numFlips = (int)signFlipOpt->getInteger(1);
+        if (numFlips < 1) throw AlgorithmException("number of sign flips must be positive");
+        nullTextName = signFlipOpt->getString(2);
+        OptionalParameter* seedOpt = signFlipOpt->getOptionalParameter(3);
+        if (seedOpt->m_present)
+        {
+            flipSeed = (int)seedOpt->getInteger(1);
+        }
+    }
+    ofstream nullOut;
+    if (numFlips > 0)
+    {//open it before doing the work, so a bad path fails early
+        nullOut.open(nullTextName.toLocal8Bit().constData());
+        if (!nullOut) throw AlgorithmException("failed to open text file for output");
+    }
+    vector<float> nullMax, nullMin;
+    AlgorithmVolumeTFCE(myProgObj, myVol, myVolOut, presmooth, myRoi, param_e, param_h, subvolNum, numFlips, &nullMax, &nullMin, flipSeed);
+    if (numFlips > 0)
+    {
+        for (int flip = 0; flip < numFlips; ++flip)
+        {
+            nullOut << nullMax[flip] << "\t" << nullMin[flip] << endl;
+        }
+        if (!nullOut) throw AlgorithmException("failed to write null distribution to text file");
+    }
+}
+
+namespace
+{
+    void signFlipTStat(const vector<const float*>& frames, const vector<char>& negated, const int64_t& frameSize, double* meanScratch, double* varScratch, float* statOut)
+    {//two passes, mean then squared deviations, because the sum of squares minus n * mean^2 loses precision when the mean is large compared to the spread
+        int numSubjects = (int)frames.size();
+        for (int64_t i = 0; i < frameSize; ++i) meanScratch[i] = 0.0;
+        for (int j = 0; j < numSubjects; ++j)
+        {
+            const float* frameData = frames[j];
+            if (negated[j])
+            {
+                for (int64_t i = 0; i < frameSize; ++i) meanScratch[i] -= frameData[i];
+            } else {
+                for (int64_t i = 0; i < frameSize; ++i) meanScratch[i] += frameData[i];
+            }
+        }
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            meanScratch[i] /= numSubjects;
+            varScratch[i] = 0.0;
+        }
+        for (int j = 0; j < numSubjects; ++j)
+        {
+            const float* frameData = frames[j];
+            double sign = (negated[j] ? -1.0 : 1.0);
+            for (int64_t i = 0; i < frameSize; ++i)
+            {
+                double deviation = sign * frameData[i] - meanScratch[i];
+                varScratch[i] += deviation * deviation;
+            }
+        }
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            double variance = varScratch[i] / (numSubjects - 1);
+            if (variance > 0.0)
+            {
+                statOut[i] = (float)(meanScratch[i] / sqrt(variance / numSubjects));
+            } else {
+                statOut[i] = 0.0f;
+            }
+        }
+    }
 }
 
 AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const VolumeFile* myVol, VolumeFile* myVolOut, const float& presmooth, const VolumeFile* myRoi,
-                                         const float& param_e, const float& param_h, const int64_t& subvolNum) : AbstractAlgorithm(myProgObj)
+                                         const float& param_e, const float& param_h, const int64_t& subvolNum,
+                                         const int& numFlips, vector<float>* nullMaxOut, vector<float>* nullMinOut, const int& flipSeed) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (myRoi != NULL && !myVol->getVolumeSpace().matches(myRoi->getVolumeSpace())) throw AlgorithmException("roi volume has different volume space than input");
@@ -123,6 +205,64 @@ AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const Volume
     vector<int64_t> dims = myVol->getDimensions();
     const float* roiFrame = NULL;
     if (myRoi != NULL) roiFrame = myRoi->getFrame();
+    if (numFlips < 0) throw AlgorithmException("number of sign flips must not be negative");
+    if (numFlips > 0)
+    {
+        if (subvolNum != -1) throw AlgorithmException("sign flipping can't be used on a single subvolume");
+        if (dims[3] < 2) throw AlgorithmException("sign flipping requires at least 2 subvolumes");
+        if (dims[4] != 1) throw AlgorithmException("sign flipping can't be used on multi-component volumes");
+        if (nullMaxOut == NULL || nullMinOut == NULL) throw AlgorithmException("sign flipping requires outputs for the null distribution");
+        const VolumeFile* toUse = myVol;
+        VolumeFile smoothed;
+        if (presmooth > 0.0f)
+        {
+            AlgorithmVolumeSmoothing(NULL, myVol, presmooth, &smoothed, myRoi);
+            toUse = &smoothed;
+        }
+        const int64_t frameSize = dims[0] * dims[1] * dims[2];
+        int numFrames = (int)dims[3];
+        vector<const float*> frames(numFrames);
+        for (int j = 0; j < numFrames; ++j)
+        {
+            frames[j] = toUse->getFrame(j);
+        }
+        vector<float>& nullMax = *nullMaxOut, &nullMin = *nullMinOut;
+        nullMax.resize(numFlips);
+        nullMin.resize(numFlips);
+        vector<int64_t> outDims = dims;
+        outDims.resize(3);
+        myVolOut->reinitialize(outDims, myVol->getSform());
+        myVolOut->setMapName(0, "TFCE of one-sample t-statistic");
+#pragma omp CARET_PAR
+        {
+            TFCEUnionFind workspace;
+            vector<double> meanScratch(frameSize), varScratch(frameSize);
+            vector<float> statData(frameSize), outframe(frameSize);
+            vector<char> negated(numFrames, 0);
+#pragma omp CARET_SINGLE
+            {
+                signFlipTStat(frames, negated, frameSize, meanScratch.data(), varScratch.data(), statData.data());
+                processFrame(toUse, statData.data(), outframe.data(), roiFrame, param_e, param_h, workspace);
+                myVolOut->setFrame(outframe.data());
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int flip = 0; flip < numFlips; ++flip)
+            {
+                tfceSignFlips(flipSeed, flip, negated);
+                signFlipTStat(frames, negated, frameSize, meanScratch.data(), varScratch.data(), statData.data());
+                processFrame(toUse, statData.data(), outframe.data(), roiFrame, param_e, param_h, workspace);
+                float maxVal = 0.0f, minVal = 0.0f;
+                for (int64_t i = 0; i < frameSize; ++i)
+                {
+                    if (outframe[i] > maxVal) maxVal = outframe[i];
+                    if (outframe[i] < minVal) minVal = outframe[i];
+                }
+                nullMax[flip] = maxVal;
+                nullMin[flip] = minVal;
+            }
+        }
+        return;
+    }
     if (subvolNum == -1)
     {
         myVolOut->reinitialize(myVol->getOriginalDimensions(), myVol->getSform(), dims[4]);
@@ -135,13 +275,14 @@ AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const Volume
         }
 #pragma omp CARET_PAR
         {
+            TFCEUnionFind workspace;
             vector<float> outframe(dims[0] * dims[1] * dims[2]);
 #pragma omp CARET_FOR
             for (int64_t b = 0; b < dims[3]; ++b)
             {
                 for (int64_t c = 0; c < dims[4]; ++c)
                 {
-                    processFrame(toUse, b, c, outframe.data(), roiFrame, param_e, param_h);
+                    processFrame(toUse, toUse->getFrame(b, c), outframe.data(), roiFrame, param_e, param_h, workspace);
                     myVolOut->setFrame(outframe.data(), b, c);
                 }
             }
@@ -159,23 +300,23 @@ AlgorithmVolumeTFCE::AlgorithmVolumeTFCE(ProgressObject* myProgObj, const Volume
             toUse = &smoothed;
             useFrame = 0;
         }
+        TFCEUnionFind workspace;
         vector<float> outframe(dims[0] * dims[1] * dims[2]);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
-            processFrame(toUse, useFrame, c, outframe.data(), roiFrame, param_e, param_h);
+            processFrame(toUse, toUse->getFrame(useFrame, c), outframe.data(), roiFrame, param_e, param_h, workspace);
             myVolOut->setFrame(outframe.data(), 0, c);
         }
     }
 }
 
-void AlgorithmVolumeTFCE::processFrame(const VolumeFile* inVol, const int64_t& b, const int64_t& c, float* outData, const float* roiData, const float& param_e, const float& param_h)
+void AlgorithmVolumeTFCE::processFrame(const VolumeFile* inVol, const float* inData, float* outData, const float* roiData, const float& param_e, const float& param_h, TFCEUnionFind& workspace)
 {
     vector<int64_t> dims = inVol->getDimensions();
     int64_t frameSize = dims[0] * dims[1] * dims[2];
     vector<double> accum(frameSize, 0.0);
-    tfce(inVol, b, c, accum.data(), roiData, param_e, param_h, false);//don't negate - positives
-    tfce(inVol, b, c, accum.data(), roiData, param_e, param_h, true);//negate - negatives - NOTE: output is still positive!!!
-    const float* inData = inVol->getFrame(b, c);
+    tfce(inVol, inData, accum.data(), roiData, param_e, param_h, workspace, false);//don't negate - positives
+    tfce(inVol, inData, accum.data(), roiData, param_e, param_h, workspace, true);//negate - negatives - NOTE: output is still positive!!!
     for (int64_t i = 0; i < frameSize; ++i)
     {
         if (inData[i] > 0.0f)//negate the results from negative inputs
@@ -187,194 +328,42 @@ void AlgorithmVolumeTFCE::processFrame(const VolumeFile* inVol, const int64_t& b
     }
 }
 
-namespace
-{//hidden namespace just to make sure things don't collide
-    struct Cluster
-    {
-        double accumVal, totalVolume;
-        vector<VoxelIJK> members;
-        float lastVal;
-        bool first;
-        Cluster()
-        {
-            first = true;
-            accumVal = 0.0;
-            totalVolume = 0.0;
-        }
-        void addMember(const VoxelIJK& voxel, const float& val, const float& voxel_volume, const float& param_e, const float& param_h)
-        {
-            update(val, param_e, param_h);
-            members.push_back(voxel);
-            totalVolume += voxel_volume;
-        }
-        void update(const float& bottomVal, const float& param_e, const float& param_h)
-        {
-            if (first)
-            {
-                lastVal = bottomVal;
-                first = false;
-            } else {
-                if (bottomVal != lastVal)//skip computing if there is no difference
-                {
-                    CaretAssert(bottomVal < lastVal);
-                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
-                    double newSlice = pow(totalVolume, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
-                    accumVal += newSlice;
-                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
-                }
-            }
-        }
-    };
-    
-    int64_t allocCluster(vector<Cluster>& clusterList, set<int64_t>& deadClusters)
-    {
-        if (deadClusters.empty())
-        {
-            clusterList.push_back(Cluster());
-            return (int64_t)(clusterList.size() - 1);
-        } else {
-            set<int64_t>::iterator iter = deadClusters.begin();
-            int64_t ret = *iter;
-            deadClusters.erase(iter);
-            clusterList[ret] = Cluster();//reinitialize
-            return ret;
-        }
-    }
-}
-
-void AlgorithmVolumeTFCE::tfce(const VolumeFile* inVol, const int64_t& b, const int64_t& c, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate)
+void AlgorithmVolumeTFCE::tfce(const VolumeFile* inVol, const float* frameData, double* accumData, const float* roiData, const float& param_e, const float& param_h, TFCEUnionFind& workspace, const bool& negate)
 {
     vector<int64_t> dims = inVol->getDimensions();
     Vector3D ivec, jvec, kvec, origin;//compute the volume of a voxel so different resolutions have comparable values - as if it matters, but hey
     inVol->getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);//who knows, maybe we'll have distortion correction in volume someday
     float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
     const int64_t frameSize = dims[0] * dims[1] * dims[2];
-    const float* frameData = inVol->getFrame(b, c);
-    vector<int64_t> membership(frameSize, -1);//use int64_t just in case we get an absurd number of clusters
-    vector<Cluster> clusterList;
-    set<int64_t> deadClusters;//to allow reallocation without changing indices
-    CaretSimpleMaxHeap<VoxelIJK, float> voxelHeap;
-    for (int64_t i = 0; i < dims[0]; ++i)
+    workspace.reset(frameSize, param_e, param_h);
+    for (int64_t index = 0; index < frameSize; ++index)
     {
-        for (int64_t j = 0; j < dims[1]; ++j)
+        if (roiData == NULL || roiData[index] > 0.0f)
         {
-            for (int64_t k = 0; k < dims[2]; ++k)
+            float value = (negate ? -frameData[index] : frameData[index]);
+            if (value > 0.0f)
             {
-                int64_t index = inVol->getIndex(i, j, k);
-                if ((roiData == NULL || roiData[index] > 0.0f))
-                {
-                    if (negate)
-                    {
-                        if (frameData[index] < 0.0f)
-                        {
-                            voxelHeap.push(VoxelIJK(i, j, k), -frameData[index]);
-                        }
-                    } else {
-                        if (frameData[index] > 0.0f)
-                        {
-                            voxelHeap.push(VoxelIJK(i, j, k), frameData[index]);
-                        }
-                    }
-                }
-            }
-        }
-    }
-    const int STENCIL_SIZE = 18;
-    int64_t stencil[STENCIL_SIZE] = { 0, 0, -1,
-                                      0, -1, 0,
-                                      -1, 0, 0,
-                                      1, 0, 0,
-                                      0, 1, 0,
-                                      0, 0, 1 };
-    while (!voxelHeap.isEmpty())
-    {
-        float value;
-        VoxelIJK voxel = voxelHeap.pop(&value);
-        int64_t voxelIndex = inVol->getIndex(voxel.m_ijk);
-        set<int64_t> touchingClusters;
-        for (int i = 0; i < STENCIL_SIZE; i += 3)
-        {
-            VoxelIJK neighVoxel(voxel.m_ijk[0] + stencil[i], voxel.m_ijk[1] + stencil[i + 1], voxel.m_ijk[2] + stencil[i + 2]);
-            if (inVol->indexValid(neighVoxel.m_ijk))
-            {
-                int64_t neighIndex = inVol->getIndex(neighVoxel.m_ijk);
-                if (membership[neighIndex] != -1)
-                {
-                    touchingClusters.insert(membership[neighIndex]);
-                }
-            }
-        }
-        int numTouching = (int)touchingClusters.size();
-        switch (numTouching)
-        {
-            case 0://make new cluster
-            {
-                int64_t newCluster = allocCluster(clusterList, deadClusters);
-                clusterList[newCluster].addMember(voxel, value, voxelVolume, param_e, param_h);
-                membership[voxelIndex] = newCluster;
-                break;
-            }
-            case 1://add to cluster
-            {
-                int64_t whichCluster = *(touchingClusters.begin());
-                clusterList[whichCluster].addMember(voxel, value, voxelVolume, param_e, param_h);
-                membership[voxelIndex] = whichCluster;
-                accumData[voxelIndex] -= clusterList[whichCluster].accumVal;//the accum value is the current amount less than the peak value that the edge of the cluster has (this node is on the edge)
-                break;//so, when the cluster merges or reaches 0, we add the accum value to every member and zero the accum value of the merged cluster, and we get the correct value in the end (with far fewer flops than integrating everywhere)
-            }
-            default://merge all touching clusters
-            {
-                int64_t mergedIndex = -1, biggestSize = 0;//find the biggest cluster (in number of members) and use as merged cluster, for optimization purposes
-                for (set<int64_t>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if ((int64_t)clusterList[*iter].members.size() > biggestSize)
-                    {
-                        mergedIndex = *iter;
-                        biggestSize = (int64_t)clusterList[*iter].members.size();
-                    }
-                }
-                CaretAssertVectorIndex(clusterList, mergedIndex);
-                Cluster& mergedCluster = clusterList[mergedIndex];
-                mergedCluster.update(value, param_e, param_h);//recalculate to align cluster bottoms
-                for (set<int64_t>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if (*iter != mergedIndex)//if we are the largest cluster, don't modify the per-voxel accum for members, so merges between small and large clusters are cheap
-                    {
-                        Cluster& thisCluster = clusterList[*iter];
-                        thisCluster.update(value, param_e, param_h);
-                        int64_t numMembers = (int64_t)thisCluster.members.size();
-                        double correctionVal = thisCluster.accumVal - mergedCluster.accumVal;//fix the accum values in the side cluster so we can add the merged cluster's accum to everything at the end
-                        for (int64_t j = 0; j < numMembers; ++j)//add the correction value to every member so that we have the current integrated values correct
-                        {
-                            int64_t memberIndex = inVol->getIndex(thisCluster.members[j].m_ijk);
-                            accumData[memberIndex] += correctionVal;//apply the correction
-                            membership[memberIndex] = mergedIndex;//and update membership
-                        }
-                        mergedCluster.members.insert(mergedCluster.members.end(), thisCluster.members.begin(), thisCluster.members.end());//copy all members
-                        mergedCluster.totalVolume += thisCluster.totalVolume;
-                        deadClusters.insert(*iter);//kill it
-                        vector<VoxelIJK>().swap(clusterList[*iter].members);//also try to deallocate member list
-                    }
-                }
-                mergedCluster.addMember(voxel, value, voxelVolume, param_e, param_h);//will not trigger recomputation, we already recomputed at this value
-                accumData[voxelIndex] -= mergedCluster.accumVal;//the voxel they merge on must not get the peak value of the cluster, obviously, so again, record its difference from peak
-                membership[voxelIndex] = mergedIndex;
-                break;//NOTE: do not reset the accum value of the merged cluster, we specifically avoided modifying the per-voxel accum for its members, so the cluster accum is still in play
+                workspace.addCandidate(index, value);
             }
         }
     }
-    int listSize = (int)clusterList.size();//final cleanup of accum values
-    for (int i = 0; i < listSize; ++i)
+    const vector<pair<float, int64_t> >& order = workspace.sortCandidates();//highest first, the union-find integrates each cluster down to each new value as it is touched
+    const int64_t numCandidates = (int64_t)order.size();
+    const int64_t sliceSize = dims[0] * dims[1];
+    for (int64_t n = 0; n < numCandidates; ++n)
     {
-        if (deadClusters.find(i) != deadClusters.end()) continue;//ignore clusters that don't exist
-        Cluster& thisCluster = clusterList[i];
-        thisCluster.update(0.0f, param_e, param_h);//update to include the to-zero slice
-        int numMembers = (int)thisCluster.members.size();
-        for (int j = 0; j < numMembers; ++j)
-        {
-            accumData[inVol->getIndex(thisCluster.members[j].m_ijk)] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
-        }
+        const int64_t index = order[n].second;
+        const int64_t i = index % dims[0], j = (index / dims[0]) % dims[1], k = index / sliceSize;//face neighbors only
+        workspace.clearTouching();
+        if (i > 0) workspace.touch(index - 1);
+        if (i < dims[0] - 1) workspace.touch(index + 1);
+        if (j > 0) workspace.touch(index - dims[0]);
+        if (j < dims[1] - 1) workspace.touch(index + dims[0]);
+        if (k > 0) workspace.touch(index - sliceSize);
+        if (k < dims[2] - 1) workspace.touch(index + sliceSize);
+        workspace.addTouching(index, order[n].first, voxelVolume);
     }
+    workspace.finish(accumData);
 }
 
 float AlgorithmVolumeTFCE::getAlgorithmInternalWeight()
@@ -36,6 +36,7 @@
 #include "BrowserTabContent.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "ChartingDataManager.h"
 #include "ChartableTwoFileDelegate.h"
@@ -120,6 +121,91 @@
 
 using namespace caret;
 
+namespace {
+    /*
+     * A data file selected for loading in a spec file.
+     */
+    struct SpecFileLoadItem {
+        DataFileTypeEnum::Enum m_dataFileType;
+        StructureEnum::Enum m_structure;
+        AString m_filename;
+        AString m_absoluteFilename;
+        CaretDataFile* m_concurrentFile; // read by a worker thread but not yet added to the brain
+        AString m_concurrentErrorMessage;
+    };
+    
+    /*
+     * @return True if files of the given type may be read on a worker thread
+     * while other files are read.  Reading these types does not send events
+     * or depend upon other loaded files, anything that does (palette coloring,
+     * validation against surfaces) happens when the file is added to the brain.
+     */
+    bool isDataFileTypeReadConcurrently(const DataFileTypeEnum::Enum dataFileType)
+    {
+        switch (dataFileType) {
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            case DataFileTypeEnum::LABEL:
+            case DataFileTypeEnum::METRIC:
+            case DataFileTypeEnum::RGBA:
+            case DataFileTypeEnum::SURFACE:
+            case DataFileTypeEnum::VOLUME:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+    
+    /*
+     * @return A new, empty file for reading on a worker thread.  Files are
+     * created on the main thread since some file constructors register
+     * event listeners.
+     */
+    CaretDataFile* createDataFileForConcurrentReading(const DataFileTypeEnum::Enum dataFileType)
+    {
+        CaretAssert(isDataFileTypeReadConcurrently(dataFileType));
+        if (dataFileType == DataFileTypeEnum::SURFACE) {
+            return new Surface();
+        }
+        return CaretDataFileHelper::createCaretDataFileForFileType(dataFileType);
+    }
+    
+    /*
+     * Read a file on a worker thread.  An error is saved in the item since
+     * errors are reported in spec file order, and the file is not deleted
+     * here since deleting files removes event listeners.
+     */
+    void readDataFileConcurrently(SpecFileLoadItem& item)
+    {
+        CaretAssert(item.m_concurrentFile);
+        try {
+            FileInformation fileInfo(item.m_absoluteFilename);
+            if (fileInfo.exists() == false) {
+                throw DataFileException(item.m_absoluteFilename,
+                                        "File not found:");
+            }
+            try {
+                item.m_concurrentFile->readFile(item.m_absoluteFilename);
+            }
+            catch (const std::bad_alloc&) {
+                throw DataFileException(item.m_absoluteFilename,
+                                        CaretDataFileHelper::createBadAllocExceptionMessage(item.m_absoluteFilename));
+            }
+        }
+        catch (const DataFileException& dfe) {
+            item.m_concurrentErrorMessage = dfe.whatString();
+            if (item.m_concurrentErrorMessage.isEmpty()) {
+                item.m_concurrentErrorMessage = ("Error reading " + item.m_absoluteFilename);
+            }
+        }
+    }
+}
+
 /**
  *  Constructor.
  */
@@ -5295,6 +5381,61 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Add a data file that was read on a worker thread while loading a spec
+ * file.  Performs the processing that follows reading of the file when
+ * it is read with readDataFile().
+ *
+ * @param caretDataFile
+ *    File that was read.  It is deleted if it cannot be added.
+ * @param dataFileType
+ *    Type of data file.
+ * @param structure
+ *    Struture of file (used if not invalid)
+ * @param dataFileName
+ *    Absolute name of the data file.
+ * @throws DataFileException
+ *    If the file cannot be added.
+ * @return
+ *    Pointer to file that was added.
+ */
+CaretDataFile*
+Brain::addDataFileReadConcurrently(CaretDataFile* caretDataFile,
+                                   const DataFileTypeEnum::Enum dataFileType,
+                                   const StructureEnum::Enum structure,
+                                   const AString& dataFileName)
+{
+    CaretAssert(caretDataFile);
+    
+    try {
+        CiftiMappableDataFile* ciftiMapFile = dynamic_cast<CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        return addReadOrReloadDataFile(FILE_MODE_ADD,
+                                       caretDataFile,
+                                       dataFileType,
+                                       structure,
+                                       dataFileName,
+                                       false);
+    }
+    catch (const DataFileException& dfe) {
+        /*
+         * When adding, a file that fails is not deleted
+         * unless it was already taken by the brain
+         */
+        std::vector<CaretDataFile*> allDataFiles;
+        getAllDataFiles(allDataFiles);
+        if (std::find(allDataFiles.begin(),
+                      allDataFiles.end(),
+                      caretDataFile) == allDataFiles.end()) {
+            delete caretDataFile;
+        }
+        throw dfe;
+    }
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -5361,6 +5502,7 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
      */
+    std::vector<SpecFileLoadItem> loadItems;
     const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
     for (int32_t ig = -1; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = ((ig == -1)
@@ -5376,42 +5518,165 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
             if (dataFileInfo->isLoadingSelected()) {
-                const AString filename = dataFileInfo->getFileName();
-                const StructureEnum::Enum structure = dataFileInfo->getStructure();
-
-                /*
-                 * Send event indicating progress of file reading
-                 */
-                FileInformation fileInfo(dataFileInfo->getFileName());
-                progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
-                                            + fileInfo.getFileName()));
+                SpecFileLoadItem item;
+                item.m_dataFileType = dataFileType;
+                item.m_structure    = dataFileInfo->getStructure();
+                item.m_filename     = dataFileInfo->getFileName();
+                item.m_absoluteFilename = convertFilePathNameToAbsolutePathName(item.m_filename);
+                item.m_concurrentFile = NULL;
+                loadItems.push_back(item);
+            }
+        }
+    }
+    const int32_t numberOfLoadItems = static_cast<int32_t>(loadItems.size());
+    
+    /*
+     * Files that do not depend upon other files while being read are
+     * read concurrently.  They are added to the brain below, on this
+     * thread and in spec file order, after the palettes and any
+     * surfaces they depend upon have been added.
+     */
+    std::vector<int32_t> concurrentItemIndices;
+    for (int32_t i = 0; i < numberOfLoadItems; i++) {
+        if (DataFile::isFileOnNetwork(loadItems[i].m_absoluteFilename) == false) {
+            if (isDataFileTypeReadConcurrently(loadItems[i].m_dataFileType)) {
+                concurrentItemIndices.push_back(i);
+            }
+        }
+    }
+    const int32_t numberOfConcurrentItems = static_cast<int32_t>(concurrentItemIndices.size());
+    if (numberOfConcurrentItems > 1) {
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + AString::number(numberOfConcurrentItems)
+                                    + " files"));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        if (progressUpdate.isCancelled()) {
+            resetBrain();
+            return;
+        }
+        
+        for (int32_t i = 0; i < numberOfConcurrentItems; i++) {
+            SpecFileLoadItem& item = loadItems[concurrentItemIndices[i]];
+            item.m_concurrentFile = createDataFileForConcurrentReading(item.m_dataFileType);
+        }
+        
+        /*
+         * Events may only be sent from this thread, which is the master
+         * thread of the parallel loop, so progress is updated and
+         * cancellation is checked whenever the master thread finishes
+         * a file.  Once cancelled, files not yet started are skipped.
+         */
+        int32_t numberOfConcurrentItemsRead = 0;
+        bool concurrentReadingCancelled = false;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t i = 0; i < numberOfConcurrentItems; i++) {
+            bool skipFile = false;
+#pragma omp critical(BrainConcurrentSpecFileRead)
+            {
+                skipFile = concurrentReadingCancelled;
+            }
+            if ( ! skipFile) {
+                readDataFileConcurrently(loadItems[concurrentItemIndices[i]]);
+            }
+
+            int32_t numberRead = 0;
+#pragma omp critical(BrainConcurrentSpecFileRead)
+            {
+                numberRead = ++numberOfConcurrentItemsRead;
+            }
+            bool isMasterThread = true;
+#ifdef CARET_OMP
+            isMasterThread = (omp_get_thread_num() == 0);
+#endif
+            if (isMasterThread
+                && ( ! skipFile)) {
+                progressUpdate.setProgress(numberRead,
+                                           ("Read "
+                                            + AString::number(numberRead)
+                                            + " of "
+                                            + AString::number(numberOfConcurrentItems)
+                                            + " files"));
                 EventManager::get()->sendEvent(progressUpdate.getPointer());
-                
-                /*
-                 * If user cancelled, reset brain and get out!
-                 */
                 if (progressUpdate.isCancelled()) {
-                    resetBrain();
-                    return;
-                }
-                
-                try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
+#pragma omp critical(BrainConcurrentSpecFileRead)
+                    {
+                        concurrentReadingCancelled = true;
+                    }
                 }
-                catch (const DataFileException& e) {
+            }
+        }
+
+        /*
+         * If user cancelled, reset brain and get out!
+         */
+        if (concurrentReadingCancelled) {
+            for (int32_t i = 0; i < numberOfLoadItems; i++) {
+                delete loadItems[i].m_concurrentFile;
+                loadItems[i].m_concurrentFile = NULL;
+            }
+            resetBrain();
+            return;
+        }
+    }
+    
+    for (int32_t iItem = 0; iItem < numberOfLoadItems; iItem++) {
+        SpecFileLoadItem& item = loadItems[iItem];
+        
+        /*
+         * Send event indicating progress of file reading
+         */
+        FileInformation fileInfo(item.m_filename);
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + fileInfo.getFileName()));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        
+        /*
+         * If user cancelled, reset brain and get out!
+         */
+        if (progressUpdate.isCancelled()) {
+            for (int32_t i = iItem; i < numberOfLoadItems; i++) {
+                delete loadItems[i].m_concurrentFile;
+                loadItems[i].m_concurrentFile = NULL;
+            }
+            resetBrain();
+            return;
+        }
+        
+        try {
+            if (item.m_concurrentFile != NULL) {
+                CaretDataFile* caretDataFile = item.m_concurrentFile;
+                item.m_concurrentFile = NULL;
+                if (item.m_concurrentErrorMessage.isEmpty() == false) {
+                    delete caretDataFile;
                     if (errorMessage.isEmpty() == false) {
                         errorMessage += "\n";
                     }
-                    errorMessage += e.whatString();
+                    errorMessage += item.m_concurrentErrorMessage;
+                }
+                else {
+                    addDataFileReadConcurrently(caretDataFile,
+                                                item.m_dataFileType,
+                                                item.m_structure,
+                                                item.m_absoluteFilename);
                 }
-                
-                fileReadCounter++;
+            }
+            else {
+                readDataFile(item.m_dataFileType,
+                             item.m_structure,
+                             item.m_filename,
+                             false);
             }
         }
+        catch (const DataFileException& e) {
+            if (errorMessage.isEmpty() == false) {
+                errorMessage += "\n";
+            }
+            errorMessage += e.whatString();
+        }
+        
+        fileReadCounter++;
     }
     
     m_specFile->clearModified();
@@ -487,6 +487,11 @@ namespace caret {
                           const AString& dataFileName,
                           const bool markDataFileAsModified);
         
+        CaretDataFile* addDataFileReadConcurrently(CaretDataFile* caretDataFile,
+                                                   const DataFileTypeEnum::Enum dataFileType,
+                                                   const StructureEnum::Enum structure,
+                                                   const AString& dataFileName);
+        
         void createModelChartTwo();
         
         /**
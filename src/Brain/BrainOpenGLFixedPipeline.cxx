@@ -63,6 +63,7 @@
 #include "CaretMappableDataFile.h"
 #include "CaretMappableDataFileAndMapSelectionModel.h"
 #include "CaretPreferences.h"
+#include "CaretTriangleLocator.h"
 #include "ChartableMatrixInterface.h"
 #include "ChartableMatrixSeriesInterface.h"
 #include "ChartModelDataSeries.h"
@@ -101,6 +102,7 @@
 #include "GapsAndMargins.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
+#include "GraphicsOpenGLSurfaceBuffers.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "IdentifiedItemNode.h"
 #include "IdentificationManager.h"
@@ -1944,51 +1946,107 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
             break;
     }
     
-    if (isSelect) {
+    /*
+     * When possible, find the triangle under the mouse with a ray
+     * so that the surface is not drawn with identification colors
+     */
+    const bool rayPickingFlag = (isSelect
+                                 && isSurfaceRayPickingAvailable());
+    
+    if (isSelect
+        && ( ! rayPickingFlag)) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
     
     uint8_t rgba[4];
     
-    glBegin(GL_TRIANGLES);
-    for (int32_t i = 0; i < numTriangles; i++) {
-        const int32_t i3 = i * 3;
-        const int32_t n1 = triangles[i3];
-        const int32_t n2 = triangles[i3+1];
-        const int32_t n3 = triangles[i3+2];
-        
+    const bool useBufferObjectsFlag = (BrainOpenGL::isVertexBuffersSupported()
+                                       && (getContextSharingGroupPointer() != NULL));
+    if (rayPickingFlag) {
+        /* triangle under mouse is found with ray after drawing is skipped */
+    }
+    else if (useBufferObjectsFlag) {
         if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            /*
+             * Identification colors change every time the surface is drawn
+             * for selection so they are loaded each time with the retained coordinates
+             */
+            std::vector<uint8_t> triangleRGB(numTriangles * 3);
+            for (int32_t i = 0; i < numTriangles; i++) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                const int32_t i3 = i * 3;
+                triangleRGB[i3]   = rgba[0];
+                triangleRGB[i3+1] = rgba[1];
+                triangleRGB[i3+2] = rgba[2];
+            }
+            surface->getOpenGLSurfaceBuffers()->drawTrianglesWithTriangleColors(getContextSharingGroupPointer(),
+                                                                                surface->getNumberOfNodes(),
+                                                                                coordinates,
+                                                                                numTriangles,
+                                                                                triangles,
+                                                                                &triangleRGB[0]);
         }
         else {
-            glColor4fv(&nodeColoringRGBA[n1*4]);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glColor4fv(&nodeColoringRGBA[n2*4]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glColor4fv(&nodeColoringRGBA[n3*4]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            surface->getOpenGLSurfaceBuffers()->drawTriangles(getContextSharingGroupPointer(),
+                                                              surface->getNumberOfNodes(),
+                                                              coordinates,
+                                                              normals,
+                                                              numTriangles,
+                                                              triangles,
+                                                              nodeColoringRGBA);
         }
     }
-    glEnd();
+    else {
+        glBegin(GL_TRIANGLES);
+        for (int32_t i = 0; i < numTriangles; i++) {
+            const int32_t i3 = i * 3;
+            const int32_t n1 = triangles[i3];
+            const int32_t n2 = triangles[i3+1];
+            const int32_t n3 = triangles[i3+2];
+        
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[n1*4]);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glColor4fv(&nodeColoringRGBA[n2*4]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glColor4fv(&nodeColoringRGBA[n3*4]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+        }
+        glEnd();
+    }
     
     if (isSelect) {
         int32_t triangleIndex = -1;
         float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         triangleIndex,
-                                         depth);
+        if (rayPickingFlag) {
+            TriangleLocatorInfo triangleInfo;
+            if (getSurfaceTriangleUnderMouse(surface,
+                                             triangleInfo,
+                                             depth)) {
+                triangleIndex = static_cast<int32_t>(triangleInfo.triangle);
+            }
+        }
+        else {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE,
+                                             this->mouseX,
+                                             this->mouseY,
+                                             triangleIndex,
+                                             depth);
+        }
         
         
         if (triangleIndex >= 0) {
@@ -2246,6 +2304,125 @@ BrainOpenGLFixedPipeline::setProjectionModeData(const float screenDepth,
     }
 }
 
+/**
+ * @return True if the surface item under the mouse may be found by
+ * casting a ray into the surface's triangles instead of drawing the
+ * surface with identification colors.  Not available when surfaces
+ * are clipped since the ray may hit triangles that are clipped.
+ */
+bool
+BrainOpenGLFixedPipeline::isSurfaceRayPickingAvailable() const
+{
+    if (m_clippingPlaneGroup != NULL) {
+        if (m_clippingPlaneGroup->isSurfaceSelected()) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Find the surface triangle under the mouse by casting a ray, through
+ * the current modelview and projection transformations, from the mouse
+ * position into the surface.  The first triangle hit by the ray is
+ * the triangle that is visible at the mouse position.
+ *
+ * @param surface
+ *    Surface that is searched.
+ * @param triangleInfoOut
+ *    Output containing the triangle, barycentric weights, and nearest vertex.
+ * @param screenDepthOut
+ *    Output containing the screen depth of the point on the triangle, which
+ *    is the same as the value in the depth buffer had the triangle been drawn.
+ * @return
+ *    True if there is a triangle under the mouse, else false.
+ */
+bool
+BrainOpenGLFixedPipeline::getSurfaceTriangleUnderMouse(const Surface* surface,
+                                                       TriangleLocatorInfo& triangleInfoOut,
+                                                       float& screenDepthOut)
+{
+    screenDepthOut = -1.0;
+    
+    GLdouble selectionModelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, selectionModelviewMatrix);
+    
+    GLdouble selectionProjectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, selectionProjectionMatrix);
+    
+    GLint selectionViewport[4];
+    glGetIntegerv(GL_VIEWPORT, selectionViewport);
+    
+    /*
+     * Ray through center of pixel under mouse from near to far clipping plane
+     */
+    const double pixelX = this->mouseX + 0.5;
+    const double pixelY = this->mouseY + 0.5;
+    double nearXYZ[3];
+    double farXYZ[3];
+    if ( ! gluUnProject(pixelX,
+                        pixelY,
+                        0.0,
+                        selectionModelviewMatrix,
+                        selectionProjectionMatrix,
+                        selectionViewport,
+                        &nearXYZ[0],
+                        &nearXYZ[1],
+                        &nearXYZ[2])) {
+        return false;
+    }
+    if ( ! gluUnProject(pixelX,
+                        pixelY,
+                        1.0,
+                        selectionModelviewMatrix,
+                        selectionProjectionMatrix,
+                        selectionViewport,
+                        &farXYZ[0],
+                        &farXYZ[1],
+                        &farXYZ[2])) {
+        return false;
+    }
+    
+    const float rayOrigin[3] = {
+        static_cast<float>(nearXYZ[0]),
+        static_cast<float>(nearXYZ[1]),
+        static_cast<float>(nearXYZ[2])
+    };
+    const float rayDirection[3] = {
+        static_cast<float>(farXYZ[0] - nearXYZ[0]),
+        static_cast<float>(farXYZ[1] - nearXYZ[1]),
+        static_cast<float>(farXYZ[2] - nearXYZ[2])
+    };
+    
+    /*
+     * Direction spans near to far clipping plane so limit distance
+     * along ray to one so that clipped triangles are not found
+     */
+    if ( ! surface->getTriangleLocator()->intersectRay(rayOrigin,
+                                                       rayDirection,
+                                                       triangleInfoOut,
+                                                       1.0)) {
+        return false;
+    }
+    
+    double windowXYZ[3];
+    if ( ! gluProject(triangleInfoOut.point[0],
+                      triangleInfoOut.point[1],
+                      triangleInfoOut.point[2],
+                      selectionModelviewMatrix,
+                      selectionProjectionMatrix,
+                      selectionViewport,
+                      &windowXYZ[0],
+                      &windowXYZ[1],
+                      &windowXYZ[2])) {
+        return false;
+    }
+    screenDepthOut = windowXYZ[2];
+    
+    return true;
+}
+
 /**
  * Draw a surface as individual nodes.
  * @param surface
@@ -2276,7 +2453,6 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
         case MODE_IDENTIFICATION:
             if (nodeID->isEnabledForSelection()) {
                 isSelect = true;
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);            
             }
             else {
                 return;
@@ -2293,6 +2469,60 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
         if (pointSize < 2.0) {
             pointSize = 2.0;
         }
+        
+        /*
+         * When possible, the vertex under the mouse is the visible triangle's
+         * nearest vertex if it is within the point drawn for the vertex.
+         */
+        if (isSurfaceRayPickingAvailable()) {
+            TriangleLocatorInfo triangleInfo;
+            float triangleDepth = -1.0;
+            if (getSurfaceTriangleUnderMouse(surface,
+                                             triangleInfo,
+                                             triangleDepth)) {
+                GLdouble selectionModelviewMatrix[16];
+                glGetDoublev(GL_MODELVIEW_MATRIX, selectionModelviewMatrix);
+                GLdouble selectionProjectionMatrix[16];
+                glGetDoublev(GL_PROJECTION_MATRIX, selectionProjectionMatrix);
+                GLint selectionViewport[4];
+                glGetIntegerv(GL_VIEWPORT, selectionViewport);
+                
+                const int32_t nodeIndex = static_cast<int32_t>(triangleInfo.nearestVertex);
+                const float* nodeXYZ = &coordinates[nodeIndex * 3];
+                double windowXYZ[3];
+                if (gluProject(nodeXYZ[0],
+                               nodeXYZ[1],
+                               nodeXYZ[2],
+                               selectionModelviewMatrix,
+                               selectionProjectionMatrix,
+                               selectionViewport,
+                               &windowXYZ[0],
+                               &windowXYZ[1],
+                               &windowXYZ[2])) {
+                    const double halfPointSize = pointSize / 2.0;
+                    const double pixelX = this->mouseX + 0.5;
+                    const double pixelY = this->mouseY + 0.5;
+                    if ((std::fabs(windowXYZ[0] - pixelX) <= halfPointSize)
+                        && (std::fabs(windowXYZ[1] - pixelY) <= halfPointSize)) {
+                        const float depth = windowXYZ[2];
+                        if (nodeID->isOtherScreenDepthCloserToViewer(depth)) {
+                            nodeID->setBrain(surface->getBrainStructure()->getBrain());
+                            nodeID->setSurface(surface);
+                            nodeID->setNodeNumber(nodeIndex);
+                            nodeID->setScreenDepth(depth);
+                            this->setSelectedItemScreenXYZ(nodeID, nodeXYZ);
+                            CaretLogFine("Selected Vertex: " + nodeID->toString());
+                        }
+                        else {
+                            CaretLogFine("Rejecting Selected Vertex: " + nodeID->toString());
+                        }
+                    }
+                }
+            }
+            return;
+        }
+        
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
     setPointSize(pointSize);
     
@@ -2350,6 +2580,25 @@ void
 BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
                                                                const float* nodeColoringRGBA)
 {
+    if (BrainOpenGL::isVertexBuffersSupported()
+        && (getContextSharingGroupPointer() != NULL)) {
+        /*
+         * Coordinates, normals, and triangles are retained in buffers
+         * owned by the surface and node coloring is loaded only when it changes
+         */
+        if (nodeColoringRGBA == NULL) {
+            glColor3fv(m_backgroundColorFloat);
+        }
+        surface->getOpenGLSurfaceBuffers()->drawTriangles(getContextSharingGroupPointer(),
+                                                          surface->getNumberOfNodes(),
+                                                          surface->getCoordinate(0),
+                                                          surface->getNormalVector(0),
+                                                          surface->getNumberOfTriangles(),
+                                                          surface->getTriangle(0),
+                                                          nodeColoringRGBA);
+        return;
+    }
+    
     glEnableClientState(GL_VERTEX_ARRAY);
     if (nodeColoringRGBA != NULL) {
         glEnableClientState(GL_COLOR_ARRAY);
@@ -80,6 +80,7 @@ namespace caret {
     class SurfaceMontageConfigurationCerebellar;
     class SurfaceMontageConfigurationCerebral;
     class SurfaceMontageConfigurationFlatMaps;
+    struct TriangleLocatorInfo;
     class VolumeFile;
     class VolumeMappableInterface;
     
@@ -207,6 +208,12 @@ namespace caret {
         void drawSurfaceTriangles(Surface* surface,
                                   const float* nodeColoringRGBA);
         
+        bool isSurfaceRayPickingAvailable() const;
+        
+        bool getSurfaceTriangleUnderMouse(const Surface* surface,
+                                          TriangleLocatorInfo& triangleInfoOut,
+                                          float& screenDepthOut);
+        
         void drawSurfaceNodeAttributes(Surface* surface);
         
         void drawSurfaceBorderBeingDrawn(const Surface* surface);
@@ -48,6 +48,8 @@
 #include "GapsAndMargins.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
+#include "GraphicsOpenGLVolumeTextures.h"
+#include "GraphicsVolumeScalarCoding.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "IdentificationManager.h"
 #include "IdentificationWithColor.h"
@@ -2490,6 +2492,44 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSlice(const VolumeSliceViewPlaneEnu
         startCoordinateXYZ[drawBottomToTopInfo.indexIntoXYZ] -= (drawBottomToTopInfo.voxelStepSize / 2.0);
         startCoordinateXYZ[viewPlaneDimIndex] = selectedSliceCoordinate;
         
+        if (m_modelWholeBrain != NULL) {
+            /*
+             * After the a slice is drawn in ALL view, some layers
+             * (volume surface outline) may be drawn in lines.  As the
+             * view is rotated, lines will partially appear and disappear
+             * due to the lines having the same (extremely close) depth
+             * values as the voxel polygons.  OpenGL's Polygon Offset
+             * only works with polygons and NOT with lines or points.
+             * So, polygon offset cannot be used to move the depth
+             * values for the lines and points "a little closer" to
+             * the user.  Instead, polygon offset is used to push
+             * the underlaying slices "a little bit away" from the
+             * user.
+             *
+             * Resolves WB-414
+             */
+            const float inverseSliceIndex = numberOfVolumesToDraw - iVol;
+            const float factor  = inverseSliceIndex * 1.0 + 1.0;
+            const float units  = inverseSliceIndex * 1.0 + 1.0;
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(factor, units);
+        }
+        
+        if (drawOrthogonalSliceWithTexture(sliceNormalVector,
+                                           startCoordinateXYZ,
+                                           rowStepXYZ,
+                                           columnStepXYZ,
+                                           drawLeftToRightInfo.numberOfVoxels,
+                                           drawBottomToTopInfo.numberOfVoxels,
+                                           volumeFile,
+                                           volInfo.mapIndex,
+                                           viewPlaneDimIndex,
+                                           sliceIndexForDrawing,
+                                           volInfo.opacity)) {
+            glDisable(GL_POLYGON_OFFSET_FILL);
+            continue;
+        }
+        
         /*
          * Stores RGBA values for each voxel.
          * Use a vector for voxel colors so no worries about memory being freed.
@@ -2540,29 +2580,6 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSlice(const VolumeSliceViewPlaneEnu
         
         const uint8_t volumeDrawingOpacity = static_cast<uint8_t>(volInfo.opacity * 255.0);
         
-        if (m_modelWholeBrain != NULL) {
-            /*
-             * After the a slice is drawn in ALL view, some layers
-             * (volume surface outline) may be drawn in lines.  As the
-             * view is rotated, lines will partially appear and disappear
-             * due to the lines having the same (extremely close) depth
-             * values as the voxel polygons.  OpenGL's Polygon Offset
-             * only works with polygons and NOT with lines or points.
-             * So, polygon offset cannot be used to move the depth
-             * values for the lines and points "a little closer" to
-             * the user.  Instead, polygon offset is used to push
-             * the underlaying slices "a little bit away" from the
-             * user.
-             *
-             * Resolves WB-414
-             */
-            const float inverseSliceIndex = numberOfVolumesToDraw - iVol;
-            const float factor  = inverseSliceIndex * 1.0 + 1.0;
-            const float units  = inverseSliceIndex * 1.0 + 1.0;
-            glEnable(GL_POLYGON_OFFSET_FILL);
-            glPolygonOffset(factor, units);
-        }
-        
         /*
          * Draw the voxels in the slice.
          */
@@ -2950,6 +2967,7 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
         
         int64_t numVoxelsX = -1, numVoxelsY = -1, numVoxelsZ = -1;
         int64_t sliceIndexForDrawing = -1;
+        int64_t sliceDimensionIndex = -1;
         int64_t dimIJK[3], numMaps, numComponents;
         volumeFile->getDimensions(dimIJK[0], dimIJK[1], dimIJK[2], numMaps, numComponents);
         
@@ -2968,6 +2986,7 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
                     if (sliceViewPlane == VolumeSliceViewPlaneEnum::PARASAGITTAL)
                     {
                         sliceIndexForDrawing = culledFirstVoxelIJK[whichDim];
+                        sliceDimensionIndex = whichDim;
                         if ((sliceIndexForDrawing < 0) || (sliceIndexForDrawing >= dimIJK[whichDim]))
                         {
                             skipDraw = true;
@@ -2980,6 +2999,7 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
                     if (sliceViewPlane == VolumeSliceViewPlaneEnum::CORONAL)
                     {
                         sliceIndexForDrawing = culledFirstVoxelIJK[whichDim];
+                        sliceDimensionIndex = whichDim;
                         if ((sliceIndexForDrawing < 0) || (sliceIndexForDrawing >= dimIJK[whichDim]))
                         {
                             skipDraw = true;
@@ -2992,6 +3012,7 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
                     if (sliceViewPlane == VolumeSliceViewPlaneEnum::AXIAL)
                     {
                         sliceIndexForDrawing = culledFirstVoxelIJK[whichDim];
+                        sliceDimensionIndex = whichDim;
                         if ((sliceIndexForDrawing < 0) || (sliceIndexForDrawing >= dimIJK[whichDim]))
                         {
                             skipDraw = true;
@@ -3028,80 +3049,6 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
                 break;
         }
         
-        /*
-         * Stores RGBA values for each voxel.
-         * Use a vector for voxel colors so no worries about memory being freed.
-         */
-        const int64_t numVoxelsInSliceRGBA = numVoxelsInSlice * 4;
-        if (numVoxelsInSliceRGBA != static_cast<int64_t>(sliceVoxelsRgbaVector.size())) {
-            sliceVoxelsRgbaVector.resize(numVoxelsInSliceRGBA);
-        }
-        uint8_t* sliceVoxelsRGBA = &sliceVoxelsRgbaVector[0];
-        
-        /*
-         * Get colors for all voxels in the slice.
-         */
-        const int64_t voxelCountXYZ[3] = {
-            numVoxelsX,
-            numVoxelsY,
-            numVoxelsZ
-        };//only used to multiply them all together to get an element count for the presumed array size, so just provide them as XYZ
-        
-        const int64_t validVoxelCount =
-           volumeFile->getVoxelColorsForSubSliceInMap(m_brain->getPaletteFile(),
-                                                   mapIndex,
-                                                   sliceViewPlane,
-                                                   sliceIndexForDrawing,
-                                                   culledFirstVoxelIJK,
-                                                   culledLastVoxelIJK,
-                                                   voxelCountXYZ,
-                                                   displayGroup,
-                                                   browserTabIndex,
-                                                   sliceVoxelsRGBA);
-        
-        /*
-         * Is label outline mode?
-         */
-        if (m_volumeDrawInfo[iVol].mapFile->isMappedWithLabelTable()) {
-            int64_t xdim = 0;
-            int64_t ydim = 0;
-            switch (sliceViewPlane) {
-                case VolumeSliceViewPlaneEnum::ALL:
-                    CaretAssert(0);
-                    break;
-                case VolumeSliceViewPlaneEnum::AXIAL:
-                    xdim = numVoxelsX;
-                    ydim = numVoxelsY;
-                    break;
-                case VolumeSliceViewPlaneEnum::CORONAL:
-                    xdim = numVoxelsX;
-                    ydim = numVoxelsZ;
-                    break;
-                case VolumeSliceViewPlaneEnum::PARASAGITTAL:
-                    xdim = numVoxelsY;
-                    ydim = numVoxelsZ;
-                    break;
-            }
-            
-            LabelDrawingTypeEnum::Enum labelDrawingType = LabelDrawingTypeEnum::DRAW_FILLED;
-            CaretColorEnum::Enum outlineColor = CaretColorEnum::BLACK;
-            const CaretMappableDataFile* mapFile = dynamic_cast<const CaretMappableDataFile*>(volumeFile);
-            if (mapFile != NULL) {
-                if (mapFile->isMappedWithLabelTable()) {
-                    const LabelDrawingProperties* props = mapFile->getLabelDrawingProperties();
-                    labelDrawingType = props->getDrawingType();
-                    outlineColor     = props->getOutlineColor();
-                }
-            }
-            NodeAndVoxelColoring::convertSliceColoringToOutlineMode(sliceVoxelsRGBA,
-                                                                    labelDrawingType,
-                                                                    outlineColor,
-                                                                    xdim,
-                                                                    ydim);
-        }
-        
-        const uint8_t volumeDrawingOpacity = static_cast<uint8_t>(volInfo.opacity * 255.0);
-        
         /*
          * Setup for drawing the voxels in the slice.
          */
@@ -3193,6 +3140,95 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
             }
         }
         
+        if (drawOrthogonalSliceWithTexture(sliceNormalVector,
+                                           startCoordinate,
+                                           rowStep,
+                                           columnStep,
+                                           numberOfColumns,
+                                           numberOfRows,
+                                           volumeFile,
+                                           mapIndex,
+                                           sliceDimensionIndex,
+                                           sliceIndexForDrawing,
+                                           volInfo.opacity)) {
+            glDisable(GL_POLYGON_OFFSET_FILL);
+            continue;
+        }
+        
+        /*
+         * Stores RGBA values for each voxel.
+         * Use a vector for voxel colors so no worries about memory being freed.
+         */
+        const int64_t numVoxelsInSliceRGBA = numVoxelsInSlice * 4;
+        if (numVoxelsInSliceRGBA != static_cast<int64_t>(sliceVoxelsRgbaVector.size())) {
+            sliceVoxelsRgbaVector.resize(numVoxelsInSliceRGBA);
+        }
+        uint8_t* sliceVoxelsRGBA = &sliceVoxelsRgbaVector[0];
+        
+        /*
+         * Get colors for all voxels in the slice.
+         */
+        const int64_t voxelCountXYZ[3] = {
+            numVoxelsX,
+            numVoxelsY,
+            numVoxelsZ
+        };//only used to multiply them all together to get an element count for the presumed array size, so just provide them as XYZ
+        
+        const int64_t validVoxelCount =
+           volumeFile->getVoxelColorsForSubSliceInMap(m_brain->getPaletteFile(),
+                                                   mapIndex,
+                                                   sliceViewPlane,
+                                                   sliceIndexForDrawing,
+                                                   culledFirstVoxelIJK,
+                                                   culledLastVoxelIJK,
+                                                   voxelCountXYZ,
+                                                   displayGroup,
+                                                   browserTabIndex,
+                                                   sliceVoxelsRGBA);
+        
+        /*
+         * Is label outline mode?
+         */
+        if (m_volumeDrawInfo[iVol].mapFile->isMappedWithLabelTable()) {
+            int64_t xdim = 0;
+            int64_t ydim = 0;
+            switch (sliceViewPlane) {
+                case VolumeSliceViewPlaneEnum::ALL:
+                    CaretAssert(0);
+                    break;
+                case VolumeSliceViewPlaneEnum::AXIAL:
+                    xdim = numVoxelsX;
+                    ydim = numVoxelsY;
+                    break;
+                case VolumeSliceViewPlaneEnum::CORONAL:
+                    xdim = numVoxelsX;
+                    ydim = numVoxelsZ;
+                    break;
+                case VolumeSliceViewPlaneEnum::PARASAGITTAL:
+                    xdim = numVoxelsY;
+                    ydim = numVoxelsZ;
+                    break;
+            }
+            
+            LabelDrawingTypeEnum::Enum labelDrawingType = LabelDrawingTypeEnum::DRAW_FILLED;
+            CaretColorEnum::Enum outlineColor = CaretColorEnum::BLACK;
+            const CaretMappableDataFile* mapFile = dynamic_cast<const CaretMappableDataFile*>(volumeFile);
+            if (mapFile != NULL) {
+                if (mapFile->isMappedWithLabelTable()) {
+                    const LabelDrawingProperties* props = mapFile->getLabelDrawingProperties();
+                    labelDrawingType = props->getDrawingType();
+                    outlineColor     = props->getOutlineColor();
+                }
+            }
+            NodeAndVoxelColoring::convertSliceColoringToOutlineMode(sliceVoxelsRGBA,
+                                                                    labelDrawingType,
+                                                                    outlineColor,
+                                                                    xdim,
+                                                                    ydim);
+        }
+        
+        const uint8_t volumeDrawingOpacity = static_cast<uint8_t>(volInfo.opacity * 255.0);
+        
         /*
          * Draw the voxels in the slice.
          */
@@ -4694,6 +4730,154 @@ BrainOpenGLVolumeSliceDrawing::setOrthographicProjection(const VolumeSliceViewPl
     glMatrixMode(GL_MODELVIEW);
 }
 
+/**
+ * Draw an orthogonal slice of a palette mapped volume as a single textured
+ * quad.  The map's scalars are kept in a 3D texture and colored by a
+ * lookup table created from the palette, so the slice does not need to
+ * be colored or drawn voxel by voxel.
+ *
+ * @param sliceNormalVector
+ *    Normal vector of the slice plane.
+ * @param coordinate
+ *    Coordinate of bottom left corner of the slice as viewed
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param volumeInterface
+ *    The volume being drawn.
+ * @param mapIndex
+ *    Selected map in the volume being drawn.
+ * @param sliceDimensionIndex
+ *    Index of the volume dimension (0=I, 1=J, 2=K) perpendicular to the slice.
+ * @param sliceIndex
+ *    Index of the slice in that dimension.
+ * @param sliceOpacity
+ *    Opacity from the overlay.
+ * @return
+ *    True if the slice was drawn, false if it must be drawn with voxels.
+ */
+bool
+BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithTexture(const float sliceNormalVector[3],
+                                                              const float coordinate[3],
+                                                              const float rowStep[3],
+                                                              const float columnStep[3],
+                                                              const int64_t numberOfColumns,
+                                                              const int64_t numberOfRows,
+                                                              const VolumeMappableInterface* volumeInterface,
+                                                              const int32_t mapIndex,
+                                                              const int64_t sliceDimensionIndex,
+                                                              const int64_t sliceIndex,
+                                                              const float sliceOpacity)
+{
+    /*
+     * Identification colors each voxel with its own color
+     */
+    if (m_identificationModeFlag) {
+        return false;
+    }
+    
+    void* openglContextPointer = m_fixedPipelineDrawing->getContextSharingGroupPointer();
+    if (openglContextPointer == NULL) {
+        return false;
+    }
+    
+    const VolumeFile* volumeFile = dynamic_cast<const VolumeFile*>(volumeInterface);
+    if (volumeFile == NULL) {
+        return false;
+    }
+    if ( ! volumeFile->isMappedWithPalette()) {
+        return false;
+    }
+    if (volumeFile->getNumberOfComponents() != 1) {
+        return false;
+    }
+    CaretAssert((sliceDimensionIndex >= 0) && (sliceDimensionIndex < 3));
+    
+    int64_t dimensions[3];
+    int64_t numberOfMaps = 0;
+    int64_t numberOfComponents = 0;
+    volumeFile->getDimensions(dimensions[0], dimensions[1], dimensions[2],
+                              numberOfMaps, numberOfComponents);
+    if ((mapIndex < 0)
+        || (mapIndex >= numberOfMaps)) {
+        return false;
+    }
+    
+    /*
+     * The coding depends upon the palette's mapped and threshold
+     * ranges so the data is reloaded if they have changed
+     */
+    const int32_t lookupTableSize = GraphicsOpenGLVolumeTextures::getLookupTableSize();
+    GraphicsVolumeScalarCoding scalarCoding;
+    if ( ! volumeFile->getPaletteScalarCodingForMap(mapIndex,
+                                                    lookupTableSize,
+                                                    scalarCoding)) {
+        return false;
+    }
+    
+    GraphicsOpenGLVolumeTextures* textures = volumeFile->getOpenGLVolumeTextures();
+    if ( ! textures->loadMapData(openglContextPointer,
+                                 mapIndex,
+                                 dimensions,
+                                 volumeFile->getFrame(mapIndex),
+                                 scalarCoding)) {
+        return false;
+    }
+    
+    if ( ! textures->isLookupTableValid(mapIndex)) {
+        std::vector<uint8_t> lookupTableRGBA(lookupTableSize * 4);
+        if ( ! volumeFile->getPaletteLookupTableForMap(mapIndex,
+                                                       scalarCoding,
+                                                       &lookupTableRGBA[0])) {
+            return false;
+        }
+        textures->loadLookupTable(mapIndex,
+                                  &lookupTableRGBA[0]);
+    }
+    
+    /*
+     * Corners of the slice, counter-clockwise from the bottom left
+     */
+    float cornerXYZ[12];
+    for (int32_t i = 0; i < 3; i++) {
+        const float columnsOffset = numberOfColumns * columnStep[i];
+        const float rowsOffset    = numberOfRows * rowStep[i];
+        cornerXYZ[i]     = coordinate[i];
+        cornerXYZ[3 + i] = coordinate[i] + columnsOffset;
+        cornerXYZ[6 + i] = coordinate[i] + columnsOffset + rowsOffset;
+        cornerXYZ[9 + i] = coordinate[i] + rowsOffset;
+    }
+    
+    /*
+     * Corners are on voxel boundaries so the texture coordinates
+     * are at the edges of the voxels.  The slice coordinate may
+     * not be at the center of the slice's voxels so the slice's
+     * texture coordinate is set from its index.
+     */
+    float cornerTextureSTR[12];
+    for (int32_t iCorner = 0; iCorner < 4; iCorner++) {
+        float voxelIndex[3];
+        volumeFile->spaceToIndex(&cornerXYZ[iCorner * 3], voxelIndex);
+        voxelIndex[sliceDimensionIndex] = sliceIndex;
+        for (int32_t i = 0; i < 3; i++) {
+            cornerTextureSTR[iCorner * 3 + i] = (voxelIndex[i] + 0.5) / dimensions[i];
+        }
+    }
+    
+    textures->drawSlice(mapIndex,
+                        cornerXYZ,
+                        cornerTextureSTR,
+                        sliceNormalVector,
+                        sliceOpacity);
+    
+    return true;
+}
+
 /**
  * Draw the voxels in an orthogonal slice.
  *
@@ -258,6 +258,18 @@ namespace caret {
         void setOrthographicProjection(const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
                                        const int viewport[4]);
         
+        bool drawOrthogonalSliceWithTexture(const float sliceNormalVector[3],
+                                            const float coordinate[3],
+                                            const float rowStep[3],
+                                            const float columnStep[3],
+                                            const int64_t numberOfColumns,
+                                            const int64_t numberOfRows,
+                                            const VolumeMappableInterface* volumeInterface,
+                                            const int32_t mapIndex,
+                                            const int64_t sliceDimensionIndex,
+                                            const int64_t sliceIndex,
+                                            const float sliceOpacity);
+        
         void drawOrthogonalSliceVoxels(const float sliceNormalVector[3],
                                        const float coordinate[3],
                                        const float rowStep[3],
@@ -24,12 +24,15 @@
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QFile>
+
 using namespace std;
 using namespace caret;
 
@@ -49,6 +52,7 @@ namespace
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
+        const NiftiHeader& getNiftiHeader() const { return m_nifti.getHeader(); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
         void close();
@@ -61,11 +65,28 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
     
+    class CiftiMmapImpl : public CiftiFile::ReadImplInterface
+    {//read-only, for uncompressed native-endian float32 without scaling, so rows can be used directly from the mapping without locks or copies
+        QFile m_file;
+        const float* m_data;
+        std::vector<int64_t> m_dims;
+    public:
+        CiftiMmapImpl(const CiftiOnDiskImpl& opened);//check isMapped() after constructing, it doesn't throw when the file can't be mapped
+        bool isMapped() const { return m_data != NULL; }
+        static bool canMap(const CiftiOnDiskImpl& opened);
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        QString getFilename() const { return m_file.fileName(); }
+        ~CiftiMmapImpl();
+    };
+    
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
     {
         CiftiXML m_xml;//because we need to parse it to check the dimensions anyway
@@ -97,6 +118,21 @@ namespace
         return (endian == CiftiFile::ANY);
     }
     
+    //returns empty string if the implementation doesn't read from a local file
+    QString getReadingFilename(const CiftiFile::ReadImplInterface* impl, bool& isSwappedOut)
+    {
+        isSwappedOut = false;
+        const CiftiOnDiskImpl* testOnDisk = dynamic_cast<const CiftiOnDiskImpl*>(impl);
+        if (testOnDisk != NULL)
+        {
+            isSwappedOut = testOnDisk->isSwapped();
+            return testOnDisk->getFilename();
+        }
+        const CiftiMmapImpl* testMmap = dynamic_cast<const CiftiMmapImpl*>(impl);
+        if (testMmap != NULL) return testMmap->getFilename();//mapping is only done for native endian
+        return "";
+    }
+    
 }
 
 CiftiFile::ReadImplInterface::~ReadImplInterface()
@@ -119,6 +155,16 @@ void CiftiFile::openFile(const QString& fileName)
     close();//to make sure it closes everything first, even if the open throws
     CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(FileInformation(fileName).getAbsoluteFilePath()));//this constructor opens existing file read-only
     m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
+    if (CiftiMmapImpl::canMap(*newRead))
+    {
+        CaretPointer<CiftiMmapImpl> newMapped(new CiftiMmapImpl(*newRead));
+        if (newMapped->isMapped())
+        {
+            m_readingImpl = newMapped;//newRead is still used for the xml below, and closes its file handle when we return
+        } else {
+            CaretLogFine("unable to memory map cifti file '" + fileName + "', using normal reading");
+        }
+    }
     m_xml = newRead->getCiftiXML();
     m_dims = m_xml.getDimensions();
     m_onDiskVersion = m_xml.getParsedVersion();
@@ -178,11 +224,12 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
     bool writeSwapped = shouldSwap(endian);
     FileInformation myInfo(fileName);
     QString canonicalFilename = myInfo.getCanonicalFilePath();//NOTE: returns EMPTY STRING for nonexistant file
-    const CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
+    bool readingSwapped = false;
+    QString readingFilename = getReadingFilename(m_readingImpl, readingSwapped);
     bool collision = false, hadWriter = (m_writingImpl != NULL);
-    if (testImpl != NULL && canonicalFilename != "" && FileInformation(testImpl->getFilename()).getCanonicalFilePath() == canonicalFilename)
+    if (readingFilename != "" && canonicalFilename != "" && FileInformation(readingFilename).getCanonicalFilePath() == canonicalFilename)
     {//empty string test is so that we don't say collision if both are nonexistant - could happen if file is removed/unlinked while reading on some filesystems
-        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == testImpl->isSwapped())) return;//don't need to copy to itself
+        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == readingSwapped)) return;//don't need to copy to itself
         collision = true;//we need to copy to memory temporarily
         CaretPointer<WriteImplInterface> tempMemory(new CiftiMemoryImpl(m_xml));
         copyImplData(m_readingImpl, tempMemory, m_dims);
@@ -226,6 +273,7 @@ void CiftiFile::convertToInMemory()
     if (isInMemory()) return;
     m_writingFile = "";//make sure it doesn't do on-disk when set...() is called
     if (m_readingImpl == NULL) return;//not set up yet
+    CaretProfiler::Span readSpan("io", "read into memory " + m_fileName);
     CaretPointer<WriteImplInterface> tempWrite(new CiftiMemoryImpl(m_xml));//if we get an error while reading, free the memory immediately, and don't leave m_readingImpl and m_writingImpl pointing to different things
     copyImplData(m_readingImpl, tempWrite, m_dims);
     m_writingImpl = tempWrite;
@@ -257,6 +305,22 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
+const float* CiftiFile::getRowPointer(const int64_t& index) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowPointer with single index called on non-2D CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    vector<int64_t> tempvec(1, index);
+    return m_readingImpl->getRowPointer(tempvec);
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -375,10 +439,11 @@ void CiftiFile::verifyWriteImpl()
     } else {//NOTE: m_onDiskVersion gets set in setWritingFile
         if (m_readingImpl != NULL)
         {
-            CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
-            if (testImpl != NULL)
+            bool readingSwapped = false;
+            QString readingFilename = getReadingFilename(m_readingImpl, readingSwapped);
+            if (readingFilename != "")
             {
-                QString canonicalCurrent = FileInformation(testImpl->getFilename()).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
+                QString canonicalCurrent = FileInformation(readingFilename).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
                 if (canonicalCurrent != "" && canonicalCurrent == FileInformation(m_writingFile).getCanonicalFilePath())//these were already absolute
                 {
                     convertToInMemory();//save existing data in memory before we clobber file
@@ -422,6 +487,11 @@ void CiftiMemoryImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     }
 }
 
+const float* CiftiMemoryImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    return m_array.get(1, indexSelect);
+}
+
 void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
@@ -698,6 +768,80 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+bool CiftiMmapImpl::canMap(const CiftiOnDiskImpl& opened)
+{
+    if (opened.getFilename().endsWith(".gz")) return false;
+    const NiftiHeader& myHeader = opened.getNiftiHeader();
+    if (myHeader.getDataType() != NIFTI_TYPE_FLOAT32 || myHeader.isSwapped()) return false;
+    double mult, offset;
+    if (myHeader.getDataScaling(mult, offset)) return false;
+    if (myHeader.getDataOffset() % sizeof(float) != 0) return false;//QFile handles page alignment, but we need float alignment
+    return true;
+}
+
+CiftiMmapImpl::CiftiMmapImpl(const CiftiOnDiskImpl& opened)
+{
+    m_data = NULL;
+    m_dims = opened.getCiftiXML().getDimensions();
+    int64_t numElems = 1;
+    for (int i = 0; i < (int)m_dims.size(); ++i)
+    {
+        numElems *= m_dims[i];
+    }
+    int64_t dataOffset = opened.getNiftiHeader().getDataOffset();
+    m_file.setFileName(opened.getFilename());
+    if (!m_file.open(QIODevice::ReadOnly)) return;
+    if (m_file.size() < dataOffset + numElems * (int64_t)sizeof(float)) return;//truncated file, let the on-disk implementation deal with it
+    uchar* mapped = m_file.map(dataOffset, numElems * sizeof(float));//can fail for large files on 32-bit, or some filesystems
+    if (mapped == NULL) return;
+    m_data = (const float*)mapped;
+}
+
+CiftiMmapImpl::~CiftiMmapImpl()
+{
+    if (m_data != NULL)
+    {
+        m_file.unmap((uchar*)m_data);
+    }
+}
+
+const float* CiftiMmapImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    CaretAssert(indexSelect.size() + 1 == m_dims.size());
+    int64_t offset = 0, stride = m_dims[0];
+    for (int i = 0; i < (int)indexSelect.size(); ++i)
+    {
+        CaretAssert(indexSelect[i] >= 0 && indexSelect[i] < m_dims[i + 1]);
+        offset += indexSelect[i] * stride;
+        stride *= m_dims[i + 1];
+    }
+    return m_data + offset;
+}
+
+void CiftiMmapImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    const float* ref = getRowPointer(indexSelect);
+    int64_t rowSize = m_dims[0];
+    CaretProfiler::IOTimer ioTimer(false, rowSize * sizeof(float));//page faults on the mapping are the actual reads
+    for (int64_t i = 0; i < rowSize; ++i)
+    {
+        dataOut[i] = ref[i];
+    }
+}
+
+void CiftiMmapImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(m_dims.size() == 2);//otherwise, CiftiFile shouldn't have called this
+    int64_t rowSize = m_dims[0];
+    int64_t colSize = m_dims[1];
+    CaretAssert(index >= 0 && index < rowSize);//because we are doing the indexing math manually for speed
+    CaretProfiler::IOTimer ioTimer(false, colSize * sizeof(float));
+    for (int64_t i = 0; i < colSize; ++i)
+    {
+        dataOut[i] = m_data[index + rowSize * i];
+    }
+}
+
 CiftiXnatImpl::CiftiXnatImpl(const QString& url, const QString& user, const QString& pass)
 {
     CaretHttpManager::setAuthentication(url, user, pass);
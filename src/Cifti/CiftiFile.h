@@ -69,6 +69,9 @@ namespace caret
             return MultiDimIterator<int64_t>(std::vector<int64_t>(m_dims.begin() + 1, m_dims.end()));
         }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        ///direct access to a row without a copy, if the file is memory mapped or in memory, otherwise returns NULL and you must use getRow
+        ///NOTE: pointer is only valid until the file is modified, rewritten, or closed
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
@@ -81,6 +84,7 @@ namespace caret
         
         void getRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const;//backwards compatibility for old CiftiFile/CiftiInterface
         void getRow(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const int64_t& index) const;//for 2D only
         int64_t getNumberOfRows() const;
         int64_t getNumberOfColumns() const;
         
@@ -91,6 +95,7 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }//only for implementations that have the data in native float32 in the address space
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
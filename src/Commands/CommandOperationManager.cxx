@@ -198,6 +198,7 @@
 #include "OperationSetMapNames.h"
 #include "OperationSetStructure.h"
 #include "OperationShowScene.h"
+#include "OperationShowSceneBatch.h"
 #include "OperationSpecFileMerge.h"
 #include "OperationSpecFileRelocate.h"
 #include "OperationSurfaceClosestVertex.h"
@@ -241,8 +242,12 @@
 #include "ProgramParameters.h"
 
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "dot_wrapper.h"
+#include "GzipIndexedReader.h"
+#include "MetricSmoothingObject.h"
 #include "StructureEnum.h"
+#include "SurfaceHelperCache.h"
 
 #include <iostream>
 #include <map>
@@ -452,6 +457,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationSetStructure()));
     if (OperationShowScene::isShowSceneCommandAvailable()) {
         this->commandOperations.push_back(new CommandParser(new AutoOperationShowScene()));
+        this->commandOperations.push_back(new CommandParser(new AutoOperationShowSceneBatch()));
     }
     this->commandOperations.push_back(new CommandParser(new AutoOperationSpecFileMerge()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationSpecFileRelocate()));
@@ -575,6 +581,22 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
     }
+    if (getGlobalOption(parameters, "-gzip-index-cache", 0, globalOptionArgs))
+    {
+        GzipIndexedReader::setUseSidecar(true);
+    }
+    if (getGlobalOption(parameters, "-smoothing-cache", 1, globalOptionArgs))
+    {
+        MetricSmoothingObject::setCacheDirectory(globalOptionArgs[0]);
+    }
+    if (getGlobalOption(parameters, "-surface-cache", 1, globalOptionArgs))
+    {
+        SurfaceHelperCache::setCacheDirectory(globalOptionArgs[0]);
+    }
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        if (!CaretProfiler::enable(globalOptionArgs[0])) throw CommandException("unable to open profile output file '" + globalOptionArgs[0] + "'");
+    }
     int16_t ciftiDType = NIFTI_TYPE_FLOAT32;
     bool ciftiScale = false;
     double ciftiMin = -1.0, ciftiMax = -1.0;
@@ -668,10 +690,17 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
                 } else {
                     operation->setCiftiOutputDTypeNoScale(ciftiDType);
                 }
-                operation->execute(parameters, preventProvenance);
+                try
+                {
+                    operation->execute(parameters, preventProvenance);
+                } catch (...) {
+                    CaretProfiler::writeTrace();//the profile of a failed run can still show where the time went
+                    throw;
+                }
             }
         }
     }
+    CaretProfiler::writeTrace();//does nothing without -profile
 }
 
 AString CommandOperationManager::doCompletion(ProgramParameters& parameters, const bool& useExtGlob)
@@ -704,6 +733,22 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
+    parseGlobalOption(parameters, "-gzip-index-cache", 0, globalOptionArgs, true);
+    OptionInfo smoothCacheInfo = parseGlobalOption(parameters, "-smoothing-cache", 1, globalOptionArgs, true);
+    if (smoothCacheInfo.specified && !smoothCacheInfo.complete)
+    {
+        return "fileglob *";//the completion script has no directory-only response, so glob to everything
+    }
+    OptionInfo surfCacheInfo = parseGlobalOption(parameters, "-surface-cache", 1, globalOptionArgs, true);
+    if (surfCacheInfo.specified && !surfCacheInfo.complete)
+    {
+        return "fileglob *";
+    }
+    OptionInfo profileInfo = parseGlobalOption(parameters, "-profile", 1, globalOptionArgs, true);
+    if (profileInfo.specified && !profileInfo.complete)
+    {
+        return "fileglob *";
+    }
     OptionInfo ciftiDTypeInfo = parseGlobalOption(parameters, "-cifti-output-datatype", 1, globalOptionArgs, true);
     if (ciftiDTypeInfo.specified && !ciftiDTypeInfo.complete)
     {
@@ -714,7 +759,7 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     {//can't tab complete a literal number
         return "";
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -gzip-index-cache\\ -smoothing-cache\\ -surface-cache\\ -profile\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -1089,7 +1134,8 @@ void CommandOperationManager::printGlobalOptions()
     cout << "   -simd <type>                      set the SIMD implementation to use" << endl;
     cout << "                                        (currently used only for correlation," << endl;
     cout << "                                        default AUTO which selects fastest" << endl;
-    cout << "                                        supported), valid values are:" << endl;
+    cout << "                                        supported, except AVX512 must be" << endl;
+    cout << "                                        requested), valid values are:" << endl;
     vector<DotSIMDEnum::Enum> simdTypes = DotSIMDEnum::getAllEnums();
     for (vector<DotSIMDEnum::Enum>::iterator iter = simdTypes.begin();
          iter != simdTypes.end();
@@ -1097,6 +1143,34 @@ void CommandOperationManager::printGlobalOptions()
         cout << "         " << DotSIMDEnum::toName(*iter) << endl;
     }
     cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -gzip-index-cache                 save the seek index of .gz input files as" << endl;
+    cout << "                                        '<file>.gzidx' once fully read, and use" << endl;
+    cout << "                                        such files when present, to speed up" << endl;
+    cout << "                                        random access into compressed files" << endl;
+    cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -smoothing-cache <directory>      save surface smoothing weights in" << endl;
+    cout << "                                        <directory>, and reuse them when the" << endl;
+    cout << "                                        same surface, kernel, method, roi and" << endl;
+    cout << "                                        vertex areas are used again" << endl;
+    cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -surface-cache <directory>        save surface topology and geodesic" << endl;
+    cout << "                                        neighbor information in <directory>," << endl;
+    cout << "                                        and reuse it when the same surface is" << endl;
+    cout << "                                        used again" << endl;
+    cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -profile <file>                   write a Chrome trace JSON file of where the" << endl;
+    cout << "                                        time went: wall time, cpu time, peak" << endl;
+    cout << "                                        memory and cifti/nifti bytes and time" << endl;
+    cout << "                                        read/written, for the command, each" << endl;
+    cout << "                                        input/output file, and each algorithm" << endl;
+    cout << "                                        and its subalgorithms and tasks, view it" << endl;
+    cout << "                                        with chrome://tracing or" << endl;
+    cout << "                                        ui.perfetto.dev" << endl;
+    cout << endl;
 }
 
 void CommandOperationManager::printCiftiHelp()
@@ -27,6 +27,7 @@
 #include "CaretCommandLine.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "CiftiFile.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
@@ -35,6 +36,7 @@
 #include "LabelFile.h"
 #include "MetricFile.h"
 #include "OperationException.h"
+#include "ProgressObject.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
 
@@ -84,6 +86,7 @@ void CommandParser::setCiftiOutputDTypeNoScale(const int16_t& dtype)
 
 void CommandParser::executeOperation(ProgramParameters& parameters)
 {
+    CaretProfiler::Span commandSpan("command", getCommandLineSwitch());
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
     vector<OutputAssoc> myOutAssoc;
     m_provenance = caret_global_commandLine;
@@ -97,7 +100,14 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
     //code to show what arguments map to what parameters should go here
     if (m_doProvenance) provenanceBeforeOperation(myOutAssoc);
-    m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    CaretPointer<ProgressObject> myProgress;//TODO: progress status for caret_command? would probably get messed up by any command info output
+    if (CaretProfiler::isEnabled())
+    {//but when profiling, give it a progress object so that the spans follow the algorithm progress hierarchy
+        myProgress.grabNew(new ProgressObject(1.0f));
+        myProgress->setProfileName(getCommandLineSwitch());
+    }
+    m_autoOper->useParameters(myAlgParams.getPointer(), myProgress);
+    if (myProgress != NULL) myProgress->forceFinish();
     vector<AString> uncheckedWarnings = myAlgParams->findUncheckedParams("the command");
     for (size_t i = 0; i < uncheckedWarnings.size(); ++i)
     {
@@ -168,6 +178,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::BORDER:
                 {
                     CaretPointer<BorderFile> myFile(new BorderFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -193,6 +204,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 {
                     FileInformation myInfo(nextArg);
                     CaretPointer<CiftiFile> myFile(new CiftiFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->openFile(nextArg);
                     m_inputCiftiNames[myInfo.getCanonicalFilePath()] = myFile;//track input cifti, so we can check their size
                     if (m_doProvenance)//just an optimization, if we aren't going to write provenance, don't generate it, either
@@ -232,6 +244,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::FOCI:
                 {
                     CaretPointer<FociFile> myFile(new FociFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -267,6 +280,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::LABEL:
                 {
                     CaretPointer<LabelFile> myFile(new LabelFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -291,6 +305,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::METRIC:
                 {
                     CaretPointer<MetricFile> myFile(new MetricFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -325,6 +340,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::SURFACE:
                 {
                     CaretPointer<SurfaceFile> myFile(new SurfaceFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -349,6 +365,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::VOLUME:
                 {
                     CaretPointer<VolumeFile> myFile(new VolumeFile());
+                    CaretProfiler::Span readSpan("io", "read " + nextArg);
                     myFile->readFile(nextArg);
                     if (m_doProvenance)
                     {
@@ -838,6 +855,7 @@ void CommandParser::provenanceBeforeOperation(const vector<OutputAssoc>& outAsso
     for (uint32_t i = 0; i < outAssociation.size(); ++i)
     {
         AbstractParameter* myParam = outAssociation[i].m_param;
+        CaretProfiler::Span writeSpan("io", "write " + outAssociation[i].m_fileName);
         switch (myParam->getType())
         {
             case OperationParametersEnum::CIFTI:
@@ -942,6 +960,7 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
     for (uint32_t i = 0; i < outAssociation.size(); ++i)
     {
         AbstractParameter* myParam = outAssociation[i].m_param;
+        CaretProfiler::Span writeSpan("io", "write " + outAssociation[i].m_fileName);
         switch (myParam->getType())
         {
             case OperationParametersEnum::CIFTI:
@@ -985,6 +1004,7 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
     for (uint32_t i = 0; i < outAssociation.size(); ++i)
     {
         AbstractParameter* myParam = outAssociation[i].m_param;
+        CaretProfiler::Span writeSpan("io", "write " + outAssociation[i].m_fileName);
         switch (myParam->getType())
         {
             case OperationParametersEnum::BOOL://ignores the name you give the output for now, but what gives primitive type output and how is it used?
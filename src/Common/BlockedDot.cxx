@@ -0,0 +1,129 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "BlockedDot.h"
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+namespace
+{
+    const int FLUSH_SPAN = 64;//number of products summed in float before adding into the double totals
+
+    //the register tile: NUM_LEFT rows against one panel, the inner loop is over the panel width, which is contiguous in the packed layout
+    //so the compiler can vectorize it without needing to reassociate floating point sums
+    template <int NUM_LEFT>
+    void tileDots(const float* const* leftRows, const float* packed, const int& length, double* dotsOut)
+    {
+        const int WIDTH = BlockedDot::PANEL_WIDTH;
+        double totals[NUM_LEFT][WIDTH];
+        for (int i = 0; i < NUM_LEFT; ++i)
+        {
+            for (int j = 0; j < WIDTH; ++j)
+            {
+                totals[i][j] = 0.0;
+            }
+        }
+        for (int spanStart = 0; spanStart < length; spanStart += FLUSH_SPAN)
+        {
+            int spanEnd = spanStart + FLUSH_SPAN;
+            if (spanEnd > length) spanEnd = length;
+            float accum[NUM_LEFT][WIDTH];
+            for (int i = 0; i < NUM_LEFT; ++i)
+            {
+                for (int j = 0; j < WIDTH; ++j)
+                {
+                    accum[i][j] = 0.0f;
+                }
+            }
+            for (int k = spanStart; k < spanEnd; ++k)
+            {
+                const float* panelElems = packed + k * WIDTH;
+                for (int i = 0; i < NUM_LEFT; ++i)
+                {
+                    const float leftVal = leftRows[i][k];
+                    for (int j = 0; j < WIDTH; ++j)
+                    {
+                        accum[i][j] += leftVal * panelElems[j];
+                    }
+                }
+            }
+            for (int i = 0; i < NUM_LEFT; ++i)
+            {
+                for (int j = 0; j < WIDTH; ++j)
+                {
+                    totals[i][j] += accum[i][j];
+                }
+            }
+        }
+        for (int i = 0; i < NUM_LEFT; ++i)
+        {
+            for (int j = 0; j < WIDTH; ++j)
+            {
+                dotsOut[i * WIDTH + j] = totals[i][j];
+            }
+        }
+    }
+}
+
+void BlockedDot::packPanel(const float* const* rows, const int& numRows, const int& length, float* packedOut)
+{
+    CaretAssert(numRows > 0 && numRows <= PANEL_WIDTH);
+    for (int j = 0; j < numRows; ++j)
+    {
+        const float* thisRow = rows[j];
+        for (int k = 0; k < length; ++k)
+        {
+            packedOut[k * PANEL_WIDTH + j] = thisRow[k];
+        }
+    }
+    for (int j = numRows; j < PANEL_WIDTH; ++j)//zero the unused rows so the tile doesn't need special cases
+    {
+        for (int k = 0; k < length; ++k)
+        {
+            packedOut[k * PANEL_WIDTH + j] = 0.0f;
+        }
+    }
+}
+
+void BlockedDot::panelDots(const float* const* leftRows, const int& numLeft, const float* packed, const int& length, double* dotsOut)
+{
+    int i = 0;
+    for (; i + TILE_ROWS <= numLeft; i += TILE_ROWS)
+    {
+        tileDots<TILE_ROWS>(leftRows + i, packed, length, dotsOut + i * PANEL_WIDTH);
+    }
+    switch (numLeft - i)//remainder, no more than TILE_ROWS - 1
+    {
+        case 3:
+            tileDots<3>(leftRows + i, packed, length, dotsOut + i * PANEL_WIDTH);
+            break;
+        case 2:
+            tileDots<2>(leftRows + i, packed, length, dotsOut + i * PANEL_WIDTH);
+            break;
+        case 1:
+            tileDots<1>(leftRows + i, packed, length, dotsOut + i * PANEL_WIDTH);
+            break;
+        default:
+            CaretAssert(numLeft - i == 0);
+            break;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef __BLOCKED_DOT_H__
+#define __BLOCKED_DOT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+namespace caret {
+
+    ///computes tiles of dot products between two sets of rows (ie, a blocked matrix multiply against a transposed matrix)
+    ///instead of one sddot per pair, so each row is streamed from memory once per tile instead of once per pair
+    class BlockedDot
+    {
+    public:
+        enum
+        {
+            PANEL_WIDTH = 8,//number of rows interleaved in a packed panel, the output tile width
+            TILE_ROWS = 4//number of left rows the register tile handles at once
+        };
+
+        ///number of floats needed to hold a packed panel of rows with the given length
+        static int packedPanelSize(const int& length) { return PANEL_WIDTH * length; }
+
+        ///interleave up to PANEL_WIDTH rows so that element k of all rows is contiguous, missing rows are zero filled
+        static void packPanel(const float* const* rows, const int& numRows, const int& length, float* packedOut);
+
+        ///dot products of each left row against every row of a packed panel, output is dotsOut[i * PANEL_WIDTH + j]
+        ///accumulates in float over short spans, and sums the spans in double, so precision is similar to sddot
+        static void panelDots(const float* const* leftRows, const int& numLeft, const float* packed, const int& length, double* dotsOut);
+    };
+
+}
+
+#endif //__BLOCKED_DOT_H__
@@ -28,12 +28,21 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "DataFileException.h"
+#include "GzipIndexedReader.h"
+#include "GzipParallelWriter.h"
 
 #include <QFile>
 #include "zlib.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+
+#ifndef CARET_OS_WINDOWS
+#include <unistd.h>
+#endif
 
 using namespace caret;
 using namespace std;
@@ -45,6 +54,8 @@ namespace caret
     class ZFileImpl : public CaretBinaryFile::ImplInterface
     {
         gzFile m_zfile;
+        CaretPointer<GzipIndexedReader> m_indexed;//used for reading gzip files, so that seeking backwards doesn't need to decompress from the start
+        CaretPointer<GzipParallelWriter> m_writer;//used for writing, compresses with multiple threads
         const static int64_t CHUNK_SIZE;
     public:
         ZFileImpl() { m_zfile = NULL; }
@@ -52,7 +63,7 @@ namespace caret
         void close();
         void seek(const int64_t& position);
         int64_t pos();
-        int64_t size() { return -1; }
+        int64_t size() { if (m_indexed != NULL) return m_indexed->size(); return -1; }
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
         ~ZFileImpl();
@@ -64,8 +75,14 @@ namespace caret
     class QFileImpl : public CaretBinaryFile::ImplInterface
     {
         QFile m_file;
+        QIODevice::OpenMode m_openMode;
+        std::atomic<bool> m_unbuffered;
+        bool m_opened;//only changes in open() and close(), not while setUnbuffered() reopens the file, so threads doing positional IO always agree
+        CaretMutex m_reopenMutex;
         const static int64_t CHUNK_SIZE;
+        void setUnbuffered();
     public:
+        QFileImpl() : m_openMode(QIODevice::NotOpen), m_unbuffered(false), m_opened(false) { }
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
         void close();
         void seek(const int64_t& position);
@@ -73,11 +90,26 @@ namespace caret
         int64_t size() { return m_file.size(); }
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
+#ifndef CARET_OS_WINDOWS
+        bool hasPositionalIO() { return m_opened; }
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);
+        void writeAt(const int64_t& position, const void* dataIn, const int64_t& count);
+#endif
     };
     
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
 }
 
+void CaretBinaryFile::ImplInterface::readAt(const int64_t&, void*, const int64_t&, int64_t*)
+{
+    throw DataFileException("positional reading is not supported for file '" + m_fileName + "'");
+}
+
+void CaretBinaryFile::ImplInterface::writeAt(const int64_t&, const void*, const int64_t&)
+{
+    throw DataFileException("positional writing is not supported for file '" + m_fileName + "'");
+}
+
 CaretBinaryFile::ImplInterface::~ImplInterface()
 {
 }
@@ -162,6 +194,26 @@ void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
     m_impl->write(dataIn, count);
 }
 
+bool CaretBinaryFile::hasPositionalIO()
+{
+    if (m_curMode == NONE) return false;
+    return m_impl->hasPositionalIO();
+}
+
+void CaretBinaryFile::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    CaretAssert(position >= 0 && count >= 0);
+    if (!getOpenForRead()) throw DataFileException("file is not open for reading");
+    m_impl->readAt(position, dataOut, count, numRead);
+}
+
+void CaretBinaryFile::writeAt(const int64_t& position, const void* dataIn, const int64_t& count)
+{
+    CaretAssert(position >= 0 && count >= 0);
+    if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
+    m_impl->writeAt(position, dataIn, count);
+}
+
 #ifdef ZLIB_VERSION
 void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
 {
@@ -179,6 +231,21 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
         default:
             throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
     }
+    if (opmode == CaretBinaryFile::READ && QFile::exists(filename))
+    {
+        CaretPointer<GzipIndexedReader> indexed(new GzipIndexedReader());
+        if (indexed->open(filename))
+        {
+            m_indexed = indexed;
+            return;
+        }//not gzip format, let zlib deal with it, gzread reads uncompressed files transparently
+    }
+    if (opmode == CaretBinaryFile::WRITE_TRUNCATE)
+    {
+        m_writer.grabNew(new GzipParallelWriter());
+        m_writer->open(filename);
+        return;
+    }
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     m_zfile = gzopen64(filename.toLocal8Bit().constData(), mode);
 #else
@@ -201,6 +268,17 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
 
 void ZFileImpl::close()
 {
+    if (m_indexed != NULL)
+    {
+        m_indexed->close();
+        m_indexed.grabNew(NULL);
+    }
+    if (m_writer != NULL)
+    {
+        CaretPointer<GzipParallelWriter> toClose = m_writer;
+        m_writer.grabNew(NULL);//don't try closing it again if this throws
+        toClose->close();
+    }
     if (m_zfile == NULL) return;//happens when closed and then destroyed, error opening
     if (gzclose(m_zfile) != 0) throw DataFileException("error closing compressed file '" + m_fileName + "'");
     m_zfile = NULL;
@@ -208,6 +286,17 @@ void ZFileImpl::close()
 
 void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
+    if (m_indexed != NULL)
+    {
+        int64_t totalRead = m_indexed->read(dataOut, count);
+        if (numRead == NULL)
+        {
+            if (totalRead != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+        } else {
+            *numRead = totalRead;
+        }
+        return;
+    }
     if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalRead = 0;
     int readret = 0;//to preserve the info of the read that broke early
@@ -232,6 +321,16 @@ void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 
 void ZFileImpl::seek(const int64_t& position)
 {
+    if (m_indexed != NULL)
+    {
+        m_indexed->seek(position);
+        return;
+    }
+    if (m_writer != NULL)
+    {
+        m_writer->seek(position);
+        return;
+    }
     if (m_zfile == NULL) throw DataFileException("seek called on unopened ZFileImpl");//shouldn't happen
     if (pos() == position) return;//slight hack, since gzseek is slow or nonfunctional for some cases, so don't try it unless necessary
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
@@ -244,6 +343,8 @@ void ZFileImpl::seek(const int64_t& position)
 
 int64_t ZFileImpl::pos()
 {
+    if (m_indexed != NULL) return m_indexed->pos();
+    if (m_writer != NULL) return m_writer->pos();
     if (m_zfile == NULL) throw DataFileException("pos called on unopened ZFileImpl");//shouldn't happen
 #if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
     return gztell64(m_zfile);
@@ -254,6 +355,11 @@ int64_t ZFileImpl::pos()
 
 void ZFileImpl::write(const void* dataIn, const int64_t& count)
 {
+    if (m_writer != NULL)
+    {
+        m_writer->write(dataIn, count);
+        return;
+    }
     if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalWritten = 0;
     while (totalWritten < count)
@@ -289,6 +395,8 @@ void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
     if (opmode & CaretBinaryFile::READ) mode |= QIODevice::ReadOnly;
     if (opmode & CaretBinaryFile::WRITE) mode |= QIODevice::WriteOnly;
     if (opmode & CaretBinaryFile::TRUNCATE) mode |= QIODevice::Truncate;//expect QFile to recognize silliness like TRUNCATE by itself
+    m_openMode = mode;
+    m_unbuffered = false;//buffered until positional IO is used, so header and extension reads don't become many tiny syscalls
     m_file.setFileName(filename);
     if (!m_file.open(mode))
     {
@@ -314,10 +422,12 @@ void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
                 }
         }
     }
+    m_opened = true;
 }
 
 void QFileImpl::close()
 {
+    m_opened = false;
     m_file.close();
 }
 
@@ -374,3 +484,70 @@ void QFileImpl::write(const void* dataIn, const int64_t& count)
                          + " bytes.");
     if (total != count) throw DataFileException(msg);
 }
+
+#ifndef CARET_OS_WINDOWS
+void QFileImpl::setUnbuffered()
+{//positional IO goes straight to the file descriptor, so from then on QFile must not hold stale or pending data in its own buffer
+    if (m_unbuffered) return;
+    CaretMutexLocker locked(&m_reopenMutex);
+    if (m_unbuffered) return;//another thread did it while we waited
+    int64_t curPos = m_file.pos();
+    m_file.close();//writes out anything pending in the buffer
+    QIODevice::OpenMode reopenMode = (m_openMode & ~QIODevice::Truncate) | QIODevice::Unbuffered;
+    if (reopenMode & QIODevice::WriteOnly) reopenMode |= QIODevice::ReadOnly;//QFile implies truncate for write-only, which would erase what was already written
+    if (!m_file.open(reopenMode))
+    {
+        throw DataFileException("failed to reopen file '" + m_fileName + "'");
+    }
+    if (!m_file.seek(curPos)) throw DataFileException("seek failed in file '" + m_fileName + "'");
+    m_unbuffered = true;
+}
+
+void QFileImpl::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    setUnbuffered();
+    int fd = m_file.handle();
+    if (fd < 0) throw DataFileException("readAt called on unopened QFileImpl");//shouldn't happen
+    int64_t total = 0;
+    ssize_t readret = -1;
+    while (total < count)
+    {
+        int64_t maxToRead = min(count - total, CHUNK_SIZE);
+        readret = pread(fd, ((char*)dataOut) + total, maxToRead, position + total);
+        if (readret < 0 && errno == EINTR) continue;
+        if (readret < 1) break;//0 or -1 means eof or error
+        total += readret;
+    }
+    if (numRead == NULL)
+    {
+        if (total != count)
+        {
+            if (readret < 0) throw DataFileException("error while reading file '" + m_fileName + "'");
+            throw DataFileException("premature end of file in '" + m_fileName + "'");
+        }
+    } else {
+        *numRead = total;
+    }
+}
+
+void QFileImpl::writeAt(const int64_t& position, const void* dataIn, const int64_t& count)
+{
+    setUnbuffered();
+    int fd = m_file.handle();
+    if (fd < 0) throw DataFileException("writeAt called on unopened QFileImpl");//shouldn't happen
+    int64_t total = 0;
+    while (total < count)
+    {
+        int64_t maxToWrite = min(count - total, CHUNK_SIZE);
+        ssize_t writeret = pwrite(fd, ((const char*)dataIn) + total, maxToWrite, position + total);
+        if (writeret < 0 && errno == EINTR) continue;
+        if (writeret < 1) break;
+        total += writeret;
+    }
+    if (total != count)
+    {
+        throw DataFileException("failed to write file '" + m_fileName + "'.  Tried to write " + AString::number(count) +
+                                " bytes but actually wrote " + AString::number(total) + " bytes.");
+    }
+}
+#endif //CARET_OS_WINDOWS
@@ -56,6 +56,11 @@ namespace caret {
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
         int64_t size();//may return -1 if size cannot be determined efficiently
+        //positional IO doesn't use or change the current position, so multiple threads can call it at once without locking
+        //only available when hasPositionalIO() returns true (uncompressed files on unix), otherwise these throw
+        bool hasPositionalIO();
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead = NULL);//same error semantics as read()
+        void writeAt(const int64_t& position, const void* dataIn, const int64_t& count);
         class ImplInterface
         {
         protected:
@@ -69,6 +74,9 @@ namespace caret {
             virtual int64_t size() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual bool hasPositionalIO() { return false; }
+            virtual void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);
+            virtual void writeAt(const int64_t& position, const void* dataIn, const int64_t& count);
             virtual ~ImplInterface();
         };
     private:
@@ -22,7 +22,9 @@
 #include "CaretException.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -39,6 +41,8 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
         throw CaretException("extra characters on end of expression input: '" + m_input.mid(m_position) + "'");
     }
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
+    m_numRegisters = 0;
+    compileNode(*m_root, 0);
 }
 
 double CaretMathExpression::evaluate(const vector<float>& variableValues) const
@@ -47,6 +51,360 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+void CaretMathExpression::evaluate(const vector<const float*>& variableArrays, const int64_t& count, float* dataOut) const
+{
+    CaretAssert(variableArrays.size() == m_varNames.size());
+    const int64_t numBlocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+#pragma omp CARET_PAR if (numBlocks > 16)
+    {
+        vector<double> registers(m_numRegisters * BLOCK_SIZE);
+#pragma omp CARET_FOR schedule(static)
+        for (int64_t block = 0; block < numBlocks; ++block)
+        {
+            const int64_t start = block * BLOCK_SIZE;
+            const int thisCount = (int)min((int64_t)BLOCK_SIZE, count - start);
+            executeBlock(variableArrays, start, thisCount, registers.data());
+            for (int i = 0; i < thisCount; ++i)
+            {
+                dataOut[start + i] = (float)registers[i];//result is always in register 0
+            }
+        }
+    }
+}
+
+void CaretMathExpression::compileNode(const MathNode& node, const int& reg)
+{
+    if (reg + 1 > m_numRegisters) m_numRegisters = reg + 1;
+    const int end = (int)node.m_arguments.size();
+    switch (node.m_type)
+    {
+        case MathNode::OR:
+        case MathNode::AND:
+        case MathNode::EQUAL:
+        case MathNode::GREATERLESS:
+        case MathNode::ADDSUB:
+        case MathNode::MULTDIV:
+        {//chained binary operators evaluate left to right, accumulating into reg
+            CaretAssert(end > 1);
+            compileNode(*(node.m_arguments[0]), reg);
+            for (int i = 1; i < end; ++i)
+            {
+                compileNode(*(node.m_arguments[i]), reg + 1);
+                Instruction::OpCode op = Instruction::ADD;
+                switch (node.m_type)
+                {
+                    case MathNode::OR:
+                        op = Instruction::OR;
+                        break;
+                    case MathNode::AND:
+                        op = Instruction::AND;
+                        break;
+                    case MathNode::EQUAL:
+                        op = (node.m_invert[i] ? Instruction::NOT_EQUAL : Instruction::EQUAL);
+                        break;
+                    case MathNode::GREATERLESS:
+                        if (node.m_inclusive[i])
+                        {
+                            op = (node.m_invert[i] ? Instruction::LESS_EQUAL : Instruction::GREATER_EQUAL);
+                        } else {
+                            op = (node.m_invert[i] ? Instruction::LESS : Instruction::GREATER);
+                        }
+                        break;
+                    case MathNode::ADDSUB:
+                        op = (node.m_invert[i] ? Instruction::SUBTRACT : Instruction::ADD);
+                        break;
+                    case MathNode::MULTDIV:
+                        op = (node.m_invert[i] ? Instruction::DIVIDE : Instruction::MULTIPLY);
+                        break;
+                    default:
+                        CaretAssert(0);
+                }
+                Instruction myInst(op, reg);
+                myInst.m_second = reg + 1;
+                m_program.push_back(myInst);
+            }
+            break;
+        }
+        case MathNode::NOT:
+        case MathNode::NEGATE:
+            CaretAssert(end == 1);
+            compileNode(*(node.m_arguments[0]), reg);
+            m_program.push_back(Instruction(node.m_type == MathNode::NOT ? Instruction::NOT : Instruction::NEGATE, reg));
+            break;
+        case MathNode::POW:
+        {
+            CaretAssert(end == 2);
+            compileNode(*(node.m_arguments[0]), reg);
+            compileNode(*(node.m_arguments[1]), reg + 1);
+            Instruction myInst(Instruction::POW, reg);
+            myInst.m_second = reg + 1;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::FUNC:
+        {
+            if (node.m_function == MathFunctionEnum::INVALID)
+            {
+                CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
+                throw CaretException("parsing problem in CaretMathExpression");
+            }
+            for (int i = 0; i < end; ++i)
+            {
+                compileNode(*(node.m_arguments[i]), reg + i);
+            }
+            Instruction myInst(Instruction::UNARY_FUNC, reg);
+            switch (end)
+            {
+                case 1:
+                    break;
+                case 2:
+                    myInst.m_op = Instruction::BINARY_FUNC;
+                    myInst.m_second = reg + 1;
+                    break;
+                case 3:
+                    CaretAssert(node.m_function == MathFunctionEnum::CLAMP);
+                    myInst.m_op = Instruction::CLAMP;
+                    myInst.m_second = reg + 1;
+                    myInst.m_third = reg + 2;
+                    break;
+                default:
+                    CaretAssert(0);
+                    throw CaretException("parsing problem in CaretMathExpression");
+            }
+            myInst.m_function = node.m_function;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::VAR:
+        {
+            Instruction myInst(Instruction::LOAD_VAR, reg);
+            myInst.m_varIndex = node.m_varIndex;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::CONST:
+        {
+            Instruction myInst(Instruction::LOAD_CONST, reg);
+            myInst.m_constVal = node.m_constVal;
+            m_program.push_back(myInst);
+            break;
+        }
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "parsing left INVALID MathNode");
+            throw CaretException("parsing problem in CaretMathExpression");
+    }
+}
+
+//NOTE: every operation here must give exactly the same result as MathNode::eval
+void CaretMathExpression::executeBlock(const vector<const float*>& variableArrays, const int64_t& start, const int& count, double* registers) const
+{
+    const int numInst = (int)m_program.size();
+    for (int inst = 0; inst < numInst; ++inst)
+    {
+        const Instruction& myInst = m_program[inst];
+        double* dest = registers + myInst.m_dest * BLOCK_SIZE;
+        const double* second = (myInst.m_second < 0 ? NULL : registers + myInst.m_second * BLOCK_SIZE);
+        switch (myInst.m_op)
+        {
+            case Instruction::LOAD_VAR:
+            {
+                CaretAssertVectorIndex(variableArrays, myInst.m_varIndex);
+                const float* input = variableArrays[myInst.m_varIndex] + start;
+                for (int i = 0; i < count; ++i) dest[i] = input[i];
+                break;
+            }
+            case Instruction::LOAD_CONST:
+            {
+                const double value = myInst.m_constVal;
+                for (int i = 0; i < count; ++i) dest[i] = value;
+                break;
+            }
+            case Instruction::OR:
+                for (int i = 0; i < count; ++i) dest[i] = ((dest[i] > 0.0) || (second[i] > 0.0)) ? 1.0 : 0.0;
+                break;
+            case Instruction::AND:
+                for (int i = 0; i < count; ++i) dest[i] = ((dest[i] > 0.0) && (second[i] > 0.0)) ? 1.0 : 0.0;
+                break;
+            case Instruction::EQUAL:
+            case Instruction::NOT_EQUAL:
+            {
+                const double ifEqual = (myInst.m_op == Instruction::EQUAL ? 1.0 : 0.0);
+                for (int i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(dest[i]), abs(second[i])) / 1000000;//same fudge factor as eval, including the float
+                    bool equal = (dest[i] >= second[i] - adjust) && (dest[i] <= second[i] + adjust);
+                    dest[i] = equal ? ifEqual : 1.0 - ifEqual;
+                }
+                break;
+            }
+            case Instruction::GREATER:
+                for (int i = 0; i < count; ++i) dest[i] = (dest[i] > second[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::LESS:
+                for (int i = 0; i < count; ++i) dest[i] = (dest[i] < second[i] ? 1.0 : 0.0);
+                break;
+            case Instruction::GREATER_EQUAL:
+                for (int i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(dest[i]), abs(second[i])) / 1000000;
+                    dest[i] = (dest[i] >= second[i] - adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::LESS_EQUAL:
+                for (int i = 0; i < count; ++i)
+                {
+                    float adjust = min(abs(dest[i]), abs(second[i])) / 1000000;
+                    dest[i] = (dest[i] <= second[i] + adjust ? 1.0 : 0.0);
+                }
+                break;
+            case Instruction::ADD:
+                for (int i = 0; i < count; ++i) dest[i] += second[i];
+                break;
+            case Instruction::SUBTRACT:
+                for (int i = 0; i < count; ++i) dest[i] -= second[i];
+                break;
+            case Instruction::MULTIPLY:
+                for (int i = 0; i < count; ++i) dest[i] *= second[i];
+                break;
+            case Instruction::DIVIDE:
+                for (int i = 0; i < count; ++i) dest[i] /= second[i];
+                break;
+            case Instruction::NOT:
+                for (int i = 0; i < count; ++i) dest[i] = (dest[i] > 0.0 ? 0.0 : 1.0);
+                break;
+            case Instruction::NEGATE:
+                for (int i = 0; i < count; ++i) dest[i] = -dest[i];
+                break;
+            case Instruction::POW:
+                for (int i = 0; i < count; ++i) dest[i] = pow(dest[i], second[i]);
+                break;
+            case Instruction::UNARY_FUNC:
+                switch (myInst.m_function)
+                {
+                    case MathFunctionEnum::SIN:
+                        for (int i = 0; i < count; ++i) dest[i] = sin(dest[i]);
+                        break;
+                    case MathFunctionEnum::COS:
+                        for (int i = 0; i < count; ++i) dest[i] = cos(dest[i]);
+                        break;
+                    case MathFunctionEnum::TAN:
+                        for (int i = 0; i < count; ++i) dest[i] = tan(dest[i]);
+                        break;
+                    case MathFunctionEnum::ASIN:
+                        for (int i = 0; i < count; ++i) dest[i] = asin(dest[i]);
+                        break;
+                    case MathFunctionEnum::ACOS:
+                        for (int i = 0; i < count; ++i) dest[i] = acos(dest[i]);
+                        break;
+                    case MathFunctionEnum::ATAN:
+                        for (int i = 0; i < count; ++i) dest[i] = atan(dest[i]);
+                        break;
+                    case MathFunctionEnum::SINH:
+                        for (int i = 0; i < count; ++i) dest[i] = sinh(dest[i]);
+                        break;
+                    case MathFunctionEnum::COSH:
+                        for (int i = 0; i < count; ++i) dest[i] = cosh(dest[i]);
+                        break;
+                    case MathFunctionEnum::TANH:
+                        for (int i = 0; i < count; ++i) dest[i] = tanh(dest[i]);
+                        break;
+                    case MathFunctionEnum::ASINH:
+                        for (int i = 0; i < count; ++i)
+                        {
+                            double arg = dest[i];
+                            if (arg > 0)
+                            {
+                                dest[i] = log(arg + sqrt(arg * arg + 1));
+                            } else {
+                                dest[i] = -log(-arg + sqrt(arg * arg + 1));
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::ACOSH:
+                        for (int i = 0; i < count; ++i) dest[i] = log(dest[i] + sqrt(dest[i] * dest[i] - 1));
+                        break;
+                    case MathFunctionEnum::ATANH:
+                        for (int i = 0; i < count; ++i) dest[i] = 0.5 * log((1 + dest[i]) / (1 - dest[i]));
+                        break;
+                    case MathFunctionEnum::LN:
+                        for (int i = 0; i < count; ++i) dest[i] = log(dest[i]);
+                        break;
+                    case MathFunctionEnum::EXP:
+                        for (int i = 0; i < count; ++i) dest[i] = exp(dest[i]);
+                        break;
+                    case MathFunctionEnum::LOG:
+                        for (int i = 0; i < count; ++i) dest[i] = log10(dest[i]);
+                        break;
+                    case MathFunctionEnum::SQRT:
+                        for (int i = 0; i < count; ++i) dest[i] = sqrt(dest[i]);
+                        break;
+                    case MathFunctionEnum::ABS:
+                        for (int i = 0; i < count; ++i) dest[i] = abs(dest[i]);
+                        break;
+                    case MathFunctionEnum::FLOOR:
+                        for (int i = 0; i < count; ++i) dest[i] = floor(dest[i]);
+                        break;
+                    case MathFunctionEnum::ROUND:
+                        for (int i = 0; i < count; ++i)
+                        {
+                            if (dest[i] > 0.0)
+                            {
+                                dest[i] = floor(dest[i] + 0.5);
+                            } else {
+                                dest[i] = ceil(dest[i] - 0.5);
+                            }
+                        }
+                        break;
+                    case MathFunctionEnum::CEIL:
+                        for (int i = 0; i < count; ++i) dest[i] = ceil(dest[i]);
+                        break;
+                    default:
+                        CaretAssertMessage(0, "function compiled as unary, but isn't");
+                        break;
+                }
+                break;
+            case Instruction::BINARY_FUNC:
+                switch (myInst.m_function)
+                {
+                    case MathFunctionEnum::ATAN2:
+                        for (int i = 0; i < count; ++i) dest[i] = atan2(dest[i], second[i]);
+                        break;
+                    case MathFunctionEnum::MIN:
+                        for (int i = 0; i < count; ++i) dest[i] = (dest[i] > second[i] ? second[i] : dest[i]);
+                        break;
+                    case MathFunctionEnum::MAX:
+                        for (int i = 0; i < count; ++i) dest[i] = (dest[i] < second[i] ? second[i] : dest[i]);
+                        break;
+                    case MathFunctionEnum::MOD:
+                        for (int i = 0; i < count; ++i)
+                        {
+                            if (second[i] == 0.0)
+                            {
+                                dest[i] = 0.0;
+                            } else {
+                                dest[i] = dest[i] - second[i] * floor(dest[i] / second[i]);
+                            }
+                        }
+                        break;
+                    default:
+                        CaretAssertMessage(0, "function compiled as binary, but isn't");
+                        break;
+                }
+                break;
+            case Instruction::CLAMP:
+            {
+                const double* high = registers + myInst.m_third * BLOCK_SIZE;
+                for (int i = 0; i < count; ++i)
+                {
+                    if (dest[i] < second[i]) dest[i] = second[i];
+                    if (dest[i] > high[i]) dest[i] = high[i];
+                }
+                break;
+            }
+        }
+    }
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
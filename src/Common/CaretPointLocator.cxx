@@ -19,395 +19,400 @@
 /*LICENSE_END*/
 
 #include "CaretPointLocator.h"
-#include "CaretHeap.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
 
-void CaretPointLocator::addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet)
+namespace
 {
-    if (thisOct->m_leaf)
+    struct CoordLess
     {
-        thisOct->m_data.m_vector->push_back(Point(point, index, pointSet));
-        int curSize = (int)thisOct->m_data.m_vector->size();
-        if (curSize > NUM_POINTS_SPLIT)
-        {//test that not all points are the same, or that they have some minimum percentage spread, or...
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            Vector3D minBox = myVecRef[0].m_point, maxBox = myVecRef[0].m_point, tempvec;
-            tempvec[0] = thisOct->m_bounds[0][2] - thisOct->m_bounds[0][0];
-            tempvec[1] = thisOct->m_bounds[1][2] - thisOct->m_bounds[1][0];
-            tempvec[2] = thisOct->m_bounds[2][2] - thisOct->m_bounds[2][0];
-            float diagonal = tempvec.length();
-            bool safeToSplit = false;
-            for (int i = 1; i < curSize; ++i)
-            {//this will slow down if lots of stuff is continuously put in an Oct that is far too big - use random sampling?
-                if (myVecRef[i].m_point[0] < minBox[0]) minBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] < minBox[1]) minBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] < minBox[2]) minBox[2] = myVecRef[i].m_point[2];
-                if (myVecRef[i].m_point[0] > maxBox[0]) maxBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] > maxBox[1]) maxBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] > maxBox[2]) maxBox[2] = myVecRef[i].m_point[2];
-                tempvec = minBox - maxBox;
-                if (tempvec.length() > 0.01f * diagonal)//make sure points aren't all identical, would go to infinity recursively
-                {
-                    safeToSplit = true;
-                    break;
-                }
-            }
-            if (safeToSplit)
+        const vector<float>& m_coords;
+        int m_axis;
+        CoordLess(const vector<float>& coords, const int axis) : m_coords(coords), m_axis(axis) { }
+        bool operator()(const int64_t& left, const int64_t& right) const
+        {
+            return m_coords[left * 3 + m_axis] < m_coords[right * 3 + m_axis];
+        }
+    };
+
+    float pointToBoxDistSquared(const float boxMin[3], const float boxMax[3], const float point[3])
+    {
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float diff = 0.0f;
+            if (point[i] < boxMin[i])
             {
-                thisOct->makeChildren();
-                for (int i = 0; i < curSize; ++i)
-                {
-                    addPoint(thisOct->containingChild(myVecRef[i].m_point), myVecRef[i].m_point, myVecRef[i].m_index, myVecRef[i].m_mySet);
-                }
-                thisOct->m_data.freeData();
+                diff = boxMin[i] - point[i];
+            } else if (point[i] > boxMax[i]) {
+                diff = point[i] - boxMax[i];
             }
+            ret += diff * diff;
         }
-    } else {
-        addPoint(thisOct->containingChild(point), point, index, pointSet);
+        return ret;
+    }
+
+    float distSquared(const float* a, const float b[3])
+    {
+        float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
     }
 }
 
+CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
+{
+    m_nextSetIndex = 1;//next set will be set #1
+    if (numCoords < 1) return;
+    m_coords.assign(coordsIn, coordsIn + numCoords * 3);
+    m_indices.resize(numCoords);
+    m_sets.resize(numCoords, 0);//this is set #0
+    for (int64_t i = 0; i < numCoords; ++i)
+    {
+        m_indices[i] = i;
+    }
+    rebuild();
+}
+
+CaretPointLocator::CaretPointLocator(const float[3], const float[3])
+{
+    m_nextSetIndex = 0;
+}
+
 int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numCoords)
 {
     CaretMutexLocker locked(&m_modifyMutex);
     int32_t setNum = newIndex();
     if (numCoords < 1) return setNum;
-    if (m_tree == NULL)
-    {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
-        {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
-        }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
-    }
+    m_coords.insert(m_coords.end(), coordsIn, coordsIn + numCoords * 3);
     for (int64_t i = 0; i < numCoords; ++i)
     {
-        int64_t i3 = i * 3;
-        m_tree = m_tree->makeContains(coordsIn + i3);//make new root if needed
-        addPoint(m_tree, coordsIn + i3, i, setNum);//and add the point
+        m_indices.push_back(i);
+        m_sets.push_back(setNum);
     }
+    rebuild();
     return setNum;
 }
 
-CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
+void CaretPointLocator::removePointSet(int32_t whichSet)
 {
-    m_nextSetIndex = 1;//next set will be set #1
-    m_tree = NULL;
-    if (numCoords >= 1)
+    CaretMutexLocker locked(&m_modifyMutex);
+    m_unusedIndexes.push_back(whichSet);
+    int64_t numPoints = (int64_t)m_indices.size(), numKept = 0;
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
+        if (m_sets[i] != whichSet)
         {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
-        }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
-        for (int64_t i = 0; i < numCoords; ++i)
-        {
-            int64_t i3 = i * 3;
-            addPoint(m_tree, coordsIn + i3, i, 0);//this is set #0
+            for (int j = 0; j < 3; ++j)
+            {
+                m_coords[numKept * 3 + j] = m_coords[i * 3 + j];
+            }
+            m_indices[numKept] = m_indices[i];
+            m_sets[numKept] = m_sets[i];
+            ++numKept;
         }
     }
+    if (numKept == numPoints) return;
+    m_coords.resize(numKept * 3);
+    m_indices.resize(numKept);
+    m_sets.resize(numKept);
+    rebuild();
 }
 
-CaretPointLocator::CaretPointLocator(const float minBounds[3], const float maxBounds[3])
+int32_t CaretPointLocator::newIndex()
 {
-    m_nextSetIndex = 0;
-    m_tree = new Oct<LeafVector<Point> >(minBounds, maxBounds);
+    if (m_unusedIndexes.empty())
+    {
+        return m_nextSetIndex++;
+    } else {
+        int32_t ret = m_unusedIndexes[m_unusedIndexes.size() - 1];
+        m_unusedIndexes.pop_back();
+        return ret;
+    }
 }
 
-int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
+void CaretPointLocator::rebuild()
 {
-    if (m_tree == NULL) return -1;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, bestDist = -1.0f, tempf, curDist = m_tree->distToPoint(target);
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist);
-    while (curDist < bestDist || first)
+    const int64_t numPoints = (int64_t)m_indices.size();
+    m_nodes.clear();
+    if (numPoints == 0) return;
+    vector<int64_t> order(numPoints);
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
-        {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
-            {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || first)
-                {
-                    first = false;
-                    bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
-                }
-            }
-            bestDist = sqrt(bestDist2);
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distToPoint(target);
-                        if (tempf < bestDist || first)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
-            }
-        }
-        if (myHeap.isEmpty())
-        {
-            break;//allows us to use top() without violating an assertion
-        }
-        myHeap.top(&curDist);//get the key for the next item
+        order[i] = i;
     }
-    if (infoOut != NULL)
+    m_nodes.reserve(2 * (numPoints / NUM_POINTS_LEAF + 1));
+    buildNode(order, 0, numPoints);
+    vector<float> coords(numPoints * 3);//put the points in leaf order, so each leaf is one contiguous block
+    vector<int64_t> indices(numPoints);
+    vector<int32_t> sets(numPoints);
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
+        for (int j = 0; j < 3; ++j)
+        {
+            coords[i * 3 + j] = m_coords[order[i] * 3 + j];
+        }
+        indices[i] = m_indices[order[i]];
+        sets[i] = m_sets[order[i]];
     }
-    return bestIndex;
+    m_coords.swap(coords);
+    m_indices.swap(indices);
+    m_sets.swap(sets);
 }
 
-int64_t CaretPointLocator::closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut) const
+void CaretPointLocator::buildNode(vector<int64_t>& order, const int64_t start, const int64_t end)
 {
-    if (m_tree == NULL) return -1;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2)
+    int64_t myIndex = (int64_t)m_nodes.size();
+    m_nodes.push_back(Node());
+    float myMin[3], myMax[3];
+    for (int j = 0; j < 3; ++j)
     {
-        if (infoOut != NULL)
+        myMin[j] = numeric_limits<float>::max();
+        myMax[j] = -numeric_limits<float>::max();
+    }
+    for (int64_t i = start; i < end; ++i)
+    {
+        const float* coord = m_coords.data() + order[i] * 3;
+        for (int j = 0; j < 3; ++j)
         {
-            infoOut->whichSet = -1;
-            infoOut->index = -1;
+            myMin[j] = min(myMin[j], coord[j]);
+            myMax[j] = max(myMax[j], coord[j]);
         }
-        return -1;
     }
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, tempf;
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist2);
-    while (curDist2 < bestDist2 || first)
+    for (int j = 0; j < 3; ++j)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
+        m_nodes[myIndex].m_min[j] = myMin[j];
+        m_nodes[myIndex].m_max[j] = myMax[j];
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (myMax[j] - myMin[j] > myMax[axis] - myMin[axis]) axis = j;
+    }
+    if (end - start <= NUM_POINTS_LEAF || !(myMax[axis] > myMin[axis]))
+    {//small enough, or all points identical so splitting can't separate them
+        m_nodes[myIndex].m_start = start;
+        m_nodes[myIndex].m_count = (int32_t)(end - start);
+        return;
+    }
+    int64_t mid = (start + end) / 2;
+    nth_element(order.begin() + start, order.begin() + mid, order.begin() + end, CoordLess(m_coords, axis));
+    m_nodes[myIndex].m_count = 0;
+    buildNode(order, start, mid);//first child immediately follows
+    m_nodes[myIndex].m_start = (int64_t)m_nodes.size();//don't hold a reference across the push_backs
+    buildNode(order, mid, end);
+}
+
+int64_t CaretPointLocator::closestPosition(const float target[3], const float& maxDist2) const
+{
+    if (m_nodes.empty()) return -1;
+    float bestDist2 = maxDist2;
+    int64_t bestPos = -1;
+    pair<int64_t, float> stack[MAX_STACK];//fixed size, so that queries don't allocate
+    int stackSize = 0;
+    float rootDist2 = pointToBoxDistSquared(m_nodes[0].m_min, m_nodes[0].m_max, target);
+    if (rootDist2 <= bestDist2) stack[stackSize++] = make_pair((int64_t)0, rootDist2);
+    while (stackSize > 0)
+    {
+        pair<int64_t, float> current = stack[--stackSize];
+        if (current.second > bestDist2 || (bestPos >= 0 && current.second == bestDist2)) continue;//a closer point was found after this was pushed
+        const Node& myNode = m_nodes[current.first];
+        if (myNode.m_count > 0)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            const int64_t leafEnd = myNode.m_start + myNode.m_count;
+            for (int64_t i = myNode.m_start; i < leafEnd; ++i)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || (first && tempf <= maxDist2))
+                float tempf = distSquared(m_coords.data() + i * 3, target);
+                if (tempf < bestDist2 || (bestPos < 0 && tempf <= bestDist2))//maxDist is inclusive
                 {
-                    first = false;
                     bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
+                    bestPos = i;
                 }
             }
         } else {
-            for (int ii = 0; ii < 2; ++ii)
+            const int64_t children[2] = { current.first + 1, myNode.m_start };
+            float dists[2];
+            for (int i = 0; i < 2; ++i)
             {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf < bestDist2 || (first && tempf <= maxDist2))
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
+                dists[i] = pointToBoxDistSquared(m_nodes[children[i]].m_min, m_nodes[children[i]].m_max, target);
             }
+            const int nearer = (dists[0] <= dists[1] ? 0 : 1);
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            if (dists[1 - nearer] <= bestDist2) stack[stackSize++] = make_pair(children[1 - nearer], dists[1 - nearer]);//farther first, so nearer is searched first
+            if (dists[nearer] <= bestDist2) stack[stackSize++] = make_pair(children[nearer], dists[nearer]);
         }
-        if (myHeap.isEmpty())
-        {
-            break;//allows us to use top() without violating an assertion
-        }
-        myHeap.top(&curDist2);//get the key for the next item
     }
-    if (infoOut != NULL)
+    if (bestPos < 0 && !(maxDist2 < numeric_limits<float>::infinity()))
+    {//unlimited search can only fail with a nan target, and the old octree returned a point anyway
+        bestPos = 0;
+    }
+    return bestPos;
+}
+
+void CaretPointLocator::fillInfo(const int64_t& position, LocatorInfo* infoOut) const
+{
+    if (infoOut == NULL) return;
+    if (position < 0)
     {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
+        infoOut->whichSet = -1;
+        infoOut->index = -1;
+        return;
     }
-    return bestIndex;
+    infoOut->whichSet = m_sets[position];
+    infoOut->index = m_indices[position];
+    infoOut->coords = m_coords.data() + position * 3;
 }
 
-set<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], const float& maxDist) const
+int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
 {
-    set<LocatorInfo> ret;
-    if (m_tree == NULL) return ret;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2) return ret;
-    vector<Oct<LeafVector<Point> >*> myStack;//since we don't need the points sorted by distance
-    myStack.push_back(m_tree);
-    while (!myStack.empty())
+    int64_t position = closestPosition(target, numeric_limits<float>::infinity());
+    fillInfo(position, infoOut);
+    if (position < 0) return -1;
+    return m_indices[position];
+}
+
+int64_t CaretPointLocator::closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut) const
+{
+    int64_t position = closestPosition(target, maxDist * maxDist);
+    fillInfo(position, infoOut);
+    if (position < 0) return -1;
+    return m_indices[position];
+}
+
+void CaretPointLocator::appendInRange(const float target[3], const float& maxDist2, vector<LocatorInfo>& pointsOut) const
+{
+    if (m_nodes.empty()) return;
+    int64_t stack[MAX_STACK];//since we don't need the points sorted by distance
+    int stackSize = 0;
+    if (pointToBoxDistSquared(m_nodes[0].m_min, m_nodes[0].m_max, target) <= maxDist2) stack[stackSize++] = 0;
+    while (stackSize > 0)
     {
-        Oct<LeafVector<Point> >* thisOct = myStack.back();
-        myStack.pop_back();
-        if (thisOct->m_leaf)
+        const int64_t current = stack[--stackSize];
+        const Node& myNode = m_nodes[current];
+        if (myNode.m_count > 0)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            const int64_t leafEnd = myNode.m_start + myNode.m_count;
+            for (int64_t i = myNode.m_start; i < leafEnd; ++i)
             {
-                float tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf <= maxDist2)
+                if (distSquared(m_coords.data() + i * 3, target) <= maxDist2)
                 {
-                    ret.insert(LocatorInfo(myVecRef[i].m_index, myVecRef[i].m_mySet, myVecRef[i].m_point));
+                    pointsOut.push_back(LocatorInfo(m_indices[i], m_sets[i], m_coords.data() + i * 3));
                 }
             }
         } else {
-            for (int ii = 0; ii < 2; ++ii)
+            const int64_t children[2] = { current + 1, myNode.m_start };
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            for (int i = 0; i < 2; ++i)
             {
-                for (int ij = 0; ij < 2; ++ij)
+                if (pointToBoxDistSquared(m_nodes[children[i]].m_min, m_nodes[children[i]].m_max, target) <= maxDist2)
                 {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        float tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myStack.push_back(thisOct->m_children[ii][ij][ik]);
-                        }
-                    }
+                    stack[stackSize++] = children[i];
                 }
             }
         }
     }
-    return ret;
+}
+
+set<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], const float& maxDist) const
+{
+    vector<LocatorInfo> found;
+    appendInRange(target, maxDist * maxDist, found);
+    return set<LocatorInfo>(found.begin(), found.end());
+}
+
+void CaretPointLocator::pointsInRange(const float target[3], const float& maxDist, vector<LocatorInfo>& pointsOut) const
+{
+    pointsOut.clear();
+    appendInRange(target, maxDist * maxDist, pointsOut);
+    sort(pointsOut.begin(), pointsOut.end());
 }
 
 bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist) const
 {
-    if (m_tree == NULL) return false;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist, tempf;
-    if (curDist2 > maxDist2) return false;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;//closer octs are more likely to contain a close enough point
-    myHeap.push(m_tree, curDist2);
-    while (!myHeap.isEmpty())
+    if (m_nodes.empty()) return false;
+    const float maxDist2 = maxDist * maxDist;
+    int64_t stack[MAX_STACK];
+    int stackSize = 0;
+    if (pointToBoxDistSquared(m_nodes[0].m_min, m_nodes[0].m_max, target) <= maxDist2) stack[stackSize++] = 0;
+    while (stackSize > 0)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop(&curDist2);
-        if (thisOct->m_leaf)
+        const int64_t current = stack[--stackSize];
+        const Node& myNode = m_nodes[current];
+        if (myNode.m_count > 0)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            const int64_t leafEnd = myNode.m_start + myNode.m_count;
+            for (int64_t i = myNode.m_start; i < leafEnd; ++i)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < maxDist2)
+                if (distSquared(m_coords.data() + i * 3, target) < maxDist2)
                 {
                     return true;
                 }
             }
         } else {
-            for (int ii = 0; ii < 2; ++ii)
+            const int64_t children[2] = { current + 1, myNode.m_start };
+            float dists[2];
+            for (int i = 0; i < 2; ++i)
             {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
+                dists[i] = pointToBoxDistSquared(m_nodes[children[i]].m_min, m_nodes[children[i]].m_max, target);
             }
+            const int nearer = (dists[0] <= dists[1] ? 0 : 1);//closer boxes are more likely to contain a close enough point
+            CaretAssert(stackSize + 2 <= MAX_STACK);
+            if (dists[1 - nearer] <= maxDist2) stack[stackSize++] = children[1 - nearer];
+            if (dists[nearer] <= maxDist2) stack[stackSize++] = children[nearer];
         }
     }
     return false;
 }
 
-int32_t CaretPointLocator::newIndex()
+void CaretPointLocator::closestPoints(const float* targets, const int64_t numTargets, vector<int64_t>& indicesOut, const float& maxDist, vector<int32_t>* whichSetOut) const
 {
-    if (m_unusedIndexes.empty())
+    indicesOut.resize(numTargets);
+    if (whichSetOut != NULL) whichSetOut->resize(numTargets);
+    const float maxDist2 = (maxDist > 0.0f ? maxDist * maxDist : numeric_limits<float>::infinity());
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numTargets; ++i)
     {
-        return m_nextSetIndex++;
-    } else {
-        int32_t ret = m_unusedIndexes[m_unusedIndexes.size() - 1];
-        m_unusedIndexes.pop_back();
-        return ret;
+        int64_t position = closestPosition(targets + i * 3, maxDist2);
+        indicesOut[i] = (position < 0 ? -1 : m_indices[position]);
+        if (whichSetOut != NULL) (*whichSetOut)[i] = (position < 0 ? -1 : m_sets[position]);
     }
 }
 
-void CaretPointLocator::removePointSet(int32_t whichSet)
-{
-    CaretMutexLocker locked(&m_modifyMutex);
-    m_unusedIndexes.push_back(whichSet);
-    removeSetHelper(m_tree, whichSet);
-}
-
-void CaretPointLocator::removeSetHelper(Oct<LeafVector<CaretPointLocator::Point> >* thisOct, int32_t thisSet)
+void CaretPointLocator::pointsInRange(const float* targets, const int64_t numTargets, const float& maxDist, vector<int64_t>& offsetsOut, vector<LocatorInfo>& pointsOut) const
 {
-    if (thisOct == NULL) return;
-    if (thisOct->m_leaf)
+    const int64_t BLOCK_SIZE = 256;//each block of targets collects into its own buffer, then they are concatenated in order
+    const int64_t numBlocks = (numTargets + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const float maxDist2 = maxDist * maxDist;
+    vector<vector<LocatorInfo> > blockPoints(numBlocks);
+    offsetsOut.resize(numTargets + 1);
+    offsetsOut[0] = 0;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t block = 0; block < numBlocks; ++block)
     {
-        vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-        int curSize = (int)myVecRef.size();
-        bool match = false;
-        for (int i = 0; i < curSize; ++i)//make sure something gets removed, so we don't have to do an allocation if it isn't needed
-        {
-            if (myVecRef[i].m_mySet == thisSet)
-            {
-                match = true;
-                break;
-            }
-        }
-        if (match)
+        vector<LocatorInfo>& myPoints = blockPoints[block];
+        const int64_t blockEnd = min(numTargets, (block + 1) * BLOCK_SIZE);
+        for (int64_t i = block * BLOCK_SIZE; i < blockEnd; ++i)
         {
-            vector<Point> tempvec;
-            tempvec.reserve(curSize - 1);//because at least one is getting removed
-            for (int i = 0; i < curSize; ++i)
-            {
-                if (myVecRef[i].m_mySet != thisSet)
-                {
-                    tempvec.push_back(myVecRef[i]);
-                }
-            }
-            myVecRef = tempvec;
-        }
-    } else {
-        for (int ii = 0; ii < 2; ++ii)
-        {
-            for (int ij = 0; ij < 2; ++ij)
-            {
-                for (int ik = 0; ik < 2; ++ik)
-                {
-                    removeSetHelper(thisOct->m_children[ii][ij][ik], thisSet);
-                }
-            }
+            int64_t before = (int64_t)myPoints.size();
+            appendInRange(targets + i * 3, maxDist2, myPoints);
+            sort(myPoints.begin() + before, myPoints.end());
+            offsetsOut[i + 1] = (int64_t)myPoints.size() - before;//counts for now, summed below
         }
     }
+    for (int64_t i = 0; i < numTargets; ++i)
+    {
+        offsetsOut[i + 1] += offsetsOut[i];
+    }
+    pointsOut.clear();
+    pointsOut.reserve(offsetsOut[numTargets]);
+    for (int64_t block = 0; block < numBlocks; ++block)
+    {
+        pointsOut.insert(pointsOut.end(), blockPoints[block].begin(), blockPoints[block].end());
+    }
 }
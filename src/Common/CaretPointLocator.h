@@ -23,10 +23,10 @@
 /*LICENSE_END*/
 
 #include "CaretMutex.h"
-#include "OctTree.h"
 #include "Vector3D.h"
 
 #include <set>
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -49,33 +49,36 @@ namespace caret {
         }
     };
     
+    ///k-d tree over one or more point sets, stored in flat arrays with each leaf's points contiguous
+    ///adding or removing a point set rebuilds the tree, queries are thread safe as long as nothing is modifying it
     class CaretPointLocator
     {
-        struct Point
+        struct Node
         {
-            Vector3D m_point;
-            int64_t m_index;
-            int32_t m_mySet;
-            Point(const float point[3], const int64_t index, const int32_t mySet)
-            {
-                m_point = point;
-                m_index = index;
-                m_mySet = mySet;
-            }
+            float m_min[3], m_max[3];
+            int64_t m_start;//for leaves, first position in the point arrays, otherwise index of second child (first child immediately follows its parent)
+            int32_t m_count;//number of points for leaves, 0 for interior nodes
         };
         CaretMutex m_modifyMutex;//thread safety, don't let multiple threads modify the point sets at once
-        Oct<LeafVector<Point> >* m_tree;
+        std::vector<float> m_coords;//point arrays, in leaf order
+        std::vector<int64_t> m_indices;
+        std::vector<int32_t> m_sets;
+        std::vector<Node> m_nodes;
         int32_t m_nextSetIndex;
         std::vector<int32_t> m_unusedIndexes;
-        void addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet);
+        static const int32_t NUM_POINTS_LEAF = 16;
+        static const int MAX_STACK = 128;//median splits keep the depth under 64, and searches have at most one pending sibling per level
         int32_t newIndex();
-        static const int NUM_POINTS_SPLIT = 100;
-        void removeSetHelper(Oct<LeafVector<Point> >* thisOct, const int32_t thisSet);
+        void rebuild();
+        void buildNode(std::vector<int64_t>& order, const int64_t start, const int64_t end);
+        int64_t closestPosition(const float target[3], const float& maxDist2) const;//position in the point arrays, -1 if nothing within maxDist2
+        void appendInRange(const float target[3], const float& maxDist2, std::vector<LocatorInfo>& pointsOut) const;
+        void fillInfo(const int64_t& position, LocatorInfo* infoOut) const;
         CaretPointLocator();
     public:
-        ///make an empty point locator with given bounding box (bounding box can expand later, but may be less efficient
+        ///make an empty point locator, the bounds are no longer needed, but are kept for compatibility
         CaretPointLocator(const float minBounds[3], const float maxBounds[3]);
-        ///make a point locator with the bounding box of this point set, and use this point set as set #0
+        ///make a point locator with this point set as set #0
         CaretPointLocator(const float* coordsIn, const int64_t numCoords);
         ///add a point set, SAVE THE RETURN VALUE because it is how you identify which point set found points belong to
         int32_t addPointSet(const float* coordsIn, const int64_t numCoords);
@@ -85,7 +88,17 @@ namespace caret {
         int64_t closestPoint(const float target[3], LocatorInfo* infoOut = NULL) const;
         int64_t closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut = NULL) const;
         std::set<LocatorInfo> pointsInRange(const float target[3], const float& maxDist) const;
+        ///same as above, but into a reusable buffer, which is cleared first and sorted the same way as the set
+        void pointsInRange(const float target[3], const float& maxDist, std::vector<LocatorInfo>& pointsOut) const;
         bool anyInRange(const float target[3], const float& maxDist) const;
+        
+        ///closest point to each of numTargets xyz triples, in parallel, -1 where nothing is within maxDist (if positive)
+        void closestPoints(const float* targets, const int64_t numTargets, std::vector<int64_t>& indicesOut, const float& maxDist = -1.0f,
+                           std::vector<int32_t>* whichSetOut = NULL) const;
+        ///points within maxDist of each of numTargets xyz triples, in parallel, as flat buffers that are overwritten (so reuse them to avoid reallocation)
+        ///the points for target i are pointsOut[offsetsOut[i]] up to (not including) pointsOut[offsetsOut[i + 1]], sorted the same way as the set
+        void pointsInRange(const float* targets, const int64_t numTargets, const float& maxDist, std::vector<int64_t>& offsetsOut,
+                           std::vector<LocatorInfo>& pointsOut) const;
     };
 }
 
@@ -0,0 +1,251 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretProfiler.h"
+
+#include "CaretCommandLine.h"
+#include "CaretLogger.h"
+#include "CaretMutex.h"
+#include "CaretOMP.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#ifdef CARET_OS_WINDOWS
+#include "windows.h"
+#define PSAPI_VERSION 2 //GetProcessMemoryInfo from kernel32, so no extra library to link
+#include "psapi.h"
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+bool CaretProfiler::s_enabled = false;
+
+namespace
+{
+    struct SpanRecord
+    {
+        AString m_name;
+        const char* m_category;
+        int m_thread;
+        CaretProfiler::Sample m_start, m_end;
+        bool operator<(const SpanRecord& rhs) const { return m_start.m_wallMicros < rhs.m_start.m_wallMicros; }
+    };
+
+    CaretMutex s_spanMutex;
+    vector<SpanRecord> s_spans;
+    QFile s_traceFile;
+    chrono::steady_clock::time_point s_startTime;
+    atomic<int64_t> s_bytesRead(0), s_bytesWritten(0), s_readMicros(0), s_writeMicros(0);
+
+    void getCpuAndPeakRss(double& cpuSeconds, int64_t& peakRssKB)
+    {
+        cpuSeconds = 0.0;
+        peakRssKB = -1;
+#ifdef CARET_OS_WINDOWS
+        FILETIME createTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &kernelTime, &userTime))
+        {//FILETIME is in units of 100 ns
+            uint64_t kernel = (((uint64_t)kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+            uint64_t user = (((uint64_t)userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+            cpuSeconds = (kernel + user) / 1e7;
+        }
+        PROCESS_MEMORY_COUNTERS memInfo;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memInfo, sizeof(memInfo)))
+        {
+            peakRssKB = memInfo.PeakWorkingSetSize / 1024;
+        }
+#else
+        struct rusage myUsage;
+        if (getrusage(RUSAGE_SELF, &myUsage) == 0)
+        {
+            cpuSeconds = myUsage.ru_utime.tv_sec + myUsage.ru_utime.tv_usec / 1e6 + myUsage.ru_stime.tv_sec + myUsage.ru_stime.tv_usec / 1e6;
+#ifdef CARET_OS_MACOSX
+            peakRssKB = myUsage.ru_maxrss / 1024;//mac reports bytes
+#else
+            peakRssKB = myUsage.ru_maxrss;//linux reports KB
+#endif
+        }
+#endif
+    }
+
+    AString jsonString(const AString& in)
+    {
+        AString ret = "\"";
+        for (int i = 0; i < in.size(); ++i)
+        {
+            QChar c = in[i];
+            if (c == '"' || c == '\\')
+            {
+                ret += '\\';
+                ret += c;
+            } else if (c.unicode() < 0x20) {
+                ret += "\\u" + AString::number(c.unicode(), 16).rightJustified(4, '0');
+            } else {
+                ret += c;
+            }
+        }
+        return ret + "\"";
+    }
+
+    AString spanArgs(const CaretProfiler::Sample& start, const CaretProfiler::Sample& end)
+    {
+        double wallSeconds = (end.m_wallMicros - start.m_wallMicros) / 1e6;
+        double cpuSeconds = end.m_cpuSeconds - start.m_cpuSeconds;
+        AString ret = "{\"cpu_ms\": " + AString::number(cpuSeconds * 1000.0, 'f', 3);
+        if (wallSeconds > 0.0)
+        {
+            ret += ", \"cpu_per_wall\": " + AString::number(cpuSeconds / wallSeconds, 'f', 2);//roughly how many cores were busy
+        }
+        if (end.m_peakRssKB >= 0)
+        {
+            ret += ", \"peak_rss_mb\": " + AString::number(end.m_peakRssKB / 1024.0, 'f', 1);
+            ret += ", \"peak_rss_growth_mb\": " + AString::number((end.m_peakRssKB - start.m_peakRssKB) / 1024.0, 'f', 1);
+        }
+        ret += ", \"bytes_read\": " + AString::number(end.m_bytesRead - start.m_bytesRead);
+        ret += ", \"bytes_written\": " + AString::number(end.m_bytesWritten - start.m_bytesWritten);
+        ret += ", \"read_ms\": " + AString::number((end.m_readMicros - start.m_readMicros) / 1000.0, 'f', 3);
+        ret += ", \"write_ms\": " + AString::number((end.m_writeMicros - start.m_writeMicros) / 1000.0, 'f', 3);
+        return ret + "}";
+    }
+}
+
+int64_t CaretProfiler::wallMicros()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - s_startTime).count();
+}
+
+bool CaretProfiler::enable(const AString& traceFileName)
+{
+    s_traceFile.setFileName(traceFileName);
+    if (!s_traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    s_startTime = chrono::steady_clock::now();
+    s_enabled = true;
+    return true;
+}
+
+CaretProfiler::Sample CaretProfiler::sample()
+{
+    Sample ret;
+    ret.m_wallMicros = wallMicros();
+    getCpuAndPeakRss(ret.m_cpuSeconds, ret.m_peakRssKB);
+    ret.m_bytesRead = s_bytesRead;
+    ret.m_bytesWritten = s_bytesWritten;
+    ret.m_readMicros = s_readMicros;
+    ret.m_writeMicros = s_writeMicros;
+    return ret;
+}
+
+void CaretProfiler::recordSpan(const char* category, const AString& name, const Sample& start, const Sample& end)
+{
+    SpanRecord myRecord;
+    myRecord.m_name = name;
+    myRecord.m_category = category;
+    myRecord.m_thread = 0;
+#ifdef CARET_OMP
+    myRecord.m_thread = omp_get_thread_num();
+#endif
+    myRecord.m_start = start;
+    myRecord.m_end = end;
+    CaretMutexLocker locked(&s_spanMutex);
+    s_spans.push_back(myRecord);
+}
+
+void CaretProfiler::addIO(const bool& isWrite, const int64_t& bytes, const int64_t& micros)
+{
+    if (isWrite)
+    {
+        s_bytesWritten += bytes;
+        s_writeMicros += micros;
+    } else {
+        s_bytesRead += bytes;
+        s_readMicros += micros;
+    }
+}
+
+void CaretProfiler::writeTrace()
+{
+    if (!s_enabled) return;
+    s_enabled = false;//spans that end after this (from objects still alive) are dropped
+    CaretMutexLocker locked(&s_spanMutex);
+    sort(s_spans.begin(), s_spans.end());//trace viewers don't need it, but it makes the file readable
+    int64_t pid = QCoreApplication::applicationPid();
+    AString ret = "{\"traceEvents\": [\n";
+    ret += "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " + AString::number(pid) + ", \"args\": {\"name\": \"wb_command\"}}";
+    for (size_t i = 0; i < s_spans.size(); ++i)
+    {
+        const SpanRecord& myRecord = s_spans[i];
+        ret += ",\n{\"name\": " + jsonString(myRecord.m_name) + ", \"cat\": \"" + myRecord.m_category + "\", \"ph\": \"X\"" +
+               ", \"ts\": " + AString::number(myRecord.m_start.m_wallMicros) +
+               ", \"dur\": " + AString::number(myRecord.m_end.m_wallMicros - myRecord.m_start.m_wallMicros) +
+               ", \"pid\": " + AString::number(pid) + ", \"tid\": " + AString::number(myRecord.m_thread) +
+               ", \"args\": " + spanArgs(myRecord.m_start, myRecord.m_end) + "}";
+    }
+    Sample zero = { 0, 0.0, 0, 0, 0, 0, 0 };
+    ret += "\n],\n\"displayTimeUnit\": \"ms\",\n";
+    ret += "\"otherData\": {\"command_line\": " + jsonString(caret_global_commandLine) + ", \"totals\": " + spanArgs(zero, sample()) + "}\n}\n";
+    s_spans.clear();
+    if (s_traceFile.write(ret.toUtf8()) < 0 || !s_traceFile.flush())
+    {
+        CaretLogWarning("error writing profile trace file '" + s_traceFile.fileName() + "'");
+    }
+    s_traceFile.close();
+}
+
+CaretProfiler::Span::Span(const char* category, const AString& name)
+{
+    m_active = CaretProfiler::isEnabled();
+    if (!m_active) return;
+    m_category = category;
+    m_name = name;
+    m_start = CaretProfiler::sample();
+}
+
+CaretProfiler::Span::~Span()
+{
+    if (!m_active || !CaretProfiler::isEnabled()) return;
+    CaretProfiler::recordSpan(m_category, m_name, m_start, CaretProfiler::sample());
+}
+
+CaretProfiler::IOTimer::IOTimer(const bool& isWrite, const int64_t& bytes)
+{
+    m_active = CaretProfiler::isEnabled();
+    if (!m_active) return;
+    m_write = isWrite;
+    m_bytes = bytes;
+    m_startMicros = CaretProfiler::wallMicros();
+}
+
+CaretProfiler::IOTimer::~IOTimer()
+{
+    if (!m_active) return;
+    CaretProfiler::addIO(m_write, m_bytes, CaretProfiler::wallMicros() - m_startMicros);
+}
@@ -0,0 +1,88 @@
+#ifndef __CARET_PROFILER_H__
+#define __CARET_PROFILER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <stdint.h>
+
+namespace caret {
+
+    ///records named spans with wall time, cpu time, peak memory and file I/O, and writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+    ///everything is a no-op until enable() is called, which wb_command does for -profile
+    class CaretProfiler
+    {
+    public:
+        ///process-wide values at one point in time, spans report the difference between their start and end
+        struct Sample
+        {
+            int64_t m_wallMicros;//since enable()
+            double m_cpuSeconds;//user + system, all threads
+            int64_t m_peakRssKB;//-1 if unknown
+            int64_t m_bytesRead, m_bytesWritten;
+            int64_t m_readMicros, m_writeMicros;//summed over threads, so can exceed wall time
+        };
+
+        ///a span that starts at construction and is recorded at destruction, does nothing when profiling is off
+        class Span
+        {
+            Sample m_start;
+            AString m_name;
+            const char* m_category;
+            bool m_active;
+            Span(const Span&);
+            Span& operator=(const Span&);
+        public:
+            Span(const char* category, const AString& name);
+            ~Span();
+        };
+
+        ///adds the time and bytes of one data transfer to the I/O totals, without making a span, for use in per-row calls
+        class IOTimer
+        {
+            int64_t m_startMicros;
+            int64_t m_bytes;
+            bool m_write;
+            bool m_active;
+            IOTimer(const IOTimer&);
+            IOTimer& operator=(const IOTimer&);
+        public:
+            IOTimer(const bool& isWrite, const int64_t& bytes);
+            ~IOTimer();
+        };
+
+        ///opens the output file immediately so that a bad path is caught before any work is done, returns false if it can't be opened
+        static bool enable(const AString& traceFileName);
+        static bool isEnabled() { return s_enabled; }
+        static Sample sample();
+        ///write the collected spans and close the file, then stop profiling
+        static void writeTrace();
+    private:
+        static bool s_enabled;
+        static void recordSpan(const char* category, const AString& name, const Sample& start, const Sample& end);
+        static void addIO(const bool& isWrite, const int64_t& bytes, const int64_t& micros);
+        static int64_t wallMicros();
+    };
+
+}
+
+#endif //__CARET_PROFILER_H__
@@ -0,0 +1,384 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretTriangleLocator.h"
+#include "CaretAssert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    struct CentroidLess
+    {
+        const vector<float>& m_centroids;
+        int m_axis;
+        CentroidLess(const vector<float>& centroids, const int axis) : m_centroids(centroids), m_axis(axis) { }
+        bool operator()(const int64_t& left, const int64_t& right) const
+        {
+            return m_centroids[left * 3 + m_axis] < m_centroids[right * 3 + m_axis];
+        }
+    };
+
+    ///entry distance of ray into box, or false if it misses or enters beyond maxT
+    bool rayEntersBox(const float boxMin[3], const float boxMax[3], const double origin[3], const double invDirection[3], const double& maxT, double& entryOut)
+    {
+        double tmin = 0.0, tmax = maxT;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (abs(invDirection[i]) == numeric_limits<double>::infinity())
+            {//parallel to the slab, so it is either always inside it or never, and the products below could be 0 * inf
+                if (origin[i] < boxMin[i] || origin[i] > boxMax[i]) return false;
+                continue;
+            }
+            double t1 = (boxMin[i] - origin[i]) * invDirection[i];
+            double t2 = (boxMax[i] - origin[i]) * invDirection[i];
+            if (t1 > t2) swap(t1, t2);
+            if (t1 > tmin) tmin = t1;
+            if (t2 < tmax) tmax = t2;
+            if (tmin > tmax) return false;
+        }
+        entryOut = tmin;
+        return true;
+    }
+
+    float pointToBoxDistSquared(const float boxMin[3], const float boxMax[3], const float point[3])
+    {
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float diff = 0.0f;
+            if (point[i] < boxMin[i])
+            {
+                diff = boxMin[i] - point[i];
+            } else if (point[i] > boxMax[i]) {
+                diff = point[i] - boxMax[i];
+            }
+            ret += diff * diff;
+        }
+        return ret;
+    }
+}
+
+CaretTriangleLocator::CaretTriangleLocator(const float* coordsIn, const int64_t numCoords, const int32_t* trianglesIn, const int64_t numTriangles)
+{
+    m_coords.assign(coordsIn, coordsIn + numCoords * 3);
+    m_triangles.assign(trianglesIn, trianglesIn + numTriangles * 3);
+    if (numTriangles < 1) return;
+    vector<float> centroids(numTriangles * 3);
+    m_order.resize(numTriangles);
+    for (int64_t i = 0; i < numTriangles; ++i)
+    {
+        m_order[i] = i;
+        for (int j = 0; j < 3; ++j)
+        {
+            CaretAssert(m_triangles[i * 3 + j] >= 0 && m_triangles[i * 3 + j] < numCoords);
+            centroids[i * 3 + j] = (m_coords[m_triangles[i * 3] * 3 + j] + m_coords[m_triangles[i * 3 + 1] * 3 + j] + m_coords[m_triangles[i * 3 + 2] * 3 + j]) / 3.0f;
+        }
+    }
+    m_nodes.reserve(2 * (numTriangles / NUM_TRIANGLES_LEAF + 1));
+    buildNode(centroids, 0, numTriangles);
+}
+
+void CaretTriangleLocator::buildNode(const vector<float>& centroids, const int64_t start, const int64_t end)
+{
+    int64_t myIndex = (int64_t)m_nodes.size();
+    m_nodes.push_back(Node());
+    float myMin[3], myMax[3], centMin[3], centMax[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        myMin[j] = numeric_limits<float>::max();
+        myMax[j] = -numeric_limits<float>::max();
+        centMin[j] = myMin[j];
+        centMax[j] = myMax[j];
+    }
+    for (int64_t i = start; i < end; ++i)
+    {
+        const int64_t triangle = m_order[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* coord = m_coords.data() + m_triangles[triangle * 3 + k] * 3;
+            for (int j = 0; j < 3; ++j)
+            {
+                myMin[j] = min(myMin[j], coord[j]);
+                myMax[j] = max(myMax[j], coord[j]);
+            }
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            centMin[j] = min(centMin[j], centroids[triangle * 3 + j]);
+            centMax[j] = max(centMax[j], centroids[triangle * 3 + j]);
+        }
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+        m_nodes[myIndex].m_min[j] = myMin[j];
+        m_nodes[myIndex].m_max[j] = myMax[j];
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (centMax[j] - centMin[j] > centMax[axis] - centMin[axis]) axis = j;
+    }
+    if (end - start <= NUM_TRIANGLES_LEAF || !(centMax[axis] > centMin[axis]))
+    {//small enough, or all centroids identical so splitting can't separate them
+        m_nodes[myIndex].m_start = start;
+        m_nodes[myIndex].m_count = (int32_t)(end - start);
+        return;
+    }
+    int64_t mid = (start + end) / 2;
+    nth_element(m_order.begin() + start, m_order.begin() + mid, m_order.begin() + end, CentroidLess(centroids, axis));
+    m_nodes[myIndex].m_count = 0;
+    buildNode(centroids, start, mid);//first child immediately follows
+    m_nodes[myIndex].m_start = (int64_t)m_nodes.size();//don't hold a reference across the push_backs
+    buildNode(centroids, mid, end);
+}
+
+bool CaretTriangleLocator::rayHitsTriangle(const int64_t triangle, const double origin[3], const double direction[3], double& tOut, double& uOut, double& vOut) const
+{//Moller-Trumbore, both sides of the triangle
+    const float* v0 = m_coords.data() + m_triangles[triangle * 3] * 3;
+    const float* v1 = m_coords.data() + m_triangles[triangle * 3 + 1] * 3;
+    const float* v2 = m_coords.data() + m_triangles[triangle * 3 + 2] * 3;
+    double e1[3], e2[3], s[3], p[3], q[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        e1[i] = v1[i] - v0[i];
+        e2[i] = v2[i] - v0[i];
+        s[i] = origin[i] - v0[i];
+    }
+    p[0] = direction[1] * e2[2] - direction[2] * e2[1];
+    p[1] = direction[2] * e2[0] - direction[0] * e2[2];
+    p[2] = direction[0] * e2[1] - direction[1] * e2[0];
+    double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (det == 0.0) return false;//parallel or degenerate
+    double invDet = 1.0 / det;
+    const double tolerance = 1e-7;//don't let rays slip through shared edges due to rounding
+    double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+    if (u < -tolerance || u > 1.0 + tolerance) return false;
+    q[0] = s[1] * e1[2] - s[2] * e1[1];
+    q[1] = s[2] * e1[0] - s[0] * e1[2];
+    q[2] = s[0] * e1[1] - s[1] * e1[0];
+    double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+    if (v < -tolerance || u + v > 1.0 + tolerance) return false;
+    tOut = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+    uOut = u;
+    vOut = v;
+    return true;
+}
+
+bool CaretTriangleLocator::intersectRay(const float origin[3], const float direction[3], TriangleLocatorInfo& infoOut, const float& maxDist) const
+{
+    infoOut = TriangleLocatorInfo();
+    if (m_nodes.empty()) return false;
+    double dOrigin[3], dDirection[3], invDirection[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        dOrigin[i] = origin[i];
+        dDirection[i] = direction[i];
+        invDirection[i] = 1.0 / dDirection[i];//inf for zero components is handled by the slab test
+    }
+    double bestT = (maxDist > 0.0f ? maxDist : numeric_limits<double>::infinity()), bestU = 0.0, bestV = 0.0;
+    int64_t bestTriangle = -1;
+    vector<pair<int64_t, double> > stack;
+    double entry;
+    if (!rayEntersBox(m_nodes[0].m_min, m_nodes[0].m_max, dOrigin, invDirection, bestT, entry)) return false;
+    stack.push_back(make_pair((int64_t)0, entry));
+    while (!stack.empty())
+    {
+        pair<int64_t, double> current = stack.back();
+        stack.pop_back();
+        if (current.second > bestT) continue;//a closer hit was found after this was pushed
+        const Node& myNode = m_nodes[current.first];
+        if (myNode.m_count > 0)
+        {
+            for (int32_t i = 0; i < myNode.m_count; ++i)
+            {
+                const int64_t triangle = m_order[myNode.m_start + i];
+                double t, u, v;
+                if (rayHitsTriangle(triangle, dOrigin, dDirection, t, u, v) && t >= 0.0 && t <= bestT)
+                {
+                    bestT = t;
+                    bestU = u;
+                    bestV = v;
+                    bestTriangle = triangle;
+                }
+            }
+        } else {
+            const int64_t children[2] = { current.first + 1, myNode.m_start };
+            double entries[2];
+            bool hits[2];
+            for (int i = 0; i < 2; ++i)
+            {
+                hits[i] = rayEntersBox(m_nodes[children[i]].m_min, m_nodes[children[i]].m_max, dOrigin, invDirection, bestT, entries[i]);
+            }
+            if (hits[0] && hits[1])
+            {//push the farther child first so the nearer one is searched first
+                const int nearer = (entries[0] <= entries[1] ? 0 : 1);
+                stack.push_back(make_pair(children[1 - nearer], entries[1 - nearer]));
+                stack.push_back(make_pair(children[nearer], entries[nearer]));
+            } else {
+                for (int i = 0; i < 2; ++i)
+                {
+                    if (hits[i]) stack.push_back(make_pair(children[i], entries[i]));
+                }
+            }
+        }
+    }
+    if (bestTriangle < 0) return false;
+    infoOut.triangle = bestTriangle;
+    infoOut.distance = (float)bestT;
+    infoOut.weights[0] = (float)(1.0 - bestU - bestV);
+    infoOut.weights[1] = (float)bestU;
+    infoOut.weights[2] = (float)bestV;
+    for (int i = 0; i < 3; ++i)
+    {
+        infoOut.point[i] = (float)(dOrigin[i] + bestT * dDirection[i]);
+    }
+    fillNearestVertex(infoOut);
+    return true;
+}
+
+void CaretTriangleLocator::closestPointOnTriangle(const int64_t triangle, const float target[3], float pointOut[3], float weightsOut[3]) const
+{//region tests from Ericson, Real-Time Collision Detection, 5.1.5
+    Vector3D a(m_coords.data() + m_triangles[triangle * 3] * 3);
+    Vector3D b(m_coords.data() + m_triangles[triangle * 3 + 1] * 3);
+    Vector3D c(m_coords.data() + m_triangles[triangle * 3 + 2] * 3);
+    Vector3D p(target);
+    Vector3D ab = b - a, ac = c - a, ap = p - a;
+    float d1 = ab.dot(ap), d2 = ac.dot(ap);
+    float u, v, w;//weights of a, b, c
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        u = 1.0f; v = 0.0f; w = 0.0f;
+    } else {
+        Vector3D bp = p - b;
+        float d3 = ab.dot(bp), d4 = ac.dot(bp);
+        Vector3D cp = p - c;
+        float d5 = ab.dot(cp), d6 = ac.dot(cp);
+        float vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            u = 0.0f; v = 1.0f; w = 0.0f;
+        } else if (d6 >= 0.0f && d5 <= d6) {
+            u = 0.0f; v = 0.0f; w = 1.0f;
+        } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            v = d1 / (d1 - d3); u = 1.0f - v; w = 0.0f;
+        } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            w = d2 / (d2 - d6); u = 1.0f - w; v = 0.0f;
+        } else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            w = (d4 - d3) / ((d4 - d3) + (d5 - d6)); v = 1.0f - w; u = 0.0f;
+        } else {
+            float sum = va + vb + vc;
+            if (sum == 0.0f)
+            {//degenerate triangle that isn't caught by the vertex or edge regions
+                u = 1.0f; v = 0.0f; w = 0.0f;
+            } else {
+                v = vb / sum; w = vc / sum; u = 1.0f - v - w;
+            }
+        }
+    }
+    Vector3D point = a * u + b * v + c * w;
+    for (int i = 0; i < 3; ++i)
+    {
+        pointOut[i] = point[i];
+    }
+    weightsOut[0] = u;
+    weightsOut[1] = v;
+    weightsOut[2] = w;
+}
+
+int64_t CaretTriangleLocator::closestTriangle(const float target[3], TriangleLocatorInfo* infoOut) const
+{
+    if (infoOut != NULL) *infoOut = TriangleLocatorInfo();
+    if (m_nodes.empty()) return -1;
+    float bestDistSquared = numeric_limits<float>::max(), bestPoint[3] = { 0.0f, 0.0f, 0.0f }, bestWeights[3] = { 0.0f, 0.0f, 0.0f };
+    int64_t bestTriangle = -1;
+    vector<pair<int64_t, float> > stack;
+    stack.push_back(make_pair((int64_t)0, pointToBoxDistSquared(m_nodes[0].m_min, m_nodes[0].m_max, target)));
+    while (!stack.empty())
+    {
+        pair<int64_t, float> current = stack.back();
+        stack.pop_back();
+        if (current.second >= bestDistSquared) continue;
+        const Node& myNode = m_nodes[current.first];
+        if (myNode.m_count > 0)
+        {
+            for (int32_t i = 0; i < myNode.m_count; ++i)
+            {
+                const int64_t triangle = m_order[myNode.m_start + i];
+                float point[3], weights[3];
+                closestPointOnTriangle(triangle, target, point, weights);
+                float distSquared = (Vector3D(point) - Vector3D(target)).lengthsquared();
+                if (distSquared < bestDistSquared)
+                {
+                    bestDistSquared = distSquared;
+                    bestTriangle = triangle;
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        bestPoint[j] = point[j];
+                        bestWeights[j] = weights[j];
+                    }
+                }
+            }
+        } else {
+            const int64_t children[2] = { current.first + 1, myNode.m_start };
+            float dists[2];
+            for (int i = 0; i < 2; ++i)
+            {
+                dists[i] = pointToBoxDistSquared(m_nodes[children[i]].m_min, m_nodes[children[i]].m_max, target);
+            }
+            const int nearer = (dists[0] <= dists[1] ? 0 : 1);
+            if (dists[1 - nearer] < bestDistSquared) stack.push_back(make_pair(children[1 - nearer], dists[1 - nearer]));
+            if (dists[nearer] < bestDistSquared) stack.push_back(make_pair(children[nearer], dists[nearer]));
+        }
+    }
+    if (infoOut != NULL && bestTriangle >= 0)
+    {
+        infoOut->triangle = bestTriangle;
+        infoOut->distance = sqrt(bestDistSquared);
+        for (int j = 0; j < 3; ++j)
+        {
+            infoOut->point[j] = bestPoint[j];
+            infoOut->weights[j] = bestWeights[j];
+        }
+        fillNearestVertex(*infoOut);
+    }
+    return bestTriangle;
+}
+
+void CaretTriangleLocator::fillNearestVertex(TriangleLocatorInfo& info) const
+{
+    CaretAssert(info.triangle >= 0);
+    float bestDistSquared = numeric_limits<float>::max();
+    for (int i = 0; i < 3; ++i)
+    {
+        const int32_t vertex = m_triangles[info.triangle * 3 + i];
+        float distSquared = (Vector3D(m_coords.data() + vertex * 3) - info.point).lengthsquared();
+        if (distSquared < bestDistSquared)
+        {
+            bestDistSquared = distSquared;
+            info.nearestVertex = vertex;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef __CARET_TRIANGLE_LOCATOR_H__
+#define __CARET_TRIANGLE_LOCATOR_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Vector3D.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    struct TriangleLocatorInfo
+    {
+        int64_t triangle;//-1 if nothing found
+        int64_t nearestVertex;//vertex of the triangle closest to point
+        float weights[3];//barycentric weights of point for the triangle's vertices, in triangle order
+        float distance;//distance along the ray for ray queries, distance from target for closest queries
+        Vector3D point;//location on the triangle
+        TriangleLocatorInfo() : triangle(-1), nearestVertex(-1), distance(-1.0f) { weights[0] = 0.0f; weights[1] = 0.0f; weights[2] = 0.0f; }
+    };
+
+    ///bounding volume hierarchy over the triangles of a mesh, for ray picking and closest point queries
+    class CaretTriangleLocator
+    {
+        struct Node
+        {
+            float m_min[3], m_max[3];
+            int64_t m_start;//for leaves, first entry in m_order, otherwise index of second child (first child immediately follows its parent)
+            int32_t m_count;//number of triangles for leaves, 0 for interior nodes
+        };
+        std::vector<float> m_coords;
+        std::vector<int32_t> m_triangles;
+        std::vector<int64_t> m_order;//triangle indices, grouped by leaf
+        std::vector<Node> m_nodes;
+        static const int32_t NUM_TRIANGLES_LEAF = 4;
+        void buildNode(const std::vector<float>& centroids, const int64_t start, const int64_t end);
+        bool rayHitsTriangle(const int64_t triangle, const double origin[3], const double direction[3], double& tOut, double& uOut, double& vOut) const;
+        void closestPointOnTriangle(const int64_t triangle, const float target[3], float pointOut[3], float weightsOut[3]) const;
+        void fillNearestVertex(TriangleLocatorInfo& info) const;
+        CaretTriangleLocator();
+    public:
+        ///make a locator for the given triangles, coordinates and triangles are copied
+        CaretTriangleLocator(const float* coordsIn, const int64_t numCoords, const int32_t* trianglesIn, const int64_t numTriangles);
+        ///find the first triangle hit by the ray (either side), only hits at 0 <= distance <= maxDist (if positive) in units of direction's length, returns false if nothing hit
+        bool intersectRay(const float origin[3], const float direction[3], TriangleLocatorInfo& infoOut, const float& maxDist = -1.0f) const;
+        ///returns the index of the triangle containing the closest point on the mesh, and optionally the point and weights
+        int64_t closestTriangle(const float target[3], TriangleLocatorInfo* infoOut = NULL) const;
+        int64_t getNumberOfTriangles() const { return (int64_t)(m_triangles.size() / 3); }
+    };
+}
+
+#endif //__CARET_TRIANGLE_LOCATOR_H__
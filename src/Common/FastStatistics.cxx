@@ -65,101 +65,209 @@ void FastStatistics::reset()
 
 void FastStatistics::update(const float* data, const int64_t& dataCount)
 {
-    reset();
-    CaretArray<float> positives(dataCount), negatives(dataCount), absolutes(dataCount);
-    double sum = 0.0;//for numerical stability
-    bool first = true;//so min can be positive and max can be negative
+    Partial wholeData;
+    wholeData.add(data, dataCount);
+    startStreaming(wholeData);
+    addStreamingData(data, dataCount);
+    finishStreaming();
+}
+
+void FastStatistics::Partial::reset()
+{
+    m_dataCount = 0;
+    m_posCount = 0;
+    m_zeroCount = 0;
+    m_negCount = 0;
+    m_infCount = 0;
+    m_negInfCount = 0;
+    m_nanCount = 0;
+    m_min = numeric_limits<float>::max();
+    m_max = -numeric_limits<float>::max();
+    m_mostNeg = 0.0f;
+    m_leastNeg = -numeric_limits<float>::max();
+    m_leastPos = numeric_limits<float>::max();
+    m_mostPos = 0.0f;
+    m_sum = 0.0;
+    m_sumSquaredDeviation = 0.0;
+}
+
+void FastStatistics::Partial::add(const float* data, const int64_t& dataCount)
+{
+    Partial block;
+    block.m_dataCount = dataCount;
     for (int64_t i = 0; i < dataCount; ++i)
     {
         if (data[i] != data[i])
         {
-            ++m_nanCount;
+            ++block.m_nanCount;
             continue;//skip NaNs
         }
         if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
         {
-            ++m_zeroCount;
+            ++block.m_zeroCount;
         } else {
             if (data[i] < 0.0f)
             {
                 if (data[i] * 2.0f == data[i])
                 {
-                    ++m_negInfCount;
+                    ++block.m_negInfCount;
                     continue;//skip neg infs
                 } else {
-                    negatives[m_negCount] = data[i];
-                    ++m_negCount;
-                    if (data[i] > m_leastNeg) m_leastNeg = data[i];
-                    if (data[i] < m_mostNeg) m_mostNeg = data[i];
-                    
-                    absolutes[m_absCount] = -data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
+                    ++block.m_negCount;
+                    if (data[i] > block.m_leastNeg) block.m_leastNeg = data[i];
+                    if (data[i] < block.m_mostNeg) block.m_mostNeg = data[i];
                 }
             } else {
                 if (data[i] * 2.0f == data[i])
                 {
-                    ++m_infCount;
+                    ++block.m_infCount;
                     continue;//skip infs
                 } else {
-                    positives[m_posCount] = data[i];
-                    ++m_posCount;
-                    if (data[i] > m_mostPos) m_mostPos = data[i];
-                    if (data[i] < m_leastPos) m_leastPos = data[i];
-                    
-                    absolutes[m_absCount] = data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
+                    ++block.m_posCount;
+                    if (data[i] > block.m_mostPos) block.m_mostPos = data[i];
+                    if (data[i] < block.m_leastPos) block.m_leastPos = data[i];
                 }
             }
         }
-        if (data[i] > m_max || first) m_max = data[i];
-        if (data[i] < m_min || first) m_min = data[i];
-        sum += data[i];//use a two-pass method for stability, only do mean this pass
-        first = false;
+        if (data[i] > block.m_max) block.m_max = data[i];
+        if (data[i] < block.m_min) block.m_min = data[i];
+        block.m_sum += data[i];//use a two-pass method for stability, only do mean this pass
     }
-    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
-    m_mean = sum / totalGood;
-    float tempf;
-    double sum2 = 0.0;
-    for (int64_t i = 0; i < dataCount; ++i)
+    int64_t blockGood = block.m_negCount + block.m_zeroCount + block.m_posCount;
+    if (blockGood > 0)
     {
-        if (data[i] != data[i]) continue;//skip NaNs
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        tempf = data[i] - m_mean;
-        sum2 += tempf * tempf;
+        float blockMean = block.m_sum / blockGood;
+        float tempf;
+        for (int64_t i = 0; i < dataCount; ++i)
+        {
+            if (data[i] != data[i]) continue;//skip NaNs
+            if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
+            if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
+            tempf = data[i] - blockMean;
+            block.m_sumSquaredDeviation += tempf * tempf;
+        }
     }
+    merge(block);
+}
+
+void FastStatistics::Partial::merge(const Partial& other)
+{
+    int64_t thisGood = m_negCount + m_zeroCount + m_posCount, otherGood = other.m_negCount + other.m_zeroCount + other.m_posCount;
+    if (thisGood == 0)
+    {
+        m_sum = other.m_sum;
+        m_sumSquaredDeviation = other.m_sumSquaredDeviation;
+    } else if (otherGood > 0) {//combine the sums of squares around the separate means, as in Chan et al.
+        double delta = other.m_sum / otherGood - m_sum / thisGood;
+        m_sumSquaredDeviation += other.m_sumSquaredDeviation + delta * delta * ((double)thisGood * otherGood / (thisGood + otherGood));
+        m_sum += other.m_sum;
+    }
+    m_dataCount += other.m_dataCount;
+    m_posCount += other.m_posCount;
+    m_zeroCount += other.m_zeroCount;
+    m_negCount += other.m_negCount;
+    m_infCount += other.m_infCount;
+    m_negInfCount += other.m_negInfCount;
+    m_nanCount += other.m_nanCount;
+    m_min = min(m_min, other.m_min);
+    m_max = max(m_max, other.m_max);
+    m_mostNeg = min(m_mostNeg, other.m_mostNeg);
+    m_leastNeg = max(m_leastNeg, other.m_leastNeg);
+    m_leastPos = min(m_leastPos, other.m_leastPos);
+    m_mostPos = max(m_mostPos, other.m_mostPos);
+}
+
+void FastStatistics::startStreaming(const Partial& wholeData)
+{
+    reset();
+    m_posCount = wholeData.m_posCount;
+    m_zeroCount = wholeData.m_zeroCount;
+    m_negCount = wholeData.m_negCount;
+    m_infCount = wholeData.m_infCount;
+    m_negInfCount = wholeData.m_negInfCount;
+    m_nanCount = wholeData.m_nanCount;
+    m_absCount = m_posCount + m_negCount;
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    m_mean = wholeData.m_sum / totalGood;
     if (totalGood > 0)
     {
-        m_stdDevPop = sqrt(sum2 / totalGood);
+        m_min = wholeData.m_min;
+        m_max = wholeData.m_max;
+        m_stdDevPop = sqrt(wholeData.m_sumSquaredDeviation / totalGood);
         if (totalGood > 1)
         {
-            m_stdDevSample = sqrt(sum2 / (totalGood - 1));
+            m_stdDevSample = sqrt(wholeData.m_sumSquaredDeviation / (totalGood - 1));
         }
     }
-    int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
-    m_negPercentHist.update(usebuckets, negatives, m_negCount);
-    m_posPercentHist.update(usebuckets, positives, m_posCount);
-    m_absPercentHist.update(usebuckets, absolutes, m_absCount);
-    
-    if (m_negCount <= 0)
+    if (m_negCount > 0)
     {
+        m_leastNeg = wholeData.m_leastNeg;
+        m_mostNeg = wholeData.m_mostNeg;
+    } else {
         m_leastNeg = 0.0;
         m_mostNeg  = 0.0;
     }
-    if (m_posCount <= 0)
+    if (m_posCount > 0)
     {
+        m_leastPos = wholeData.m_leastPos;
+        m_mostPos = wholeData.m_mostPos;
+    } else {
         m_leastPos = 0.0;
         m_mostPos  = 0.0;
     }
-    if (m_absCount <= 0)
+    if (m_absCount > 0)
     {
+        m_leastAbs = min((m_posCount > 0 ? m_leastPos : numeric_limits<float>::max()), (m_negCount > 0 ? -m_leastNeg : numeric_limits<float>::max()));
+        m_mostAbs = max(m_mostPos, -m_mostNeg);
+    } else {
         m_leastAbs = 0.0;
         m_mostAbs  = 0.0;
     }
+    int usebuckets = max((int64_t)1, min(NUM_BUCKETS_PERCENTILE_HIST, wholeData.m_dataCount));
+    m_negPercentHist.startRange(usebuckets, m_mostNeg, m_leastNeg);
+    m_posPercentHist.startRange(usebuckets, m_leastPos, m_mostPos);
+    m_absPercentHist.startRange(usebuckets, m_leastAbs, m_mostAbs);
+}
+
+void FastStatistics::addStreamingData(const float* data, const int64_t& dataCount)
+{
+    const int CHUNK_SIZE = 1024;
+    float positives[CHUNK_SIZE], negatives[CHUNK_SIZE], absolutes[CHUNK_SIZE];
+    for (int64_t start = 0; start < dataCount; start += CHUNK_SIZE)
+    {
+        int64_t end = min(start + CHUNK_SIZE, dataCount);
+        int numPos = 0, numNeg = 0, numAbs = 0;
+        for (int64_t i = start; i < end; ++i)
+        {
+            if (data[i] != data[i] || data[i] == 0.0f) continue;//NaNs and zeros are in no percentile histogram
+            if (data[i] * 2.0f == data[i]) continue;//nor are infs
+            if (data[i] < 0.0f)
+            {
+                negatives[numNeg++] = data[i];
+                absolutes[numAbs++] = -data[i];
+            } else {
+                positives[numPos++] = data[i];
+                absolutes[numAbs++] = data[i];
+            }
+        }
+        m_negPercentHist.addData(negatives, numNeg);
+        m_posPercentHist.addData(positives, numPos);
+        m_absPercentHist.addData(absolutes, numAbs);
+    }
+}
+
+void FastStatistics::mergeStreamingData(const FastStatistics& other)
+{
+    m_negPercentHist.merge(other.m_negPercentHist);
+    m_posPercentHist.merge(other.m_posPercentHist);
+    m_absPercentHist.merge(other.m_absPercentHist);
+}
+
+void FastStatistics::finishStreaming()
+{
+    m_negPercentHist.finish();
+    m_posPercentHist.finish();
+    m_absPercentHist.finish();
 }
 
 void FastStatistics::update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
@@ -40,6 +40,25 @@ namespace caret
         static float getValuePercentileHelper(const Histogram& histogram, const float numberOfDataValues, const bool negativeDataFlag, const float value);
 
     public:
+        ///first pass of the statistics over a block of data: counts, extremes, and sums for the mean and variance
+        ///partials of separate blocks can be computed in parallel and merged, then given to startStreaming()
+        struct Partial
+        {
+            int64_t m_dataCount;//including NaNs and infs
+            int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+            float m_min, m_max, m_mostPos, m_leastPos, m_leastNeg, m_mostNeg;
+            double m_sum, m_sumSquaredDeviation;//deviation from the mean of this partial's data
+            
+            Partial() { reset(); }
+            
+            void reset();
+            
+            ///add a block of data, with a two-pass sum of squares within the block
+            void add(const float* data, const int64_t& dataCount);
+            
+            void merge(const Partial& other);
+        };
+        
         FastStatistics();
         
         FastStatistics(const float* data, const int64_t& dataCount);
@@ -49,6 +68,18 @@ namespace caret
         ///statistics and display are really not that related, so for now, only include a continuous clipping range, excluding the middle from data will do weird things to standard deviation
         void update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive);
         
+        ///set everything except the percentiles from the merged partial of all the data, then give every block of the data to addStreamingData()
+        void startStreaming(const Partial& wholeData);
+        
+        ///add a block of data to the percentile histograms, use a copy per thread and mergeStreamingData() to do blocks in parallel
+        void addStreamingData(const float* data, const int64_t& dataCount);
+        
+        ///add the percentile histogram counts of a copy made after startStreaming()
+        void mergeStreamingData(const FastStatistics& other);
+        
+        ///call after all data has been added or merged
+        void finishStreaming();
+        
         float getApproxPositivePercentile(const float& percent) const;
         
         float getApproxNegativePercentile(const float& percent) const;
@@ -0,0 +1,441 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "GzipIndexedReader.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+bool GzipIndexedReader::s_useSidecar = false;
+
+namespace
+{
+    const int64_t MIN_SPAN = 1<<21;//minimum uncompressed distance between access points, bounds the cost of a random seek
+    const int SPAN_SHIFT = 10;//spacing also grows with position, so huge files don't use an unbounded amount of memory for windows
+    const quint32 SIDECAR_MAGIC = 0x57424749;//"WBGI"
+    const quint32 SIDECAR_VERSION = 1;
+}
+
+GzipIndexedReader::GzipIndexedReader()
+{
+    memset(&m_strm, 0, sizeof(m_strm));
+    m_strmInit = false;
+    m_rawMode = false;
+    m_inEOF = false;
+    m_atEnd = false;
+    m_loadedIndex = false;
+    m_inOffset = 0;
+    m_outPos = 0;
+    m_pendStart = 0;
+    m_pendLen = 0;
+    m_winWrite = 0;
+    m_totalSize = -1;
+}
+
+GzipIndexedReader::~GzipIndexedReader()
+{
+    close();
+}
+
+bool GzipIndexedReader::open(const QString& filename)
+{
+    close();
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        throw DataFileException("failed to open compressed file '" + filename + "'");
+    }
+    unsigned char magic[2];
+    if (m_file.read((char*)magic, 2) != 2 || magic[0] != 0x1f || magic[1] != 0x8b)
+    {
+        m_file.close();
+        return false;
+    }
+    memset(&m_strm, 0, sizeof(m_strm));
+    if (inflateInit2(&m_strm, 31) != Z_OK)//31 means gzip format only
+    {
+        m_file.close();
+        throw DataFileException("failed to initialize decompression for file '" + filename + "'");
+    }
+    m_strmInit = true;
+    m_inBuf.resize(IN_BUF_SIZE);
+    m_window.resize(WINDOW_SIZE);
+    m_points.clear();
+    m_totalSize = -1;
+    m_loadedIndex = false;
+    if (s_useSidecar)
+    {
+        m_loadedIndex = loadSidecar();
+    }
+    resetToStart();
+    return true;
+}
+
+void GzipIndexedReader::close()
+{
+    if (m_file.isOpen() && s_useSidecar && !m_loadedIndex && m_totalSize >= 0)
+    {
+        saveSidecar();
+    }
+    if (m_strmInit)
+    {
+        inflateEnd(&m_strm);
+        m_strmInit = false;
+    }
+    m_file.close();
+    m_points.clear();
+    m_totalSize = -1;
+    m_pendLen = 0;
+}
+
+int64_t GzipIndexedReader::read(void* dataOut, const int64_t& count)
+{
+    CaretAssert(m_strmInit);
+    char* outBytes = (char*)dataOut;
+    int64_t total = 0;
+    while (total < count)
+    {
+        if (m_pendLen > 0)
+        {
+            int64_t toCopy = min(m_pendLen, count - total);
+            memcpy(outBytes + total, &m_window[m_pendStart], toCopy);
+            m_pendStart += toCopy;
+            m_pendLen -= toCopy;
+            total += toCopy;
+            continue;
+        }
+        if (m_atEnd) break;
+        decompressSome();
+    }
+    return total;
+}
+
+void GzipIndexedReader::seek(const int64_t& position)
+{
+    CaretAssert(m_strmInit);
+    CaretAssert(position >= 0);
+    int64_t curPos = pos();
+    if (position == curPos) return;
+    if (m_totalSize >= 0 && position > m_totalSize)
+    {
+        throw DataFileException("seek past end of compressed file '" + m_file.fileName() + "'");
+    }
+    int64_t low = 0, high = (int64_t)m_points.size();//find the last access point at or before position
+    while (low < high)
+    {
+        int64_t mid = (low + high) / 2;
+        if (m_points[mid].m_out <= position)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    int64_t pointIndex = low - 1;
+    if (position < curPos || (pointIndex >= 0 && m_points[pointIndex].m_out > curPos))
+    {//going backwards, or there is an access point between here and the target
+        if (pointIndex >= 0)
+        {
+            resetToPoint(m_points[pointIndex]);
+        } else {
+            resetToStart();
+        }
+        curPos = pos();
+    }
+    while (curPos < position)//decompress and discard, recording any new access points on the way
+    {
+        if (m_pendLen > 0)
+        {
+            int64_t toSkip = min(m_pendLen, position - curPos);
+            m_pendStart += toSkip;
+            m_pendLen -= toSkip;
+            curPos += toSkip;
+            continue;
+        }
+        if (m_atEnd)
+        {
+            throw DataFileException("seek past end of compressed file '" + m_file.fileName() + "'");
+        }
+        decompressSome();
+    }
+}
+
+void GzipIndexedReader::resetToStart()
+{
+    if (inflateReset2(&m_strm, 31) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_file.fileName() + "'");
+    if (!m_file.seek(0)) throw DataFileException("seek failed in file '" + m_file.fileName() + "'");
+    m_inOffset = 0;
+    m_strm.next_in = &m_inBuf[0];
+    m_strm.avail_in = 0;
+    m_inEOF = false;
+    m_rawMode = false;
+    m_atEnd = false;
+    m_outPos = 0;
+    m_pendStart = 0;
+    m_pendLen = 0;
+    m_winWrite = 0;
+}
+
+void GzipIndexedReader::resetToPoint(const AccessPoint& point)
+{
+    if (inflateReset2(&m_strm, -15) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_file.fileName() + "'");
+    int64_t start = point.m_in - (point.m_bits != 0 ? 1 : 0);
+    if (!m_file.seek(start)) throw DataFileException("seek failed in file '" + m_file.fileName() + "'");
+    m_inOffset = start;
+    m_strm.next_in = &m_inBuf[0];
+    m_strm.avail_in = 0;
+    m_inEOF = false;
+    m_rawMode = true;//access points are inside a deflate stream, past the gzip header
+    m_atEnd = false;
+    if (point.m_bits != 0)
+    {
+        ensureInput(1);
+        if (m_strm.avail_in < 1) throw DataFileException("premature end of compressed file '" + m_file.fileName() + "'");
+        int partial = m_strm.next_in[0];
+        ++m_strm.next_in;
+        --m_strm.avail_in;
+        inflatePrime(&m_strm, point.m_bits, partial >> (8 - point.m_bits));
+    }
+    int64_t dictLen = (int64_t)point.m_window.size();
+    if (dictLen > 0)
+    {
+        inflateSetDictionary(&m_strm, &point.m_window[0], dictLen);
+        memcpy(&m_window[WINDOW_SIZE - dictLen], &point.m_window[0], dictLen);//so that later access points get the correct window
+    }
+    m_winWrite = 0;
+    m_outPos = point.m_out;
+    m_pendStart = 0;
+    m_pendLen = 0;
+}
+
+void GzipIndexedReader::decompressSome()
+{
+    CaretAssert(m_pendLen == 0 && !m_atEnd);
+    if (m_winWrite == WINDOW_SIZE) m_winWrite = 0;//window is also the output buffer, wrap around
+    while (true)
+    {
+        if (m_strm.avail_in == 0 && !m_inEOF) fillInput();
+        const int64_t outRoom = WINDOW_SIZE - m_winWrite;
+        m_strm.next_out = &m_window[m_winWrite];
+        m_strm.avail_out = outRoom;
+        int ret = inflate(&m_strm, Z_BLOCK);//Z_BLOCK stops at deflate block boundaries, which is where access points can be made
+        int64_t produced = outRoom - m_strm.avail_out;
+        m_pendStart = m_winWrite;
+        m_pendLen = produced;
+        m_winWrite += produced;
+        m_outPos += produced;
+        switch (ret)
+        {
+            case Z_NEED_DICT:
+            case Z_DATA_ERROR:
+                throw DataFileException("compressed data is corrupt in file '" + m_file.fileName() + "'");
+            case Z_MEM_ERROR:
+                throw DataFileException("out of memory while decompressing file '" + m_file.fileName() + "'");
+            default:
+                break;
+        }
+        if (ret == Z_STREAM_END)
+        {
+            finishMember();
+            return;
+        }
+        if ((m_strm.data_type & 128) && !(m_strm.data_type & 64))//at a block boundary that isn't the last block
+        {
+            maybeAddPoint();
+        }
+        if (produced > 0) return;
+        if (ret == Z_BUF_ERROR && m_inEOF)
+        {//truncated file, behave like gzread and just stop giving data
+            m_atEnd = true;
+            return;
+        }
+    }
+}
+
+void GzipIndexedReader::finishMember()
+{
+    if (m_rawMode) skipInput(8);//raw inflate doesn't consume the gzip trailer
+    ensureInput(2);
+    if (m_strm.avail_in < 2 || m_strm.next_in[0] != 0x1f || m_strm.next_in[1] != 0x8b)
+    {//no more members, ignore any trailing garbage, as gzread does
+        m_atEnd = true;
+        m_totalSize = m_outPos;//decoding always started from the beginning or an access point, so the index now covers the whole file
+        return;
+    }
+    if (inflateReset2(&m_strm, 31) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_file.fileName() + "'");
+    m_rawMode = false;
+}
+
+void GzipIndexedReader::maybeAddPoint()
+{
+    int64_t spacing = max(MIN_SPAN, m_outPos >> SPAN_SHIFT);
+    if (m_points.empty())
+    {
+        if (m_outPos != 0) return;//coverage must start at the beginning, shouldn't happen
+    } else {
+        if (m_outPos - m_points.back().m_out < spacing) return;//also prevents duplicates when decoding again from an earlier point
+    }
+    m_points.push_back(AccessPoint());
+    AccessPoint& newPoint = m_points.back();
+    newPoint.m_out = m_outPos;
+    newPoint.m_in = m_inOffset + (m_strm.next_in - &m_inBuf[0]);
+    newPoint.m_bits = m_strm.data_type & 7;
+    int64_t dictLen = min(m_outPos, (int64_t)WINDOW_SIZE);
+    newPoint.m_window.resize(dictLen);
+    if (dictLen == 0) return;
+    int64_t start = (m_winWrite - dictLen + WINDOW_SIZE) % WINDOW_SIZE;//m_window is circular, ending just before m_winWrite
+    int64_t firstPart = min(dictLen, WINDOW_SIZE - start);
+    memcpy(&newPoint.m_window[0], &m_window[start], firstPart);
+    if (firstPart < dictLen)
+    {
+        memcpy(&newPoint.m_window[firstPart], &m_window[0], dictLen - firstPart);
+    }
+}
+
+void GzipIndexedReader::fillInput()
+{
+    int64_t consumed = m_strm.next_in - &m_inBuf[0];
+    if (m_strm.avail_in > 0 && consumed > 0)
+    {
+        memmove(&m_inBuf[0], m_strm.next_in, m_strm.avail_in);
+    }
+    m_inOffset += consumed;
+    m_strm.next_in = &m_inBuf[0];
+    int64_t numRead = m_file.read((char*)&m_inBuf[m_strm.avail_in], IN_BUF_SIZE - m_strm.avail_in);
+    if (numRead < 0) throw DataFileException("error while reading compressed file '" + m_file.fileName() + "'");
+    if (numRead == 0) m_inEOF = true;
+    m_strm.avail_in += numRead;
+}
+
+void GzipIndexedReader::ensureInput(const int64_t& count)
+{
+    while (m_strm.avail_in < count && !m_inEOF)
+    {
+        fillInput();
+    }
+}
+
+void GzipIndexedReader::skipInput(int64_t count)
+{
+    while (count > 0)
+    {
+        if (m_strm.avail_in == 0)
+        {
+            if (m_inEOF) return;
+            fillInput();
+            continue;
+        }
+        int64_t toSkip = min(count, (int64_t)m_strm.avail_in);
+        m_strm.next_in += toSkip;
+        m_strm.avail_in -= toSkip;
+        count -= toSkip;
+    }
+}
+
+QString GzipIndexedReader::getSidecarName() const
+{
+    return m_file.fileName() + ".gzidx";
+}
+
+bool GzipIndexedReader::loadSidecar()
+{
+    QFile sidecar(getSidecarName());
+    if (!sidecar.exists() || !sidecar.open(QIODevice::ReadOnly)) return false;
+    QFileInfo dataInfo(m_file.fileName());
+    QDataStream stream(&sidecar);
+    quint32 magic = 0, version = 0, numPoints = 0;
+    qint64 compressedSize = -1, modifiedTime = -1, totalSize = -1;
+    stream >> magic >> version >> compressedSize >> modifiedTime >> totalSize >> numPoints;
+    if (stream.status() != QDataStream::Ok || magic != SIDECAR_MAGIC || version != SIDECAR_VERSION ||
+        compressedSize != dataInfo.size() || modifiedTime != dataInfo.lastModified().toMSecsSinceEpoch() || totalSize < 0)
+    {
+        CaretLogFine("ignoring invalid or out of date gzip index '" + getSidecarName() + "'");
+        return false;
+    }
+    vector<AccessPoint> points(numPoints);
+    for (quint32 i = 0; i < numPoints; ++i)
+    {
+        qint64 outPos = -1, inPos = -1;
+        qint32 bits = -1;
+        QByteArray window;
+        stream >> outPos >> inPos >> bits >> window;
+        if (stream.status() != QDataStream::Ok || bits < 0 || bits > 7 || window.size() > WINDOW_SIZE || outPos < 0 || inPos < 0 || inPos > compressedSize)
+        {
+            CaretLogFine("ignoring corrupt gzip index '" + getSidecarName() + "'");
+            return false;
+        }
+        points[i].m_out = outPos;
+        points[i].m_in = inPos;
+        points[i].m_bits = bits;
+        points[i].m_window.assign(window.constData(), window.constData() + window.size());
+    }
+    m_points.swap(points);
+    m_totalSize = totalSize;
+    return true;
+}
+
+void GzipIndexedReader::saveSidecar()
+{//failing to write the sidecar is never an error, the file will just be indexed again next time
+    //write to a temporary name and rename, so an interrupted write never leaves a corrupt index for later reads
+    //pid and thread make the name unique when several readers of the same file finish at once
+    QString tempName = getSidecarName() + "." + QString::number(QCoreApplication::applicationPid()) + "." +
+                       QString::number((quintptr)QThread::currentThreadId(), 16) + ".tmp";
+    QFile sidecar(tempName);
+    if (!sidecar.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        CaretLogFine("unable to write gzip index '" + getSidecarName() + "'");
+        return;
+    }
+    QFileInfo dataInfo(m_file.fileName());
+    QDataStream stream(&sidecar);
+    stream << SIDECAR_MAGIC << SIDECAR_VERSION << (qint64)dataInfo.size() << (qint64)dataInfo.lastModified().toMSecsSinceEpoch()
+           << (qint64)m_totalSize << (quint32)m_points.size();
+    for (size_t i = 0; i < m_points.size(); ++i)
+    {
+        const AccessPoint& thisPoint = m_points[i];
+        stream << (qint64)thisPoint.m_out << (qint64)thisPoint.m_in << (qint32)thisPoint.m_bits
+               << QByteArray((const char*)thisPoint.m_window.data(), (int)thisPoint.m_window.size());
+    }
+    sidecar.close();
+    if (stream.status() != QDataStream::Ok || sidecar.error() != QFile::NoError)
+    {
+        sidecar.remove();
+        CaretLogFine("error writing gzip index '" + getSidecarName() + "'");
+        return;
+    }
+    QFile::remove(getSidecarName());//QFile::rename won't replace an existing file, an out of date index may be there
+    if (!QFile::rename(tempName, getSidecarName()))//another reader may have just written it, which is fine
+    {
+        QFile::remove(tempName);
+    }
+}
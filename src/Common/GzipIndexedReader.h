@@ -0,0 +1,95 @@
+#ifndef __GZIP_INDEXED_READER_H__
+#define __GZIP_INDEXED_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QFile>
+#include <QString>
+
+#include "zlib.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    ///reads a gzip file (including concatenated members) while recording access points into the deflate stream (as in zlib's zran example),
+    ///so that seeking backwards only needs to decompress from the nearest access point instead of from the start of the file
+    ///the index is built as a side effect of reading or seeking forward, and can optionally be saved to and loaded from a sidecar file
+    class GzipIndexedReader
+    {
+    public:
+        GzipIndexedReader();
+        ~GzipIndexedReader();
+        ///returns false if the file doesn't start with the gzip magic number (caller should fall back to gzread, which also reads uncompressed files)
+        bool open(const QString& filename);
+        void close();
+        int64_t read(void* dataOut, const int64_t& count);//returns number of bytes read, short only at end of data, throws on corrupt data
+        void seek(const int64_t& position);
+        int64_t pos() const { return m_outPos - m_pendLen; }
+        int64_t size() const { return m_totalSize; }//-1 until the end of the data has been found (or the index was loaded from a sidecar)
+
+        ///whether to load and save the index as "<filename>.gzidx", off by default because it writes files next to the data
+        static void setUseSidecar(const bool& useSidecar) { s_useSidecar = useSidecar; }
+        static bool getUseSidecar() { return s_useSidecar; }
+    private:
+        enum
+        {
+            WINDOW_SIZE = 32768,//maximum deflate back-reference distance
+            IN_BUF_SIZE = 1<<18
+        };
+        struct AccessPoint
+        {
+            int64_t m_out, m_in;//uncompressed position, and compressed position of the first full byte
+            int m_bits;//number of bits of the preceding byte that belong to the next block
+            std::vector<unsigned char> m_window;//up to WINDOW_SIZE bytes of uncompressed data preceding m_out
+        };
+        GzipIndexedReader(const GzipIndexedReader&);
+        GzipIndexedReader& operator=(const GzipIndexedReader&);
+
+        QFile m_file;
+        z_stream m_strm;
+        bool m_strmInit, m_rawMode, m_inEOF, m_atEnd, m_loadedIndex;
+        std::vector<unsigned char> m_inBuf, m_window;
+        int64_t m_inOffset;//file offset of m_inBuf[0]
+        int64_t m_outPos;//uncompressed position of the end of the decompressed data
+        int64_t m_pendStart, m_pendLen;//decompressed but not yet returned data, in m_window
+        int64_t m_winWrite;//where in m_window the next output goes
+        int64_t m_totalSize;
+        std::vector<AccessPoint> m_points;
+        static bool s_useSidecar;
+
+        void resetToStart();
+        void resetToPoint(const AccessPoint& point);
+        void decompressSome();
+        void finishMember();
+        void maybeAddPoint();
+        void fillInput();
+        void ensureInput(const int64_t& count);
+        void skipInput(int64_t count);
+        QString getSidecarName() const;
+        bool loadSidecar();
+        void saveSidecar();
+    };
+
+} //namespace caret
+
+#endif //__GZIP_INDEXED_READER_H__
@@ -0,0 +1,171 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "GzipParallelWriter.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+GzipParallelWriter::GzipParallelWriter()
+{
+    m_curBlock = 0;
+    m_curFill = 0;
+    m_pos = 0;
+    m_wroteMember = false;
+}
+
+GzipParallelWriter::~GzipParallelWriter()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
+
+void GzipParallelWriter::open(const QString& filename)
+{
+    close();
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw DataFileException("failed to open compressed file '" + filename + "' for writing");
+    }
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = max(1, omp_get_max_threads());
+#endif
+    m_blocks.clear();
+    m_blocks.resize(numThreads);//storage is allocated as blocks get used, so small files don't cost much memory
+    m_curBlock = 0;
+    m_curFill = 0;
+    m_pos = 0;
+    m_wroteMember = false;
+}
+
+void GzipParallelWriter::close()
+{
+    if (!m_file.isOpen()) return;
+    if (m_curBlock > 0 || m_curFill > 0)
+    {
+        flushBlocks(m_curBlock + (m_curFill > 0 ? 1 : 0));
+    } else {
+        if (!m_wroteMember) flushBlocks(1);//an empty file still needs one (empty) member to be valid gzip
+    }
+    bool ok = m_file.flush();
+    m_file.close();
+    m_blocks.clear();
+    if (!ok) throw DataFileException("failed to write to compressed file '" + m_file.fileName() + "'");
+}
+
+void GzipParallelWriter::write(const void* dataIn, const int64_t& count)
+{
+    CaretAssert(m_file.isOpen());
+    const char* inBytes = (const char*)dataIn;
+    int64_t total = 0;
+    while (total < count)
+    {
+        vector<char>& thisBlock = m_blocks[m_curBlock];
+        if (thisBlock.size() != BLOCK_SIZE) thisBlock.resize(BLOCK_SIZE);
+        int64_t toCopy = min(count - total, BLOCK_SIZE - m_curFill);
+        memcpy(thisBlock.data() + m_curFill, inBytes + total, toCopy);
+        total += toCopy;
+        m_curFill += toCopy;
+        if (m_curFill == BLOCK_SIZE)
+        {
+            ++m_curBlock;
+            m_curFill = 0;
+            if (m_curBlock == (int64_t)m_blocks.size())
+            {
+                flushBlocks(m_curBlock);
+            }
+        }
+    }
+    m_pos += count;
+}
+
+void GzipParallelWriter::seek(const int64_t& position)
+{
+    if (position == m_pos) return;
+    if (position < m_pos) throw DataFileException("can't seek backwards while writing compressed file '" + m_file.fileName() + "'");
+    vector<char> zeros(min(position - m_pos, (int64_t)BLOCK_SIZE), 0);
+    while (m_pos < position)
+    {
+        write(zeros.data(), min(position - m_pos, (int64_t)zeros.size()));
+    }
+}
+
+void GzipParallelWriter::flushBlocks(const int64_t& numBlocks)
+{//blocks before m_curBlock are full, block m_curBlock has m_curFill bytes
+    vector<vector<unsigned char> > compressed(numBlocks);
+    bool failed = false;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        int64_t blockSize = (i < m_curBlock ? (int64_t)BLOCK_SIZE : m_curFill);
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY) != Z_OK)//31 means gzip wrapper, same settings as gzopen "wb"
+        {
+#pragma omp critical
+            failed = true;
+            continue;
+        }
+        uLong bound = deflateBound(&strm, blockSize);//big enough to finish in one call
+        compressed[i].resize(bound);
+        strm.next_in = (Bytef*)m_blocks[i].data();
+        strm.avail_in = blockSize;
+        strm.next_out = compressed[i].data();
+        strm.avail_out = bound;
+        if (deflate(&strm, Z_FINISH) != Z_STREAM_END)
+        {
+#pragma omp critical
+            failed = true;
+        }
+        compressed[i].resize(bound - strm.avail_out);
+        deflateEnd(&strm);
+    }
+    if (failed) throw DataFileException("failed to compress data for file '" + m_file.fileName() + "'");
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        if (m_file.write((const char*)compressed[i].data(), compressed[i].size()) != (int64_t)compressed[i].size())
+        {
+            throw DataFileException("failed to write to compressed file '" + m_file.fileName() + "'");
+        }
+    }
+    m_wroteMember = true;
+    m_curBlock = 0;
+    m_curFill = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef __GZIP_PARALLEL_WRITER_H__
+#define __GZIP_PARALLEL_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QFile>
+#include <QString>
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    ///writes a gzip file by compressing fixed size blocks of the input as separate gzip members, a batch of blocks at a time using openmp threads
+    ///concatenated members are part of the gzip standard, so any gzip reader (including zlib's gzread and the gzip tool) reads the result as one stream
+    class GzipParallelWriter
+    {
+    public:
+        GzipParallelWriter();
+        ~GzipParallelWriter();
+        void open(const QString& filename);//always truncates
+        void close();//flushes remaining data, throws on failure
+        void write(const void* dataIn, const int64_t& count);
+        void seek(const int64_t& position);//only forward, fills with zeros, like gzseek in write mode
+        int64_t pos() const { return m_pos; }
+    private:
+        enum
+        {
+            BLOCK_SIZE = 1<<20//uncompressed size of each member, large enough that member headers and the dictionary reset cost little compression
+        };
+        GzipParallelWriter(const GzipParallelWriter&);
+        GzipParallelWriter& operator=(const GzipParallelWriter&);
+
+        QFile m_file;
+        std::vector<std::vector<char> > m_blocks;//a batch of full blocks, plus the partial one being filled
+        int64_t m_curBlock, m_curFill;
+        int64_t m_pos;
+        bool m_wroteMember;
+
+        void flushBlocks(const int64_t& numBlocks);
+    };
+
+} //namespace caret
+
+#endif //__GZIP_PARALLEL_WRITER_H__
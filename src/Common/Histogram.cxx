@@ -76,6 +76,12 @@ void Histogram::reset()
     m_displayHeightMax = 0.0;
     m_bucketMin = 0.0;
     m_bucketMax = 0.0;
+    m_limited = false;
+    m_mostPosLimit = 0.0f;
+    m_leastPosLimit = 0.0f;
+    m_leastNegLimit = 0.0f;
+    m_mostNegLimit = 0.0f;
+    m_includeZero = true;
 }
 
 void Histogram::update(const int& numBuckets, const float* data, const int64_t& dataCount)
@@ -86,101 +92,30 @@ void Histogram::update(const int& numBuckets, const float* data, const int64_t&
 
 void Histogram::update(const float* data, const int64_t& dataCount)
 {
-    int numBuckets = (int)m_buckets.size();
-    reset();
     bool first = true;
+    float rangeMin = 0.0f, rangeMax = 0.0f;
     for (int64_t i = 0; i < dataCount; ++i)
-    {//count value classes
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
-            {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    ++m_negCount;
-                }
-            } else {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_infCount;
-                    continue;//skip infs
-                } else {
-                    ++m_posCount;
-                }
-            }
-        }
+    {//find the range of the numerical values
+        if (data[i] != data[i]) continue;//skip NaNs
+        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//skip neg infs
+        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//skip infs
         if (first)
         {
             first = false;
-            m_bucketMin = data[i];
-            m_bucketMax = data[i];
+            rangeMin = data[i];
+            rangeMax = data[i];
         } else {
-            if (data[i] > m_bucketMax)
-            {
-                m_bucketMax = data[i];
-            } else if (data[i] < m_bucketMin) {//skip testing for new minimum if we found a new maximum
-                m_bucketMin = data[i];
-            }
-        }
-    }
-    if (first)
-    {
-        m_bucketMin = m_bucketMax = 0.0f;
-        return;//our arrays are already zeroed, so just return if no valid data
-    }
-    if (m_bucketMin == m_bucketMax)
-    {
-        int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
-        for (int i = 0; i < numBuckets - 1; ++i)
-        {
-            m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-            if (i == 0)
+            if (data[i] > rangeMax)
             {
-                m_buckets[i] = m_cumulative[i];
-            } else {
-                m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+                rangeMax = data[i];
+            } else if (data[i] < rangeMin) {//skip testing for new minimum if we found a new maximum
+                rangeMin = data[i];
             }
-        }//display is already zeroed, so just return
-        m_cumulative[numBuckets - 1] = totalValid;//make sure the last one has all of them
-        if (numBuckets > 1)
-        {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-        } else {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
-        }
-        return;
-    }
-    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {//determine histogram
-        if (data[i] != data[i]) continue;//exclude NaN
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
-    }
-    computeCumulative();
-    m_displayHeightMax = 0.0;
-    for (int i = 0; i < numBuckets; ++i)
-    {//compute display values by normalizing by bucket size
-        m_display[i] = m_buckets[i] / bucketsize;
-        if (m_display[i] > m_displayHeightMax) {
-            m_displayHeightMax = m_display[i];
         }
     }
+    startRange((int)m_buckets.size(), rangeMin, rangeMax);
+    addData(data, dataCount);
+    finish();
 }
 
 void Histogram::update(const int32_t& numBuckets,
@@ -198,7 +133,25 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                        float leastPositiveValueInclusive, float leastNegativeValueInclusive,
                        float mostNegativeValueInclusive, const bool& includeZeroValues)
 {
-    int numBuckets = (int)m_buckets.size();
+    startLimited((int)m_buckets.size(), mostPositiveValueInclusive, leastPositiveValueInclusive,
+                 leastNegativeValueInclusive, mostNegativeValueInclusive, includeZeroValues);
+    addData(data, dataCount);
+    finish();
+}
+
+void Histogram::startRange(const int& numBuckets, const float& rangeMin, const float& rangeMax)
+{
+    resize(numBuckets);
+    reset();
+    m_bucketMin = rangeMin;
+    m_bucketMax = rangeMax;
+}
+
+void Histogram::startLimited(const int& numBuckets, float mostPositiveValueInclusive,
+                             float leastPositiveValueInclusive, float leastNegativeValueInclusive,
+                             float mostNegativeValueInclusive, const bool& includeZeroValues)
+{
+    resize(numBuckets);
     reset();
     if (mostNegativeValueInclusive > 0.0f) mostNegativeValueInclusive = 0.0f;//sanity check the inputs without asserting
     if (mostPositiveValueInclusive < 0.0f) mostPositiveValueInclusive = 0.0f;
@@ -216,10 +169,20 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
     } else {
         m_bucketMin = leastPositiveValueInclusive;
     }
+    m_limited = true;
+    m_mostPosLimit = mostPositiveValueInclusive;
+    m_leastPosLimit = leastPositiveValueInclusive;
+    m_leastNegLimit = leastNegativeValueInclusive;
+    m_mostNegLimit = mostNegativeValueInclusive;
+    m_includeZero = includeZeroValues;
+}
+
+void Histogram::addData(const float* data, const int64_t& dataCount)
+{
+    int numBuckets = (int)m_buckets.size();
     float sanity = m_bucketMax + m_bucketMin;
     if (m_bucketMax <= m_bucketMin || sanity != sanity)
-    {//bad input ranges, so collect counts, make a mock histogram if equal, and return (display values will be zeros)
-        int64_t equalCount = 0;
+    {//empty or bad range, so only collect counts, finish() makes a mock histogram if the range is a single value
         for (int64_t i = 0; i < dataCount; ++i)
         {
             if (data[i] != data[i])
@@ -237,46 +200,26 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                 ++m_infCount;
                 continue;
             }
-            if (data[i] == m_bucketMax)
+            if (m_limited)
             {
-                ++equalCount;
+                if (data[i] != m_bucketMax || m_bucketMax != m_bucketMin) continue;//limited histograms only count values equal to a single-value range
             }
-        }
-        if (m_bucketMax == m_bucketMin)
-        {
-            if (m_bucketMax == 0.0f)
+            if (data[i] == 0.0f)
             {
-                m_zeroCount = equalCount;
+                ++m_zeroCount;
             } else {
-                if (m_bucketMax < 0.0f)
+                if (data[i] < 0.0f)
                 {
-                    m_negCount = equalCount;
-                } else {
-                    m_posCount = equalCount;
-                }
-            }
-            for (int i = 0; i < numBuckets - 1; ++i)
-            {
-                m_cumulative[i] = (i + 1) * equalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-                if (i == 0)
-                {
-                    m_buckets[i] = m_cumulative[i];
+                    ++m_negCount;
                 } else {
-                    m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+                    ++m_posCount;
                 }
-            }//display is already zeroed, so just return
-            m_cumulative[numBuckets - 1] = equalCount;//make sure the last one has all of them
-            if (numBuckets > 1)
-            {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-            } else {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
             }
         }
         return;
     }
     float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)//do the histogram
+    for (int64_t i = 0; i < dataCount; ++i)
     {//count value classes
         if (data[i] != data[i])
         {
@@ -285,7 +228,7 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
         }
         if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
         {
-            if (!includeZeroValues) continue;//don't count what is excluded
+            if (!m_includeZero) continue;//don't count what is excluded
             ++m_zeroCount;
         } else {
             if (data[i] < 0.0f)
@@ -295,7 +238,7 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                     ++m_negInfCount;
                     continue;//skip neg infs
                 } else {
-                    if (data[i] > leastNegativeValueInclusive || data[i] < mostNegativeValueInclusive) continue;//exclude negatives outside range
+                    if (m_limited && (data[i] > m_leastNegLimit || data[i] < m_mostNegLimit)) continue;//exclude negatives outside range
                     ++m_negCount;
                 }
             } else {
@@ -304,7 +247,7 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                     ++m_infCount;
                     continue;//skip infs
                 } else {
-                    if (data[i] > mostPositiveValueInclusive || data[i] < leastPositiveValueInclusive) continue;//exclude negatives outside range
+                    if (m_limited && (data[i] > m_mostPosLimit || data[i] < m_leastPosLimit)) continue;//exclude positives outside range
                     ++m_posCount;
                 }
             }
@@ -315,8 +258,61 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
         CaretAssertVectorIndex(m_buckets, bucket);
         ++m_buckets[bucket];
     }
-    computeCumulative();
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    CaretAssert(other.m_buckets.size() == m_buckets.size());
+    CaretAssert(other.m_limited == m_limited);//the ranges must also match, but limited ranges can be NaN
+    m_posCount += other.m_posCount;
+    m_zeroCount += other.m_zeroCount;
+    m_negCount += other.m_negCount;
+    m_infCount += other.m_infCount;
+    m_negInfCount += other.m_negInfCount;
+    m_nanCount += other.m_nanCount;
+    int numBuckets = (int)m_buckets.size();
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+}
+
+void Histogram::finish()
+{
+    int numBuckets = (int)m_buckets.size();
     m_displayHeightMax = 0.0;
+    float sanity = m_bucketMax + m_bucketMin;
+    if (m_bucketMax <= m_bucketMin || sanity != sanity)
+    {//display values stay zero
+        for (int i = 0; i < numBuckets; ++i)
+        {
+            m_display[i] = 0.0f;
+        }
+        if (m_bucketMax == m_bucketMin)
+        {
+            int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
+            for (int i = 0; i < numBuckets - 1; ++i)
+            {
+                m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
+                if (i == 0)
+                {
+                    m_buckets[i] = m_cumulative[i];
+                } else {
+                    m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+                }
+            }
+            m_cumulative[numBuckets - 1] = totalValid;//make sure the last one has all of them
+            if (numBuckets > 1)
+            {
+                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+            } else {
+                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+            }
+        }
+        return;
+    }
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
+    computeCumulative();
     for (int i = 0; i < numBuckets; ++i)
     {//compute display values by normalizing by bucket size
         m_display[i] = m_buckets[i] / bucketsize;
@@ -34,6 +34,10 @@ namespace caret
         float m_bucketMin, m_bucketMax;
         float m_displayHeightMax;
         
+        ///value limits for a histogram started with startLimited()
+        bool m_limited, m_includeZero;
+        float m_mostPosLimit, m_leastPosLimit, m_leastNegLimit, m_mostNegLimit;
+        
         ///counts of each class of number
         int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
         
@@ -71,6 +75,26 @@ namespace caret
                     float mostNegativeValueInclusive,
                     const bool& includeZeroValues);
         
+        ///start an empty histogram over a known range, so it can be built a block at a time with addData() or merge(), values outside the range go in the end buckets
+        void startRange(const int& numBuckets, const float& rangeMin, const float& rangeMax);
+        
+        ///start an empty histogram that only counts values within the limits, with the same rules as the limited update()
+        void startLimited(const int& numBuckets,
+                          float mostPositiveValueInclusive,
+                          float leastPositiveValueInclusive,
+                          float leastNegativeValueInclusive,
+                          float mostNegativeValueInclusive,
+                          const bool& includeZeroValues);
+        
+        ///add a block of data to a started histogram, call finish() after the last block
+        void addData(const float* data, const int64_t& dataCount);
+        
+        ///add the counts of a histogram started with the same settings, so blocks can be done in parallel, call finish() after the last merge
+        void merge(const Histogram& other);
+        
+        ///compute the cumulative counts and display values after adding or merging
+        void finish();
+        
         ///get raw counts (useful mathematically)
         const std::vector<int64_t>& getHistogramCounts() const { return m_buckets; }
         
@@ -57,16 +57,19 @@ ProgressObject* ProgressObject::addAlgorithm(const float weight, const float chi
 
 void ProgressObject::algorithmStartSentinel()
 {
-    if (m_sentinelPassed)
+    startProfileSpan();
+    if (m_sentinelPassed && !m_finished)
     {
         m_disabled = true;//if it hits start twice (passed through an algorithm without interaction), disable it
-    } else {
+    } else {//an algorithm given an object that a previous algorithm already finished just leaves it at 100%
         m_sentinelPassed = true;
     }
 }
 
 void ProgressObject::finishLevel()
 {
+    m_profileTaskSpan.grabNew(NULL);//end the spans, innermost first, even if already finished, because an operation can run several algorithms with one object
+    m_profileSpan.grabNew(NULL);
     if (m_finished) return;//don't finish twice
     m_currentProgress = m_totalWeight;
     m_finished = true;
@@ -96,6 +99,27 @@ float ProgressObject::getCurrentProgressPercent()
     return getCurrentProgressFraction() * 100.0f;
 }
 
+void ProgressObject::setProfileName(const AString& name)
+{
+    m_profileName = name;
+}
+
+void ProgressObject::startProfileSpan()
+{//doesn't check m_finished, the first algorithm given an object finishes it, and later ones given the same object still need their own spans
+    if (!CaretProfiler::isEnabled() || m_profileSpan != NULL) return;
+    AString name = m_profileName;
+    if (name.isEmpty())
+    {
+        if (m_parent != NULL && !m_parent->m_description.isEmpty())
+        {
+            name = m_parent->m_description;
+        } else {
+            name = (m_parent == NULL ? "algorithm" : "subalgorithm");
+        }
+    }
+    m_profileSpan.grabNew(new CaretProfiler::Span("algorithm", name));
+}
+
 const AString& ProgressObject::getTaskDescription()
 {
     return m_description;
@@ -124,6 +148,7 @@ LevelProgress::LevelProgress(ProgressObject* myProgObj, const float finishedProg
     m_internalResolution = max(internalResolution, ProgressObject::MAX_INTERNAL_RESOLUTION);//the lower the value, the more often it updates
     if (m_progObjRef != NULL)
     {
+        m_progObjRef->startProfileSpan();//in case the algorithm didn't go through AbstractAlgorithm
         m_progObjRef->setInternalWeight(internalWeight);
         EventProgressUpdate myUpdate(myProgObj);
         myUpdate.m_starting = true;
@@ -233,6 +258,11 @@ void LevelProgress::setTask(const AString& taskDescription)
 {//maybe this should be in a setter in m_progObjRef, here for coherence with progress reporting
     if (m_progObjRef == NULL) return;
     m_progObjRef->m_description = taskDescription;
+    if (CaretProfiler::isEnabled())
+    {
+        m_progObjRef->m_profileTaskSpan.grabNew(NULL);//end the previous task before starting the next
+        m_progObjRef->m_profileTaskSpan.grabNew(new CaretProfiler::Span("task", taskDescription));
+    }
     EventProgressUpdate myUpdate(m_progObjRef);
     myUpdate.m_textUpdate = true;
     EventManager::get()->sendEvent(myUpdate.getPointer());
@@ -24,6 +24,8 @@
 #include "stdint.h"
 #include <vector>
 #include "AString.h"
+#include "CaretPointer.h"
+#include "CaretProfiler.h"
 
 namespace caret {
    
@@ -52,6 +54,9 @@ namespace caret {
       bool m_sentinelPassed;
       bool m_disabled;//disables itself if sentinel called twice
       bool m_finished;
+      AString m_profileName;
+      CaretPointer<CaretProfiler::Span> m_profileSpan, m_profileTaskSpan;//only used when profiling
+      void startProfileSpan();//when an algorithm starts, not when it is added, as algorithms often add all subalgorithms up front, ended by finishLevel()
       void updateProgress();//used by LevelProgress to report changes
       void finishLevel();//moves this progress object to 100%, then updates parent if not NULL
       void setInternalWeight(const float& myInternalWeight);//used by LevelProgress when you start a level
@@ -86,6 +91,10 @@ namespace caret {
       
       ///true if algorithmStartSentinel disabled the object
       bool isDisabled();
+      
+      ///for -profile, name the spans of a root object, there is one for each algorithm run with it
+      ///subalgorithm spans start when the subalgorithm does, and are named with the parent's task description at that time
+      void setProfileName(const AString& name);
       //TODO: make something to return the statuses of all in-progress (nonzero curProgress) tasks for the entire tree, for detailed progress info
       //TODO: set up callbacks so progress changes don't have to be polled for
       friend class LevelProgress;//so that LevelProgress can report progress, but nothing else can
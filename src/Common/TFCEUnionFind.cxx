@@ -0,0 +1,174 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TFCEUnionFind.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    bool candidateGreater(const pair<float, int64_t>& left, const pair<float, int64_t>& right)
+    {
+        if (left.first != right.first) return left.first > right.first;
+        return left.second < right.second;//make ties deterministic
+    }
+}
+
+TFCEUnionFind::TFCEUnionFind()
+{
+    m_param_e = 1.0;
+    m_integrated_h = 3.0;
+}
+
+void TFCEUnionFind::reset(const int64_t& numElements, const float& param_e, const float& param_h)
+{
+    for (int64_t i = 0; i < (int64_t)m_added.size(); ++i)//in case the previous pass wasn't finished
+    {
+        m_parent[m_added[i]] = -1;
+    }
+    m_added.clear();
+    m_candidates.clear();
+    if ((int64_t)m_parent.size() < numElements)
+    {
+        m_parent.resize(numElements, -1);
+        m_offset.resize(numElements);
+        m_accumVal.resize(numElements);
+        m_totalSize.resize(numElements);
+        m_lastVal.resize(numElements);
+        m_numMembers.resize(numElements);
+    }
+    m_param_e = param_e;
+    m_integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+}
+
+const vector<pair<float, int64_t> >& TFCEUnionFind::sortCandidates()
+{
+    sort(m_candidates.begin(), m_candidates.end(), candidateGreater);
+    return m_candidates;
+}
+
+int64_t TFCEUnionFind::findRoot(const int64_t& elem)
+{
+    int64_t root = elem;
+    m_path.clear();
+    while (m_parent[root] != root)
+    {
+        m_path.push_back(root);
+        root = m_parent[root];
+    }
+    for (int64_t i = (int64_t)m_path.size() - 2; i >= 0; --i)//compress from the top down, so each parent's offset is already relative to the root
+    {
+        int64_t node = m_path[i];
+        m_offset[node] += m_offset[m_parent[node]];
+        m_parent[node] = root;
+    }
+    return root;
+}
+
+void TFCEUnionFind::update(const int64_t& root, const float& bottomVal)
+{
+    if (bottomVal != m_lastVal[root])//skip computing if there is no difference
+    {
+        CaretAssert(bottomVal < m_lastVal[root]);
+        double newSlice = pow(m_totalSize[root], m_param_e) * (pow((double)m_lastVal[root], m_integrated_h) - pow((double)bottomVal, m_integrated_h)) / m_integrated_h;
+        m_accumVal[root] += newSlice;
+        m_lastVal[root] = bottomVal;
+    }
+}
+
+void TFCEUnionFind::addTouching(const int64_t& elem, const float& value, const float& size)
+{
+    CaretAssertVectorIndex(m_parent, elem);
+    CaretAssert(m_parent[elem] == -1);
+    m_added.push_back(elem);
+    int numTouching = (int)m_touching.size();
+    if (numTouching == 0)//make new cluster
+    {
+        m_parent[elem] = elem;
+        m_offset[elem] = 0.0;
+        m_accumVal[elem] = 0.0;
+        m_totalSize[elem] = size;
+        m_lastVal[elem] = value;
+        m_numMembers[elem] = 1;
+        return;
+    }
+    int64_t merged = m_touching[0];//use the biggest cluster as the root, to keep the trees shallow
+    for (int i = 1; i < numTouching; ++i)
+    {
+        if (m_numMembers[m_touching[i]] > m_numMembers[merged]) merged = m_touching[i];
+    }
+    update(merged, value);//recalculate to align cluster bottoms
+    for (int i = 0; i < numTouching; ++i)
+    {
+        int64_t other = m_touching[i];
+        if (other == merged) continue;
+        update(other, value);
+        m_parent[other] = merged;
+        m_offset[other] = m_accumVal[other] - m_accumVal[merged];//members of the side cluster get the merged cluster's integral from here on, so record what they already have beyond it
+        m_totalSize[merged] += m_totalSize[other];
+        m_numMembers[merged] += m_numMembers[other];
+    }
+    m_parent[elem] = merged;
+    m_offset[elem] = -m_accumVal[merged];//this element is at the bottom of the cluster, it gets none of what has been integrated so far
+    m_totalSize[merged] += size;
+    ++m_numMembers[merged];
+}
+
+void TFCEUnionFind::finish(double* accumData)
+{
+    int64_t numAdded = (int64_t)m_added.size();
+    for (int64_t i = 0; i < numAdded; ++i)
+    {
+        int64_t elem = m_added[i];
+        if (m_parent[elem] == elem) update(elem, 0.0f);//include the to-zero slice
+    }
+    for (int64_t i = 0; i < numAdded; ++i)
+    {
+        int64_t elem = m_added[i];
+        int64_t root = findRoot(elem);
+        if (root == elem)
+        {
+            accumData[elem] += m_accumVal[elem];
+        } else {
+            accumData[elem] += m_offset[elem] + m_accumVal[root];
+        }
+    }
+    for (int64_t i = 0; i < numAdded; ++i)
+    {
+        m_parent[m_added[i]] = -1;
+    }
+    m_added.clear();
+    m_candidates.clear();
+}
+
+void caret::tfceSignFlips(const int& seed, const int& flip, vector<char>& negatedOut)
+{
+    seed_seq mySeq{(uint32_t)seed, (uint32_t)flip};
+    mt19937 myRand(mySeq);
+    for (int j = 0; j < (int)negatedOut.size(); ++j)
+    {
+        negatedOut[j] = (char)(myRand() >> 31);
+    }
+}
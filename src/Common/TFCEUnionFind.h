@@ -0,0 +1,97 @@
+#ifndef __TFCE_UNION_FIND_H__
+#define __TFCE_UNION_FIND_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretAssert.h"
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace caret
+{
+    ///disjoint-set forest over flat arrays for computing the TFCE integral, one cluster per tree
+    ///every element stores its offset from its parent's integrated value, so merging clusters never has to visit their members
+    ///keep one per thread and reuse it for every pass, all storage is only reallocated when the number of elements grows
+    class TFCEUnionFind
+    {
+    public:
+        TFCEUnionFind();
+
+        ///start a new pass over elements 0 to numElements - 1
+        void reset(const int64_t& numElements, const float& param_e, const float& param_h);
+
+        ///queue an element with a positive value to be added
+        void addCandidate(const int64_t& elem, const float& value) { m_candidates.push_back(std::make_pair(value, elem)); }
+
+        ///sorts the candidates by descending value, returns them as (value, element) for the caller to add in order
+        const std::vector<std::pair<float, int64_t> >& sortCandidates();
+
+        ///add an element with value no larger than any previously added element, neighbors that haven't been added yet are ignored
+        template <typename T>
+        void addElement(const int64_t& elem, const float& value, const float& size, const T* neighbors, const int& numNeighbors)
+        {
+            m_touching.clear();
+            for (int i = 0; i < numNeighbors; ++i)
+            {
+                touch(neighbors[i]);
+            }
+            addTouching(elem, value, size);
+        }
+
+        ///for neighbor stencils that aren't a simple list, call touch() on each neighbor, then addTouching()
+        void clearTouching() { m_touching.clear(); }
+        void touch(const int64_t& neighbor)
+        {
+            CaretAssertVectorIndex(m_parent, neighbor);
+            if (m_parent[neighbor] == -1) return;
+            int64_t root = findRoot(neighbor);
+            for (int i = 0; i < (int)m_touching.size(); ++i)
+            {
+                if (m_touching[i] == root) return;
+            }
+            m_touching.push_back(root);
+        }
+        void addTouching(const int64_t& elem, const float& value, const float& size);
+
+        ///integrate all clusters down to zero, and add the TFCE value of every added element to accumData
+        void finish(double* accumData);
+    private:
+        std::vector<int64_t> m_parent;//-1 for elements not yet added
+        std::vector<double> m_offset;//for non-roots, the value difference from the parent, for roots it is zero
+        std::vector<double> m_accumVal, m_totalSize;//only valid for roots
+        std::vector<float> m_lastVal;//only valid for roots
+        std::vector<int64_t> m_numMembers;//only valid for roots, used to keep trees shallow
+        std::vector<int64_t> m_added, m_touching, m_path;
+        std::vector<std::pair<float, int64_t> > m_candidates;
+        double m_param_e, m_integrated_h;
+
+        int64_t findRoot(const int64_t& elem);
+        void update(const int64_t& root, const float& bottomVal);
+    };
+
+    ///fill negatedOut (already sized to the number of subjects) with the sign flips for one permutation of a sign-flip null
+    ///the generator is seeded from both numbers, so the flips don't depend on which thread does them, and neighboring seeds don't share flips
+    void tfceSignFlips(const int& seed, const int& flip, std::vector<char>& negatedOut);
+}
+
+#endif //__TFCE_UNION_FIND_H__
@@ -23,6 +23,11 @@ inline double sddot (const float *a, const float *b, int n)
     sum += a[k] * b[k];
   return sum;
 }  // sddot()
+inline void sddot_batch (const float *a, const float *const *b, int m, int n, double *r)
+{
+  for (int i = 0; i < m; i++)
+    r[i] = sddot(a, b[i], n);
+}  // sddot_batch()
 //copy enum from dot.h
 //renamed to dot_flags in both files for less conflict chance
 typedef enum {
@@ -30,6 +35,8 @@ typedef enum {
     DOT_SSE2   = 2,
     DOT_AVX    = 3,
     DOT_AVXFMA = 4,
+    DOT_AVX2   = 5,
+    DOT_AVX512 = 6,
     DOT_AUTO   = 100
 } dot_flags;
 //and dummy implementation of dot_set_impl
@@ -63,6 +70,8 @@ namespace caret
             ret.push_back(DOT_SSE2);
             ret.push_back(DOT_AVX);
             ret.push_back(DOT_AVXFMA);
+            ret.push_back(DOT_AVX2);
+            ret.push_back(DOT_AVX512);
             ret.push_back(DOT_AUTO);
             return ret;
         }
@@ -84,6 +93,12 @@ namespace caret
             } else if (name == "AVXFMA") {
                 ret = DOT_AVXFMA;
                 valid = true;
+            } else if (name == "AVX2") {
+                ret = DOT_AVX2;
+                valid = true;
+            } else if (name == "AVX512") {
+                ret = DOT_AVX512;
+                valid = true;
             } else if (name == "AUTO") {
                 ret = DOT_AUTO;
                 valid = true;
@@ -109,6 +124,10 @@ namespace caret
                     return "AVX";
                 case DOT_AVXFMA:
                     return "AVXFMA";
+                case DOT_AVX2:
+                    return "AVX2";
+                case DOT_AVX512:
+                    return "AVX512";
                 case DOT_AUTO:
                     return "AUTO";
                 default:
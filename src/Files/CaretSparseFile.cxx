@@ -28,18 +28,52 @@
 
 #include <QByteArray>
 
+#include <cstring>
+
 using namespace caret;
 using namespace std;
 
-const char magic[] = "\0\0\0\0cst\0";
+const char magic[] = "\0\0\0\0cst\0";//last byte is the version number, version 1 used 0
+
+namespace
+{
+    const int64_t MAX_V2_ENTRY_BYTES = 19;//10 byte varint for the index delta, 5 byte varint for the high half, 4 bytes for the low half
+    
+    void appendVarint(vector<unsigned char>& bytes, uint64_t value)
+    {
+        while (value >= 128)
+        {
+            bytes.push_back((unsigned char)((value & 127) | 128));
+            value >>= 7;
+        }
+        bytes.push_back((unsigned char)value);
+    }
+    
+    uint64_t readVarint(const unsigned char*& data, const unsigned char* end)
+    {
+        uint64_t ret = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (data >= end) break;
+            unsigned char byte = *data;
+            ++data;
+            ret |= ((uint64_t)(byte & 127)) << shift;
+            if ((byte & 128) == 0) return ret;
+        }
+        throw DataFileException("malformed row data in wbsparse file");
+    }
+}
 
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
+    m_mapped = NULL;
+    m_version = 0;
     readFile(fileName);
 }
 
 void CaretSparseFile::readFile(const AString& filename)
 {
+    unmap();
     m_file.close();
     if (filename.endsWith(".gz"))
     {
@@ -49,10 +83,21 @@ void CaretSparseFile::readFile(const AString& filename)
     FileInformation fileInfo(filename);//useful later for file size, but create it now to reduce the amount of time between file open and size check
     char buf[8];
     m_file.read(buf, 8);
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < 7; ++i)
     {
         if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
     }
+    switch (buf[7])
+    {
+        case 0:
+            m_version = 1;
+            break;
+        case 2:
+            m_version = 2;
+            break;
+        default:
+            throw DataFileException("unsupported wbsparse version, file may be from a newer version of workbench");
+    }
     m_file.read(m_dims, 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
     {
@@ -60,6 +105,7 @@ void CaretSparseFile::readFile(const AString& filename)
     }
     if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
     m_indexArray.resize(m_dims[1] + 1);
+    m_byteIndexArray.resize(m_dims[1] + 1);
     vector<int64_t> lengthArray(m_dims[1]);
     m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
@@ -72,8 +118,29 @@ void CaretSparseFile::readFile(const AString& filename)
         if (lengthArray[i] > m_dims[0] || lengthArray[i] < 0) throw DataFileException("impossible value found in length array");
         m_indexArray[i + 1] = m_indexArray[i] + lengthArray[i];
     }
-    m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
-    int64_t xml_offset = m_valuesOffset + m_indexArray[m_dims[1]] * 2 * sizeof(int64_t);
+    m_byteIndexArray[0] = 0;
+    if (m_version == 1)
+    {
+        for (int64_t i = 0; i <= m_dims[1]; ++i)
+        {
+            m_byteIndexArray[i] = m_indexArray[i] * 2 * sizeof(int64_t);
+        }
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+    } else {
+        vector<int64_t> byteLengthArray(m_dims[1]);
+        m_file.read(byteLengthArray.data(), m_dims[1] * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(byteLengthArray.data(), m_dims[1]);
+        }
+        for (int64_t i = 0; i < m_dims[1]; ++i)
+        {
+            if (byteLengthArray[i] < lengthArray[i] * 6 || byteLengthArray[i] > lengthArray[i] * MAX_V2_ENTRY_BYTES) throw DataFileException("impossible value found in byte length array");
+            m_byteIndexArray[i + 1] = m_byteIndexArray[i] + byteLengthArray[i];
+        }
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + 2 * m_dims[1] * sizeof(int64_t);
+    }
+    int64_t xml_offset = m_valuesOffset + m_byteIndexArray[m_dims[1]];
     if (xml_offset >= fileInfo.size()) throw DataFileException("file is truncated");
     int64_t xml_length = fileInfo.size() - xml_offset;
     if (xml_length < 1) throw DataFileException("file is truncated");
@@ -94,91 +161,131 @@ void CaretSparseFile::readFile(const AString& filename)
     {
         throw DataFileException("cifti XML doesn't match dimensions of sparse file");
     }
+    int64_t dataBytes = m_byteIndexArray[m_dims[1]];
+    if (dataBytes > 0)
+    {//map the data section so that rows can be decoded straight from the page cache, without seeking a shared file handle
+        m_mapFile.setFileName(filename);
+        if (m_mapFile.open(QIODevice::ReadOnly))
+        {
+            uchar* mapped = m_mapFile.map(m_valuesOffset, dataBytes);//can fail for large files on 32-bit, or some filesystems, then we read through m_file instead
+            if (mapped != NULL)
+            {
+                m_mapped = mapped;
+            } else {
+                m_mapFile.close();
+            }
+        }
+    }
+}
+
+void CaretSparseFile::unmap()
+{
+    if (m_mapped != NULL)
+    {
+        m_mapFile.unmap((uchar*)m_mapped);
+        m_mapped = NULL;
+    }
+    m_mapFile.close();
 }
 
 CaretSparseFile::~CaretSparseFile()
 {
+    unmap();
 }
 
 void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 {
-    CaretAssert(index >= 0 && index < m_dims[1]);
-    int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
-    int64_t numToRead = (end - start) * 2;
-    m_scratchArray.resize(numToRead);
-    m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
-    m_file.read(m_scratchArray.data(), numToRead * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
-    }
-    int64_t curIndex = 0;
-    for (int64_t i = 0; i < numToRead; i += 2)
+    vector<int64_t> indices, values;//not members, so that rows can be read in parallel
+    getRowSparse(index, indices, values);
+    for (int64_t i = 0; i < m_dims[0]; ++i)
     {
-        int64_t index = m_scratchArray[i];
-        if (index < curIndex || index >= m_dims[0]) throw DataFileException("impossible index value found in file");
-        while (curIndex < index)
-        {
-            rowOut[curIndex] = 0;
-            ++curIndex;
-        }
-        ++curIndex;
-        rowOut[index] = m_scratchArray[i + 1];
+        rowOut[i] = 0;
     }
-    while (curIndex < m_dims[0])
+    int64_t numNonzero = (int64_t)indices.size();
+    for (int64_t i = 0; i < numNonzero; ++i)
     {
-        rowOut[curIndex] = 0;
-        ++curIndex;
+        rowOut[indices[i]] = values[i];
     }
 }
 
 void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
-    int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
-    int64_t numToRead = (end - start) * 2, numNonzero = end - start;
-    m_scratchArray.resize(numToRead);
-    m_file.seek(m_valuesOffset + start * sizeof(int64_t) * 2);
-    m_file.read(m_scratchArray.data(), numToRead * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), numToRead);
-    }
+    int64_t numNonzero = m_indexArray[index + 1] - m_indexArray[index];
+    int64_t byteStart = m_byteIndexArray[index], numBytes = m_byteIndexArray[index + 1] - byteStart;
     indicesOut.resize(numNonzero);
     valuesOut.resize(numNonzero);
+    if (numNonzero == 0) return;
+    const unsigned char* data = NULL;
+    vector<unsigned char> buffer;
+    if (m_mapped != NULL)
+    {
+        data = m_mapped + byteStart;
+    } else {
+        buffer.resize(numBytes);
+        CaretMutexLocker locked(&m_fileMutex);//seek and read must not be interleaved with another thread's
+        m_file.seek(m_valuesOffset + byteStart);
+        m_file.read(buffer.data(), numBytes);
+        data = buffer.data();
+    }
+    const unsigned char* end = data + numBytes;
     int64_t lastIndex = -1;
     for (int64_t i = 0; i < numNonzero; ++i)
     {
-        indicesOut[i] = m_scratchArray[i * 2];
-        valuesOut[i] = m_scratchArray[i * 2 + 1];
+        if (m_version == 1)
+        {
+            int64_t entry[2];
+            memcpy(entry, data, 2 * sizeof(int64_t));//the mapping has no alignment guarantees
+            data += 2 * sizeof(int64_t);
+            if (ByteOrderEnum::isSystemBigEndian())
+            {
+                ByteSwapping::swapBytes(entry, 2);
+            }
+            indicesOut[i] = entry[0];
+            valuesOut[i] = entry[1];
+        } else {
+            uint64_t delta = readVarint(data, end);
+            if (delta >= (uint64_t)m_dims[0]) throw DataFileException("impossible index value found in file");
+            uint64_t high = readVarint(data, end);
+            if (end - data < 4) throw DataFileException("malformed row data in wbsparse file");
+            uint64_t low = ((uint64_t)data[0]) | (((uint64_t)data[1]) << 8) | (((uint64_t)data[2]) << 16) | (((uint64_t)data[3]) << 24);
+            data += 4;
+            indicesOut[i] = lastIndex + 1 + (int64_t)delta;
+            valuesOut[i] = (int64_t)((high << 32) | low);
+        }
         if (indicesOut[i] <= lastIndex || indicesOut[i] >= m_dims[0]) throw DataFileException("impossible index value found in file");
         lastIndex = indicesOut[i];
     }
+    if (data != end) throw DataFileException("malformed row data in wbsparse file");
 }
 
 void CaretSparseFile::getFibersRow(const int64_t& index, FiberFractions* rowOut)
 {
-    if (m_scratchRow.size() != (size_t)m_dims[0]) m_scratchRow.resize(m_dims[0]);
-    getRow(index, (int64_t*)m_scratchRow.data());
+    vector<int64_t> indices, values;
+    getRowSparse(index, indices, values);
     for (int64_t i = 0; i < m_dims[0]; ++i)
     {
-        if (m_scratchRow[i] == 0)
+        rowOut[i].zero();
+    }
+    int64_t numNonzero = (int64_t)indices.size();
+    for (int64_t i = 0; i < numNonzero; ++i)
+    {
+        if (values[i] != 0)
         {
-            rowOut[i].zero();
-        } else {
-             decodeFibers(m_scratchRow[i], rowOut[i]);
+            decodeFibers((uint64_t)values[i], rowOut[indices[i]]);
         }
     }
 }
 
 void CaretSparseFile::getFibersRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<FiberFractions>& valuesOut)
 {
-    getRowSparse(index, indicesOut, m_scratchSparseRow);
-    size_t numNonzero = m_scratchSparseRow.size();
+    vector<int64_t> values;
+    getRowSparse(index, indicesOut, values);
+    size_t numNonzero = values.size();
     valuesOut.resize(numNonzero);
     for (size_t i = 0; i < numNonzero; ++i)
     {
-        decodeFibers(((uint64_t*)m_scratchSparseRow.data())[i], valuesOut[i]);
+        decodeFibers((uint64_t)values[i], valuesOut[i]);
     }
 }
 
@@ -206,12 +313,14 @@ void FiberFractions::zero()
     distance = 0.0f;
 }
 
-CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml)
+CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const int& version)
 {
     if (!fileName.endsWith(".trajTEMP.wbsparse"))
     {//for now (and maybe forever), this format is single-purpose
         CaretLogWarning("sparse trajectory file '" + fileName + "' should be saved ending in .trajTEMP.wbsparse");
     }
+    if (version != 1 && version != 2) throw DataFileException("wbsparse version must be 1 or 2");
+    m_version = version;
     m_finished = false;
     int64_t dimensions[2] = { xml.getDimensionLength(CiftiXML::ALONG_ROW), xml.getDimensionLength(CiftiXML::ALONG_COLUMN) };
     if (dimensions[0] < 1 || dimensions[1] < 1) throw DataFileException("both dimensions must be positive");
@@ -223,7 +332,10 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
         throw DataFileException("wbsparse files cannot be written compressed");
     }//because after we finish writing the data, we have to come back and write the lengths array
     m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
-    m_file.write(magic, 8);
+    char tempMagic[8];
+    memcpy(tempMagic, magic, 8);
+    if (m_version == 2) tempMagic[7] = 2;
+    m_file.write(tempMagic, 8);
     int64_t tempdims[2] = { m_dims[0], m_dims[1] };
     if (ByteOrderEnum::isSystemBigEndian())
     {
@@ -232,38 +344,29 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
     m_file.write(tempdims, 2 * sizeof(int64_t));
     m_lengthArray.resize(m_dims[1], 0);//initialize the memory so that valgrind won't complain
     m_file.write(m_lengthArray.data(), m_dims[1] * sizeof(uint64_t));//write it to get the file to the correct length
-    m_nextRowIndex = 0;
     m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+    if (m_version == 2)
+    {
+        m_byteLengthArray.resize(m_dims[1], 0);
+        m_file.write(m_byteLengthArray.data(), m_dims[1] * sizeof(uint64_t));
+        m_valuesOffset += m_dims[1] * sizeof(int64_t);
+    }
+    m_nextRowIndex = 0;
 }
 
 void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
 {
-    CaretAssert(index < m_dims[1]);
-    CaretAssert(index >= m_nextRowIndex);
-    while (m_nextRowIndex < index)
-    {
-        m_lengthArray[m_nextRowIndex] = 0;
-        ++m_nextRowIndex;
-    }
-    m_scratchArray.clear();
-    int64_t count = 0;
+    m_scratchIndices.clear();
+    m_scratchValues.clear();
     for (int64_t i = 0; i < m_dims[0]; ++i)
     {
         if (row[i] != 0)
         {
-            m_scratchArray.push_back(i);
-            m_scratchArray.push_back(row[i]);
-            ++count;
+            m_scratchIndices.push_back(i);
+            m_scratchValues.push_back(row[i]);
         }
     }
-    m_lengthArray[index] = count;
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
-    }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
-    m_nextRowIndex = index + 1;
-    if (m_nextRowIndex == m_dims[1]) finish();
+    writeRowSparse(index, m_scratchIndices, m_scratchValues);
 }
 
 void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
@@ -277,21 +380,39 @@ void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<in
         ++m_nextRowIndex;
     }
     m_scratchArray.clear();
+    m_scratchBytes.clear();
     size_t numNonzero = indices.size();//assume no zeros
     m_lengthArray[index] = numNonzero;
     int64_t lastIndex = -1;
     for (size_t i = 0; i < numNonzero; ++i)
     {
         if (indices[i] <= lastIndex || indices[i] >= m_dims[0]) throw DataFileException("indices must be sorted when writing sparse rows");
+        if (m_version == 1)
+        {
+            m_scratchArray.push_back(indices[i]);
+            m_scratchArray.push_back(values[i]);
+        } else {
+            appendVarint(m_scratchBytes, (uint64_t)(indices[i] - lastIndex - 1));
+            uint64_t value = (uint64_t)values[i];
+            appendVarint(m_scratchBytes, value >> 32);//streamline count for fibers, usually small
+            for (int b = 0; b < 4; ++b)
+            {
+                m_scratchBytes.push_back((unsigned char)((value >> (8 * b)) & 255));
+            }
+        }
         lastIndex = indices[i];
-        m_scratchArray.push_back(indices[i]);
-        m_scratchArray.push_back(values[i]);
     }
-    if (ByteOrderEnum::isSystemBigEndian())
+    if (m_version == 1)
     {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+        }
+        m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
+    } else {
+        m_byteLengthArray[index] = m_scratchBytes.size();
+        m_file.write(m_scratchBytes.data(), m_scratchBytes.size());
     }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
     m_nextRowIndex = index + 1;
     if (m_nextRowIndex == m_dims[1]) finish();
 }
@@ -339,6 +460,14 @@ void CaretSparseFileWriter::finish()
         ByteSwapping::swapBytes(m_lengthArray.data(), m_lengthArray.size());
     }
     m_file.write(m_lengthArray.data(), m_lengthArray.size() * sizeof(uint64_t));
+    if (m_version == 2)
+    {
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_byteLengthArray.data(), m_byteLengthArray.size());
+        }
+        m_file.write(m_byteLengthArray.data(), m_byteLengthArray.size() * sizeof(uint64_t));
+    }
     m_file.close();
 }
 
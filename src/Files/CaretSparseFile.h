@@ -24,8 +24,11 @@
 #include <vector>
 #include "stdint.h"
 
+#include <QFile>
+
 #include "AString.h"
 #include "CaretBinaryFile.h"
+#include "CaretMutex.h"
 #include "CiftiXML.h"
 #include "DataFile.h"
 #include "DataFileException.h"
@@ -40,19 +43,30 @@ namespace caret {
         void zero();
     };
     
+    ///version 1 stores each nonzero as an (int64 index, int64 value) pair
+    ///version 2 adds an array of the byte length of each row after the length array, and stores each nonzero as
+    ///varint(index - previous index - 1), varint(value >> 32), then the low 32 bits of the value as 4 bytes, all little endian
+    ///this takes trajectory files from 16 bytes per nonzero to about 7, as the high half of coded fibers is the streamline count
     class CaretSparseFile /* : public DataFile */
     {
         static void decodeFibers(const uint64_t& coded, FiberFractions& decoded);//takes a uint because right shift on signed is implementation dependent
         CaretBinaryFile m_file;
+        QFile m_mapFile;
+        const unsigned char* m_mapped;//the entire data section, when mapping works
+        CaretMutex m_fileMutex;//only used when not mapped
+        int m_version;
         int64_t m_dims[2], m_valuesOffset;
-        std::vector<uint64_t> m_indexArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        std::vector<uint64_t> m_indexArray, m_byteIndexArray;//nonzero and byte offsets of the start of each row, relative to the data section
         CaretSparseFile(const CaretSparseFile& rhs);
         CiftiXML m_xml;
+        void unmap();
     public:
         const int64_t* getDimensions() { return m_dims; }
+        
+        ///1 or 2, see above
+        int getVersion() const { return m_version; }
 
-        CaretSparseFile() {};
+        CaretSparseFile() { m_mapped = NULL; m_version = 0; };
         
         virtual void readFile(const AString& filename);
         
@@ -63,6 +77,7 @@ namespace caret {
         ///get a reference to the XML data
         const CiftiXML& getCiftiXML() const { return m_xml; }
         
+        ///the row functions may be called from multiple threads at once, they don't contend when the file could be memory mapped
         void getRow(const int64_t& index, int64_t* rowOut);
         
         void getRowSparse(const int64_t& index, std::vector<int64_t>& indicesOut, std::vector<int64_t>& valuesOut);
@@ -79,14 +94,17 @@ namespace caret {
         static void encodeFibers(const FiberFractions& orig, uint64_t& coded);
         static uint32_t myclamp(const int& x);
         CaretBinaryFile m_file;
+        int m_version;
         int64_t m_dims[2], m_valuesOffset, m_nextRowIndex;
         bool m_finished;
-        std::vector<uint64_t> m_lengthArray, m_scratchRow;
-        std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
+        std::vector<uint64_t> m_lengthArray, m_byteLengthArray, m_scratchRow;
+        std::vector<int64_t> m_scratchArray, m_scratchSparseRow, m_scratchIndices, m_scratchValues;
+        std::vector<unsigned char> m_scratchBytes;
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
     public:
-        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml);
+        ///version 2 is much smaller, but can't be read by older versions of workbench
+        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const int& version = 1);
         
         ~CaretSparseFileWriter();
         
@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -31,12 +32,91 @@
 #include "CaretOMP.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiFile.h"
+#include "ElapsedTimer.h"
 #include "FileInformation.h"
+#include "MathFunctions.h"
 #include "SceneClassAssistant.h"
 #include "dot_wrapper.h"
 
 using namespace caret;
 
+namespace {
+    /** Extra columns for the randomized SVD beyond the rank */
+    const int32_t LOW_RANK_OVERSAMPLING = 10;
+    
+    /**
+     * Eigen-decomposition of M^T * M for a numRows by numColumns row-major
+     * matrix M.  Eigenvalues are in decreasing order, eigenvectors are
+     * the columns of the numColumns by numColumns row-major output.
+     */
+    void symmetricEigen(const std::vector<double>& matrix,
+                        const int64_t numRows,
+                        const int32_t numColumns,
+                        std::vector<double>& eigenvaluesOut,
+                        std::vector<double>& eigenvectorsOut)
+    {
+        std::vector<double> gram(static_cast<int64_t>(numColumns) * numColumns, 0.0);
+        for (int64_t i = 0; i < numRows; i++) {
+            const double* row = &matrix[i * numColumns];
+            for (int32_t a = 0; a < numColumns; a++) {
+                for (int32_t b = a; b < numColumns; b++) {
+                    gram[a * numColumns + b] += row[a] * row[b];
+                }
+            }
+        }
+        std::vector<double*> gramRows(numColumns), vectorRows(numColumns);
+        eigenvectorsOut.assign(static_cast<int64_t>(numColumns) * numColumns, 0.0);
+        eigenvaluesOut.assign(numColumns, 0.0);
+        for (int32_t a = 0; a < numColumns; a++) {
+            for (int32_t b = 0; b < a; b++) {
+                gram[a * numColumns + b] = gram[b * numColumns + a];
+            }
+            gramRows[a] = &gram[a * numColumns];
+            vectorRows[a] = &eigenvectorsOut[a * numColumns];
+        }
+        MathFunctions::vtkJacobiN(&gramRows[0], numColumns, &eigenvaluesOut[0], &vectorRows[0]);
+    }
+    
+    /**
+     * Make the columns of a numRows by numColumns row-major matrix
+     * orthonormal, using the eigen-decomposition of its Gram matrix.
+     * Columns in directions with (nearly) no variance become zero.
+     */
+    void orthonormalizeColumns(std::vector<double>& matrix,
+                               const int64_t numRows,
+                               const int32_t numColumns)
+    {
+        std::vector<double> eigenvalues, eigenvectors;
+        symmetricEigen(matrix, numRows, numColumns, eigenvalues, eigenvectors);
+        std::vector<double> transform(static_cast<int64_t>(numColumns) * numColumns, 0.0);
+        const double tolerance = std::max(eigenvalues[0], 0.0) * 1.0e-12;
+        for (int32_t k = 0; k < numColumns; k++) {
+            if (eigenvalues[k] > tolerance) {
+                const double scale = 1.0 / std::sqrt(eigenvalues[k]);
+                for (int32_t m = 0; m < numColumns; m++) {
+                    transform[m * numColumns + k] = eigenvectors[m * numColumns + k] * scale;
+                }
+            }
+        }
+#pragma omp CARET_PAR
+        {
+            std::vector<double> rowScratch(numColumns);
+#pragma omp CARET_FOR schedule(dynamic, 256)
+            for (int64_t i = 0; i < numRows; i++) {
+                double* row = &matrix[i * numColumns];
+                for (int32_t k = 0; k < numColumns; k++) {
+                    double sum = 0.0;
+                    for (int32_t m = 0; m < numColumns; m++) {
+                        sum += row[m] * transform[m * numColumns + k];
+                    }
+                    rowScratch[k] = sum;
+                }
+                std::copy(rowScratch.begin(), rowScratch.end(), row);
+            }
+        }
+    }
+}
+
 /**
  * \class caret::CiftiConnectivityMatrixDenseDynamicFile 
  * \brief Connectivity Dynamic Dense x Dense File version of data-series
@@ -62,13 +142,29 @@ m_numberOfBrainordinates(-1),
 m_numberOfTimePoints(-1),
 m_validDataFlag(false),
 m_enabledAsLayer(true),
-m_cacheDataFlag(false)
+m_cacheDataFlag(false),
+m_windowFirstTimePoint(0),
+m_windowNumberOfTimePoints(0),
+m_lowRankEnabled(false),
+m_lowRankRank(100),
+m_windowStateRowIndex(-1),
+m_windowStateFirstTimePoint(0),
+m_windowStateNumberOfTimePoints(0),
+m_lowRankFactorsRank(0)
 {
     CaretAssert(m_parentDataSeriesFile);
 
     m_sceneAssistant.grabNew(new SceneClassAssistant());
     m_sceneAssistant->add("m_enabledAsLayer",
                           &m_enabledAsLayer);
+    m_sceneAssistant->add("m_windowFirstTimePoint",
+                          &m_windowFirstTimePoint);
+    m_sceneAssistant->add("m_windowNumberOfTimePoints",
+                          &m_windowNumberOfTimePoints);
+    m_sceneAssistant->add("m_lowRankEnabled",
+                          &m_lowRankEnabled);
+    m_sceneAssistant->add("m_lowRankRank",
+                          &m_lowRankRank);
 }
 
 /**
@@ -166,6 +262,7 @@ CiftiConnectivityMatrixDenseDynamicFile::updateAfterReading(const CiftiFile* cif
     m_numberOfTimePoints     = ciftiXML.getSeriesMap(CiftiXML::ALONG_ROW).getLength();
     
     m_rowData.clear();
+    invalidateWindowAndLowRankData();
     
     if ((m_numberOfBrainordinates > 0)
         && (m_numberOfTimePoints > 0)) {
@@ -228,6 +325,20 @@ CiftiConnectivityMatrixDenseDynamicFile::getDataForRow(float* dataOut,
                                         index);
 }
 
+/**
+ * Get direct access to the data for the given row, without a copy.
+ *
+ * @param index of the row.
+ * @return
+ *     Pointer to the row data, or NULL if the parent data series file is
+ *     not memory mapped or in memory (use getDataForRow() instead).
+ */
+const float*
+CiftiConnectivityMatrixDenseDynamicFile::getDataPointerForRow(const int64_t& index) const
+{
+    return m_parentDataSeriesCiftiFile->getRowPointer(index);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
@@ -268,11 +379,75 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(float* dataOut,
         return;
     }
     
+    if (isTimeWindowEnabled()) {
+        getWindowedDataForRow(dataOut,
+                              index);
+        return;
+    }
+    if (m_lowRankEnabled) {
+        getLowRankDataForRow(dataOut,
+                             index);
+        return;
+    }
+    
     std::vector<float> rowData(m_numberOfTimePoints);
     m_parentDataSeriesCiftiFile->getRow(&rowData[0], index);
     const float mean = m_rowData[index].m_mean;
     const float ssxx = m_rowData[index].m_sqrt_ssxx;
     
+    correlationWithAllRows(rowData,
+                           mean,
+                           ssxx,
+                           index,
+                           dataOut);
+}
+
+/**
+ * Compute the correlation of data with all rows.
+ *
+ * @param data
+ *     Data for correlation, one value per time point.
+ * @param mean
+ *     Mean of data
+ * @param sumSquared
+ *     Sum squared of data.
+ * @param selfRowIndex
+ *     Index of the row that is the data (correlation is set to one), or negative if none.
+ * @param dataOut
+ *     Output with correlation with each row.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::correlationWithAllRows(const std::vector<float>& data,
+                                                                const float mean,
+                                                                const float sumSquared,
+                                                                const int64_t selfRowIndex,
+                                                                float* dataOut) const
+{
+    if (m_cacheDataFlag) {
+        /*
+         * Dot products of the data with a block of rows in one call, so that
+         * the data is loaded once per group of rows instead of once per row
+         */
+        const int32_t BLOCK_SIZE = 64;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t blockStart = 0; blockStart < m_numberOfBrainordinates; blockStart += BLOCK_SIZE) {
+            const int32_t blockCount = std::min(BLOCK_SIZE, m_numberOfBrainordinates - blockStart);
+            const float* rows[BLOCK_SIZE];
+            double xySums[BLOCK_SIZE];
+            for (int32_t i = 0; i < blockCount; i++) {
+                rows[i] = &m_rowData[blockStart + i].m_data[0];
+            }
+            sddot_batch(&data[0], rows, blockCount, m_numberOfTimePoints, xySums);
+            for (int32_t i = 0; i < blockCount; i++) {
+                const int32_t iRow = blockStart + i;
+                dataOut[iRow] = ((iRow == selfRowIndex)
+                                 ? 1.0
+                                 : correlationFromSumOfProducts(xySums[i], mean, sumSquared, iRow, m_numberOfTimePoints));
+            }
+        }
+        return;
+    }
+    
     /*
      * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
      * there is almost no overhead to dynamic scheduling
@@ -281,8 +456,8 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(float* dataOut,
     for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
         float coefficient = 1.0;
         
-        if (iRow != index) {
-            coefficient = correlation(rowData, mean, ssxx, iRow, m_numberOfTimePoints);
+        if (iRow != selfRowIndex) {
+            coefficient = correlation(data, mean, sumSquared, iRow, m_numberOfTimePoints);
         }
         
         dataOut[iRow] = coefficient;
@@ -325,20 +500,11 @@ CiftiConnectivityMatrixDenseDynamicFile::processRowAverageData(std::vector<float
     
     std::vector<float> processedRowAverageData(m_numberOfBrainordinates);
     
-    /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
-     */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-        const float coefficient = correlation(rowAverageDataInOut,
-                                              mean,
-                                              sumSquared,
-                                              iRow,
-                                              dataLength);
-        CaretAssertVectorIndex(processedRowAverageData, iRow);
-        processedRowAverageData[iRow] = coefficient;
-    }
+    correlationWithAllRows(rowAverageDataInOut,
+                           mean,
+                           sumSquared,
+                           -1,
+                           &processedRowAverageData[0]);
     
     rowAverageDataInOut = processedRowAverageData;
 }
@@ -482,7 +648,6 @@ CiftiConnectivityMatrixDenseDynamicFile::correlation(const std::vector<float>& d
                                                      const int32_t otherRowIndex,
                                                      const int32_t numberOfPoints) const
 {
-    const double numFloat = numberOfPoints;
     double xySum = 0.0;
     
     CaretAssertVectorIndex(m_rowData, otherRowIndex);
@@ -497,6 +662,40 @@ CiftiConnectivityMatrixDenseDynamicFile::correlation(const std::vector<float>& d
         xySum = sddot(&data[0], &otherDataVector[0], numberOfPoints);
     }
     
+    return correlationFromSumOfProducts(xySum,
+                                        mean,
+                                        sumSquared,
+                                        otherRowIndex,
+                                        numberOfPoints);
+}
+
+/**
+ * Correlation from the sum of products of data with another row.
+ *
+ * @param xySum
+ *     Sum of products of data with the other row.
+ * @param mean
+ *     Mean of data
+ * @param sumSquared
+ *     Sum squared of data.
+ * @param otherRowIndex
+ *     Index of another row
+ * @param numberOfPoints
+ *     Number of points int the two arrays
+ * @return
+ *     The correlation coefficient computed on the two arrays.
+ */
+float
+CiftiConnectivityMatrixDenseDynamicFile::correlationFromSumOfProducts(const double xySum,
+                                                                      const float mean,
+                                                                      const float sumSquared,
+                                                                      const int32_t otherRowIndex,
+                                                                      const int32_t numberOfPoints) const
+{
+    const double numFloat = numberOfPoints;
+    CaretAssertVectorIndex(m_rowData, otherRowIndex);
+    const RowData& otherData = m_rowData[otherRowIndex];
+    
     const double ssxy = xySum - (numFloat * mean * otherData.m_mean);
     
     float correlationCoefficient = 0.0;
@@ -561,6 +760,518 @@ CiftiConnectivityMatrixDenseDynamicFile::correlation(const int32_t rowIndex,
     }
     return correlationCoefficient;
 }
+/**
+ * Set the sliding time window used for correlation.  Moving the window
+ * by a few time points updates the correlation of the most recently
+ * loaded row from running sums instead of recomputing it.
+ *
+ * NOTE: Afterwards, the loaded row must be loaded again for the
+ * new window to take effect.
+ *
+ * @param firstTimePoint
+ *     Index of the first time point in the window.
+ * @param numberOfTimePoints
+ *     Number of time points in the window, zero or less for all time points.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::setTimeWindow(const int32_t firstTimePoint,
+                                                       const int32_t numberOfTimePoints)
+{
+    m_windowFirstTimePoint     = std::max(firstTimePoint, 0);
+    m_windowNumberOfTimePoints = numberOfTimePoints;
+}
+
+/**
+ * Get the sliding time window used for correlation, limited to the
+ * time points in the file.
+ *
+ * @param firstTimePointOut
+ *     Output with index of the first time point in the window.
+ * @param numberOfTimePointsOut
+ *     Output with number of time points in the window.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getTimeWindow(int32_t& firstTimePointOut,
+                                                       int32_t& numberOfTimePointsOut) const
+{
+    firstTimePointOut     = 0;
+    numberOfTimePointsOut = std::max(m_numberOfTimePoints, 0);
+    if ((m_windowNumberOfTimePoints <= 0)
+        || (m_numberOfTimePoints <= 0)) {
+        return;
+    }
+    
+    firstTimePointOut     = std::min(m_windowFirstTimePoint, m_numberOfTimePoints - 1);
+    numberOfTimePointsOut = std::min(m_windowNumberOfTimePoints, m_numberOfTimePoints - firstTimePointOut);
+}
+
+/**
+ * @return True if the time window is a subset of the time points.
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::isTimeWindowEnabled() const
+{
+    int32_t firstTimePoint = 0, numberOfTimePoints = 0;
+    getTimeWindow(firstTimePoint,
+                  numberOfTimePoints);
+    return (numberOfTimePoints < m_numberOfTimePoints);
+}
+
+/**
+ * @return True if correlation uses the low-rank approximation
+ * (only used when the time window is all time points).
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::isLowRankApproximationEnabled() const
+{
+    return m_lowRankEnabled;
+}
+
+/**
+ * Set correlation to use a low-rank approximation of the data.  The
+ * approximation is computed once, when the first row is loaded, and
+ * afterwards each row costs rank times the number of rows, instead of
+ * number of time points times number of rows.
+ *
+ * NOTE: Afterwards, the loaded row must be loaded again.
+ *
+ * @param enabled
+ *     New status.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::setLowRankApproximationEnabled(const bool enabled)
+{
+    m_lowRankEnabled = enabled;
+}
+
+/**
+ * @return Rank of the low-rank approximation.
+ */
+int32_t
+CiftiConnectivityMatrixDenseDynamicFile::getLowRankApproximationRank() const
+{
+    return m_lowRankRank;
+}
+
+/**
+ * Set the rank of the low-rank approximation.
+ *
+ * @param rank
+ *     New rank.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::setLowRankApproximationRank(const int32_t rank)
+{
+    const int32_t newRank = std::max(rank, 1);
+    if (newRank != m_lowRankRank) {
+        m_lowRankRank = newRank;
+        m_lowRankFactors.clear();
+        m_lowRankFactorsRank = 0;
+    }
+}
+
+/**
+ * Discard sliding window sums and low-rank factors.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::invalidateWindowAndLowRankData()
+{
+    m_windowStateRowIndex = -1;
+    m_windowStateFirstTimePoint = 0;
+    m_windowStateNumberOfTimePoints = 0;
+    m_windowSum.clear();
+    m_windowSumSquared.clear();
+    m_windowSumProduct.clear();
+    m_windowStateRowData.clear();
+    m_lowRankFactors.clear();
+    m_lowRankFactorsRank = 0;
+}
+
+/**
+ * Get the time series for a row, without reading it when the data
+ * is cached or the parent file is memory mapped.  Safe to call
+ * from multiple threads.
+ *
+ * @param rowIndex
+ *     Index of the row.
+ * @param scratch
+ *     Used for the data when it must be read.
+ * @return
+ *     Pointer to the time series.
+ */
+const float*
+CiftiConnectivityMatrixDenseDynamicFile::getTimeSeriesForRow(const int32_t rowIndex,
+                                                             std::vector<float>& scratch) const
+{
+    if (m_cacheDataFlag) {
+        CaretAssertVectorIndex(m_rowData, rowIndex);
+        return &m_rowData[rowIndex].m_data[0];
+    }
+    
+    const float* pointer = m_parentDataSeriesCiftiFile->getRowPointer(rowIndex);
+    if (pointer != NULL) {
+        return pointer;
+    }
+    
+    scratch.resize(m_numberOfTimePoints);
+#pragma omp critical
+    {//reading a row from an on-disk CiftiFile moves its file position, so only one thread may read at a time
+        m_parentDataSeriesCiftiFile->getRow(&scratch[0], rowIndex);
+    }
+    return &scratch[0];
+}
+
+/**
+ * Update the per-row sums for the given window and row.  When the
+ * previous sums were for an overlapping window, only the time points
+ * entering and leaving the window are processed.
+ *
+ * @param rowIndex
+ *     Index of the row being correlated with all rows.
+ * @param firstTimePoint
+ *     First time point of the window.
+ * @param numberOfTimePoints
+ *     Number of time points in the window.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::updateWindowSums(const int64_t rowIndex,
+                                                          const int32_t firstTimePoint,
+                                                          const int32_t numberOfTimePoints) const
+{
+    const int32_t endTimePoint = firstTimePoint + numberOfTimePoints;
+    const int32_t oldFirstTimePoint = m_windowStateFirstTimePoint;
+    const int32_t oldEndTimePoint = m_windowStateFirstTimePoint + m_windowStateNumberOfTimePoints;
+    
+    std::vector<int32_t> removedTimePoints, addedTimePoints;
+    bool incrementalFlag = ((m_windowStateNumberOfTimePoints > 0)
+                            && (static_cast<int32_t>(m_windowSum.size()) == m_numberOfBrainordinates));
+    if (incrementalFlag) {
+        for (int32_t t = oldFirstTimePoint; t < oldEndTimePoint; t++) {
+            if ((t < firstTimePoint) || (t >= endTimePoint)) removedTimePoints.push_back(t);
+        }
+        for (int32_t t = firstTimePoint; t < endTimePoint; t++) {
+            if ((t < oldFirstTimePoint) || (t >= oldEndTimePoint)) addedTimePoints.push_back(t);
+        }
+        /*
+         * When most of the window changed, it is cheaper to start over
+         */
+        if (static_cast<int32_t>(removedTimePoints.size() + addedTimePoints.size()) >= numberOfTimePoints) {
+            incrementalFlag = false;
+        }
+    }
+    if ( ! incrementalFlag) {
+        removedTimePoints.clear();
+        addedTimePoints.clear();
+        for (int32_t t = firstTimePoint; t < endTimePoint; t++) {
+            addedTimePoints.push_back(t);
+        }
+        m_windowSum.assign(m_numberOfBrainordinates, 0.0);
+        m_windowSumSquared.assign(m_numberOfBrainordinates, 0.0);
+        m_windowSumProduct.assign(m_numberOfBrainordinates, 0.0);
+    }
+    
+    const bool sameRowFlag = (rowIndex == m_windowStateRowIndex);
+    if ( ! sameRowFlag) {
+        m_windowStateRowData.resize(m_numberOfTimePoints);
+        m_parentDataSeriesCiftiFile->getRow(&m_windowStateRowData[0], rowIndex);
+    }
+    const bool recomputeProductsFlag = (( ! incrementalFlag) || ( ! sameRowFlag));
+    const float* x = &m_windowStateRowData[0];
+    const int32_t numRemoved = static_cast<int32_t>(removedTimePoints.size());
+    const int32_t numAdded   = static_cast<int32_t>(addedTimePoints.size());
+    
+#pragma omp CARET_PAR
+    {
+        std::vector<float> scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+            const float* y = getTimeSeriesForRow(iRow, scratch);
+            double sum = m_windowSum[iRow];
+            double sumSquared = m_windowSumSquared[iRow];
+            double sumProduct = m_windowSumProduct[iRow];
+            for (int32_t i = 0; i < numRemoved; i++) {
+                const int32_t t = removedTimePoints[i];
+                sum        -= y[t];
+                sumSquared -= static_cast<double>(y[t]) * y[t];
+                sumProduct -= static_cast<double>(x[t]) * y[t];
+            }
+            for (int32_t i = 0; i < numAdded; i++) {
+                const int32_t t = addedTimePoints[i];
+                sum        += y[t];
+                sumSquared += static_cast<double>(y[t]) * y[t];
+                sumProduct += static_cast<double>(x[t]) * y[t];
+            }
+            if (recomputeProductsFlag) {
+                sumProduct = 0.0;
+                for (int32_t t = firstTimePoint; t < endTimePoint; t++) {
+                    sumProduct += static_cast<double>(x[t]) * y[t];
+                }
+            }
+            m_windowSum[iRow] = sum;
+            m_windowSumSquared[iRow] = sumSquared;
+            m_windowSumProduct[iRow] = sumProduct;
+        }
+    }
+    
+    m_windowStateRowIndex = rowIndex;
+    m_windowStateFirstTimePoint = firstTimePoint;
+    m_windowStateNumberOfTimePoints = numberOfTimePoints;
+}
+
+/**
+ * Load correlation of a row with all rows over the sliding time window.
+ *
+ * @param dataOut
+ *     Output with data.
+ * @param index
+ *     Index of the row.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getWindowedDataForRow(float* dataOut,
+                                                               const int64_t& index) const
+{
+    int32_t firstTimePoint = 0, numberOfTimePoints = 0;
+    getTimeWindow(firstTimePoint,
+                  numberOfTimePoints);
+    updateWindowSums(index,
+                     firstTimePoint,
+                     numberOfTimePoints);
+    
+    const double numFloat = numberOfTimePoints;
+    const double xSum = m_windowSum[index];
+    const double ssxx = m_windowSumSquared[index] - (xSum * xSum / numFloat);
+    
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+        float coefficient = 1.0;
+        
+        if (iRow != index) {
+            const double ySum = m_windowSum[iRow];
+            const double ssyy = m_windowSumSquared[iRow] - (ySum * ySum / numFloat);
+            const double ssxy = m_windowSumProduct[iRow] - (xSum * ySum / numFloat);
+            coefficient = 0.0;
+            if ((ssxx > 0.0)
+                && (ssyy > 0.0)) {
+                coefficient = (ssxy / std::sqrt(ssxx * ssyy));
+            }
+        }
+        
+        dataOut[iRow] = coefficient;
+    }
+}
+
+/**
+ * Load the low-rank approximation of correlation of a row with all rows.
+ *
+ * @param dataOut
+ *     Output with data.
+ * @param index
+ *     Index of the row.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getLowRankDataForRow(float* dataOut,
+                                                              const int64_t& index) const
+{
+    if (m_lowRankFactorsRank <= 0) {
+        computeLowRankFactors();
+    }
+    const int32_t rank = m_lowRankFactorsRank;
+    CaretAssert(rank > 0);
+    const float* rowFactors = &m_lowRankFactors[index * rank];
+    
+    const int32_t BLOCK_SIZE = 256;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t blockStart = 0; blockStart < m_numberOfBrainordinates; blockStart += BLOCK_SIZE) {
+        const int32_t blockCount = std::min(BLOCK_SIZE, m_numberOfBrainordinates - blockStart);
+        const float* rows[BLOCK_SIZE];
+        double dots[BLOCK_SIZE];
+        for (int32_t i = 0; i < blockCount; i++) {
+            rows[i] = &m_lowRankFactors[static_cast<int64_t>(blockStart + i) * rank];
+        }
+        sddot_batch(rowFactors, rows, blockCount, rank, dots);
+        for (int32_t i = 0; i < blockCount; i++) {
+            const int32_t iRow = blockStart + i;
+            dataOut[iRow] = ((iRow == index)
+                             ? 1.0
+                             : dots[i]);
+        }
+    }
+}
+
+/**
+ * Get a row of data with its mean removed and scaled to unit length,
+ * so that correlation of two rows is the dot product of their standardized rows.
+ *
+ * @param rowIndex
+ *     Index of the row.
+ * @param scratch
+ *     Used for the data when it must be read.
+ * @param standardizedOut
+ *     Output with the standardized data (all zeros when the row is constant).
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getStandardizedRow(const int32_t rowIndex,
+                                                            std::vector<float>& scratch,
+                                                            std::vector<double>& standardizedOut) const
+{
+    standardizedOut.assign(m_numberOfTimePoints, 0.0);
+    const RowData& rowData = m_rowData[rowIndex];
+    if ( ! (rowData.m_sqrt_ssxx > 0.0)) {
+        return;
+    }
+    
+    const float* data = getTimeSeriesForRow(rowIndex, scratch);
+    const double scale = 1.0 / rowData.m_sqrt_ssxx;
+    for (int32_t t = 0; t < m_numberOfTimePoints; t++) {
+        standardizedOut[t] = (data[t] - rowData.m_mean) * scale;
+    }
+}
+
+/**
+ * Multiply the standardized data (rows by time points) by a matrix.
+ *
+ * @param matrixIn
+ *     Time points by numberOfColumns matrix, row major.
+ * @param numberOfColumns
+ *     Number of columns in the matrices.
+ * @param matrixOut
+ *     Output rows by numberOfColumns matrix, row major.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::multiplyStandardizedData(const std::vector<double>& matrixIn,
+                                                                  const int32_t numberOfColumns,
+                                                                  std::vector<double>& matrixOut) const
+{
+    matrixOut.assign(static_cast<int64_t>(m_numberOfBrainordinates) * numberOfColumns, 0.0);
+#pragma omp CARET_PAR
+    {
+        std::vector<float> scratch;
+        std::vector<double> z;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+            getStandardizedRow(iRow, scratch, z);
+            double* out = &matrixOut[static_cast<int64_t>(iRow) * numberOfColumns];
+            for (int32_t t = 0; t < m_numberOfTimePoints; t++) {
+                if (z[t] == 0.0) continue;
+                const double* in = &matrixIn[static_cast<int64_t>(t) * numberOfColumns];
+                for (int32_t c = 0; c < numberOfColumns; c++) {
+                    out[c] += z[t] * in[c];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Multiply the transpose of the standardized data (time points by rows) by a matrix.
+ *
+ * @param matrixIn
+ *     Rows by numberOfColumns matrix, row major.
+ * @param numberOfColumns
+ *     Number of columns in the matrices.
+ * @param matrixOut
+ *     Output time points by numberOfColumns matrix, row major.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::multiplyStandardizedDataTransposed(const std::vector<double>& matrixIn,
+                                                                            const int32_t numberOfColumns,
+                                                                            std::vector<double>& matrixOut) const
+{
+    const int64_t outSize = static_cast<int64_t>(m_numberOfTimePoints) * numberOfColumns;
+    matrixOut.assign(outSize, 0.0);
+#pragma omp CARET_PAR
+    {
+        std::vector<float> scratch;
+        std::vector<double> z;
+        std::vector<double> accum(outSize, 0.0);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+            getStandardizedRow(iRow, scratch, z);
+            const double* in = &matrixIn[static_cast<int64_t>(iRow) * numberOfColumns];
+            for (int32_t t = 0; t < m_numberOfTimePoints; t++) {
+                if (z[t] == 0.0) continue;
+                double* out = &accum[static_cast<int64_t>(t) * numberOfColumns];
+                for (int32_t c = 0; c < numberOfColumns; c++) {
+                    out[c] += z[t] * in[c];
+                }
+            }
+        }
+#pragma omp critical
+        {
+            for (int64_t i = 0; i < outSize; i++) {
+                matrixOut[i] += accum[i];
+            }
+        }
+    }
+}
+
+/**
+ * Compute low-rank factors of the correlation matrix with a randomized
+ * SVD of the standardized data (one power iteration), so that the
+ * correlation of two rows is approximately the dot product of their factors.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::computeLowRankFactors() const
+{
+    ElapsedTimer timer;
+    timer.start();
+    
+    const int32_t rank = std::min(m_lowRankRank, m_numberOfTimePoints);
+    const int32_t numColumns = std::min(rank + LOW_RANK_OVERSAMPLING, m_numberOfTimePoints);
+    
+    /*
+     * Deterministic pseudo-random test matrix so results are repeatable
+     */
+    std::vector<double> omega(static_cast<int64_t>(m_numberOfTimePoints) * numColumns);
+    uint32_t seed = 12345;
+    for (int64_t i = 0; i < static_cast<int64_t>(omega.size()); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        omega[i] = (seed / 4294967296.0) * 2.0 - 1.0;
+    }
+    
+    std::vector<double> q, w;
+    multiplyStandardizedData(omega, numColumns, q);
+    omega.clear();
+    orthonormalizeColumns(q, m_numberOfBrainordinates, numColumns);
+    multiplyStandardizedDataTransposed(q, numColumns, w);
+    multiplyStandardizedData(w, numColumns, q);
+    orthonormalizeColumns(q, m_numberOfBrainordinates, numColumns);
+    multiplyStandardizedDataTransposed(q, numColumns, w);
+    
+    /*
+     * B = Q^T * Z, eigenvectors of B * B^T = W^T * W are the left singular vectors of B
+     */
+    std::vector<double> eigenvalues, eigenvectors;
+    symmetricEigen(w, m_numberOfTimePoints, numColumns, eigenvalues, eigenvectors);
+    
+    m_lowRankFactors.assign(static_cast<int64_t>(m_numberOfBrainordinates) * rank, 0.0f);
+    std::vector<double> singularValues(rank);
+    for (int32_t k = 0; k < rank; k++) {
+        singularValues[k] = std::sqrt(std::max(eigenvalues[k], 0.0));
+    }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+        const double* qRow = &q[static_cast<int64_t>(iRow) * numColumns];
+        float* factors = &m_lowRankFactors[static_cast<int64_t>(iRow) * rank];
+        for (int32_t k = 0; k < rank; k++) {
+            double sum = 0.0;
+            for (int32_t m = 0; m < numColumns; m++) {
+                sum += qRow[m] * eigenvectors[static_cast<int64_t>(m) * numColumns + k];
+            }
+            factors[k] = sum * singularValues[k];
+        }
+    }
+    m_lowRankFactorsRank = rank;
+    
+    CaretLogInfo("Computed rank "
+                 + AString::number(rank)
+                 + " approximation of dynamic connectivity for "
+                 + getFileNameNoPath()
+                 + " in "
+                 + AString::number(timer.getElapsedTimeSeconds(), 'f', 2)
+                 + " seconds");
+}
+
 /**
  * Save subclass data to the scene.
  *
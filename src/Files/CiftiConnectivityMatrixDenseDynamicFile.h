@@ -49,6 +49,22 @@ namespace caret {
         
         const CiftiBrainordinateDataSeriesFile* getParentBrainordinateDataSeriesFile() const;
         
+        void setTimeWindow(const int32_t firstTimePoint,
+                           const int32_t numberOfTimePoints);
+        
+        void getTimeWindow(int32_t& firstTimePointOut,
+                           int32_t& numberOfTimePointsOut) const;
+        
+        bool isTimeWindowEnabled() const;
+        
+        bool isLowRankApproximationEnabled() const;
+        
+        void setLowRankApproximationEnabled(const bool enabled);
+        
+        int32_t getLowRankApproximationRank() const;
+        
+        void setLowRankApproximationRank(const int32_t rank);
+        
     private:
         CiftiConnectivityMatrixDenseDynamicFile(const CiftiConnectivityMatrixDenseDynamicFile&);
 
@@ -58,6 +74,8 @@ namespace caret {
         virtual void getDataForColumn(float* dataOut, const int64_t& index) const;
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
+        
+        virtual const float* getDataPointerForRow(const int64_t& index) const;
                 
         virtual void getProcessedDataForColumn(float* dataOut, const int64_t& index) const;
         
@@ -93,6 +111,18 @@ namespace caret {
                           const int32_t otherRowIndex,
                           const int32_t numberOfPoints) const;
         
+        float correlationFromSumOfProducts(const double xySum,
+                                           const float mean,
+                                           const float sumSquared,
+                                           const int32_t otherRowIndex,
+                                           const int32_t numberOfPoints) const;
+        
+        void correlationWithAllRows(const std::vector<float>& data,
+                                    const float mean,
+                                    const float sumSquared,
+                                    const int64_t selfRowIndex,
+                                    float* dataOut) const;
+        
         void preComputeRowMeanAndSumSquared();
         
         void computeDataMeanAndSumSquared(const float* data,
@@ -100,6 +130,35 @@ namespace caret {
                                           float& meanOut,
                                           float& sumSquaredOut) const;
         
+        const float* getTimeSeriesForRow(const int32_t rowIndex,
+                                         std::vector<float>& scratch) const;
+        
+        void getWindowedDataForRow(float* dataOut,
+                                   const int64_t& index) const;
+        
+        void updateWindowSums(const int64_t rowIndex,
+                              const int32_t firstTimePoint,
+                              const int32_t numberOfTimePoints) const;
+        
+        void getLowRankDataForRow(float* dataOut,
+                                  const int64_t& index) const;
+        
+        void computeLowRankFactors() const;
+        
+        void getStandardizedRow(const int32_t rowIndex,
+                                std::vector<float>& scratch,
+                                std::vector<double>& standardizedOut) const;
+        
+        void multiplyStandardizedData(const std::vector<double>& matrixIn,
+                                      const int32_t numberOfColumns,
+                                      std::vector<double>& matrixOut) const;
+        
+        void multiplyStandardizedDataTransposed(const std::vector<double>& matrixIn,
+                                                const int32_t numberOfColumns,
+                                                std::vector<double>& matrixOut) const;
+        
+        void invalidateWindowAndLowRankData();
+        
         CiftiBrainordinateDataSeriesFile* m_parentDataSeriesFile;
         
         CiftiFile* m_parentDataSeriesCiftiFile;
@@ -116,6 +175,45 @@ namespace caret {
         
         const bool m_cacheDataFlag;
         
+        /** First time point of the sliding window */
+        int32_t m_windowFirstTimePoint;
+        
+        /** Number of time points in the sliding window, zero or less means all time points */
+        int32_t m_windowNumberOfTimePoints;
+        
+        /** Use low-rank approximation of correlation when the window is all time points */
+        bool m_lowRankEnabled;
+        
+        /** Rank of the low-rank approximation */
+        int32_t m_lowRankRank;
+        
+        /** Row for which m_windowSumProduct was computed */
+        mutable int64_t m_windowStateRowIndex;
+        
+        /** First time point of window for which sums were computed */
+        mutable int32_t m_windowStateFirstTimePoint;
+        
+        /** Number of time points in window for which sums were computed, zero if none */
+        mutable int32_t m_windowStateNumberOfTimePoints;
+        
+        /** Sum of each row over the window */
+        mutable std::vector<double> m_windowSum;
+        
+        /** Sum of squares of each row over the window */
+        mutable std::vector<double> m_windowSumSquared;
+        
+        /** Sum of products of each row with the row m_windowStateRowIndex over the window */
+        mutable std::vector<double> m_windowSumProduct;
+        
+        /** Time series of row m_windowStateRowIndex */
+        mutable std::vector<float> m_windowStateRowData;
+        
+        /** Low-rank factors, rows by m_lowRankFactorsRank, so correlation is the dot product of two rows of factors */
+        mutable std::vector<float> m_lowRankFactors;
+        
+        /** Rank of the factors in m_lowRankFactors, zero if not computed */
+        mutable int32_t m_lowRankFactorsRank;
+        
         CaretPointer<SceneClassAssistant> m_sceneAssistant;
         
         // ADD_NEW_MEMBERS_HERE
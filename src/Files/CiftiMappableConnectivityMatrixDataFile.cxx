@@ -376,8 +376,18 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
         for (std::vector<int64_t>::const_iterator iter = indices.begin();
              iter != indices.end();
              iter++) {
+            const float* rowData = &data[0];
             if (doRowsFlag) {
-                getDataForRow(&data[0], *iter);
+                /*
+                 * Memory mapped and in-memory files avoid the copy
+                 */
+                const float* rowPointer = getDataPointerForRow(*iter);
+                if (rowPointer != NULL) {
+                    rowData = rowPointer;
+                }
+                else {
+                    getDataForRow(&data[0], *iter);
+                }
             }
             else {
                 getDataForColumn(&data[0], *iter);
@@ -385,8 +395,7 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
             
             for (int64_t i = 0; i < dataLength; i++) {
                 CaretAssertVectorIndex(sum, i);
-                CaretAssertVectorIndex(data, i);
-                sum[i] += data[i];
+                sum[i] += rowData[i];
             }
         }
 
@@ -594,6 +603,20 @@ CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int
                         index);
 }
 
+/**
+ * Get direct access to the data for the given row, without a copy.
+ *
+ * @param index of the row.
+ * @return
+ *     Pointer to the row data, or NULL if the file is not memory
+ *     mapped or in memory (use getDataForRow() instead).
+ */
+const float*
+CiftiMappableConnectivityMatrixDataFile::getDataPointerForRow(const int64_t& index) const
+{
+    return m_ciftiFile->getRowPointer(index);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
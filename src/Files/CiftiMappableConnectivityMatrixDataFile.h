@@ -132,6 +132,8 @@ namespace caret {
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
         
+        virtual const float* getDataPointerForRow(const int64_t& index) const;
+        
         virtual void processRowAverageData(std::vector<float>& rowAverageData);
         
     private:
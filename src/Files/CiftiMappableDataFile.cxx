@@ -28,6 +28,7 @@
 #include "BoundingBox.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "ChartDataCartesian.h"
 #include "CiftiBrainordinateLabelFile.h"
@@ -62,8 +63,98 @@
 #include "PaletteFile.h"
 #include "SparseVolumeIndexer.h"
 
+#include <algorithm>
+#include <numeric>
+
 using namespace caret;
 
+namespace {
+    /*
+     * Reads rows of a CIFTI file a block at a time, so that statistics on
+     * all data in the file never need a copy of the entire file.  Rows of
+     * files that are in memory are used in place.  Blocks are read by one
+     * thread and may then be processed in parallel.
+     */
+    class CiftiRowBlockReader {
+    public:
+        CiftiRowBlockReader(const CiftiFile* ciftiFile)
+        : m_ciftiFile(ciftiFile)
+        {
+            m_rowIndices.resize(ciftiFile->getNumberOfRows());
+            std::iota(m_rowIndices.begin(), m_rowIndices.end(), (int64_t)0);
+            initialize();
+        }
+        
+        CiftiRowBlockReader(const CiftiFile* ciftiFile,
+                            const std::vector<int64_t>& rowIndices)
+        : m_ciftiFile(ciftiFile),
+        m_rowIndices(rowIndices)
+        {
+            initialize();
+        }
+        
+        /*
+         * Read the next block of rows.  Returns false when all rows have been read.
+         */
+        bool readNextBlock()
+        {
+            m_blockStart = m_blockEnd;
+            m_blockEnd = std::min(m_blockStart + m_maximumBlockRows,
+                                  static_cast<int64_t>(m_rowIndices.size()));
+            const int64_t numBlockRows = m_blockEnd - m_blockStart;
+            if (numBlockRows <= 0) {
+                return false;
+            }
+            
+            m_rowPointers.resize(numBlockRows);
+            for (int64_t i = 0; i < numBlockRows; i++) {
+                const int64_t rowIndex = m_rowIndices[m_blockStart + i];
+                const float* rowPointer = m_ciftiFile->getRowPointer(rowIndex);
+                if (rowPointer == NULL) {
+                    if (m_buffer.empty()) {
+                        m_buffer.resize(m_maximumBlockRows * m_numberOfColumns);
+                    }
+                    float* bufferRow = m_buffer.data() + i * m_numberOfColumns;
+                    m_ciftiFile->getRow(bufferRow,
+                                        rowIndex);
+                    rowPointer = bufferRow;
+                }
+                m_rowPointers[i] = rowPointer;
+            }
+            return true;
+        }
+        
+        int64_t getNumberOfRowsInBlock() const { return m_blockEnd - m_blockStart; }
+        
+        int64_t getNumberOfColumns() const { return m_numberOfColumns; }
+        
+        /* Index of the block's row in the file */
+        int64_t getRowIndex(const int64_t indexInBlock) const { return m_rowIndices[m_blockStart + indexInBlock]; }
+        
+        const float* getRow(const int64_t indexInBlock) const { return m_rowPointers[indexInBlock]; }
+        
+    private:
+        void initialize()
+        {
+            const int64_t maximumValuesInBlock = 1 << 22;
+            m_numberOfColumns = m_ciftiFile->getNumberOfColumns();
+            m_maximumBlockRows = std::max(static_cast<int64_t>(1),
+                                          maximumValuesInBlock / std::max(static_cast<int64_t>(1), m_numberOfColumns));
+            m_blockStart = 0;
+            m_blockEnd = 0;
+        }
+        
+        const CiftiFile* m_ciftiFile;
+        std::vector<int64_t> m_rowIndices;
+        std::vector<const float*> m_rowPointers;
+        std::vector<float> m_buffer;
+        int64_t m_numberOfColumns;
+        int64_t m_maximumBlockRows;
+        int64_t m_blockStart;
+        int64_t m_blockEnd;
+    };
+}
+
 
     
 /**
@@ -110,9 +201,7 @@ CiftiMappableDataFile::CiftiMappableDataFile(const DataFileTypeEnum::Enum dataFi
     m_dataMappingDirectionForCiftiXML = S_CIFTI_XML_ALONG_INVALID;
     m_dataReadingDirectionForCiftiXML = S_CIFTI_XML_ALONG_INVALID;
     
-    m_fileFastStatistics.grabNew(NULL);
-    m_fileHistogram.grabNew(NULL);
-    m_fileHistorgramLimitedValues.grabNew(NULL);
+    invalidateFileStatistics();
     
     /*
      * Note: The first palette normalization mode is assumed to
@@ -1068,9 +1157,7 @@ CiftiMappableDataFile::initializeAfterReading(const AString& filename)
     m_forceUpdateOfGroupAndNameHierarchy = false;
     m_classNameHierarchy->setAllSelected(true);
     
-    m_fileFastStatistics.grabNew(NULL);
-    m_fileHistogram.grabNew(NULL);
-    m_fileHistorgramLimitedValues.grabNew(NULL);
+    invalidateFileStatistics();
     
     CaretLogFiner("CLASS/NAME Table for : "
                   + this->getFileNameNoPath()
@@ -1365,6 +1452,7 @@ CiftiMappableDataFile::setMapData(const int32_t mapIndex,
     m_forceUpdateOfGroupAndNameHierarchy = true;
     
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    invalidateFileStatistics();
 }
 
 /**
@@ -1378,6 +1466,174 @@ CiftiMappableDataFile::updateForChangeInMapDataWithMapIndex(const int32_t mapInd
 {
     CaretAssertVectorIndex(m_mapContent, mapIndex);
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    invalidateFileStatistics();
+}
+
+/**
+ * Invalidate the statistics and histograms on all data in the file.  The
+ * statistics partial of each map is kept unless that map's data changed.
+ */
+void
+CiftiMappableDataFile::invalidateFileStatistics()
+{
+    m_fileFastStatistics.grabNew(NULL);
+    m_fileHistogram.grabNew(NULL);
+    m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsPartialValid = false;
+}
+
+/**
+ * Get the first pass of the statistics on all data in the file.  For files
+ * with maps, this merges the cached partial of each map, so after editing
+ * a map only that map's data is read.
+ *
+ * @return
+ *    Partial statistics (counts, extremes, mean and variance sums).
+ */
+const FastStatistics::Partial&
+CiftiMappableDataFile::getFileStatisticsPartial()
+{
+    if (m_fileStatisticsPartialValid) {
+        return m_fileStatisticsPartial;
+    }
+    
+    CaretAssert(m_ciftiFile);
+    const int64_t numRows = m_ciftiFile->getNumberOfRows();
+    const int64_t numCols = m_ciftiFile->getNumberOfColumns();
+    const int64_t numMaps = getNumberOfMaps();
+    
+    bool mapsAreRows    = false;
+    bool mapsAreColumns = false;
+    if (m_fileMapDataType == FILE_MAP_DATA_TYPE_MULTI_MAP) {
+        switch (m_dataReadingAccessMethod) {
+            case DATA_ACCESS_METHOD_INVALID:
+                break;
+            case DATA_ACCESS_NONE:
+                break;
+            case DATA_ACCESS_FILE_COLUMNS_OR_XML_ALONG_ROW:
+                mapsAreColumns = (numMaps == numCols);
+                break;
+            case DATA_ACCESS_FILE_ROWS_OR_XML_ALONG_COLUMN:
+                mapsAreRows = (numMaps == numRows);
+                break;
+        }
+    }
+    
+    FastStatistics::Partial fileStatisticsPartial;
+    if (mapsAreRows
+        || mapsAreColumns) {
+        std::vector<int64_t> invalidMapIndices;
+        for (int64_t i = 0; i < numMaps; i++) {
+            if ( ! m_mapContent[i]->m_statisticsPartialValid) {
+                invalidMapIndices.push_back(i);
+            }
+        }
+        const int64_t numInvalidMaps = static_cast<int64_t>(invalidMapIndices.size());
+        std::vector<FastStatistics::Partial> mapPartials(numInvalidMaps);
+        
+        if (numInvalidMaps > 0) {
+            if (mapsAreRows) {
+                CiftiRowBlockReader reader(m_ciftiFile,
+                                           invalidMapIndices);
+                int64_t blockOffset = 0;
+                while (reader.readNextBlock()) {
+                    const int64_t numBlockRows = reader.getNumberOfRowsInBlock();
+#pragma omp CARET_PARFOR schedule(dynamic)
+                    for (int64_t i = 0; i < numBlockRows; i++) {
+                        mapPartials[blockOffset + i].add(reader.getRow(i),
+                                                         numCols);
+                    }
+                    blockOffset += numBlockRows;
+                }
+            }
+            else {
+                /*
+                 * Each row has one value from every map, so gather each
+                 * map's values from a block of rows into a column
+                 */
+                CiftiRowBlockReader reader(m_ciftiFile);
+                while (reader.readNextBlock()) {
+                    const int64_t numBlockRows = reader.getNumberOfRowsInBlock();
+#pragma omp CARET_PAR
+                    {
+                        std::vector<float> columnData(numBlockRows);
+#pragma omp CARET_FOR schedule(dynamic, 16)
+                        for (int64_t j = 0; j < numInvalidMaps; j++) {
+                            const int64_t mapIndex = invalidMapIndices[j];
+                            for (int64_t i = 0; i < numBlockRows; i++) {
+                                columnData[i] = reader.getRow(i)[mapIndex];
+                            }
+                            mapPartials[j].add(columnData.data(),
+                                               numBlockRows);
+                        }
+                    }
+                }
+            }
+            
+            for (int64_t j = 0; j < numInvalidMaps; j++) {
+                MapContent* mc = m_mapContent[invalidMapIndices[j]];
+                mc->m_statisticsPartial = mapPartials[j];
+                mc->m_statisticsPartialValid = true;
+            }
+        }
+        
+        for (int64_t i = 0; i < numMaps; i++) {
+            fileStatisticsPartial.merge(m_mapContent[i]->m_statisticsPartial);
+        }
+    }
+    else {
+        CiftiRowBlockReader reader(m_ciftiFile);
+        while (reader.readNextBlock()) {
+            const int64_t numBlockRows = reader.getNumberOfRowsInBlock();
+            std::vector<FastStatistics::Partial> rowPartials(numBlockRows);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = 0; i < numBlockRows; i++) {
+                rowPartials[i].add(reader.getRow(i),
+                                   numCols);
+            }
+            for (int64_t i = 0; i < numBlockRows; i++) {
+                fileStatisticsPartial.merge(rowPartials[i]);
+            }
+        }
+    }
+    
+    m_fileStatisticsPartial = fileStatisticsPartial;
+    m_fileStatisticsPartialValid = true;
+    
+    return m_fileStatisticsPartial;
+}
+
+/**
+ * Add all data in the file to a histogram that has been started with
+ * a range or limits, reading the file a block of rows at a time.
+ *
+ * @param histogram
+ *    Histogram that is finished upon exit.
+ */
+void
+CiftiMappableDataFile::addFileDataToHistogram(Histogram& histogram) const
+{
+    CaretAssert(m_ciftiFile);
+    const Histogram emptyHistogram = histogram;
+    CiftiRowBlockReader reader(m_ciftiFile);
+    const int64_t numCols = reader.getNumberOfColumns();
+    while (reader.readNextBlock()) {
+        const int64_t numBlockRows = reader.getNumberOfRowsInBlock();
+#pragma omp CARET_PAR
+        {
+            Histogram threadHistogram = emptyHistogram;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < numBlockRows; i++) {
+                threadHistogram.addData(reader.getRow(i),
+                                        numCols);
+            }
+#pragma omp critical
+            {
+                histogram.merge(threadHistogram);
+            }
+        }
+    }
+    histogram.finish();
 }
 
 
@@ -2029,12 +2285,35 @@ const FastStatistics*
 CiftiMappableDataFile::getFileFastStatistics()
 {
     if (m_fileFastStatistics == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
-            m_fileFastStatistics.grabNew(new FastStatistics());
-            m_fileFastStatistics->update(&fileData[0],
-                                         fileData.size());
+        /*
+         * The merged partials give everything except the percentiles,
+         * which need a second pass over the rows with the ranges known
+         */
+        const FastStatistics::Partial& fileStatisticsPartial = getFileStatisticsPartial();
+        if (fileStatisticsPartial.m_dataCount > 0) {
+            CaretPointer<FastStatistics> fastStatistics(new FastStatistics());
+            fastStatistics->startStreaming(fileStatisticsPartial);
+            const FastStatistics emptyStatistics = *fastStatistics;
+            CiftiRowBlockReader reader(m_ciftiFile);
+            const int64_t numCols = reader.getNumberOfColumns();
+            while (reader.readNextBlock()) {
+                const int64_t numBlockRows = reader.getNumberOfRowsInBlock();
+#pragma omp CARET_PAR
+                {
+                    FastStatistics threadStatistics = emptyStatistics;
+#pragma omp CARET_FOR schedule(dynamic)
+                    for (int64_t i = 0; i < numBlockRows; i++) {
+                        threadStatistics.addStreamingData(reader.getRow(i),
+                                                          numCols);
+                    }
+#pragma omp critical
+                    {
+                        fastStatistics->mergeStreamingData(threadStatistics);
+                    }
+                }
+            }
+            fastStatistics->finishStreaming();
+            m_fileFastStatistics = fastStatistics;
         }
     }
     
@@ -2064,16 +2343,26 @@ CiftiMappableDataFile::getFileHistogram()
         updateHistogramFlag = true;
     }
     if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        
-        if ( ! fileData.empty()) {
+        /*
+         * Range of the histogram is from the merged partials
+         */
+        const FastStatistics::Partial& fileStatisticsPartial = getFileStatisticsPartial();
+        if (fileStatisticsPartial.m_dataCount > 0) {
+            float rangeMin = 0.0f;
+            float rangeMax = 0.0f;
+            if ((fileStatisticsPartial.m_negCount
+                 + fileStatisticsPartial.m_zeroCount
+                 + fileStatisticsPartial.m_posCount) > 0) {
+                rangeMin = fileStatisticsPartial.m_min;
+                rangeMax = fileStatisticsPartial.m_max;
+            }
             if (m_fileHistogram == NULL) {
                 m_fileHistogram.grabNew(new Histogram(numberOfBuckets));
             }
-            m_fileHistogram->update(numberOfBuckets,
-                                    &fileData[0],
-                                    fileData.size());
+            m_fileHistogram->startRange(numberOfBuckets,
+                                        rangeMin,
+                                        rangeMax);
+            addFileDataToHistogram(*m_fileHistogram);
             m_fileHistogramNumberOfBuckets = numberOfBuckets;
         }
     }
@@ -2123,20 +2412,18 @@ CiftiMappableDataFile::getFileHistogram(const float mostPositiveValueInclusive,
     }
     
     if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
+        CaretAssert(m_ciftiFile);
+        if ((m_ciftiFile->getNumberOfRows() * m_ciftiFile->getNumberOfColumns()) > 0) {
             if (m_fileHistorgramLimitedValues == NULL) {
                 m_fileHistorgramLimitedValues.grabNew(new Histogram());
             }
-            m_fileHistorgramLimitedValues->update(numberOfBuckets,
-                                                  &fileData[0],
-                                                  fileData.size(),
-                                                  mostPositiveValueInclusive,
-                                                  leastPositiveValueInclusive,
-                                                  leastNegativeValueInclusive,
-                                                  mostNegativeValueInclusive,
-                                                  includeZeroValues);
+            m_fileHistorgramLimitedValues->startLimited(numberOfBuckets,
+                                                        mostPositiveValueInclusive,
+                                                        leastPositiveValueInclusive,
+                                                        leastNegativeValueInclusive,
+                                                        mostNegativeValueInclusive,
+                                                        includeZeroValues);
+            addFileDataToHistogram(*m_fileHistorgramLimitedValues);
             
             m_fileHistogramLimitedValuesNumberOfBuckets             = numberOfBuckets;
             m_fileHistogramLimitedValuesMostPositiveValueInclusive  = mostPositiveValueInclusive;
@@ -6970,6 +7257,7 @@ m_mapIndex(mapIndex)
     m_fastStatistics.grabNew(NULL);
     m_histogram.grabNew(NULL);
     m_histogramLimitedValues.grabNew(NULL);
+    m_statisticsPartialValid = false;
     
     m_metadata = NULL;
     m_paletteColorMapping = NULL;
@@ -7223,6 +7511,7 @@ CiftiMappableDataFile::MapContent::updateForChangeInMapData()
     m_fastStatistics.grabNew(NULL);
     m_histogram.grabNew(NULL);
     m_histogramLimitedValues.grabNew(NULL);    
+    m_statisticsPartialValid = false;
     m_rgbaValid = false;
 }
 
@@ -7249,9 +7538,20 @@ CiftiMappableDataFile::MapContent::updateFastStatistics(const std::vector<float>
     }
     else {
         if (m_fastStatistics == NULL) {
+            /*
+             * The partial is also used for the file's statistics
+             */
+            if ( ! m_statisticsPartialValid) {
+                m_statisticsPartial.reset();
+                m_statisticsPartial.add(&data[0],
+                                        data.size());
+                m_statisticsPartialValid = true;
+            }
             m_fastStatistics.grabNew(new FastStatistics());
-            m_fastStatistics->update(&data[0],
-                                     data.size());
+            m_fastStatistics->startStreaming(m_statisticsPartial);
+            m_fastStatistics->addStreamingData(&data[0],
+                                               data.size());
+            m_fastStatistics->finishStreaming();
         }
     }
 }
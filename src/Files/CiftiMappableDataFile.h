@@ -29,6 +29,7 @@
 #include "CiftiXMLElements.h"
 #include "DisplayGroupEnum.h"
 #include "EventListenerInterface.h"
+#include "FastStatistics.h"
 #include "VolumeMappableInterface.h"
 
 #include <memory>
@@ -41,7 +42,6 @@ namespace caret {
     class CiftiFile;
     class CiftiParcelsMap;
     class CiftiXML;
-    class FastStatistics;
     class GraphicsPrimitiveV3fC4f;
     class GroupAndNameHierarchyModel;
     class Histogram;
@@ -476,6 +476,12 @@ namespace caret {
         
         CiftiMappableDataFile& operator=(const CiftiMappableDataFile&);
         
+        void invalidateFileStatistics();
+        
+        const FastStatistics::Partial& getFileStatisticsPartial();
+        
+        void addFileDataToHistogram(Histogram& histogram) const;
+        
     public:
         
         virtual void getMapData(const int32_t mapIndex,
@@ -639,6 +645,11 @@ namespace caret {
             float m_histogramLimitedValuesMostNegativeValueInclusive;
             bool m_histogramLimitedValuesIncludeZeroValues;
             
+            /** first pass statistics of the map's data, merged for the file's statistics */
+            FastStatistics::Partial m_statisticsPartial;
+            
+            bool m_statisticsPartialValid;
+            
         private:
             /** Name of map */
             AString m_name;
@@ -758,6 +769,11 @@ namespace caret {
         float m_fileHistogramLimitedValuesMostNegativeValueInclusive;
         bool m_fileHistogramLimitedValuesIncludeZeroValues;
         
+        /** Merged statistics partials of all data in file */
+        FastStatistics::Partial m_fileStatisticsPartial;
+        
+        bool m_fileStatisticsPartialValid = false;
+        
         /** Fast conversion of IJK to data offset */
         CaretPointer<SparseVolumeIndexer> m_voxelIndicesToOffset;
         
@@ -23,10 +23,13 @@
 #include "CaretAssert.h"
 #include "CaretHeap.h"
 #include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "FastStatistics.h"
 #include "SurfaceFile.h"
+#include "SurfaceHelperCache.h"
 #include "TopologyHelper.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdint.h>
@@ -34,7 +37,91 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int32_t GEODESIC_CACHE_VERSION = 1;//change this if the stored members or how they are computed changes
+}
+
 GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas)
+{
+    AString cacheFileName;
+    if (SurfaceHelperCache::isEnabled())
+    {
+        int64_t extraBytes = (correctedAreas == NULL ? 0 : surfaceIn->getNumberOfNodes() * sizeof(float));
+        cacheFileName = SurfaceHelperCache::getCacheFileName(surfaceIn, "wbgeodesic", GEODESIC_CACHE_VERSION, correctedAreas, extraBytes);
+        if (loadCache(cacheFileName, surfaceIn)) return;
+    }
+    computeFromSurface(surfaceIn, correctedAreas);
+    if (!cacheFileName.isEmpty())
+    {
+        saveCache(cacheFileName);
+    }
+}
+
+bool GeodesicHelperBase::loadCache(const AString& fileName, const SurfaceFile* surfaceIn)
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openRead(fileName)) return false;
+    int32_t fileNodes = -1;
+    bool ok = myCache.readValue(fileNodes) && fileNodes == surfaceIn->getNumberOfNodes() &&
+              myCache.readValue(m_avgNodeSpacing) && myCache.readValue(m_corrAreaSmallestFactor) &&
+              myCache.readValue(m_minNeighDist) && myCache.readValue(m_minNeighDist2) &&
+              myCache.readNested(nodeNeighbors) && myCache.readNested(distances) &&
+              myCache.readNested(nodeNeighbors2) && myCache.readNested(distances2) && myCache.readNested(neighbors2PathInfo) &&
+              myCache.finish();
+    if (ok)
+    {
+        ok = ((int32_t)nodeNeighbors.size() == fileNodes && (int32_t)distances.size() == fileNodes && (int32_t)nodeNeighbors2.size() == fileNodes &&
+              (int32_t)distances2.size() == fileNodes && (int32_t)neighbors2PathInfo.size() == fileNodes);
+        for (int32_t i = 0; ok && i < fileNodes; ++i)
+        {
+            ok = (nodeNeighbors[i].size() == distances[i].size() && nodeNeighbors2[i].size() == distances2[i].size() && nodeNeighbors2[i].size() == neighbors2PathInfo[i].size());
+            for (int32_t j = 0; ok && j < (int32_t)nodeNeighbors[i].size(); ++j)
+            {
+                if (nodeNeighbors[i][j] < 0 || nodeNeighbors[i][j] >= fileNodes) ok = false;
+            }
+            for (int32_t j = 0; ok && j < (int32_t)nodeNeighbors2[i].size(); ++j)
+            {
+                if (nodeNeighbors2[i][j] < 0 || nodeNeighbors2[i][j] >= fileNodes) ok = false;
+            }
+        }
+    }
+    if (!ok)
+    {
+        nodeNeighbors.clear();
+        distances.clear();
+        nodeNeighbors2.clear();
+        distances2.clear();
+        neighbors2PathInfo.clear();
+        return false;
+    }
+    numNodes = fileNodes;
+    nodeCoords.resize(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        nodeCoords[i] = surfaceIn->getCoordinate(i);
+    }
+    return true;
+}
+
+void GeodesicHelperBase::saveCache(const AString& fileName) const
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openWrite(fileName)) return;
+    myCache.writeValue(numNodes);
+    myCache.writeValue(m_avgNodeSpacing);
+    myCache.writeValue(m_corrAreaSmallestFactor);
+    myCache.writeValue(m_minNeighDist);
+    myCache.writeValue(m_minNeighDist2);
+    myCache.writeNested(nodeNeighbors);
+    myCache.writeNested(distances);
+    myCache.writeNested(nodeNeighbors2);
+    myCache.writeNested(distances2);
+    myCache.writeNested(neighbors2PathInfo);
+    myCache.finish();
+}
+
+void GeodesicHelperBase::computeFromSurface(const SurfaceFile* surfaceIn, const float* correctedAreas)
 {
     CaretPointer<TopologyHelperBase> topoBase(new TopologyHelperBase(surfaceIn));
     TopologyHelper topoHelpIn(topoBase);//leave this building one privately, to not introduce even worse dependencies regarding SurfaceFile
@@ -163,6 +250,20 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         distances2[baseNode].push_back(tempf);
         neighbors2PathInfo[baseNode].push_back(tempInfo);
     }
+    m_minNeighDist = -1.0f;//-1 means no edges
+    m_minNeighDist2 = -1.0f;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        for (int32_t j = 0; j < (int32_t)distances[i].size(); ++j)
+        {
+            if (m_minNeighDist < 0.0f || distances[i][j] < m_minNeighDist) m_minNeighDist = distances[i][j];
+        }
+        for (int32_t j = 0; j < (int32_t)distances2[i].size(); ++j)
+        {
+            if (m_minNeighDist2 < 0.0f || distances2[i][j] < m_minNeighDist2) m_minNeighDist2 = distances2[i][j];
+        }
+    }
+    if (m_minNeighDist2 < 0.0f || m_minNeighDist < m_minNeighDist2) m_minNeighDist2 = m_minNeighDist;//smooth searches use both kinds of neighbors
 }
 
 GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
@@ -172,6 +273,8 @@ GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& bas
     numNodes = m_myBase->numNodes;
     m_avgNodeSpacing = m_myBase->m_avgNodeSpacing;
     m_corrAreaSmallestFactor = m_myBase->m_corrAreaSmallestFactor;
+    m_minNeighDist = m_myBase->m_minNeighDist;
+    m_minNeighDist2 = m_myBase->m_minNeighDist2;
     distances = m_myBase->distances.data();
     distances2 = m_myBase->distances2.data();
     nodeNeighbors = m_myBase->nodeNeighbors.data();
@@ -215,8 +318,52 @@ void GeodesicHelper::getNodesToGeoDist(const int32_t node, const float maxdist,
     }
 }
 
+void GeodesicHelper::getNodesToGeoDistBatch(const SurfaceFile* surfaceIn, const vector<int32_t>& roots, const float maxdist, vector<vector<int32_t> >& nodesOut,
+                                            vector<vector<float> >& distsOut, const bool smoothflag)
+{
+    int64_t numRoots = (int64_t)roots.size();
+    nodesOut.resize(numRoots);
+    distsOut.resize(numRoots);
+#pragma omp CARET_PAR
+    {
+        CaretPointer<GeodesicHelper> myHelp = surfaceIn->getGeodesicHelper();//returns to the surface's pool when done
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numRoots; ++i)
+        {
+            myHelp->getNodesToGeoDist(roots[i], maxdist, nodesOut[i], distsOut[i], smoothflag);
+        }
+    }
+}
+
+void GeodesicHelper::getNodesToGeoDistBatch(const CaretPointer<const GeodesicHelperBase>& baseIn, const vector<int32_t>& roots, const float maxdist, vector<vector<int32_t> >& nodesOut,
+                                            vector<vector<float> >& distsOut, const bool smoothflag)
+{
+    int64_t numRoots = (int64_t)roots.size();
+    nodesOut.resize(numRoots);
+    distsOut.resize(numRoots);
+#pragma omp CARET_PAR
+    {
+        GeodesicHelper myHelp(baseIn);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numRoots; ++i)
+        {
+            myHelp.getNodesToGeoDist(roots[i], maxdist, nodesOut[i], distsOut[i], smoothflag);
+        }
+    }
+}
+
 void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth)
 {
+    float minDist = (smooth ? m_minNeighDist2 : m_minNeighDist);
+    if (minDist > 0.0f)
+    {
+        float bucketWidth = minDist * 0.5f;//half the shortest step, so rounding can't put a neighbor in the bucket being processed
+        if (maxdist / bucketWidth < MAX_BUCKETS)
+        {
+            dijkstraBuckets(root, maxdist, bucketWidth, nodes, dists, smooth);
+            return;
+        }
+    }
     int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0;
     const int32_t* neighbors;
     float tempf;
@@ -293,6 +440,79 @@ void GeodesicHelper::dijkstra(const int32_t root, const float maxdist, std::vect
     }
 }
 
+namespace
+{
+    struct BucketDistCompare
+    {
+        const float* m_dists;
+        BucketDistCompare(const float* dists) : m_dists(dists) { }
+        bool operator()(const int32_t& left, const int32_t& right) const { return m_dists[left] < m_dists[right]; }
+    };
+}
+
+void GeodesicHelper::dijkstraBuckets(const int32_t root, const float maxdist, const float bucketWidth, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth)
+{//dial's algorithm: every step is longer than a bucket, so nothing in the current bucket can improve anything else in it, and each bucket is final when reached
+    int32_t numBuckets = (int32_t)(maxdist / bucketWidth) + 1, numChanged = 0;
+    if ((int32_t)m_buckets.size() < numBuckets) m_buckets.resize(numBuckets);
+    output[root] = 0.0f;
+    marked[root] |= 4;
+    parent[root] = -1;//idiom for end of path
+    changed[numChanged++] = root;
+    m_buckets[0].push_back(root);
+    for (int32_t b = 0; b < numBuckets; ++b)
+    {
+        vector<int32_t>& curBucket = m_buckets[b];
+        if (curBucket.empty()) continue;
+        m_bucketNodes.clear();
+        for (int32_t k = 0; k < (int32_t)curBucket.size(); ++k)
+        {//nodes get pushed again when their distance improves, so skip ones already finished
+            int32_t whichnode = curBucket[k];
+            if (!(marked[whichnode] & 1))
+            {
+                marked[whichnode] |= 1;
+                m_bucketNodes.push_back(whichnode);
+            }
+        }
+        curBucket.clear();
+        sort(m_bucketNodes.begin(), m_bucketNodes.end(), BucketDistCompare(output));//keep output in increasing distance, like the heap version
+        for (int32_t k = 0; k < (int32_t)m_bucketNodes.size(); ++k)
+        {
+            int32_t whichnode = m_bucketNodes[k];
+            nodes.push_back(whichnode);
+            dists.push_back(output[whichnode]);
+            for (int pass = 0; pass < (smooth ? 2 : 1); ++pass)
+            {
+                const vector<int32_t>& neighbors = (pass == 0 ? nodeNeighbors[whichnode] : nodeNeighbors2[whichnode]);
+                const vector<float>& neighDists = (pass == 0 ? distances[whichnode] : distances2[whichnode]);
+                int32_t numNeigh = (int32_t)neighbors.size();
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    int32_t whichneigh = neighbors[j];
+                    if (marked[whichneigh] & 1) continue;
+                    float tempf = output[whichnode] + neighDists[j];
+                    if (tempf > maxdist) continue;
+                    if (!(marked[whichneigh] & 4))
+                    {
+                        marked[whichneigh] |= 4;
+                        changed[numChanged++] = whichneigh;
+                    } else if (!(tempf < output[whichneigh])) {
+                        continue;
+                    }
+                    output[whichneigh] = tempf;
+                    parent[whichneigh] = whichnode;
+                    int32_t whichBucket = (int32_t)(tempf / bucketWidth);
+                    if (whichBucket >= numBuckets) whichBucket = numBuckets - 1;
+                    m_buckets[whichBucket].push_back(whichneigh);
+                }
+            }
+        }
+    }
+    for (int32_t i = 0; i < numChanged; ++i)
+    {
+        marked[changed[i]] = 0;//minimize reinitialization of arrays
+    }
+}
+
 void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
 {//straightforward dijkstra, no cutoffs, full surface
     int32_t i, j, whichnode, whichneigh, numNeigh;
@@ -27,6 +27,7 @@
 #include <cmath>
 //for inlining
 
+#include "AString.h"
 #include "CaretMutex.h"
 #include "CaretPointer.h"
 #include "CaretHeap.h"
@@ -58,6 +59,10 @@ namespace caret {
         int32_t numNodes;
         float m_avgNodeSpacing;//to use for balancing line following penalty
         float m_corrAreaSmallestFactor;//so that heuristics can be consistent despite corrected areas
+        float m_minNeighDist, m_minNeighDist2;//shortest edge, and shortest of edges and crawl neighbors, for bucket queue widths
+        void computeFromSurface(const SurfaceFile* surfaceIn, const float* correctedAreas);
+        bool loadCache(const AString& fileName, const SurfaceFile* surfaceIn);
+        void saveCache(const AString& fileName) const;
     public:
         explicit GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas = NULL);//NOTE: this is only an APPROXIMATE correction, use the real surface whenever possible
         friend class GeodesicHelper;//let it grab the private variables it needs
@@ -78,13 +83,18 @@ namespace caret {
         std::vector<float> heurVal;
         std::vector<int32_t> marked, changed, parentStore;
         std::vector<int64_t> m_heapIdent;
+        std::vector<std::vector<int32_t> > m_buckets;//for bucket queue on limited distance searches
+        std::vector<int32_t> m_bucketNodes;
         int32_t numNodes;
         float m_avgNodeSpacing;
         float m_corrAreaSmallestFactor;
+        float m_minNeighDist, m_minNeighDist2;
+        static const int32_t MAX_BUCKETS = 4096;//beyond this, empty buckets cost more than the heap saves
         GeodesicHelper();//Don't allow construction without arguments
         GeodesicHelper& operator=(const GeodesicHelper& right);//can't assign
         GeodesicHelper(const GeodesicHelper&);//can't use copy constructor
         void dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth);//geodesic distance restricted
+        void dijkstraBuckets(const int32_t root, const float maxdist, const float bucketWidth, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth);//same, with a bucket queue instead of the heap
         void dijkstra(const int32_t root, bool smooth);//full surface
         void dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth);//partial surface
         int32_t dijkstra(const std::vector<int32_t>& startList, const std::vector<int32_t>& endList, const float& maxDist, bool smooth);//one path that connects lists
@@ -104,6 +114,14 @@ namespace caret {
         /// Get distances from root node, up to a geodesic distance cutoff, and also return their parents (root node has -1 as parent)
         void getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& neighborsOut, std::vector<float>& distsOut, std::vector<int32_t>& parentsOut, const bool smoothflag = true);
 
+        /// Get distances from each root node up to a geodesic distance cutoff, with roots processed in parallel using one helper per thread from the surface's pool - outputs are in the same order as roots
+        static void getNodesToGeoDistBatch(const SurfaceFile* surfaceIn, const std::vector<int32_t>& roots, const float maxdist, std::vector<std::vector<int32_t> >& neighborsOut,
+                                           std::vector<std::vector<float> >& distsOut, const bool smoothflag = true);
+        
+        /// Same as above, for a base that a surface doesn't cache (for instance, with corrected areas), helpers are made for the duration of the call
+        static void getNodesToGeoDistBatch(const CaretPointer<const GeodesicHelperBase>& baseIn, const std::vector<int32_t>& roots, const float maxdist, std::vector<std::vector<int32_t> >& neighborsOut,
+                                           std::vector<std::vector<float> >& distsOut, const bool smoothflag = true);
+
         /// Get distances from root node to entire surface - allocate the array first
         void getGeoFromNode(const int32_t node, float* valuesOut, const bool smoothflag = true);//MUST be already allocated to number of nodes
 
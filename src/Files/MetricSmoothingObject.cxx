@@ -22,16 +22,88 @@
 
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "SurfaceFile.h"
 #include "MetricFile.h"
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+#include "SurfaceHelperCache.h"
+
+#include <QByteArray>
+
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
 using namespace caret;
 
+AString MetricSmoothingObject::s_cacheDirectory;
+
+namespace
+{
+    const int SPMM_BLOCK = 16;//columns smoothed per pass over the weights, the per-vertex inner loop is this wide so it vectorizes
+    
+    const char* CACHE_KIND = "wbsmoothing";
+    const int32_t CACHE_KIND_VERSION = 1;
+    
+    template <bool USE_ROI, bool FIX_ZEROS>
+    void smoothBlock(const int32_t& numNodes, const int64_t* rowStart, const int32_t* nodes, const float* weights, const float* weightSums,
+                     const float* transposed, const float* roiColumn, float* const* columnsOut, const int& blockCols)
+    {//same arithmetic in the same order as smoothColumnInternal, for each column
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            if (weightSums[i] != 0.0f && (!USE_ROI || roiColumn[i] > 0.0f))
+            {
+                float sums[SPMM_BLOCK], columnWeightSums[SPMM_BLOCK];
+                float roiWeightSum = 0.0f;
+                for (int c = 0; c < SPMM_BLOCK; ++c)
+                {
+                    sums[c] = 0.0f;
+                    columnWeightSums[c] = 0.0f;
+                }
+                int64_t rowEnd = rowStart[i + 1];
+                for (int64_t j = rowStart[i]; j < rowEnd; ++j)
+                {
+                    int32_t neighbor = nodes[j];
+                    if (USE_ROI && !(roiColumn[neighbor] > 0.0f)) continue;
+                    float weight = weights[j];
+                    const float* values = transposed + neighbor * (int64_t)SPMM_BLOCK;
+                    for (int c = 0; c < SPMM_BLOCK; ++c)
+                    {
+                        sums[c] += weight * values[c];//when fixing zeros, this adds zero for zero values
+                    }
+                    if (FIX_ZEROS)
+                    {
+                        for (int c = 0; c < SPMM_BLOCK; ++c)
+                        {
+                            columnWeightSums[c] += (values[c] != 0.0f ? weight : 0.0f);
+                        }
+                    } else if (USE_ROI) {
+                        roiWeightSum += weight;
+                    }
+                }
+                for (int c = 0; c < blockCols; ++c)
+                {
+                    float divisor = (FIX_ZEROS ? columnWeightSums[c] : (USE_ROI ? roiWeightSum : weightSums[i]));
+                    if (divisor != 0.0f)
+                    {
+                        columnsOut[c][i] = sums[c] / divisor;
+                    } else {
+                        columnsOut[c][i] = 0.0f;
+                    }
+                }
+            } else {
+                for (int c = 0; c < blockCols; ++c)
+                {
+                    columnsOut[c][i] = 0.0f;
+                }
+            }
+        }
+    }
+}
+
 MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
 {
     CaretAssert(mySurf != NULL);
@@ -39,14 +111,27 @@ MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const fl
     {
         throw CaretException("roi number of nodes doesn't match the surface");
     }
+    AString cacheFileName;
+    if (!s_cacheDirectory.isEmpty())
+    {
+        cacheFileName = getCacheFileName(mySurf, kernel, myRoi, myMethod, nodeAreas);
+        if (loadCache(cacheFileName) && getNumberOfNodes() == mySurf->getNumberOfNodes())
+        {
+            return;
+        }
+    }
     precomputeWeights(mySurf, kernel, myRoi, myMethod, nodeAreas);
+    if (!cacheFileName.isEmpty())
+    {
+        saveCache(cacheFileName);
+    }
 }
 
 void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +139,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != getNumberOfNodes() || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(getNumberOfNodes(), 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != getNumberOfNodes())
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +160,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != getNumberOfNodes()))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,29 +198,82 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != getNumberOfNodes())
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != getNumberOfNodes() || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(getNumberOfNodes(), numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
+    const float* roiColumn = NULL;
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != getNumberOfNodes())
         {
             throw CaretException("roi does not match surface number of nodes");
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        roiColumn = roi->getValuePointerForColumn(0);
+    }
+    vector<vector<float> > scratch(min(numCols, (int32_t)SPMM_BLOCK), vector<float>(getNumberOfNodes()));
+    vector<const float*> columnsIn;
+    vector<float*> columnsOut;
+    for (int32_t start = 0; start < numCols; start += SPMM_BLOCK)
+    {
+        int32_t blockCols = min((int32_t)SPMM_BLOCK, numCols - start);
+        columnsIn.resize(blockCols);
+        columnsOut.resize(blockCols);
+        for (int32_t c = 0; c < blockCols; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            columnsIn[c] = metricIn->getValuePointerForColumn(start + c);
+            columnsOut[c] = scratch[c].data();
         }
-    } else {
-        for (int32_t i = 0; i < numCols; ++i)
+        smoothColumns(columnsIn, columnsOut, roiColumn, fixZeros);
+        for (int32_t c = 0; c < blockCols; ++c)
+        {
+            metricOut->setValuesForColumn(start + c, scratch[c].data());
+        }
+    }
+}
+
+void MetricSmoothingObject::smoothColumns(const vector<const float*>& columnsIn, const vector<float*>& columnsOut, const float* roiColumn, const bool& fixZeros) const
+{
+    CaretAssert(columnsIn.size() == columnsOut.size());
+    int numCols = (int)columnsIn.size();
+    int32_t numNodes = getNumberOfNodes();
+    vector<float> transposed(numNodes * (int64_t)SPMM_BLOCK);//vertex-major, so each weight is applied to a contiguous row of values
+    for (int start = 0; start < numCols; start += SPMM_BLOCK)
+    {
+        int blockCols = min(SPMM_BLOCK, numCols - start);
+#pragma omp CARET_PARFOR
+        for (int32_t i = 0; i < numNodes; ++i)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            float* row = transposed.data() + i * (int64_t)SPMM_BLOCK;
+            for (int c = 0; c < blockCols; ++c)
+            {
+                row[c] = columnsIn[start + c][i];
+            }
+            for (int c = blockCols; c < SPMM_BLOCK; ++c)
+            {
+                row[c] = 0.0f;
+            }
+        }
+        float* const* blockOut = columnsOut.data() + start;
+        if (roiColumn != NULL)
+        {
+            if (fixZeros)
+            {
+                smoothBlock<true, true>(numNodes, m_rowStart.data(), m_nodes.data(), m_weights.data(), m_weightSums.data(), transposed.data(), roiColumn, blockOut, blockCols);
+            } else {
+                smoothBlock<true, false>(numNodes, m_rowStart.data(), m_nodes.data(), m_weights.data(), m_weightSums.data(), transposed.data(), roiColumn, blockOut, blockCols);
+            }
+        } else {
+            if (fixZeros)
+            {
+                smoothBlock<false, true>(numNodes, m_rowStart.data(), m_nodes.data(), m_weights.data(), m_weightSums.data(), transposed.data(), roiColumn, blockOut, blockCols);
+            } else {
+                smoothBlock<false, false>(numNodes, m_rowStart.data(), m_nodes.data(), m_weights.data(), m_weightSums.data(), transposed.data(), roiColumn, blockOut, blockCols);
+            }
         }
     }
 }
@@ -154,17 +292,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[m_nodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +320,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += m_weights[j] * myColumn[m_nodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -218,18 +354,17 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_nodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +383,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = m_rowStart[i + 1];
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_nodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -277,12 +411,12 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel)
+void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, vector<WeightList>& weightsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    weightsOut.resize(numNodes);
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
@@ -291,32 +425,32 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
+            myGeoHelp->getNodesToGeoDist(i, myGeoDist, weightsOut[i].m_nodes, distances, true);
             if (distances.size() < 7)
             {
-                m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
-                m_weightLists[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                weightsOut[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
+                weightsOut[i].m_nodes.push_back(i);
+                myGeoHelp->getGeoToTheseNodes(i, weightsOut[i].m_nodes, distances, true);
             }
             int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
-            m_weightLists[i].m_weightSum = 0.0f;
+            weightsOut[i].m_weights.resize(numNeigh);
+            weightsOut[i].m_weightSum = 0.0f;
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
-                m_weightLists[i].m_weightSum += weight;
+                weightsOut[i].m_weights[j] = weight;
+                weightsOut[i].m_weightSum += weight;
             }
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi)
+void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, vector<WeightList>& weightsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    weightsOut.resize(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
 #pragma omp CARET_PAR
     {
@@ -337,17 +471,17 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
                     myGeoHelp->getGeoToTheseNodes(i, nodes, distances, true);
                 }
                 int32_t numNeigh = (int32_t)distances.size();
-                m_weightLists[i].m_weights.reserve(numNeigh);
-                m_weightLists[i].m_nodes.reserve(numNeigh);
-                m_weightLists[i].m_weightSum = 0.0f;
+                weightsOut[i].m_weights.reserve(numNeigh);
+                weightsOut[i].m_nodes.reserve(numNeigh);
+                weightsOut[i].m_weightSum = 0.0f;
                 for (int32_t j = 0; j < numNeigh; ++j)
                 {
                     if (myRoiColumn[nodes[j]] > 0.0f)
                     {
                         float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                        m_weightLists[i].m_weights.push_back(weight);
-                        m_weightLists[i].m_nodes.push_back(nodes[j]);
-                        m_weightLists[i].m_weightSum += weight;
+                        weightsOut[i].m_weights.push_back(weight);
+                        weightsOut[i].m_nodes.push_back(nodes[j]);
+                        weightsOut[i].m_weightSum += weight;
                     }
                 }
             }
@@ -355,7 +489,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, vector<WeightList>& weightsOut)
 {//this method is normalized in two ways to provide evenly diffusing smoothing with equivalent sum of areas * values as input
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -396,13 +530,13 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
             tempList[i].m_weightSum = nodeAreas[i];
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
+        weightsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -411,14 +545,14 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightsOut[node].m_nodes.push_back(i);
+            weightsOut[node].m_weights.push_back(weight);
+            weightsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, vector<WeightList>& weightsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -468,13 +602,13 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
+        weightsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -483,14 +617,14 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightsOut[node].m_nodes.push_back(i);
+            weightsOut[node].m_weights.push_back(weight);
+            weightsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel)
+void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, vector<WeightList>& weightsOut)
 {//this method is normalized in two ways to provide evenly diffusing smoothing with equivalent sum of values as input - this special purpose smoothing is for things that should not be integrated across the surface
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -530,13 +664,13 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
             tempList[i].m_weightSum = 1.0f;
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
+        weightsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -545,14 +679,14 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightsOut[node].m_nodes.push_back(i);
+            weightsOut[node].m_weights.push_back(weight);
+            weightsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi)
+void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, vector<WeightList>& weightsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -601,13 +735,13 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
+        weightsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -616,9 +750,9 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightsOut[node].m_nodes.push_back(i);
+            weightsOut[node].m_weights.push_back(weight);
+            weightsOut[node].m_weightSum += weight;
         }
     }
 }
@@ -639,18 +773,19 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         default:
             break;
     }
+    vector<WeightList> weightLists;
     if (theRoi != NULL)
     {
         switch (myMethod)
         {
             case GEO_GAUSS_AREA:
-                precomputeWeightsROIGeoGaussArea(mySurf, myKernel, theRoi, passAreas);
+                precomputeWeightsROIGeoGaussArea(mySurf, myKernel, theRoi, passAreas, weightLists);
                 break;
             case GEO_GAUSS_EQUAL:
-                precomputeWeightsROIGeoGaussEqual(mySurf, myKernel, theRoi);
+                precomputeWeightsROIGeoGaussEqual(mySurf, myKernel, theRoi, weightLists);
                 break;
             case GEO_GAUSS:
-                precomputeWeightsROIGeoGauss(mySurf, myKernel, theRoi);
+                precomputeWeightsROIGeoGauss(mySurf, myKernel, theRoi, weightLists);
                 break;
             default:
                 throw CaretException("unknown smoothing method specified");
@@ -659,16 +794,105 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         switch (myMethod)
         {
             case GEO_GAUSS_AREA:
-                precomputeWeightsGeoGaussArea(mySurf, myKernel, passAreas);
+                precomputeWeightsGeoGaussArea(mySurf, myKernel, passAreas, weightLists);
                 break;
             case GEO_GAUSS_EQUAL:
-                precomputeWeightsGeoGaussEqual(mySurf, myKernel);
+                precomputeWeightsGeoGaussEqual(mySurf, myKernel, weightLists);
                 break;
             case GEO_GAUSS:
-                precomputeWeightsGeoGauss(mySurf, myKernel);
+                precomputeWeightsGeoGauss(mySurf, myKernel, weightLists);
                 break;
             default:
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    buildCSR(weightLists);
+}
+
+void MetricSmoothingObject::buildCSR(vector<WeightList>& weightLists)
+{
+    int32_t numNodes = (int32_t)weightLists.size();
+    m_rowStart.resize(numNodes + 1);
+    m_rowStart[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        CaretAssert(weightLists[i].m_nodes.size() == weightLists[i].m_weights.size());
+        m_rowStart[i + 1] = m_rowStart[i] + (int64_t)weightLists[i].m_nodes.size();
+    }
+    m_nodes.resize(m_rowStart[numNodes]);
+    m_weights.resize(m_rowStart[numNodes]);
+    m_weightSums.resize(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if (!weightLists[i].m_nodes.empty())
+        {
+            memcpy(m_nodes.data() + m_rowStart[i], weightLists[i].m_nodes.data(), weightLists[i].m_nodes.size() * sizeof(int32_t));
+            memcpy(m_weights.data() + m_rowStart[i], weightLists[i].m_weights.data(), weightLists[i].m_weights.size() * sizeof(float));
+        }
+        m_weightSums[i] = weightLists[i].m_weightSum;
+        vector<int32_t>().swap(weightLists[i].m_nodes);//free as we go, to keep peak memory down
+        vector<float>().swap(weightLists[i].m_weights);
+    }
+}
+
+AString MetricSmoothingObject::getCacheFileName(const SurfaceFile* mySurf, const float& kernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas) const
+{//the surface is hashed by SurfaceHelperCache, everything else that changes the weights goes in the extra data
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    int32_t methodInt = (int32_t)myMethod;
+    QByteArray extra;
+    extra.append((const char*)&kernel, sizeof(kernel));
+    extra.append((const char*)&methodInt, sizeof(methodInt));
+    extra.append((char)(theRoi != NULL));
+    extra.append((char)(nodeAreas != NULL));
+    if (theRoi != NULL)
+    {
+        extra.append((const char*)theRoi->getValuePointerForColumn(0), numNodes * sizeof(float));
+    }
+    if (nodeAreas != NULL)
+    {
+        extra.append((const char*)nodeAreas, numNodes * sizeof(float));
+    }
+    return SurfaceHelperCache::getCacheFileName(s_cacheDirectory, mySurf, CACHE_KIND, CACHE_KIND_VERSION, extra.constData(), extra.size());
+}
+
+bool MetricSmoothingObject::loadCache(const AString& filename)
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openRead(filename)) return false;
+    bool ok = myCache.readVector(m_rowStart) && myCache.readVector(m_nodes) && myCache.readVector(m_weights) && myCache.readVector(m_weightSums) && myCache.finish();
+    if (ok)
+    {
+        int64_t numNodes = (int64_t)m_weightSums.size(), numWeights = (int64_t)m_nodes.size();
+        ok = ((int64_t)m_rowStart.size() == numNodes + 1 && (int64_t)m_weights.size() == numWeights &&
+              m_rowStart[0] == 0 && m_rowStart[numNodes] == numWeights);
+        for (int64_t i = 0; ok && i < numNodes; ++i)
+        {
+            if (m_rowStart[i + 1] < m_rowStart[i]) ok = false;
+        }
+        for (int64_t i = 0; ok && i < numWeights; ++i)
+        {
+            if (m_nodes[i] < 0 || m_nodes[i] >= numNodes) ok = false;
+        }
+        if (!ok) CaretLogInfo("ignoring invalid smoothing cache file '" + filename + "'");
+    }
+    if (!ok)
+    {
+        m_rowStart.clear();
+        m_nodes.clear();
+        m_weights.clear();
+        m_weightSums.clear();
+        return false;
+    }
+    return true;
+}
+
+void MetricSmoothingObject::saveCache(const AString& filename) const
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openWrite(filename)) return;
+    myCache.writeVector(m_rowStart);
+    myCache.writeVector(m_nodes);
+    myCache.writeVector(m_weights);
+    myCache.writeVector(m_weightSums);
+    myCache.finish();
 }
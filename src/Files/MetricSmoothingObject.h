@@ -30,6 +30,8 @@
 //NOTE: for a static ROI, it is (sometimes much) more efficient to use it in the constructor, and provide no ROI (NULL) to the functions, using both an ROI in constructor and in method
 //      will result in the effective ROI being the logical AND of the two (intersection).
 
+#include "AString.h"
+
 #include "stdint.h"
 #include "stddef.h"
 #include <vector>
@@ -52,6 +54,12 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///smooth many columns in one pass over the weights, roiColumn is used for all columns
+        void smoothColumns(const std::vector<const float*>& columnsIn, const std::vector<float*>& columnsOut, const float* roiColumn = NULL, const bool& fixZeros = false) const;
+        
+        ///directory to save computed weights to and load them from, keyed on a hash of everything that affects them, empty (the default) disables it
+        static void setCacheDirectory(const AString& directory) { s_cacheDirectory = directory; }
+        static AString getCacheDirectory() { return s_cacheDirectory; }
     private:
         struct WeightList
         {
@@ -59,16 +67,26 @@ namespace caret {
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        //gathering kernels as a CSR sparse matrix, row i is the kernel of node i
+        std::vector<int64_t> m_rowStart;//numNodes + 1 elements
+        std::vector<int32_t> m_nodes;
+        std::vector<float> m_weights;
+        std::vector<float> m_weightSums;
+        static AString s_cacheDirectory;
+        int32_t getNumberOfNodes() const { return (int32_t)m_weightSums.size(); }
+        void buildCSR(std::vector<WeightList>& weightLists);
+        AString getCacheFileName(const SurfaceFile* mySurf, const float& kernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas) const;
+        bool loadCache(const AString& filename);
+        void saveCache(const AString& filename) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
-        void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel);
-        void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
-        void precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
-        void precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
-        void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel);
-        void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
+        void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, std::vector<WeightList>& weightsOut);
+        void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, std::vector<WeightList>& weightsOut);
+        void precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, std::vector<WeightList>& weightsOut);
+        void precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, std::vector<WeightList>& weightsOut);
+        void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, std::vector<WeightList>& weightsOut);
+        void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, std::vector<WeightList>& weightsOut);
         MetricSmoothingObject();
     };
     
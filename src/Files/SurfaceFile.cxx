@@ -37,11 +37,13 @@
 
 #include "GiftiFile.h"
 #include "GiftiMetaDataXmlElements.h"
+#include "GraphicsOpenGLSurfaceBuffers.h"
 #include "MathFunctions.h"
 #include "Matrix4x4.h"
 #include "Vector3D.h"
 
 #include "CaretPointLocator.h"
+#include "CaretTriangleLocator.h"
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
@@ -565,6 +567,34 @@ void
 SurfaceFile::invalidateNormals()
 {
     m_normalsComputed = false;
+    invalidateOpenGLSurfaceGeometry();
+}
+
+/**
+ * Get the OpenGL buffers for drawing this surface, creating them if needed.
+ * The buffers are reloaded after the coordinates, normals, topology, or
+ * node coloring of the surface change.
+ *
+ * @return The OpenGL buffers.
+ */
+GraphicsOpenGLSurfaceBuffers*
+SurfaceFile::getOpenGLSurfaceBuffers() const
+{
+    if (m_openGLSurfaceBuffers == NULL) {
+        m_openGLSurfaceBuffers.reset(new GraphicsOpenGLSurfaceBuffers());
+    }
+    return m_openGLSurfaceBuffers.get();
+}
+
+/**
+ * Invalidate the geometry in the OpenGL buffers, if they exist.
+ */
+void
+SurfaceFile::invalidateOpenGLSurfaceGeometry()
+{
+    if (m_openGLSurfaceBuffers != NULL) {
+        m_openGLSurfaceBuffers->invalidateGeometry();
+    }
 }
 /**
  * Compute surface normals.
@@ -577,6 +607,7 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    invalidateOpenGLSurfaceGeometry();
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -858,6 +889,7 @@ CaretPointer<SignedDistanceHelper> SurfaceFile::getSignedDistanceHelper() const
 
 void SurfaceFile::invalidateHelpers()
 {
+    invalidateOpenGLSurfaceGeometry();
     if (m_geoBase != NULL)
     {
         CaretMutexLocker myLock(&m_geoHelperMutex);//make this function threadsafe
@@ -884,6 +916,11 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_triangleLocator != NULL)
+    {
+        CaretMutexLocker myLock5(&m_triangleLocatorMutex);
+        m_triangleLocator.grabNew(NULL);
+    }
 }
 
 /**
@@ -1161,6 +1198,7 @@ SurfaceFile::setModified()
         delete this->boundingBox;
         this->boundingBox = NULL;
     }
+    invalidateOpenGLSurfaceGeometry();
     
     GiftiTypeFile::setModified();
 }
@@ -1188,6 +1226,19 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const CaretTriangleLocator> SurfaceFile::getTriangleLocator() const
+{//see getPointLocator
+    if (m_triangleLocator == NULL)
+    {
+        CaretMutexLocker myLock(&m_triangleLocatorMutex);
+        if (m_triangleLocator == NULL)
+        {
+            m_triangleLocator.grabNew(new CaretTriangleLocator(getCoordinateData(), getNumberOfNodes(), trianglePointer, getNumberOfTriangles()));
+        }
+    }
+    return m_triangleLocator;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1212,6 +1263,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_triangleLocatorMutex);
+        m_triangleLocator.grabNew(NULL);
+    }
 }
 
 /**
@@ -1351,6 +1406,10 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->surfaceMontageNodeColoringForBrowserTabs[i].clear();
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
     }    
+    
+    if (m_openGLSurfaceBuffers != NULL) {
+        m_openGLSurfaceBuffers->invalidateColors();
+    }
 }
 
 /**
@@ -1479,6 +1538,10 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    
+    if (m_openGLSurfaceBuffers != NULL) {
+        m_openGLSurfaceBuffers->invalidateColors();
+    }
 }
 
 /**
@@ -1526,6 +1589,10 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    
+    if (m_openGLSurfaceBuffers != NULL) {
+        m_openGLSurfaceBuffers->invalidateColors();
+    }
 }
 
 
@@ -1573,6 +1640,10 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    
+    if (m_openGLSurfaceBuffers != NULL) {
+        m_openGLSurfaceBuffers->invalidateColors();
+    }
 }
 
 /**
@@ -22,6 +22,7 @@
  */
 /*LICENSE_END*/
 
+#include <memory>
 #include <vector>
 #include <stdint.h>
 
@@ -37,11 +38,13 @@ namespace caret {
 
     class BoundingBox;
     class CaretPointLocator;
+    class CaretTriangleLocator;
     class DescriptiveStatistics;
     class FastStatistics;
     class GeodesicHelper;
     class GeodesicHelperBase;
     class GiftiDataArray;
+    class GraphicsOpenGLSurfaceBuffers;
     class Matrix4x4;
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
@@ -138,6 +141,8 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        CaretPointer<const CaretTriangleLocator> getTriangleLocator() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -176,6 +181,8 @@ namespace caret {
 
         void invalidateNormals();
         
+        GraphicsOpenGLSurfaceBuffers* getOpenGLSurfaceBuffers() const;
+        
         void translateToCenterOfMass();
         
         void flipNormals();
@@ -292,12 +299,20 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to find the triangles hit by a ray or closest to a point
+        mutable CaretPointer<CaretTriangleLocator> m_triangleLocator;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
+        ///OpenGL buffers for drawing, created when first drawn, never copied
+        mutable std::unique_ptr<GraphicsOpenGLSurfaceBuffers> m_openGLSurfaceBuffers;
+        
+        void invalidateOpenGLSurfaceGeometry();
+        
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_triangleLocatorMutex;
     };
 
 } // namespace
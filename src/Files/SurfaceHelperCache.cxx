@@ -0,0 +1,170 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceHelperCache.h"
+
+#include "CaretLogger.h"
+#include "SurfaceFile.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+
+#include <cstring>
+
+using namespace std;
+using namespace caret;
+
+AString SurfaceHelperCache::s_cacheDirectory;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'S', 'U', 'R', 'F', 'H', 'C' };
+    const int32_t CACHE_VERSION = 2;
+    const int32_t CACHE_BYTE_ORDER = 0x01020304;//written natively, a cache from a machine with different byte order just gets ignored
+}
+
+AString SurfaceHelperCache::getCacheFileName(const SurfaceFile* mySurf, const AString& kind, const int32_t& kindVersion, const void* extraData, const int64_t& extraBytes)
+{
+    return getCacheFileName(s_cacheDirectory, mySurf, kind, kindVersion, extraData, extraBytes);
+}
+
+AString SurfaceHelperCache::getCacheFileName(const AString& directory, const SurfaceFile* mySurf, const AString& kind, const int32_t& kindVersion,
+                                             const void* extraData, const int64_t& extraBytes)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t numNodes = mySurf->getNumberOfNodes(), numTris = mySurf->getNumberOfTriangles();
+    myHash.addData((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+    myHash.addData(kind.toUtf8());
+    myHash.addData((const char*)&kindVersion, sizeof(kindVersion));
+    myHash.addData((const char*)&numNodes, sizeof(numNodes));
+    myHash.addData((const char*)&numTris, sizeof(numTris));
+    myHash.addData((const char*)mySurf->getCoordinateData(), numNodes * 3 * sizeof(float));
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        myHash.addData((const char*)mySurf->getTriangle(i), 3 * sizeof(int32_t));
+    }
+    if (extraData != NULL && extraBytes > 0)
+    {
+        myHash.addData((const char*)extraData, extraBytes);
+    }
+    return QDir(directory).filePath(AString(myHash.result().toHex()) + "." + kind);
+}
+
+SurfaceHelperCache::~SurfaceHelperCache()
+{
+    if (m_file.isOpen())
+    {
+        m_file.close();
+        if (m_writing) QFile::remove(m_tempName);//didn't finish, don't leave junk around
+    }
+}
+
+bool SurfaceHelperCache::readBytes(void* dataOut, const int64_t& bytes)
+{
+    if (!m_ok) return false;
+    if (m_file.read((char*)dataOut, bytes) != bytes) m_ok = false;
+    return m_ok;
+}
+
+void SurfaceHelperCache::writeBytes(const void* dataIn, const int64_t& bytes)
+{
+    if (!m_ok) return;
+    if (m_file.write((const char*)dataIn, bytes) != bytes) m_ok = false;
+}
+
+bool SurfaceHelperCache::openRead(const AString& fileName)
+{
+    m_writing = false;
+    m_ok = false;
+    m_fileName = fileName;
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+    m_ok = true;
+    char magic[8];
+    int32_t version = 0, byteOrder = 0;
+    vector<char> storedName;
+    QByteArray expectedName = QFileInfo(fileName).fileName().toUtf8();
+    if (!readBytes(magic, 8) || memcmp(magic, CACHE_MAGIC, 8) != 0 ||
+        !readValue(version) || version != CACHE_VERSION ||
+        !readValue(byteOrder) || byteOrder != CACHE_BYTE_ORDER ||
+        !readVector(storedName) || QByteArray(storedName.data(), (int)storedName.size()) != expectedName)//copied or renamed from another hash
+    {
+        CaretLogInfo("ignoring invalid surface helper cache file '" + fileName + "'");
+        m_file.close();
+        m_ok = false;
+        return false;
+    }
+    return true;
+}
+
+bool SurfaceHelperCache::openWrite(const AString& fileName)
+{
+    m_writing = true;
+    m_ok = false;
+    m_fileName = fileName;
+    QFileInfo fileInfo(fileName);
+    QDir().mkpath(fileInfo.absolutePath());
+    //pid and thread make the name unique when several threads or processes build the same helper at once
+    m_tempName = fileName + "." + AString::number(QCoreApplication::applicationPid()) + "." +
+                 QString::number((quintptr)QThread::currentThreadId(), 16) + ".tmp";
+    m_file.setFileName(m_tempName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        CaretLogWarning("unable to write surface helper cache file '" + m_tempName + "'");
+        return false;
+    }
+    m_ok = true;
+    writeBytes(CACHE_MAGIC, 8);
+    writeValue(CACHE_VERSION);
+    writeValue(CACHE_BYTE_ORDER);
+    QByteArray nameBytes = fileInfo.fileName().toUtf8();
+    writeVector(vector<char>(nameBytes.constData(), nameBytes.constData() + nameBytes.size()));
+    return m_ok;
+}
+
+bool SurfaceHelperCache::finish()
+{
+    if (!m_file.isOpen()) return false;
+    if (m_writing)
+    {
+        m_file.close();
+        if (!m_ok || m_file.error() != QFile::NoError)
+        {
+            CaretLogWarning("unable to write surface helper cache file '" + m_tempName + "'");
+            QFile::remove(m_tempName);
+            return false;
+        }
+        if (!QFile::rename(m_tempName, m_fileName))//fails if another process already wrote it, which is fine
+        {
+            QFile::remove(m_tempName);
+        }
+        return true;
+    }
+    bool ret = m_ok && m_file.pos() == m_file.size();
+    m_file.close();
+    if (!ret)
+    {
+        CaretLogInfo("ignoring invalid surface helper cache file '" + m_fileName + "'");
+    }
+    return ret;
+}
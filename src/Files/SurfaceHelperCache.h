@@ -0,0 +1,159 @@
+#ifndef __SURFACE_HELPER_CACHE_H__
+#define __SURFACE_HELPER_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//NOTE: this is for saving the derived structures of surface helpers (topology, geodesic) between runs, so that repeated commands on the same surface
+//      don't rebuild them.  Files are named by a hash of the surface content and anything else that affects the structures, so they never need invalidating.
+//      Files are written to a temporary name and renamed, so concurrent processes never see a partial file.  Anything wrong with a file just means it is ignored.
+//      The file name is also stored inside the file, so a file that was copied or renamed to another hash is rejected instead of trusted.
+//      Other cached derived data that depends on a surface (for instance, smoothing weights) should use this class too, with its own kind and directory.
+
+#include "AString.h"
+
+#include <QFile>
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    class SurfaceFile;
+
+    class SurfaceHelperCache
+    {
+        static AString s_cacheDirectory;
+        QFile m_file;
+        AString m_fileName, m_tempName;
+        bool m_writing, m_ok;
+        bool readBytes(void* dataOut, const int64_t& bytes);
+        void writeBytes(const void* dataIn, const int64_t& bytes);
+        SurfaceHelperCache(const SurfaceHelperCache&);
+        SurfaceHelperCache& operator=(const SurfaceHelperCache&);
+    public:
+        ///directory to save helper structures to and load them from, empty (the default) disables it
+        static void setCacheDirectory(const AString& directory) { s_cacheDirectory = directory; }
+        static AString getCacheDirectory() { return s_cacheDirectory; }
+        static bool isEnabled() { return !s_cacheDirectory.isEmpty(); }
+
+        ///name of the cache file for this surface and kind of helper, extraData is anything else that changes the result (may be NULL)
+        static AString getCacheFileName(const SurfaceFile* mySurf, const AString& kind, const int32_t& kindVersion, const void* extraData = NULL, const int64_t& extraBytes = 0);
+        ///same, in a directory other than the helper cache directory
+        static AString getCacheFileName(const AString& directory, const SurfaceFile* mySurf, const AString& kind, const int32_t& kindVersion,
+                                        const void* extraData = NULL, const int64_t& extraBytes = 0);
+
+        SurfaceHelperCache() : m_writing(false), m_ok(false) { }
+        ~SurfaceHelperCache();
+
+        ///returns false if the file doesn't exist or has the wrong header
+        bool openRead(const AString& fileName);
+        ///returns false if the file can't be created
+        bool openWrite(const AString& fileName);
+        ///for reading, whether everything read so far was valid, for writing, whether everything written so far succeeded
+        bool isOk() const { return m_ok; }
+        ///for reading, true if all data was read and nothing is left over, for writing, renames the finished file into place
+        bool finish();
+
+        template <typename T>
+        void writeValue(const T& value) { writeBytes(&value, sizeof(T)); }
+        template <typename T>
+        bool readValue(T& value) { return readBytes(&value, sizeof(T)); }
+
+        template <typename T>
+        void writeVector(const std::vector<T>& data)
+        {//only for plain data types
+            int64_t count = (int64_t)data.size();
+            writeValue(count);
+            int32_t elemSize = sizeof(T);
+            writeValue(elemSize);
+            if (count > 0) writeBytes(data.data(), count * sizeof(T));
+        }
+
+        template <typename T>
+        bool readVector(std::vector<T>& data)
+        {
+            int64_t count = -1;
+            int32_t elemSize = -1;
+            if (!readValue(count) || !readValue(elemSize) || count < 0 || elemSize != (int32_t)sizeof(T) || count * (int64_t)sizeof(T) > m_file.size() - m_file.pos())
+            {
+                m_ok = false;
+                return false;
+            }
+            data.resize(count);
+            if (count > 0) return readBytes(data.data(), count * sizeof(T));
+            return true;
+        }
+
+        template <typename T>
+        void writeNested(const std::vector<std::vector<T> >& data)
+        {//store as lengths and one flat array, so reading doesn't do a read call per element
+            std::vector<int32_t> lengths(data.size());
+            int64_t total = 0;
+            for (int64_t i = 0; i < (int64_t)data.size(); ++i)
+            {
+                lengths[i] = (int32_t)data[i].size();
+                total += lengths[i];
+            }
+            std::vector<T> flat;
+            flat.reserve(total);
+            for (int64_t i = 0; i < (int64_t)data.size(); ++i)
+            {
+                flat.insert(flat.end(), data[i].begin(), data[i].end());
+            }
+            writeVector(lengths);
+            writeVector(flat);
+        }
+
+        template <typename T>
+        bool readNested(std::vector<std::vector<T> >& data)
+        {
+            std::vector<int32_t> lengths;
+            std::vector<T> flat;
+            if (!readVector(lengths) || !readVector(flat)) return false;
+            int64_t total = 0;
+            for (int64_t i = 0; i < (int64_t)lengths.size(); ++i)
+            {
+                if (lengths[i] < 0)
+                {
+                    m_ok = false;
+                    return false;
+                }
+                total += lengths[i];
+            }
+            if (total != (int64_t)flat.size())
+            {
+                m_ok = false;
+                return false;
+            }
+            data.resize(lengths.size());
+            typename std::vector<T>::const_iterator iter = flat.begin();
+            for (int64_t i = 0; i < (int64_t)lengths.size(); ++i)
+            {
+                data[i].assign(iter, iter + lengths[i]);
+                iter += lengths[i];
+            }
+            return true;
+        }
+    };
+
+}
+
+#endif //__SURFACE_HELPER_CACHE_H__
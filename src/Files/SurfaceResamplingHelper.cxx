@@ -204,6 +204,44 @@ void SurfaceResamplingHelper::getResampleValidROI(float* output) const
     }
 }
 
+void SurfaceResamplingHelper::getSparseWeights(vector<int64_t>& rowStartOut, vector<int>& nodeOut, vector<float>& weightOut, const bool& largestOnly) const
+{
+    int numNodes = (int)m_weights.size() - 1;
+    rowStartOut.resize(numNodes + 1);
+    nodeOut.clear();
+    weightOut.clear();
+    rowStartOut[0] = 0;
+    for (int i = 0; i < numNodes; ++i)
+    {
+        WeightElem* end = m_weights[i + 1];
+        if (largestOnly)
+        {
+            float largest = -1.0f;
+            int largestNode = -1;
+            for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+            {
+                if (elem->weight > largest)
+                {
+                    largest = elem->weight;
+                    largestNode = elem->node;
+                }
+            }
+            if (largestNode != -1)
+            {
+                nodeOut.push_back(largestNode);
+                weightOut.push_back(1.0f);
+            }
+        } else {
+            for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+            {
+                nodeOut.push_back(elem->node);
+                weightOut.push_back(elem->weight);
+            }
+        }
+        rowStartOut[i + 1] = (int64_t)nodeOut.size();
+    }
+}
+
 void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* currentSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut)
 {
     if (cutSurfaceIn->getNumberOfNodes() != currentSphere->getNumberOfNodes()) throw CaretException("input surface has different number of nodes than input sphere");
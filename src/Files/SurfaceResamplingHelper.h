@@ -64,6 +64,8 @@ namespace caret {
         void resampleLargest(const int32_t* input, int32_t* output, const int32_t& invalidVal = 0) const;
         ///get the ROI of nodes that have data within the input ROI
         void getResampleValidROI(float* output) const;
+        ///get the weights as a sparse matrix in compressed row form, one row per new node, entries index current nodes - largestOnly keeps only the entry resampleLargest would use, with weight 1
+        void getSparseWeights(std::vector<int64_t>& rowStartOut, std::vector<int>& nodeOut, std::vector<float>& weightOut, const bool& largestOnly = false) const;
         
         ///resample a cut surface - not something you will apply multiple times, so static method
         static void resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut);
@@ -21,12 +21,115 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "CaretAssert.h"
+#include "SurfaceHelperCache.h"
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int32_t TOPOLOGY_CACHE_VERSION = 1;//change this if the stored members or how they are computed changes
+}
+
 TopologyHelperBase::TopologyHelperBase(const SurfaceFile* surfIn, bool sortFlag)
+{
+    AString cacheFileName;
+    if (SurfaceHelperCache::isEnabled())
+    {
+        char sortChar = (sortFlag ? 1 : 0);
+        cacheFileName = SurfaceHelperCache::getCacheFileName(surfIn, "wbtopology", TOPOLOGY_CACHE_VERSION, &sortChar, 1);
+        if (loadCache(cacheFileName, surfIn, sortFlag)) return;
+    }
+    computeFromSurface(surfIn, sortFlag);
+    if (!cacheFileName.isEmpty())
+    {
+        saveCache(cacheFileName);
+    }
+}
+
+bool TopologyHelperBase::loadCache(const AString& fileName, const SurfaceFile* surfIn, const bool& sortFlag)
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openRead(fileName)) return false;
+    int32_t numNodes = -1, numTris = -1;
+    char sortChar = 0;
+    vector<vector<int32_t> > neighbors, edges, tiles, whichVertex;
+    bool ok = myCache.readValue(numNodes) && numNodes == surfIn->getNumberOfNodes() &&
+              myCache.readValue(numTris) && numTris == surfIn->getNumberOfTriangles() &&
+              myCache.readValue(sortChar) && (sortChar != 0) == sortFlag &&
+              myCache.readValue(m_maxNeigh) && myCache.readValue(m_maxTiles) &&
+              myCache.readNested(neighbors) && myCache.readNested(edges) && myCache.readNested(tiles) && myCache.readNested(whichVertex) &&
+              myCache.readVector(m_edgeInfo) && myCache.readVector(m_tileInfo) && myCache.readVector(m_boundaryCount) &&
+              myCache.finish();
+    if (ok)
+    {
+        int32_t numEdges = (int32_t)m_edgeInfo.size();
+        ok = ((int32_t)neighbors.size() == numNodes && (int32_t)edges.size() == numNodes && (int32_t)tiles.size() == numNodes &&
+              (int32_t)whichVertex.size() == numNodes && (int32_t)m_tileInfo.size() == numTris && (int32_t)m_boundaryCount.size() == numNodes);
+        for (int32_t i = 0; ok && i < numNodes; ++i)
+        {
+            ok = (neighbors[i].size() == edges[i].size() && tiles[i].size() == whichVertex[i].size());
+            for (int32_t j = 0; ok && j < (int32_t)neighbors[i].size(); ++j)
+            {
+                if (neighbors[i][j] < 0 || neighbors[i][j] >= numNodes || edges[i][j] < 0 || edges[i][j] >= numEdges) ok = false;
+            }
+            for (int32_t j = 0; ok && j < (int32_t)tiles[i].size(); ++j)
+            {
+                if (tiles[i][j] < 0 || tiles[i][j] >= numTris || whichVertex[i][j] < 0 || whichVertex[i][j] > 2) ok = false;
+            }
+        }
+    }
+    if (!ok)
+    {
+        m_edgeInfo.clear();
+        m_tileInfo.clear();
+        m_boundaryCount.clear();
+        return false;
+    }
+    m_numNodes = numNodes;
+    m_numTris = numTris;
+    m_neighborsSorted = sortFlag;
+    m_nodeInfo.resize(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_nodeInfo[i].m_neighbors.swap(neighbors[i]);
+        m_nodeInfo[i].m_edges.swap(edges[i]);
+        m_nodeInfo[i].m_tiles.swap(tiles[i]);
+        m_nodeInfo[i].m_whichVertex.swap(whichVertex[i]);
+    }
+    return true;
+}
+
+void TopologyHelperBase::saveCache(const AString& fileName) const
+{
+    SurfaceHelperCache myCache;
+    if (!myCache.openWrite(fileName)) return;
+    vector<vector<int32_t> > neighbors(m_numNodes), edges(m_numNodes), tiles(m_numNodes), whichVertex(m_numNodes);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        neighbors[i] = m_nodeInfo[i].m_neighbors;
+        edges[i] = m_nodeInfo[i].m_edges;
+        tiles[i] = m_nodeInfo[i].m_tiles;
+        whichVertex[i] = m_nodeInfo[i].m_whichVertex;
+    }
+    char sortChar = (m_neighborsSorted ? 1 : 0);
+    myCache.writeValue(m_numNodes);
+    myCache.writeValue(m_numTris);
+    myCache.writeValue(sortChar);
+    myCache.writeValue(m_maxNeigh);
+    myCache.writeValue(m_maxTiles);
+    myCache.writeNested(neighbors);
+    myCache.writeNested(edges);
+    myCache.writeNested(tiles);
+    myCache.writeNested(whichVertex);
+    myCache.writeVector(m_edgeInfo);
+    myCache.writeVector(m_tileInfo);
+    myCache.writeVector(m_boundaryCount);
+    myCache.finish();
+}
+
+void TopologyHelperBase::computeFromSurface(const SurfaceFile* surfIn, bool sortFlag)
 {
     m_numNodes = surfIn->getNumberOfNodes();
     m_numTris = surfIn->getNumberOfTriangles();
@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <vector>
+#include "AString.h"
 #include "CaretPointer.h"
 
 namespace caret {
@@ -84,6 +85,9 @@ namespace caret {
         TopologyHelperBase& operator=(const TopologyHelperBase&);
         void processTileNeighbor(std::vector<TopologyEdgeInfo>& tempEdgeInfo, CaretArray<int32_t>& scratch, const int32_t& root, const int32_t& neighbor, const int32_t& thirdNode, const int32_t& tile, const int32_t& tileEdge, const bool& reversed);
         void sortNeighbors(const SurfaceFile* mySurf, const int32_t& node, CaretArray<int32_t>& nodeScratch, CaretArray<int32_t>& tileScratch);
+        void computeFromSurface(const SurfaceFile* surfIn, bool sortFlag);
+        bool loadCache(const AString& fileName, const SurfaceFile* surfIn, const bool& sortFlag);
+        void saveCache(const AString& fileName) const;
         struct NodeInfo
         {
             std::vector<int32_t> m_neighbors;
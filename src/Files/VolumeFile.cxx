@@ -33,6 +33,7 @@
 #include "ElapsedTimer.h"
 #include "EventManager.h"
 #include "EventPaletteGetByName.h"
+#include "GraphicsOpenGLVolumeTextures.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "FastStatistics.h"
 #include "Histogram.h"
@@ -177,6 +178,7 @@ VolumeFile::clear()
 {
     CaretMappableDataFile::clear();
     m_voxelColorizer.grabNew(NULL);
+    m_openGLVolumeTextures.grabNew(NULL);
     m_classNameHierarchy.grabNew(NULL);
     m_forceUpdateOfGroupAndNameHierarchy = true;
     m_fileFastStatistics.grabNew(NULL);
@@ -694,6 +696,9 @@ void VolumeFile::validateMembers()
     if (s_voxelColoringEnabled) {
         m_voxelColorizer.grabNew(new VolumeFileVoxelColorizer(this));
     }
+    if (m_openGLVolumeTextures != NULL) {
+        m_openGLVolumeTextures->invalidateData();
+    }
     if (m_classNameHierarchy == NULL) {
         m_classNameHierarchy.grabNew(new GroupAndNameHierarchyModel());
     }
@@ -717,6 +722,9 @@ VolumeFile::setModified()
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    if (m_openGLVolumeTextures != NULL) {
+        m_openGLVolumeTextures->invalidateData();
+    }
 }
 
 /**
@@ -1456,6 +1464,9 @@ VolumeFile::updateScalarColoringForMap(const int32_t mapIndex,
                                               palette,
                                               this,
                                               mapIndex);
+    if (m_openGLVolumeTextures != NULL) {
+        m_openGLVolumeTextures->invalidateLookupTable(mapIndex);
+    }
     
     invalidateHistogramChartColoring();
 }
@@ -1754,6 +1765,83 @@ VolumeFile::clearVoxelColoringForMap(const int64_t mapIndex)
     }
 }
 
+/**
+ * Get the coding of a map's scalars for coloring the map's voxels
+ * with a palette lookup table while drawing.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @param numberOfEntries
+ *     Number of entries in the lookup table.
+ * @param scalarCodingOut
+ *     Output containing the coding.
+ * @return
+ *     True if the coding is valid, false if coloring is not
+ *     enabled or the map is not colored with a palette.
+ */
+bool
+VolumeFile::getPaletteScalarCodingForMap(const int32_t mapIndex,
+                                         const int32_t numberOfEntries,
+                                         GraphicsVolumeScalarCoding& scalarCodingOut) const
+{
+    if (s_voxelColoringEnabled == false) {
+        return false;
+    }
+    
+    CaretAssert(m_voxelColorizer);
+    
+    return m_voxelColorizer->getPaletteScalarCodingForMap(mapIndex,
+                                                          numberOfEntries,
+                                                          scalarCodingOut);
+}
+
+/**
+ * Get a lookup table with the palette coloring for each entry of a
+ * scalar coding so that the map's voxels can be colored while drawing.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @param scalarCoding
+ *     Coding from getPaletteScalarCodingForMap().
+ * @param rgbaOut
+ *     Output containing RGBA for each entry
+ *     (4 * scalarCoding.getNumberOfEntries()).
+ * @return
+ *     True if the lookup table is valid, false if coloring is not
+ *     enabled or the map is not colored with a palette.
+ */
+bool
+VolumeFile::getPaletteLookupTableForMap(const int32_t mapIndex,
+                                        const GraphicsVolumeScalarCoding& scalarCoding,
+                                        uint8_t* rgbaOut) const
+{
+    if (s_voxelColoringEnabled == false) {
+        return false;
+    }
+    
+    CaretAssert(m_voxelColorizer);
+    
+    return m_voxelColorizer->getPaletteLookupTableForMap(mapIndex,
+                                                         scalarCoding,
+                                                         rgbaOut);
+}
+
+/**
+ * Get the OpenGL textures for drawing this volume's slices, creating
+ * them if needed.  The data is reloaded after the voxels change and
+ * the lookup table is reloaded after a map's coloring is updated.
+ *
+ * @return The OpenGL textures.
+ */
+GraphicsOpenGLVolumeTextures*
+VolumeFile::getOpenGLVolumeTextures() const
+{
+    if (m_openGLVolumeTextures == NULL) {
+        m_openGLVolumeTextures.grabNew(new GraphicsOpenGLVolumeTextures());
+    }
+    return m_openGLVolumeTextures;
+}
+
 /**
  * Get the minimum and maximum values from ALL maps in this file.
  * Note that not all files (due to size of file) are able to provide
@@ -37,6 +37,8 @@
 
 namespace caret {
     
+    class GraphicsOpenGLVolumeTextures;
+    class GraphicsVolumeScalarCoding;
     class GroupAndNameHierarchyModel;
     class VolumeFileEditorDelegate;
     class VolumeFileVoxelColorizer;
@@ -97,6 +99,9 @@ namespace caret {
         /** Performs coloring of voxels.  Will be NULL if coloring is disabled. */
         CaretPointer<VolumeFileVoxelColorizer> m_voxelColorizer;
         
+        /** Textures for drawing slices with a palette lookup table, created when first requested */
+        mutable CaretPointer<GraphicsOpenGLVolumeTextures> m_openGLVolumeTextures;
+        
         /** True if the volume is a single slice, needed by interpolateValue() methods */
         bool m_singleSliceFlag;
         
@@ -335,6 +340,16 @@ namespace caret {
         
         void clearVoxelColoringForMap(const int64_t mapIndex);
         
+        bool getPaletteScalarCodingForMap(const int32_t mapIndex,
+                                          const int32_t numberOfEntries,
+                                          GraphicsVolumeScalarCoding& scalarCodingOut) const;
+        
+        bool getPaletteLookupTableForMap(const int32_t mapIndex,
+                                         const GraphicsVolumeScalarCoding& scalarCoding,
+                                         uint8_t* rgbaOut) const;
+        
+        GraphicsOpenGLVolumeTextures* getOpenGLVolumeTextures() const;
+        
         virtual bool getDataRangeFromAllMaps(float& dataRangeMinimumOut,
                                              float& dataRangeMaximumOut) const;
         
@@ -27,10 +27,14 @@
 #include "CaretLogger.h"
 #include "ElapsedTimer.h"
 #include "GiftiLabel.h"
+#include "GraphicsVolumeScalarCoding.h"
 #include "GroupAndNameHierarchyItem.h"
 #include "NodeAndVoxelColoring.h"
+#include "Palette.h"
+#include "PaletteColorMapping.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -40,6 +44,13 @@ using namespace caret;
 /**
  * \class caret::VolumeFileVoxelColorizer 
  * \brief Delegate for coloring a volumes voxels.
+ *
+ * Assigning coloring to a map only records the palette.  The voxels
+ * are colored when the map's colors are first requested so that maps
+ * that are never drawn with voxel colors (such as maps in a 4D volume
+ * that are not viewed or maps drawn with a palette lookup table) do
+ * not use memory for RGBA.  Only the most recently colored maps keep
+ * their RGBA.
  */
 
 /**
@@ -65,10 +76,11 @@ VolumeFileVoxelColorizer::VolumeFileVoxelColorizer(VolumeFile* volumeFile)
     m_voxelCountPerMap = m_dimI * m_dimJ * m_dimK;
     m_mapRGBACount = m_voxelCountPerMap * 4;
     
-    for (int64_t i = 0; i < m_mapCount; i++) {
-        m_mapRGBA.push_back(new uint8_t[m_mapRGBACount]);
-        m_mapColoringValid.push_back(false);
-    }
+    m_mapColoringAssigned.resize(m_mapCount, false);
+    m_mapPalette.resize(m_mapCount, NULL);
+    m_mapIgnoreThresholding.resize(m_mapCount, true);
+    m_mapColoringValid.resize(m_mapCount, false);
+    m_mapRGBA.resize(m_mapCount, NULL);
 }
 
 /**
@@ -78,12 +90,15 @@ VolumeFileVoxelColorizer::~VolumeFileVoxelColorizer()
 {
     for (int64_t i = 0; i < m_mapCount; i++) {
         delete[] m_mapRGBA[i];
+        delete m_mapPalette[i];
     }
     m_mapRGBA.clear();
+    m_mapPalette.clear();
 }
 
 /**
- * Assign voxel coloring for a map.
+ * Assign voxel coloring for a map.  The voxels are colored when
+ * the map's colors are requested.
  *
  * @param mapIndex
  *     Index of map.
@@ -103,14 +118,6 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex,
 {
     CaretAssertVectorIndex(m_mapRGBA, mapIndex);
     
-    ElapsedTimer timer;
-    timer.start();
-    
-    /*
-     * Pointer to map's data 
-     */
-    const float* mapDataPointer = m_volumeFile->getFrame(mapIndex);
-    
     /*
      * Get access to threshold data
      */
@@ -141,34 +148,121 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex,
         }
     }
     
+    /*
+     * Keep a copy of the palette since coloring is performed later
+     */
+    delete m_mapPalette[mapIndex];
+    m_mapPalette[mapIndex] = ((palette != NULL)
+                              ? new Palette(*palette)
+                              : NULL);
+    m_mapIgnoreThresholding[mapIndex] = ignoreThresholding;
+    m_mapColoringAssigned[mapIndex] = true;
+    m_mapColoringValid[mapIndex] = false;
+}
+
+/**
+ * @return The statistics used for palette coloring of a map.
+ *
+ * @param mapIndex
+ *     Index of map.
+ */
+const FastStatistics*
+VolumeFileVoxelColorizer::getStatisticsForMap(const int64_t mapIndex) const
+{
+    const FastStatistics* statistics = NULL;
+    switch (m_volumeFile->getPaletteNormalizationMode()) {
+        case PaletteNormalizationModeEnum::NORMALIZATION_ALL_MAP_DATA:
+            statistics = m_volumeFile->getFileFastStatistics();
+            break;
+        case PaletteNormalizationModeEnum::NORMALIZATION_SELECTED_MAP_DATA:
+            statistics = m_volumeFile->getMapFastStatistics(mapIndex);
+            break;
+    }
+    CaretAssert(statistics);
+    return statistics;
+}
+
+/**
+ * Get the RGBA for a map, coloring the map's voxels if the coloring
+ * is not valid.  Allocating RGBA for the map may release the RGBA
+ * of the map that was colored first.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @return
+ *     RGBA for the map's voxels or NULL if coloring has not been
+ *     assigned or the map could not be colored.
+ */
+const uint8_t*
+VolumeFileVoxelColorizer::getMapRGBA(const int64_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    if (m_mapColoringValid[mapIndex]) {
+        return m_mapRGBA[mapIndex];
+    }
+    if ( ! m_mapColoringAssigned[mapIndex]) {
+        return NULL;
+    }
+    
+    if (m_mapRGBA[mapIndex] == NULL) {
+        while (static_cast<int64_t>(m_coloredMapOrder.size()) >= MAXIMUM_COLORED_MAPS) {
+            const int64_t oldestMapIndex = m_coloredMapOrder.front();
+            m_coloredMapOrder.pop_front();
+            delete[] m_mapRGBA[oldestMapIndex];
+            m_mapRGBA[oldestMapIndex] = NULL;
+            m_mapColoringValid[oldestMapIndex] = false;
+        }
+        m_mapRGBA[mapIndex] = new uint8_t[m_mapRGBACount];
+        m_coloredMapOrder.push_back(mapIndex);
+    }
+    
+    colorMap(mapIndex);
+    
+    if (m_mapColoringValid[mapIndex]) {
+        return m_mapRGBA[mapIndex];
+    }
+    return NULL;
+}
+
+/**
+ * Color the voxels in a map using the assigned coloring.
+ *
+ * @param mapIndex
+ *     Index of map.
+ */
+void
+VolumeFileVoxelColorizer::colorMap(const int64_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    CaretAssert(m_mapRGBA[mapIndex]);
+    
+    ElapsedTimer timer;
+    timer.start();
+    
+    /*
+     * Pointer to map's data 
+     */
+    const float* mapDataPointer = m_volumeFile->getFrame(mapIndex);
+    
     switch (m_volumeFile->getType()) {
         case SubvolumeAttributes::UNKNOWN:
         case SubvolumeAttributes::ANATOMY:
         case SubvolumeAttributes::FUNCTIONAL:
         {
+            const Palette* palette = m_mapPalette[mapIndex];
             CaretAssert(palette);
-
-            
-            FastStatistics* statistics = NULL;
-            switch (m_volumeFile->getPaletteNormalizationMode()) {
-                case PaletteNormalizationModeEnum::NORMALIZATION_ALL_MAP_DATA:
-                    statistics = const_cast<FastStatistics*>(m_volumeFile->getFileFastStatistics());
-                    break;
-                case PaletteNormalizationModeEnum::NORMALIZATION_SELECTED_MAP_DATA:
-                    statistics = const_cast<FastStatistics*>(m_volumeFile->getMapFastStatistics(mapIndex));
-                    break;
+            if (palette == NULL) {
+                break;
             }
-            CaretAssert(statistics);
-            
 
-            NodeAndVoxelColoring::colorScalarsWithPalette(statistics, //m_volumeFile->getMapFastStatistics(mapIndex),
+            NodeAndVoxelColoring::colorScalarsWithPalette(getStatisticsForMap(mapIndex),
                                                           m_volumeFile->getMapPaletteColorMapping(mapIndex),
                                                           palette,
                                                           mapDataPointer,
                                                           mapDataPointer,
                                                           m_voxelCountPerMap,
                                                           m_mapRGBA[mapIndex],
-                                                          ignoreThresholding);
+                                                          m_mapIgnoreThresholding[mapIndex]);
             m_mapColoringValid[mapIndex] = true;
         }
             break;
@@ -222,7 +316,161 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex,
 }
 
 /**
- * Invalidate the RGBA coloring for all maps.
+ * @return True if a map is colored with a palette so that it
+ * may be drawn with a palette lookup table.
+ *
+ * @param mapIndex
+ *     Index of map.
+ */
+bool
+VolumeFileVoxelColorizer::isPaletteLookupTableSupported(const int32_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapPalette, mapIndex);
+    
+    switch (m_volumeFile->getType()) {
+        case SubvolumeAttributes::UNKNOWN:
+        case SubvolumeAttributes::ANATOMY:
+        case SubvolumeAttributes::FUNCTIONAL:
+            break;
+        case SubvolumeAttributes::LABEL:
+        case SubvolumeAttributes::RGB:
+        case SubvolumeAttributes::SEGMENTATION:
+        case SubvolumeAttributes::VECTOR:
+            return false;
+            break;
+    }
+    
+    return (m_mapColoringAssigned[mapIndex]
+            && (m_mapPalette[mapIndex] != NULL));
+}
+
+/**
+ * Get the coding of a map's scalars for coloring with a palette lookup
+ * table.  The palette's coloring only changes abruptly at zero, at the
+ * thresholds, and at the ends of the mapped ranges so these are the
+ * boundaries of the coding and entries are evenly spaced only within
+ * the mapped ranges.  Values outside the mapped and threshold ranges
+ * are colored the same as the nearest end of the ranges.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @param numberOfEntries
+ *     Number of entries in the lookup table.
+ * @param scalarCodingOut
+ *     Output containing the coding.
+ * @return
+ *     True if the map is colored with a palette and the coding
+ *     is valid, else false.
+ */
+bool
+VolumeFileVoxelColorizer::getPaletteScalarCodingForMap(const int32_t mapIndex,
+                                                       const int32_t numberOfEntries,
+                                                       GraphicsVolumeScalarCoding& scalarCodingOut) const
+{
+    if ( ! isPaletteLookupTableSupported(mapIndex)) {
+        return false;
+    }
+    
+    const PaletteColorMapping* paletteColorMapping = m_volumeFile->getMapPaletteColorMapping(mapIndex);
+    CaretAssert(paletteColorMapping);
+    
+    /*
+     * Display of positive, zero, and negative values changes at zero
+     */
+    std::vector<float> boundaryValues;
+    boundaryValues.push_back(0.0f);
+    
+    float mostNegative  = 0.0f;
+    float leastNegative = 0.0f;
+    float leastPositive = 0.0f;
+    float mostPositive  = 0.0f;
+    paletteColorMapping->getPaletteMappingValues(getStatisticsForMap(mapIndex),
+                                                 mostNegative,
+                                                 leastNegative,
+                                                 leastPositive,
+                                                 mostPositive);
+    boundaryValues.push_back(mostNegative);
+    boundaryValues.push_back(leastNegative);
+    boundaryValues.push_back(leastPositive);
+    boundaryValues.push_back(mostPositive);
+    
+    const PaletteThresholdTypeEnum::Enum thresholdType = paletteColorMapping->getThresholdType();
+    if (( ! m_mapIgnoreThresholding[mapIndex])
+        && (thresholdType != PaletteThresholdTypeEnum::THRESHOLD_TYPE_OFF)) {
+        boundaryValues.push_back(paletteColorMapping->getThresholdMinimum(thresholdType));
+        boundaryValues.push_back(paletteColorMapping->getThresholdMaximum(thresholdType));
+        if (paletteColorMapping->isShowThresholdFailureInGreen()
+            && (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_MAPPED)) {
+            boundaryValues.push_back(paletteColorMapping->getThresholdMappedMaximum());
+            boundaryValues.push_back(paletteColorMapping->getThresholdMappedAverageAreaMaximum());
+            boundaryValues.push_back(paletteColorMapping->getThresholdMappedMinimum());
+            boundaryValues.push_back(paletteColorMapping->getThresholdMappedAverageAreaMinimum());
+        }
+    }
+    
+    /*
+     * Positive values are normalized within the positive mapped range and
+     * negative values within the negative mapped range
+     */
+    std::vector<std::pair<float, float> > varyingRanges;
+    varyingRanges.push_back(std::make_pair(std::max(0.0f, std::min(leastPositive, mostPositive)),
+                                           std::max(0.0f, std::max(leastPositive, mostPositive))));
+    varyingRanges.push_back(std::make_pair(std::min(0.0f, std::min(mostNegative, leastNegative)),
+                                           std::min(0.0f, std::max(mostNegative, leastNegative))));
+    
+    scalarCodingOut.setup(boundaryValues,
+                          varyingRanges,
+                          numberOfEntries);
+    
+    return true;
+}
+
+/**
+ * Get a lookup table containing the palette coloring, including
+ * thresholding, for each entry of a scalar coding so that voxels
+ * can be colored while drawing without coloring all voxels in the map.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @param scalarCoding
+ *     Coding from getPaletteScalarCodingForMap().
+ * @param rgbaOut
+ *     Output containing RGBA for each entry
+ *     (4 * scalarCoding.getNumberOfEntries()).
+ * @return
+ *     True if the map is colored with a palette and the lookup table
+ *     is valid, else false.
+ */
+bool
+VolumeFileVoxelColorizer::getPaletteLookupTableForMap(const int32_t mapIndex,
+                                                      const GraphicsVolumeScalarCoding& scalarCoding,
+                                                      uint8_t* rgbaOut) const
+{
+    CaretAssert(rgbaOut);
+    
+    if (( ! isPaletteLookupTableSupported(mapIndex))
+        || (scalarCoding.getNumberOfEntries() <= 0)) {
+        return false;
+    }
+    
+    std::vector<float> values;
+    scalarCoding.getEntryValues(values);
+    
+    NodeAndVoxelColoring::colorScalarsWithPalette(getStatisticsForMap(mapIndex),
+                                                  m_volumeFile->getMapPaletteColorMapping(mapIndex),
+                                                  m_mapPalette[mapIndex],
+                                                  &values[0],
+                                                  &values[0],
+                                                  values.size(),
+                                                  rgbaOut,
+                                                  m_mapIgnoreThresholding[mapIndex]);
+    
+    return true;
+}
+
+/**
+ * Invalidate the RGBA coloring for all maps.  Maps are
+ * colored again when their colors are requested.
  */
 void
 VolumeFileVoxelColorizer::invalidateColoring()
@@ -233,9 +481,8 @@ VolumeFileVoxelColorizer::invalidateColoring()
 }
 
 /**
- * Get voxel coloring for a slice in a map.  If voxel coloring is not ready
- * (it may be running in a different thread) this method will wait until the 
- * coloring is valid prior to returning the slice's coloring.
+ * Get voxel coloring for a slice in a map.  If voxel coloring is not valid
+ * the map is colored prior to returning the slice's coloring.
  *
  * @param mapIndex
  *     Index of map.
@@ -291,7 +538,14 @@ VolumeFileVoxelColorizer::getVoxelColorsForSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
+    if (mapRGBA == NULL) {
+        const int64_t sliceVoxelCount = ((iEnd - iStart + 1)
+                                         * (jEnd - jStart + 1)
+                                         * (kEnd - kStart + 1));
+        std::fill(rgbaOut, rgbaOut + (sliceVoxelCount * 4), 0);
+        return 0;
+    }
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -389,7 +643,11 @@ VolumeFileVoxelColorizer::getVoxelColorsForSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
+    if (mapRGBA == NULL) {
+        std::fill(rgbaOut, rgbaOut + (numberOfRows * numberOfColumns * 4), 0);
+        return 0;
+    }
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -455,9 +713,8 @@ VolumeFileVoxelColorizer::getVoxelColorsForSliceInMap(const int32_t mapIndex,
 }
 
 /**
- * Get voxel coloring for a sub-slice in a map.  If voxel coloring is not ready
- * (it may be running in a different thread) this method will wait until the
- * coloring is valid prior to returning the slice's coloring.
+ * Get voxel coloring for a sub-slice in a map.  If voxel coloring is not valid
+ * the map is colored prior to returning the slice's coloring.
  *
  * @param mapIndex
  *     Index of map.
@@ -550,7 +807,11 @@ VolumeFileVoxelColorizer::getVoxelColorsForSubSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
+    if (mapRGBA == NULL) {
+        std::fill(rgbaOut, rgbaOut + rgbaCount, 0);
+        return 0;
+    }
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -651,7 +912,11 @@ VolumeFileVoxelColorizer::getVoxelColorInMap(const int64_t i,
      * Pointer to maps RGBA values
      */
     CaretAssertVectorIndex(m_mapRGBA, mapIndex);
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
+    if (mapRGBA == NULL) {
+        std::fill(rgbaOut, rgbaOut + 4, 0);
+        return;
+    }
     const int64_t rgbaOffset = getRgbaOffsetForVoxelIndex(i, j, k);
     CaretAssertArrayIndex(mapRGBA, m_mapRGBACount, rgbaOffset);
     rgbaOut[0] = mapRGBA[rgbaOffset];
@@ -688,7 +953,10 @@ VolumeFileVoxelColorizer::getVoxelColorInMap(const int64_t i,
 }
 
 /**
- * Clear the voxel coloring for the given map.
+ * Clear the voxel coloring for the given map and release its RGBA.
+ * The map is colored again with the assigned coloring when its
+ * colors are requested.
+ *
  * @param mapIndex
  *    Index of map.
  */
@@ -696,10 +964,12 @@ void
 VolumeFileVoxelColorizer::clearVoxelColoringForMap(const int64_t mapIndex)
 {
     CaretAssertVectorIndex(m_mapRGBA, mapIndex);
-    uint8_t* mapRGBA = m_mapRGBA[mapIndex];
-    
-    for (int64_t i = 0; i < m_mapRGBACount; i++) {
-        mapRGBA[i] = 0.0;
+    if (m_mapRGBA[mapIndex] != NULL) {
+        delete[] m_mapRGBA[mapIndex];
+        m_mapRGBA[mapIndex] = NULL;
+        m_coloredMapOrder.erase(std::find(m_coloredMapOrder.begin(),
+                                          m_coloredMapOrder.end(),
+                                          mapIndex));
     }
     
     CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
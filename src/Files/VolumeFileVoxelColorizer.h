@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include <deque>
 
 #include "CaretObject.h"
 #include "DisplayGroupEnum.h"
@@ -28,6 +29,8 @@
 
 namespace caret {
 
+    class FastStatistics;
+    class GraphicsVolumeScalarCoding;
     class Palette;
     class VolumeFile;
     
@@ -78,6 +81,14 @@ namespace caret {
                                 const int32_t tabIndex,
                                 uint8_t rgbaOut[4]) const;
         
+        bool getPaletteScalarCodingForMap(const int32_t mapIndex,
+                                          const int32_t numberOfEntries,
+                                          GraphicsVolumeScalarCoding& scalarCodingOut) const;
+        
+        bool getPaletteLookupTableForMap(const int32_t mapIndex,
+                                         const GraphicsVolumeScalarCoding& scalarCoding,
+                                         uint8_t* rgbaOut) const;
+        
         void clearVoxelColoringForMap(const int64_t mapIndex);
         
         void invalidateColoring();
@@ -87,6 +98,14 @@ namespace caret {
 
         VolumeFileVoxelColorizer& operator=(const VolumeFileVoxelColorizer&);
         
+        const uint8_t* getMapRGBA(const int64_t mapIndex) const;
+        
+        void colorMap(const int64_t mapIndex) const;
+        
+        const FastStatistics* getStatisticsForMap(const int64_t mapIndex) const;
+        
+        bool isPaletteLookupTableSupported(const int32_t mapIndex) const;
+        
         /**
          * Get theRGBA offset for a voxel index
          */
@@ -118,12 +137,27 @@ namespace caret {
         int64_t m_mapCount;
         int64_t m_mapRGBACount;
         
-        std::vector<bool> m_mapColoringValid;
-        std::vector<uint8_t*> m_mapRGBA;
+        /** Coloring was assigned so the map can be colored when its colors are requested */
+        std::vector<bool> m_mapColoringAssigned;
+        
+        /** Copy of the palette assigned to each map, NULL if not mapped with a palette */
+        std::vector<Palette*> m_mapPalette;
+        
+        std::vector<bool> m_mapIgnoreThresholding;
+        
+        mutable std::vector<bool> m_mapColoringValid;
+        
+        /** RGBA for each map, NULL until the map's colors are requested */
+        mutable std::vector<uint8_t*> m_mapRGBA;
+        
+        /** Maps in the order their RGBA was allocated, oldest is released when there are too many */
+        mutable std::deque<int64_t> m_coloredMapOrder;
+        
+        static const int64_t MAXIMUM_COLORED_MAPS;
     };
     
 #ifdef __VOLUME_FILE_VOXEL_COLORIZER_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const int64_t VolumeFileVoxelColorizer::MAXIMUM_COLORED_MAPS = 16;
 #endif // __VOLUME_FILE_VOXEL_COLORIZER_DECLARE__
 
 } // namespace
@@ -0,0 +1,474 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+#include "GraphicsOpenGLSurfaceBuffers.h"
+#undef __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+
+#include <vector>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOpenGLInclude.h"
+#include "EventGraphicsOpenGLCreateBufferObject.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLBufferObject.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::GraphicsOpenGLSurfaceBuffers
+ * \brief OpenGL buffers for drawing a surface's triangles.
+ * \ingroup Graphics
+ *
+ * The coordinates, normal vectors, and triangles are loaded into
+ * buffers once and are only reloaded after the geometry is
+ * invalidated.  Vertex coloring is loaded once for each coloring
+ * that is drawn (a surface has coloring for each tab) and is only
+ * reloaded after the coloring is invalidated.
+ *
+ * Buffers are created in the OpenGL context passed to the drawing
+ * methods and are recreated if a different context is used.
+ */
+
+/**
+ * Constructor.
+ */
+GraphicsOpenGLSurfaceBuffers::GraphicsOpenGLSurfaceBuffers()
+: CaretObject()
+{
+
+}
+
+/**
+ * Destructor.  Buffer objects send an event so that they are
+ * deleted when their OpenGL context is current.
+ */
+GraphicsOpenGLSurfaceBuffers::~GraphicsOpenGLSurfaceBuffers()
+{
+}
+
+/**
+ * Invalidate the coordinates, normal vectors, and triangles
+ * after any of them have changed in the surface.
+ */
+void
+GraphicsOpenGLSurfaceBuffers::invalidateGeometry()
+{
+    m_geometryValid = false;
+    m_triangleCoordinatesValid = false;
+}
+
+/**
+ * Invalidate the vertex coloring after the surface's
+ * coloring has changed.
+ */
+void
+GraphicsOpenGLSurfaceBuffers::invalidateColors()
+{
+    m_vertexColorBufferObjects.clear();
+}
+
+/**
+ * Set the OpenGL context used for drawing.  If it is not the context
+ * in which the buffers were created, all buffers are discarded.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ */
+void
+GraphicsOpenGLSurfaceBuffers::setOpenGLContextPointer(void* openglContextPointer)
+{
+    if (openglContextPointer != m_openglContextPointer) {
+        m_coordinateBufferObject.reset();
+        m_normalVectorBufferObject.reset();
+        m_triangleBufferObject.reset();
+        m_triangleCoordinateBufferObject.reset();
+        m_triangleColorBufferObject.reset();
+        m_vertexColorBufferObjects.clear();
+        invalidateGeometry();
+
+        m_openglContextPointer = openglContextPointer;
+    }
+}
+
+/**
+ * @return A new OpenGL buffer object or NULL if creating it failed.
+ */
+GraphicsOpenGLBufferObject*
+GraphicsOpenGLSurfaceBuffers::createBufferObject()
+{
+    EventGraphicsOpenGLCreateBufferObject createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    GraphicsOpenGLBufferObject* bufferObject = createEvent.getOpenGLBufferObject();
+    if (bufferObject != NULL) {
+        if (bufferObject->getBufferObjectName() == 0) {
+            delete bufferObject;
+            bufferObject = NULL;
+        }
+    }
+    return bufferObject;
+}
+
+/**
+ * Load the coordinate, normal vector, and triangle buffers.
+ *
+ * @return True if the buffers are valid for drawing.
+ */
+bool
+GraphicsOpenGLSurfaceBuffers::loadGeometryBuffers(const int32_t numberOfVertices,
+                                                  const float* xyz,
+                                                  const float* normalXYZ,
+                                                  const int32_t numberOfTriangles,
+                                                  const int32_t* triangleVertexIndices)
+{
+    if (m_geometryValid
+        && (numberOfVertices == m_numberOfVertices)
+        && (numberOfTriangles == m_numberOfTriangles)) {
+        return true;
+    }
+    m_triangleCoordinatesValid = false;
+
+    if (m_coordinateBufferObject == NULL) {
+        m_coordinateBufferObject.reset(createBufferObject());
+    }
+    if (m_normalVectorBufferObject == NULL) {
+        m_normalVectorBufferObject.reset(createBufferObject());
+    }
+    if (m_triangleBufferObject == NULL) {
+        m_triangleBufferObject.reset(createBufferObject());
+    }
+    if ((m_coordinateBufferObject == NULL)
+        || (m_normalVectorBufferObject == NULL)
+        || (m_triangleBufferObject == NULL)) {
+        CaretLogSevere("Failed to create OpenGL buffers for surface drawing.");
+        return false;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_coordinateBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 numberOfVertices * 3 * sizeof(float),
+                 (const GLvoid*)xyz,
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_normalVectorBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 numberOfVertices * 3 * sizeof(float),
+                 (const GLvoid*)normalXYZ,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 m_triangleBufferObject->getBufferObjectName());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 numberOfTriangles * 3 * sizeof(int32_t),
+                 (const GLvoid*)triangleVertexIndices,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    m_numberOfVertices  = numberOfVertices;
+    m_numberOfTriangles = numberOfTriangles;
+    m_geometryValid = true;
+
+    return true;
+}
+
+/**
+ * Load the buffer containing the coordinates of each triangle's
+ * three vertices.  Only used when drawing with a color per triangle.
+ *
+ * @return True if the buffer is valid for drawing.
+ */
+bool
+GraphicsOpenGLSurfaceBuffers::loadTriangleCoordinateBuffer(const float* xyz,
+                                                           const int32_t* triangleVertexIndices)
+{
+    if (m_triangleCoordinatesValid) {
+        return true;
+    }
+
+    if (m_triangleCoordinateBufferObject == NULL) {
+        m_triangleCoordinateBufferObject.reset(createBufferObject());
+        if (m_triangleCoordinateBufferObject == NULL) {
+            CaretLogSevere("Failed to create OpenGL buffer for surface triangle drawing.");
+            return false;
+        }
+    }
+
+    const int64_t numberOfTriangleVertices = static_cast<int64_t>(m_numberOfTriangles) * 3;
+    std::vector<float> triangleXYZ(numberOfTriangleVertices * 3);
+    for (int64_t i = 0; i < numberOfTriangleVertices; i++) {
+        const float* c = &xyz[triangleVertexIndices[i] * 3];
+        const int64_t i3 = i * 3;
+        triangleXYZ[i3]   = c[0];
+        triangleXYZ[i3+1] = c[1];
+        triangleXYZ[i3+2] = c[2];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_triangleCoordinateBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 triangleXYZ.size() * sizeof(float),
+                 (const GLvoid*)&triangleXYZ[0],
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    m_triangleCoordinatesValid = true;
+
+    return true;
+}
+
+/**
+ * Get the buffer containing the given vertex coloring, loading
+ * the coloring if it has not been loaded since colors were invalidated.
+ *
+ * @param vertexRGBA
+ *     RGBA for each vertex.
+ * @return
+ *     The buffer or NULL if creating it failed.
+ */
+GraphicsOpenGLBufferObject*
+GraphicsOpenGLSurfaceBuffers::loadVertexColorBuffer(const float* vertexRGBA)
+{
+    CaretAssert(vertexRGBA);
+
+    auto iter = m_vertexColorBufferObjects.find(vertexRGBA);
+    if (iter != m_vertexColorBufferObjects.end()) {
+        return iter->second.get();
+    }
+
+    GraphicsOpenGLBufferObject* bufferObject = createBufferObject();
+    if (bufferObject == NULL) {
+        CaretLogSevere("Failed to create OpenGL buffer for surface coloring.");
+        return NULL;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 bufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 m_numberOfVertices * 4 * sizeof(float),
+                 (const GLvoid*)vertexRGBA,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    m_vertexColorBufferObjects[vertexRGBA].reset(bufferObject);
+
+    return bufferObject;
+}
+
+/**
+ * Draw the triangles with a color for each vertex.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ * @param numberOfVertices
+ *     Number of vertices.
+ * @param xyz
+ *     Coordinates of the vertices.
+ * @param normalXYZ
+ *     Normal vectors of the vertices.
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @param triangleVertexIndices
+ *     Indices of each triangle's three vertices.
+ * @param vertexRGBA
+ *     RGBA for each vertex.  This must remain valid and unchanged until
+ *     colors are invalidated since it is only loaded the first time
+ *     it is drawn.  If NULL, the current OpenGL color is used.
+ */
+void
+GraphicsOpenGLSurfaceBuffers::drawTriangles(void* openglContextPointer,
+                                            const int32_t numberOfVertices,
+                                            const float* xyz,
+                                            const float* normalXYZ,
+                                            const int32_t numberOfTriangles,
+                                            const int32_t* triangleVertexIndices,
+                                            const float* vertexRGBA)
+{
+    if ((numberOfVertices <= 0)
+        || (numberOfTriangles <= 0)) {
+        return;
+    }
+
+    setOpenGLContextPointer(openglContextPointer);
+    if ( ! loadGeometryBuffers(numberOfVertices,
+                               xyz,
+                               normalXYZ,
+                               numberOfTriangles,
+                               triangleVertexIndices)) {
+        return;
+    }
+
+    GraphicsOpenGLBufferObject* colorBufferObject = NULL;
+    if (vertexRGBA != NULL) {
+        colorBufferObject = loadVertexColorBuffer(vertexRGBA);
+        if (colorBufferObject == NULL) {
+            return;
+        }
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_coordinateBufferObject->getBufferObjectName());
+    glVertexPointer(3, GL_FLOAT, 0, (GLvoid*)0);
+
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_normalVectorBufferObject->getBufferObjectName());
+    glNormalPointer(GL_FLOAT, 0, (GLvoid*)0);
+
+    if (colorBufferObject != NULL) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     colorBufferObject->getBufferObjectName());
+        glColorPointer(4, GL_FLOAT, 0, (GLvoid*)0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 m_triangleBufferObject->getBufferObjectName());
+    glDrawElements(GL_TRIANGLES,
+                   (3 * m_numberOfTriangles),
+                   GL_UNSIGNED_INT,
+                   (GLvoid*)0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+}
+
+/**
+ * Draw the triangles with one color for each triangle, such as
+ * colors that identify the triangles for selection.  Normal vectors
+ * are not used so lighting should be disabled.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ * @param numberOfVertices
+ *     Number of vertices.
+ * @param xyz
+ *     Coordinates of the vertices.
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @param triangleVertexIndices
+ *     Indices of each triangle's three vertices.
+ * @param triangleRGB
+ *     RGB for each triangle.  Loaded every time this method is called.
+ */
+void
+GraphicsOpenGLSurfaceBuffers::drawTrianglesWithTriangleColors(void* openglContextPointer,
+                                                              const int32_t numberOfVertices,
+                                                              const float* xyz,
+                                                              const int32_t numberOfTriangles,
+                                                              const int32_t* triangleVertexIndices,
+                                                              const uint8_t* triangleRGB)
+{
+    if ((numberOfVertices <= 0)
+        || (numberOfTriangles <= 0)) {
+        return;
+    }
+
+    setOpenGLContextPointer(openglContextPointer);
+
+    /*
+     * Triangle coordinates are not valid unless
+     * geometry (number of triangles) is valid.
+     */
+    if ( ! m_geometryValid
+        || (numberOfVertices != m_numberOfVertices)
+        || (numberOfTriangles != m_numberOfTriangles)) {
+        m_numberOfVertices  = numberOfVertices;
+        m_numberOfTriangles = numberOfTriangles;
+        m_geometryValid = false;
+        m_triangleCoordinatesValid = false;
+    }
+    if ( ! loadTriangleCoordinateBuffer(xyz,
+                                        triangleVertexIndices)) {
+        return;
+    }
+
+    if (m_triangleColorBufferObject == NULL) {
+        m_triangleColorBufferObject.reset(createBufferObject());
+        if (m_triangleColorBufferObject == NULL) {
+            CaretLogSevere("Failed to create OpenGL buffer for surface triangle coloring.");
+            return;
+        }
+    }
+
+    const int64_t numberOfTriangleVertices = static_cast<int64_t>(numberOfTriangles) * 3;
+    std::vector<uint8_t> vertexRGB(numberOfTriangleVertices * 3);
+    for (int64_t i = 0; i < numberOfTriangles; i++) {
+        const uint8_t* rgb = &triangleRGB[i * 3];
+        for (int32_t j = 0; j < 3; j++) {
+            const int64_t offset = (i * 9) + (j * 3);
+            vertexRGB[offset]   = rgb[0];
+            vertexRGB[offset+1] = rgb[1];
+            vertexRGB[offset+2] = rgb[2];
+        }
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_triangleCoordinateBufferObject->getBufferObjectName());
+    glVertexPointer(3, GL_FLOAT, 0, (GLvoid*)0);
+
+    glEnableClientState(GL_COLOR_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_triangleColorBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 vertexRGB.size() * sizeof(uint8_t),
+                 (const GLvoid*)&vertexRGB[0],
+                 GL_STREAM_DRAW);
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, (GLvoid*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    glDrawArrays(GL_TRIANGLES,
+                 0,
+                 numberOfTriangleVertices);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+GraphicsOpenGLSurfaceBuffers::toString() const
+{
+    return "GraphicsOpenGLSurfaceBuffers";
+}
+
@@ -0,0 +1,124 @@
+#ifndef __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_H__
+#define __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include "CaretObject.h"
+
+
+
+namespace caret {
+
+    class GraphicsOpenGLBufferObject;
+
+    class GraphicsOpenGLSurfaceBuffers : public CaretObject {
+
+    public:
+        GraphicsOpenGLSurfaceBuffers();
+
+        virtual ~GraphicsOpenGLSurfaceBuffers();
+
+        void invalidateGeometry();
+
+        void invalidateColors();
+
+        void drawTriangles(void* openglContextPointer,
+                           const int32_t numberOfVertices,
+                           const float* xyz,
+                           const float* normalXYZ,
+                           const int32_t numberOfTriangles,
+                           const int32_t* triangleVertexIndices,
+                           const float* vertexRGBA);
+
+        void drawTrianglesWithTriangleColors(void* openglContextPointer,
+                                             const int32_t numberOfVertices,
+                                             const float* xyz,
+                                             const int32_t numberOfTriangles,
+                                             const int32_t* triangleVertexIndices,
+                                             const uint8_t* triangleRGB);
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        GraphicsOpenGLSurfaceBuffers(const GraphicsOpenGLSurfaceBuffers&);
+
+        GraphicsOpenGLSurfaceBuffers& operator=(const GraphicsOpenGLSurfaceBuffers&);
+
+        void setOpenGLContextPointer(void* openglContextPointer);
+
+        bool loadGeometryBuffers(const int32_t numberOfVertices,
+                                 const float* xyz,
+                                 const float* normalXYZ,
+                                 const int32_t numberOfTriangles,
+                                 const int32_t* triangleVertexIndices);
+
+        bool loadTriangleCoordinateBuffer(const float* xyz,
+                                          const int32_t* triangleVertexIndices);
+
+        GraphicsOpenGLBufferObject* loadVertexColorBuffer(const float* vertexRGBA);
+
+        static GraphicsOpenGLBufferObject* createBufferObject();
+
+        void* m_openglContextPointer = NULL;
+
+        int32_t m_numberOfVertices = 0;
+
+        int32_t m_numberOfTriangles = 0;
+
+        bool m_geometryValid = false;
+
+        bool m_triangleCoordinatesValid = false;
+
+        /** Coordinate for each vertex */
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_coordinateBufferObject;
+
+        /** Normal vector for each vertex */
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_normalVectorBufferObject;
+
+        /** Vertex indices for each triangle (element array) */
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_triangleBufferObject;
+
+        /** Coordinates of each triangle's three vertices, only created for drawing with a color per triangle */
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_triangleCoordinateBufferObject;
+
+        /** Color for each triangle's three vertices, loaded every time drawn with a color per triangle */
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_triangleColorBufferObject;
+
+        /** Vertex colors keyed by the coloring that was loaded, cleared when coloring is invalidated */
+        std::map<const float*, std::unique_ptr<GraphicsOpenGLBufferObject>> m_vertexColorBufferObjects;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_OPEN_G_L_SURFACE_BUFFERS_H__
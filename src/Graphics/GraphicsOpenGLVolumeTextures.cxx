@@ -0,0 +1,508 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_DECLARE__
+#include "GraphicsOpenGLVolumeTextures.h"
+#undef __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_DECLARE__
+
+#include <vector>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOpenGLInclude.h"
+#include "EventGraphicsOpenGLCreateTextureName.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLTextureName.h"
+
+using namespace caret;
+
+
+namespace {
+    /*
+     * Shader programs are shared by contexts in a sharing group, so one is
+     * created for each sharing group.  Zero is stored when the program could
+     * not be created so that it is not attempted again.
+     */
+    std::map<void*, unsigned int> s_shaderPrograms;
+
+    const char* s_vertexShaderSource =
+    "void main()\n"
+    "{\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_ClipVertex = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+    /*
+     * Code 0 is not a number (not drawn) and code N is the
+     * center of the lookup table's entry (N - 1).
+     */
+    const char* s_fragmentShaderSource =
+    "uniform sampler3D dataTexture;\n"
+    "uniform sampler1D lookupTexture;\n"
+    "uniform float lookupTableSize;\n"
+    "uniform float opacity;\n"
+    "void main()\n"
+    "{\n"
+    "    float code = floor(texture3D(dataTexture, gl_TexCoord[0].stp).r * 65535.0 + 0.5);\n"
+    "    if (code < 0.5) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    vec4 color = texture1D(lookupTexture, (code - 0.5) / lookupTableSize);\n"
+    "    if (color.a <= 0.0) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    gl_FragColor = vec4(color.rgb, opacity);\n"
+    "}\n";
+}
+
+/**
+ * \class caret::GraphicsOpenGLVolumeTextures
+ * \brief OpenGL textures for drawing a volume's slices with a palette lookup table.
+ * \ingroup Graphics
+ *
+ * A map's scalars are loaded into a 3D texture once and are only
+ * reloaded after the data is invalidated.  Palette coloring and
+ * thresholding are applied while drawing by a shader that looks up
+ * each voxel's color in a 1D texture, so a palette change only reloads
+ * the small lookup table instead of recoloring every voxel.
+ *
+ * Scalars are stored as 16-bit codes of a GraphicsVolumeScalarCoding
+ * which needs half the memory of RGBA and does not require floating
+ * point textures.  The coding depends upon the palette's mapped and
+ * threshold ranges so the data is reloaded when they change.  Only the
+ * most recently loaded maps are kept.
+ *
+ * Requires OpenGL 2.0 (shaders).  Textures are created in the OpenGL
+ * context passed to loadMapData() and are recreated if a different
+ * context is used.
+ */
+
+/**
+ * Constructor.
+ */
+GraphicsOpenGLVolumeTextures::GraphicsOpenGLVolumeTextures()
+: CaretObject()
+{
+
+}
+
+/**
+ * Destructor.  Texture names send an event so that they are
+ * deleted when their OpenGL context is current.
+ */
+GraphicsOpenGLVolumeTextures::~GraphicsOpenGLVolumeTextures()
+{
+}
+
+/**
+ * Invalidate the data for all maps after the volume's voxels
+ * or dimensions have changed.
+ */
+void
+GraphicsOpenGLVolumeTextures::invalidateData()
+{
+    m_mapTextures.clear();
+    m_loadedMapOrder.clear();
+}
+
+/**
+ * Invalidate the lookup table for a map after its palette or
+ * thresholding has changed.
+ *
+ * @param mapIndex
+ *     Index of the map.
+ */
+void
+GraphicsOpenGLVolumeTextures::invalidateLookupTable(const int32_t mapIndex)
+{
+    auto iter = m_mapTextures.find(mapIndex);
+    if (iter != m_mapTextures.end()) {
+        iter->second.m_lookupTableValid = false;
+    }
+}
+
+/**
+ * Invalidate the lookup tables for all maps.
+ */
+void
+GraphicsOpenGLVolumeTextures::invalidateLookupTables()
+{
+    for (auto& iter : m_mapTextures) {
+        iter.second.m_lookupTableValid = false;
+    }
+}
+
+/**
+ * Set the OpenGL context used for drawing.  If it is not the context
+ * in which the textures were created, all textures are discarded.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ */
+void
+GraphicsOpenGLVolumeTextures::setOpenGLContextPointer(void* openglContextPointer)
+{
+    if (openglContextPointer != m_openglContextPointer) {
+        invalidateData();
+
+        m_openglContextPointer = openglContextPointer;
+    }
+}
+
+/**
+ * @return A new OpenGL texture name or NULL if creating it failed.
+ */
+GraphicsOpenGLTextureName*
+GraphicsOpenGLVolumeTextures::createTextureName()
+{
+    EventGraphicsOpenGLCreateTextureName createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    GraphicsOpenGLTextureName* textureName = createEvent.getOpenGLTextureName();
+    if (textureName != NULL) {
+        if (textureName->getTextureName() == 0) {
+            delete textureName;
+            textureName = NULL;
+        }
+    }
+    return textureName;
+}
+
+/**
+ * Get the shader program that colors voxels with the lookup table,
+ * creating it the first time it is requested for a context.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ * @return
+ *     The shader program or zero if shaders are not supported.
+ */
+unsigned int
+GraphicsOpenGLVolumeTextures::getShaderProgram(void* openglContextPointer)
+{
+    auto iter = s_shaderPrograms.find(openglContextPointer);
+    if (iter != s_shaderPrograms.end()) {
+        return iter->second;
+    }
+    
+    GLuint program = 0;
+#ifdef GL_VERSION_2_0
+    /*
+     * Shader functions are only available if the runtime version
+     * of OpenGL is 2.0 or later.
+     */
+    const char* versionChars = (const char*)glGetString(GL_VERSION);
+    const AString versionString((versionChars != NULL) ? versionChars : "");
+    const int32_t majorVersion = versionString.section('.', 0, 0).toInt();
+    GLint maximumTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+    if ((majorVersion >= 2)
+        && (maximumTextureSize >= LOOKUP_TABLE_SIZE)) {
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &s_vertexShaderSource, NULL);
+        glCompileShader(vertexShader);
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &s_fragmentShaderSource, NULL);
+        glCompileShader(fragmentShader);
+        
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        
+        /*
+         * Shaders are deleted when the program is deleted
+         */
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        
+        GLint linkStatus = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if (linkStatus != GL_TRUE) {
+            char infoLog[1024] = "";
+            glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+            CaretLogWarning("Volume slice shader failed to link, slices will be drawn with voxel colors: "
+                            + AString(infoLog));
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+#endif // GL_VERSION_2_0
+    
+    s_shaderPrograms[openglContextPointer] = program;
+    
+    return program;
+}
+
+/**
+ * Load a map's scalars into a texture.  If the map was previously loaded
+ * with the same coding, no action is taken.  Loading a map may remove the
+ * textures of the map that was loaded first.  The map's lookup table
+ * is invalid after its data is loaded.
+ *
+ * @param openglContextPointer
+ *     Pointer to the active OpenGL context.
+ * @param mapIndex
+ *     Index of the map.
+ * @param dimensions
+ *     Dimensions of the volume.
+ * @param mapData
+ *     Scalars for the map, the first dimension varies fastest.
+ * @param scalarCoding
+ *     Coding of the scalars, must have getLookupTableSize() entries.
+ * @return
+ *     True if the map's data is loaded and drawSlice() may be used
+ *     after a lookup table is loaded, false if texture drawing is not
+ *     supported or the volume is too large for a texture.
+ */
+bool
+GraphicsOpenGLVolumeTextures::loadMapData(void* openglContextPointer,
+                                          const int32_t mapIndex,
+                                          const int64_t dimensions[3],
+                                          const float* mapData,
+                                          const GraphicsVolumeScalarCoding& scalarCoding)
+{
+    CaretAssert(mapData);
+    CaretAssert(scalarCoding.getNumberOfEntries() == LOOKUP_TABLE_SIZE);
+    
+#ifdef GL_VERSION_2_0
+    setOpenGLContextPointer(openglContextPointer);
+    if (getShaderProgram(openglContextPointer) == 0) {
+        return false;
+    }
+    
+    auto iter = m_mapTextures.find(mapIndex);
+    if ((iter != m_mapTextures.end())
+        && (iter->second.m_scalarCoding == scalarCoding)) {
+        return true;
+    }
+    
+    GLint maximumTextureSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maximumTextureSize);
+    for (int32_t i = 0; i < 3; i++) {
+        if ((dimensions[i] <= 0)
+            || (dimensions[i] > maximumTextureSize)) {
+            return false;
+        }
+    }
+    
+    const int64_t numberOfVoxels = dimensions[0] * dimensions[1] * dimensions[2];
+    std::vector<uint16_t> codes(numberOfVoxels);
+    for (int64_t i = 0; i < numberOfVoxels; i++) {
+        codes[i] = scalarCoding.getCodeForValue(mapData[i]);
+    }
+    
+    GraphicsOpenGLTextureName* textureName = NULL;
+    if (iter != m_mapTextures.end()) {
+        /*
+         * Coding changed (thresholds or mapped range) so reload
+         * the map's texture
+         */
+        textureName = iter->second.m_dataTexture.get();
+    }
+    else {
+        while (static_cast<int32_t>(m_loadedMapOrder.size()) >= MAXIMUM_LOADED_MAPS) {
+            m_mapTextures.erase(m_loadedMapOrder.front());
+            m_loadedMapOrder.pop_front();
+        }
+        
+        textureName = createTextureName();
+        if (textureName == NULL) {
+            CaretLogSevere("Failed to create OpenGL texture for volume drawing.");
+            return false;
+        }
+        
+        m_mapTextures[mapIndex].m_dataTexture.reset(textureName);
+        m_loadedMapOrder.push_back(mapIndex);
+    }
+    
+    MapTextures& mapTextures = m_mapTextures[mapIndex];
+    mapTextures.m_scalarCoding = scalarCoding;
+    mapTextures.m_lookupTableValid = false;
+    
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glBindTexture(GL_TEXTURE_3D, textureName->getTextureName());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D,
+                 0,
+                 GL_LUMINANCE16,
+                 dimensions[0],
+                 dimensions[1],
+                 dimensions[2],
+                 0,
+                 GL_LUMINANCE,
+                 GL_UNSIGNED_SHORT,
+                 &codes[0]);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glPopClientAttrib();
+    
+    return true;
+#else  // GL_VERSION_2_0
+    return false;
+#endif // GL_VERSION_2_0
+}
+
+/**
+ * @return True if the lookup table for a loaded map is valid.
+ *
+ * @param mapIndex
+ *     Index of the map.
+ */
+bool
+GraphicsOpenGLVolumeTextures::isLookupTableValid(const int32_t mapIndex) const
+{
+    auto iter = m_mapTextures.find(mapIndex);
+    if (iter != m_mapTextures.end()) {
+        return iter->second.m_lookupTableValid;
+    }
+    return false;
+}
+
+/**
+ * Load the lookup table for a map whose data is loaded.
+ *
+ * @param mapIndex
+ *     Index of the map.
+ * @param lookupTableRGBA
+ *     RGBA for each of the getLookupTableSize() entries of the scalar
+ *     coding used to load the map's data.  Colors with zero alpha are
+ *     not drawn.
+ */
+void
+GraphicsOpenGLVolumeTextures::loadLookupTable(const int32_t mapIndex,
+                                              const uint8_t* lookupTableRGBA)
+{
+    CaretAssert(lookupTableRGBA);
+    
+    auto iter = m_mapTextures.find(mapIndex);
+    if (iter == m_mapTextures.end()) {
+        CaretAssertMessage(0, "Map data must be loaded before its lookup table");
+        return;
+    }
+    MapTextures& mapTextures = iter->second;
+    
+    if (mapTextures.m_lookupTexture == NULL) {
+        mapTextures.m_lookupTexture.reset(createTextureName());
+        if (mapTextures.m_lookupTexture == NULL) {
+            CaretLogSevere("Failed to create OpenGL texture for volume lookup table.");
+            return;
+        }
+    }
+    
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_1D, mapTextures.m_lookupTexture->getTextureName());
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D,
+                 0,
+                 GL_RGBA8,
+                 LOOKUP_TABLE_SIZE,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 lookupTableRGBA);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glPopClientAttrib();
+    
+    mapTextures.m_lookupTableValid = true;
+}
+
+/**
+ * Draw a slice through a map as one quadrilateral.  The map's data
+ * and lookup table must be loaded.  Voxels whose color has zero alpha
+ * are not drawn and all other voxels are drawn with the given opacity.
+ *
+ * @param mapIndex
+ *     Index of the map.
+ * @param cornerXYZ
+ *     Coordinates of the slice's four corners (counter-clockwise).
+ * @param cornerTextureSTR
+ *     Texture coordinates of the four corners, voxel (i, j, k) is at
+ *     ((i + 0.5) / dimI, (j + 0.5) / dimJ, (k + 0.5) / dimK).
+ * @param normalVector
+ *     Normal vector of the slice.
+ * @param opacity
+ *     Opacity for the slice.
+ */
+void
+GraphicsOpenGLVolumeTextures::drawSlice(const int32_t mapIndex,
+                                        const float cornerXYZ[12],
+                                        const float cornerTextureSTR[12],
+                                        const float normalVector[3],
+                                        const float opacity)
+{
+#ifdef GL_VERSION_2_0
+    auto iter = m_mapTextures.find(mapIndex);
+    if (iter == m_mapTextures.end()) {
+        return;
+    }
+    const MapTextures& mapTextures = iter->second;
+    if (( ! mapTextures.m_lookupTableValid)
+        || (mapTextures.m_lookupTexture == NULL)) {
+        return;
+    }
+    const GLuint program = getShaderProgram(m_openglContextPointer);
+    if (program == 0) {
+        return;
+    }
+    
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "dataTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "lookupTexture"), 1);
+    glUniform1f(glGetUniformLocation(program, "lookupTableSize"), LOOKUP_TABLE_SIZE);
+    glUniform1f(glGetUniformLocation(program, "opacity"), opacity);
+    
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, mapTextures.m_lookupTexture->getTextureName());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, mapTextures.m_dataTexture->getTextureName());
+    
+    glBegin(GL_QUADS);
+    glNormal3fv(normalVector);
+    for (int32_t i = 0; i < 4; i++) {
+        glTexCoord3fv(&cornerTextureSTR[i * 3]);
+        glVertex3fv(&cornerXYZ[i * 3]);
+    }
+    glEnd();
+    
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+#endif // GL_VERSION_2_0
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+GraphicsOpenGLVolumeTextures::toString() const
+{
+    return "GraphicsOpenGLVolumeTextures";
+}
@@ -0,0 +1,126 @@
+#ifndef __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_H__
+#define __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include "CaretObject.h"
+#include "GraphicsVolumeScalarCoding.h"
+
+
+
+namespace caret {
+
+    class GraphicsOpenGLTextureName;
+
+    class GraphicsOpenGLVolumeTextures : public CaretObject {
+
+    public:
+        GraphicsOpenGLVolumeTextures();
+
+        virtual ~GraphicsOpenGLVolumeTextures();
+
+        void invalidateData();
+
+        void invalidateLookupTable(const int32_t mapIndex);
+
+        void invalidateLookupTables();
+
+        bool loadMapData(void* openglContextPointer,
+                         const int32_t mapIndex,
+                         const int64_t dimensions[3],
+                         const float* mapData,
+                         const GraphicsVolumeScalarCoding& scalarCoding);
+
+        bool isLookupTableValid(const int32_t mapIndex) const;
+
+        void loadLookupTable(const int32_t mapIndex,
+                             const uint8_t* lookupTableRGBA);
+
+        void drawSlice(const int32_t mapIndex,
+                       const float cornerXYZ[12],
+                       const float cornerTextureSTR[12],
+                       const float normalVector[3],
+                       const float opacity);
+
+        /**
+         * @return Number of colors in a lookup table.
+         */
+        static int32_t getLookupTableSize() { return LOOKUP_TABLE_SIZE; }
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        /**
+         * Textures for one map.
+         */
+        struct MapTextures {
+            /** Scalars replaced by 16-bit codes of the scalar coding */
+            std::unique_ptr<GraphicsOpenGLTextureName> m_dataTexture;
+
+            /** Palette colors for the entries of the scalar coding */
+            std::unique_ptr<GraphicsOpenGLTextureName> m_lookupTexture;
+
+            /** Coding used for the data texture */
+            GraphicsVolumeScalarCoding m_scalarCoding;
+
+            bool m_lookupTableValid = false;
+        };
+
+        GraphicsOpenGLVolumeTextures(const GraphicsOpenGLVolumeTextures&);
+
+        GraphicsOpenGLVolumeTextures& operator=(const GraphicsOpenGLVolumeTextures&);
+
+        void setOpenGLContextPointer(void* openglContextPointer);
+
+        static GraphicsOpenGLTextureName* createTextureName();
+
+        static unsigned int getShaderProgram(void* openglContextPointer);
+
+        void* m_openglContextPointer = NULL;
+
+        std::map<int32_t, MapTextures> m_mapTextures;
+
+        /** Maps in the order their data was loaded, oldest is removed when there are too many */
+        std::deque<int32_t> m_loadedMapOrder;
+
+        static const int32_t LOOKUP_TABLE_SIZE;
+
+        static const int32_t MAXIMUM_LOADED_MAPS;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_DECLARE__
+    const int32_t GraphicsOpenGLVolumeTextures::LOOKUP_TABLE_SIZE = 4096;
+    const int32_t GraphicsOpenGLVolumeTextures::MAXIMUM_LOADED_MAPS = 8;
+#endif // __GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_OPEN_G_L_VOLUME_TEXTURES_H__
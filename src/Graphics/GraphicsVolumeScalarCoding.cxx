@@ -0,0 +1,371 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define __GRAPHICS_VOLUME_SCALAR_CODING_DECLARE__
+#include "GraphicsVolumeScalarCoding.h"
+#undef __GRAPHICS_VOLUME_SCALAR_CODING_DECLARE__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::GraphicsVolumeScalarCoding
+ * \brief Maps scalars to codes that index a palette lookup table.
+ * \ingroup Graphics
+ *
+ * Scalars are replaced by codes so that a volume can be colored with a
+ * lookup table.  A palette's coloring only changes abruptly at a few
+ * values (zero, thresholds, and the ends of the mapped ranges) so these
+ * are the boundaries of the coding.  Each boundary value has its own
+ * entry and values between adjacent boundaries never share an entry
+ * with values outside them, so sign, display and threshold tests of the
+ * lookup table's values are the same as for the scalars they replace.
+ *
+ * Intervals where the color varies continuously (the mapped ranges)
+ * are divided into evenly spaced entries, with each mapped range
+ * receiving an equal share of the entries regardless of its size.  All
+ * other intervals have a constant color and use a single entry, so
+ * values far outside the mapped ranges (outliers) do not reduce the
+ * resolution of the coding.
+ */
+
+/**
+ * Constructor of an empty coding with no entries.
+ */
+GraphicsVolumeScalarCoding::GraphicsVolumeScalarCoding()
+: CaretObject(),
+m_numberOfEntries(0)
+{
+
+}
+
+/**
+ * Destructor.
+ */
+GraphicsVolumeScalarCoding::~GraphicsVolumeScalarCoding()
+{
+}
+
+/**
+ * Copy constructor.
+ * @param obj
+ *    Object that is copied.
+ */
+GraphicsVolumeScalarCoding::GraphicsVolumeScalarCoding(const GraphicsVolumeScalarCoding& obj)
+: CaretObject(obj)
+{
+    this->copyHelperGraphicsVolumeScalarCoding(obj);
+}
+
+/**
+ * Assignment operator.
+ * @param obj
+ *    Data copied from obj to this.
+ * @return
+ *    Reference to this object.
+ */
+GraphicsVolumeScalarCoding&
+GraphicsVolumeScalarCoding::operator=(const GraphicsVolumeScalarCoding& obj)
+{
+    if (this != &obj) {
+        CaretObject::operator=(obj);
+        this->copyHelperGraphicsVolumeScalarCoding(obj);
+    }
+    return *this;
+}
+
+/**
+ * Helps with copying an object of this type.
+ * @param obj
+ *    Object that is copied.
+ */
+void
+GraphicsVolumeScalarCoding::copyHelperGraphicsVolumeScalarCoding(const GraphicsVolumeScalarCoding& obj)
+{
+    m_boundaryValues  = obj.m_boundaryValues;
+    m_boundaryEntries = obj.m_boundaryEntries;
+    m_intervals       = obj.m_intervals;
+    m_numberOfEntries = obj.m_numberOfEntries;
+}
+
+/**
+ * Equality operator.
+ * @param obj
+ *    Instance compared to this for equality.
+ * @return
+ *    True if this instance and 'obj' produce the same codes,
+ *    otherwise false.
+ */
+bool
+GraphicsVolumeScalarCoding::operator==(const GraphicsVolumeScalarCoding& obj) const
+{
+    if (this == &obj) {
+        return true;
+    }
+
+    if ((m_numberOfEntries != obj.m_numberOfEntries)
+        || (m_boundaryValues != obj.m_boundaryValues)
+        || (m_intervals.size() != obj.m_intervals.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < m_intervals.size(); i++) {
+        if (m_intervals[i].m_numberOfEntries != obj.m_intervals[i].m_numberOfEntries) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Setup the coding.
+ *
+ * @param boundaryValues
+ *     Values at which coloring may change abruptly.  Values that
+ *     are not finite are ignored and duplicates are removed.
+ * @param varyingRanges
+ *     Ranges (minimum, maximum) in which coloring varies continuously.
+ *     The ends of each range should also be boundary values.
+ * @param numberOfEntries
+ *     Number of entries in the lookup table, must be at least
+ *     twice the number of boundaries plus one.
+ */
+void
+GraphicsVolumeScalarCoding::setup(const std::vector<float>& boundaryValues,
+                                  const std::vector<std::pair<float, float> >& varyingRanges,
+                                  const int32_t numberOfEntries)
+{
+    m_boundaryValues.clear();
+    for (std::vector<float>::const_iterator iter = boundaryValues.begin();
+         iter != boundaryValues.end();
+         iter++) {
+        if (std::isfinite(*iter)) {
+            m_boundaryValues.push_back(*iter);
+        }
+    }
+    std::sort(m_boundaryValues.begin(), m_boundaryValues.end());
+    m_boundaryValues.erase(std::unique(m_boundaryValues.begin(),
+                                       m_boundaryValues.end()),
+                           m_boundaryValues.end());
+
+    const int32_t numberOfBoundaries = static_cast<int32_t>(m_boundaryValues.size());
+    const int32_t numberOfIntervals  = numberOfBoundaries + 1;
+    const int32_t minimumNumberOfEntries = numberOfBoundaries + numberOfIntervals;
+    CaretAssert(numberOfEntries >= minimumNumberOfEntries);
+    CaretAssert(numberOfEntries < 65536);
+    m_numberOfEntries = std::max(numberOfEntries,
+                                 minimumNumberOfEntries);
+
+    /*
+     * Weight of an interval is the fraction of a varying range that it
+     * covers so that each varying range receives an equal share of the
+     * entries.  Intervals outside the varying ranges have constant color.
+     */
+    const double infinity = std::numeric_limits<double>::infinity();
+    m_intervals.resize(numberOfIntervals);
+    std::vector<double> weights(numberOfIntervals, 0.0);
+    double totalWeight = 0.0;
+    for (int32_t i = 0; i < numberOfIntervals; i++) {
+        Interval& interval = m_intervals[i];
+        interval.m_minimumValue = ((i > 0)
+                                   ? m_boundaryValues[i - 1]
+                                   : -infinity);
+        interval.m_maximumValue = ((i < numberOfBoundaries)
+                                   ? m_boundaryValues[i]
+                                   : infinity);
+        interval.m_numberOfEntries = 1;
+
+        if ((i > 0)
+            && (i < numberOfBoundaries)) {
+            for (std::vector<std::pair<float, float> >::const_iterator iter = varyingRanges.begin();
+                 iter != varyingRanges.end();
+                 iter++) {
+                const double rangeMinimum = iter->first;
+                const double rangeMaximum = iter->second;
+                if ((rangeMaximum > rangeMinimum)
+                    && (interval.m_minimumValue >= rangeMinimum)
+                    && (interval.m_maximumValue <= rangeMaximum)) {
+                    weights[i] = ((interval.m_maximumValue - interval.m_minimumValue)
+                                  / (rangeMaximum - rangeMinimum));
+                    totalWeight += weights[i];
+                    break;
+                }
+            }
+        }
+    }
+
+    /*
+     * Divide the remaining entries among the varying intervals.  If there
+     * are none, the extra entries are unused by the interval above the
+     * largest boundary.
+     */
+    const int32_t numberOfExtraEntries = m_numberOfEntries - minimumNumberOfEntries;
+    int32_t extraEntriesRemaining = numberOfExtraEntries;
+    int32_t largestWeightIndex = numberOfIntervals - 1;
+    if (totalWeight > 0.0) {
+        for (int32_t i = 0; i < numberOfIntervals; i++) {
+            const int32_t count = static_cast<int32_t>(std::floor(numberOfExtraEntries
+                                                                  * (weights[i] / totalWeight)));
+            m_intervals[i].m_numberOfEntries += count;
+            extraEntriesRemaining -= count;
+            if (weights[i] > weights[largestWeightIndex]) {
+                largestWeightIndex = i;
+            }
+        }
+    }
+    CaretAssert(extraEntriesRemaining >= 0);
+    m_intervals[largestWeightIndex].m_numberOfEntries += extraEntriesRemaining;
+
+    /*
+     * Entries are in order of value: first interval, first boundary,
+     * second interval, second boundary, ..., last interval
+     */
+    m_boundaryEntries.resize(numberOfBoundaries);
+    int32_t entryIndex = 0;
+    for (int32_t i = 0; i < numberOfIntervals; i++) {
+        m_intervals[i].m_firstEntry = entryIndex;
+        entryIndex += m_intervals[i].m_numberOfEntries;
+        if (i < numberOfBoundaries) {
+            m_boundaryEntries[i] = entryIndex;
+            entryIndex++;
+        }
+    }
+    CaretAssert(entryIndex == m_numberOfEntries);
+}
+
+/**
+ * Get the code for a value.
+ *
+ * @param value
+ *     The value.
+ * @return
+ *     NOT_A_NUMBER_CODE if the value is not a number, else one plus
+ *     the index of the value's entry in the lookup table.  Values
+ *     outside the range of the boundaries use the entry of the
+ *     interval below the smallest or above the largest boundary.
+ */
+uint16_t
+GraphicsVolumeScalarCoding::getCodeForValue(const float value) const
+{
+    CaretAssert(m_numberOfEntries > 0);
+    if (std::isnan(value)) {
+        return NOT_A_NUMBER_CODE;
+    }
+
+    std::vector<float>::const_iterator iter = std::lower_bound(m_boundaryValues.begin(),
+                                                               m_boundaryValues.end(),
+                                                               value);
+    const int32_t index = static_cast<int32_t>(iter - m_boundaryValues.begin());
+    if ((iter != m_boundaryValues.end())
+        && (*iter == value)) {
+        return static_cast<uint16_t>(m_boundaryEntries[index] + 1);
+    }
+
+    CaretAssertVectorIndex(m_intervals, index);
+    const Interval& interval = m_intervals[index];
+    int32_t entryOffset = 0;
+    if ((interval.m_numberOfEntries > 1)
+        && std::isfinite(interval.m_minimumValue)
+        && std::isfinite(interval.m_maximumValue)) {
+        entryOffset = static_cast<int32_t>(((value - interval.m_minimumValue)
+                                            / (interval.m_maximumValue - interval.m_minimumValue))
+                                           * interval.m_numberOfEntries);
+        entryOffset = std::min(std::max(entryOffset, 0),
+                               interval.m_numberOfEntries - 1);
+    }
+
+    return static_cast<uint16_t>(interval.m_firstEntry + entryOffset + 1);
+}
+
+/**
+ * Get the value that is colored for each entry of the lookup table.
+ * An entry in an interval uses the value at the center of the part of
+ * the interval that it covers and a boundary's entry uses the boundary.
+ *
+ * @param entryValuesOut
+ *     Output containing the value for each entry.
+ */
+void
+GraphicsVolumeScalarCoding::getEntryValues(std::vector<float>& entryValuesOut) const
+{
+    entryValuesOut.resize(m_numberOfEntries);
+
+    for (size_t i = 0; i < m_boundaryValues.size(); i++) {
+        CaretAssertVectorIndex(entryValuesOut, m_boundaryEntries[i]);
+        entryValuesOut[m_boundaryEntries[i]] = m_boundaryValues[i];
+    }
+
+    for (std::vector<Interval>::const_iterator iter = m_intervals.begin();
+         iter != m_intervals.end();
+         iter++) {
+        const Interval& interval = *iter;
+        const bool minimumFinite = std::isfinite(interval.m_minimumValue);
+        const bool maximumFinite = std::isfinite(interval.m_maximumValue);
+        const double step = (interval.m_maximumValue - interval.m_minimumValue) / interval.m_numberOfEntries;
+        for (int32_t j = 0; j < interval.m_numberOfEntries; j++) {
+            double value = 0.0;
+            if (minimumFinite
+                && maximumFinite) {
+                value = interval.m_minimumValue + (j + 0.5) * step;
+            }
+            else if (maximumFinite) {
+                value = interval.m_maximumValue - std::max(1.0, std::fabs(interval.m_maximumValue));
+            }
+            else if (minimumFinite) {
+                value = interval.m_minimumValue + std::max(1.0, std::fabs(interval.m_minimumValue));
+            }
+
+            /*
+             * Value must be inside the interval after conversion to float
+             */
+            float entryValue = static_cast<float>(value);
+            if ((entryValue <= interval.m_minimumValue)
+                || (entryValue >= interval.m_maximumValue)) {
+                entryValue = (minimumFinite
+                              ? std::nextafter(static_cast<float>(interval.m_minimumValue),
+                                               std::numeric_limits<float>::infinity())
+                              : std::nextafter(static_cast<float>(interval.m_maximumValue),
+                                               -std::numeric_limits<float>::infinity()));
+            }
+
+            CaretAssertVectorIndex(entryValuesOut, interval.m_firstEntry + j);
+            entryValuesOut[interval.m_firstEntry + j] = entryValue;
+        }
+    }
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+GraphicsVolumeScalarCoding::toString() const
+{
+    return ("GraphicsVolumeScalarCoding: boundaries="
+            + AString::number(m_boundaryValues.size())
+            + " entries="
+            + AString::number(m_numberOfEntries));
+}
@@ -0,0 +1,106 @@
+#ifndef __GRAPHICS_VOLUME_SCALAR_CODING_H__
+#define __GRAPHICS_VOLUME_SCALAR_CODING_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2017 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "CaretObject.h"
+
+
+
+namespace caret {
+
+    class GraphicsVolumeScalarCoding : public CaretObject {
+
+    public:
+        GraphicsVolumeScalarCoding();
+
+        virtual ~GraphicsVolumeScalarCoding();
+
+        GraphicsVolumeScalarCoding(const GraphicsVolumeScalarCoding& obj);
+
+        GraphicsVolumeScalarCoding& operator=(const GraphicsVolumeScalarCoding& obj);
+
+        bool operator==(const GraphicsVolumeScalarCoding& obj) const;
+
+        bool operator!=(const GraphicsVolumeScalarCoding& obj) const { return ! (*this == obj); }
+
+        void setup(const std::vector<float>& boundaryValues,
+                   const std::vector<std::pair<float, float> >& varyingRanges,
+                   const int32_t numberOfEntries);
+
+        /**
+         * @return Number of entries in the lookup table.
+         */
+        int32_t getNumberOfEntries() const { return m_numberOfEntries; }
+
+        uint16_t getCodeForValue(const float value) const;
+
+        void getEntryValues(std::vector<float>& entryValuesOut) const;
+
+        /** Code for a value that is not a number, entry i in the lookup table has code (i + 1) */
+        static const uint16_t NOT_A_NUMBER_CODE;
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        /**
+         * Values between two adjacent boundaries, exclusive of the boundaries.
+         */
+        struct Interval {
+            double m_minimumValue;
+
+            double m_maximumValue;
+
+            int32_t m_firstEntry;
+
+            int32_t m_numberOfEntries;
+        };
+
+        void copyHelperGraphicsVolumeScalarCoding(const GraphicsVolumeScalarCoding& obj);
+
+        /** Sorted boundaries, each boundary value has its own entry */
+        std::vector<float> m_boundaryValues;
+
+        /** Entry for each boundary */
+        std::vector<int32_t> m_boundaryEntries;
+
+        /** Intervals below, between, and above the boundaries */
+        std::vector<Interval> m_intervals;
+
+        int32_t m_numberOfEntries;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_VOLUME_SCALAR_CODING_DECLARE__
+    const uint16_t GraphicsVolumeScalarCoding::NOT_A_NUMBER_CODE = 0;
+#endif // __GRAPHICS_VOLUME_SCALAR_CODING_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_VOLUME_SCALAR_CODING_H__
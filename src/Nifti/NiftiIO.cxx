@@ -74,7 +74,7 @@ int NiftiIO::getNumComponents() const
     return m_header.getNumComponents();
 }
 
-int NiftiIO::numBytesPerElem()
+int NiftiIO::numBytesPerElem() const
 {
     switch (m_header.getDataType())
     {
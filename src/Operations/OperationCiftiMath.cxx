@@ -235,8 +235,9 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
+    vector<float> scratchRow(outDims[0]);
+    vector<const float*> rowPointers(numVars);
+    vector<vector<float> > inputRows(numVars), selectedRows(numVars);//selectedRows holds a row-length copy of the value for -select along row
     vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
     for (int v = 0; v < numVars; ++v)
     {
@@ -267,24 +268,25 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
             if (needToLoad)
             {
                 varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                if (selectInfo[v][0] == -1)//now we check for select along row
+                {
+                    rowPointers[v] = inputRows[v].data();
+                } else {
+                    selectedRows[v].assign(outDims[0], inputRows[v][selectInfo[v][0]]);
+                    rowPointers[v] = selectedRows[v].data();
+                }
             }
         }
-        for (int j = 0; j < outDims[0]; ++j)
+        myExpr.evaluate(rowPointers, outDims[0], scratchRow.data());
+        if (nanfix)
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            for (int j = 0; j < outDims[0]; ++j)
             {
-                if (selectInfo[v][0] == -1)
+                if (scratchRow[j] != scratchRow[j])
                 {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
+                    scratchRow[j] = nanfixval;
                 }
             }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
-            {
-                scratchRow[j] = nanfixval;
-            }
         }
         myCiftiOut->setRow(scratchRow.data(), *iter);
     }
@@ -20,7 +20,9 @@
 /*LICENSE_END*/
 
 #include <cstdio>
+#include <exception>
 #include <fstream>
+#include <map>
 
 #ifdef HAVE_GLEW
 #include <GL/glew.h>
@@ -45,6 +47,7 @@
 #include "EventManager.h"
 #include "FileInformation.h"
 #include "DummyFontTextRenderer.h"
+#include "ElapsedTimer.h"
 #include "FtglFontTextRenderer.h"
 #include "ImageFile.h"
 #include "MapYokingGroupEnum.h"
@@ -172,7 +175,109 @@ OperationShowScene::useParameters(OperationParameters* /*myParams*/,
     throw OperationException("Show scene command not available due to this software version "
                              "not being built with the Mesa OffScreen Library");
 }
+
+/**
+ * Render scene jobs (not available without the Mesa OffScreen Library).
+ */
+void
+OperationShowScene::renderSceneJobs(const std::vector<SceneJob>& /*jobs*/,
+                                    const bool /*useWindowSizeForImageSizeFlag*/,
+                                    const bool /*doNotUseSceneColorsFlag*/,
+                                    const MapYokingGroupEnum::Enum /*mapYokingGroup*/,
+                                    const int32_t /*mapYokingMapIndex*/,
+                                    const bool /*continueAfterFailureFlag*/,
+                                    std::vector<SceneJobResult>& /*resultsOut*/)
+{
+    throw OperationException("Show scene command not available due to this software version "
+                             "not being built with the Mesa OffScreen Library");
+}
 #else // HAVE_OSMESA
+
+/**
+ * Mesa context, image buffer, and OpenGL rendering that are created
+ * once and reused for every window of every scene that is rendered.
+ */
+struct OperationShowScene::OffScreenContext {
+    OffScreenContext()
+    : m_mesaContext(0),
+    m_imageWidth(0),
+    m_imageHeight(0) { }
+    
+    ~OffScreenContext() {
+        /*
+         * OpenGL must be destroyed while its context is still valid
+         */
+        m_brainOpenGL.grabNew(NULL);
+        if (m_mesaContext != 0) {
+            OSMesaDestroyContext(m_mesaContext);
+        }
+    }
+    
+    /**
+     * Make the context current with an image buffer of the given size,
+     * creating the context and OpenGL the first time.
+     */
+    void makeCurrent(const int32_t imageWidth,
+                     const int32_t imageHeight) {
+        if (m_mesaContext == 0) {
+            //
+            // Create the Mesa Context
+            //
+            const int depthBits = 16;
+            const int stencilBits = 0;
+            const int accumBits = 0;
+            m_mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
+                                                   depthBits,
+                                                   stencilBits,
+                                                   accumBits,
+                                                   NULL);
+            if (m_mesaContext == 0) {
+                throw OperationException("Creating Mesa Context failed.");
+            }
+        }
+        
+        //
+        // Allocate image buffer
+        //
+        const int64_t imageBufferSize = (static_cast<int64_t>(imageWidth) * imageHeight * 4 * sizeof(unsigned char));
+        try {
+            m_imageBuffer.resize(imageBufferSize);
+        }
+        catch (const std::bad_alloc&) {
+            throw OperationException("Allocating image buffer size="
+                                     + AString::number(imageBufferSize)
+                                     + " failed.");
+        }
+        m_imageWidth  = imageWidth;
+        m_imageHeight = imageHeight;
+        
+        //
+        // Assign buffer to Mesa Context and make current
+        //
+        if (OSMesaMakeCurrent(m_mesaContext,
+                              &m_imageBuffer[0],
+                              GL_UNSIGNED_BYTE,
+                              imageWidth,
+                              imageHeight) == 0) {
+            throw OperationException("Assigning buffer to context and make current failed.");
+        }
+        
+        if (m_brainOpenGL == NULL) {
+            m_brainOpenGL.grabNew(createBrainOpenGL());
+        }
+    }
+    
+    OSMesaContext m_mesaContext;
+    
+    std::vector<unsigned char> m_imageBuffer;
+    
+    int32_t m_imageWidth;
+    
+    int32_t m_imageHeight;
+    
+    CaretPointer<BrainOpenGL> m_brainOpenGL;
+};
+
 void
 OperationShowScene::useParameters(OperationParameters* myParams,
                                   ProgressObject* myProgObj)
@@ -221,20 +326,159 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         }
     }
     
+    std::vector<SceneJob> jobs;
+    jobs.push_back(SceneJob(sceneFileName,
+                            sceneNameOrNumber,
+                            imageFileName,
+                            userImageWidth,
+                            userImageHeight));
+    
+    std::vector<SceneJobResult> results;
+    renderSceneJobs(jobs,
+                    useWindowSizeForImageSizeFlag,
+                    doNotUseSceneColorsFlag,
+                    mapYokingGroup,
+                    mapYokingMapIndex,
+                    false,
+                    results);
+}
+
+/**
+ * Render scenes into image files.  Scene files are read once and data
+ * files that remain in memory from a previously rendered scene are reused
+ * by the next scene (see Brain::resetBrainKeepSceneFiles()).  The Mesa
+ * context and the OpenGL rendering are created once for all jobs.
+ *
+ * @param jobs
+ *     The scenes and their image files.
+ * @param useWindowSizeForImageSizeFlag
+ *     If true, use the window size in the scene for the image size.
+ * @param doNotUseSceneColorsFlag
+ *     If true, do not use the background and foreground colors in the scene.
+ * @param mapYokingGroup
+ *     Map yoking group whose selected map is overridden.
+ * @param mapYokingMapIndex
+ *     Map index for the map yoking group.
+ * @param continueAfterFailureFlag
+ *     If true, a failed job is recorded in its result and remaining jobs
+ *     are rendered.  Otherwise, the first failure is thrown.
+ * @param resultsOut
+ *     Output containing timing and any error for each job.
+ * @throw OperationException
+ *     If a job fails and continuing after failure is off.
+ */
+void
+OperationShowScene::renderSceneJobs(const std::vector<SceneJob>& jobs,
+                                    const bool useWindowSizeForImageSizeFlag,
+                                    const bool doNotUseSceneColorsFlag,
+                                    const MapYokingGroupEnum::Enum mapYokingGroup,
+                                    const int32_t mapYokingMapIndex,
+                                    const bool continueAfterFailureFlag,
+                                    std::vector<SceneJobResult>& resultsOut)
+{
+    resultsOut.clear();
+    resultsOut.resize(jobs.size());
+    
     /*
-     * Read the scene file and load the scene
+     * Enable voxel coloring since it is defaulted off for commands
      */
-    SceneFile sceneFile;
-    sceneFile.readFile(sceneFileName);
-    Scene* scene = sceneFile.getSceneWithName(sceneNameOrNumber);
+    VolumeFile::setVoxelColoringEnabled(true);
+    
+    std::map<AString, CaretPointer<SceneFile> > sceneFiles;
+    OffScreenContext offScreenContext;
+    
+    const int32_t numberOfJobs = static_cast<int32_t>(jobs.size());
+    for (int32_t iJob = 0; iJob < numberOfJobs; iJob++) {
+        const SceneJob& job = jobs[iJob];
+        SceneJobResult& result = resultsOut[iJob];
+        
+        ElapsedTimer totalTimer;
+        totalTimer.start();
+        
+        CaretLogInfo("Rendering job "
+                     + AString::number(iJob + 1)
+                     + " of "
+                     + AString::number(numberOfJobs)
+                     + ": scene "
+                     + job.m_sceneNameOrNumber
+                     + " from "
+                     + job.m_sceneFileName);
+        
+        try {
+            /*
+             * Read the scene file unless it was read by a previous job
+             */
+            const AString sceneFileName = FileInformation(job.m_sceneFileName).getAbsoluteFilePath();
+            std::map<AString, CaretPointer<SceneFile> >::iterator sceneFileIter = sceneFiles.find(sceneFileName);
+            if (sceneFileIter == sceneFiles.end()) {
+                ElapsedTimer readTimer;
+                readTimer.start();
+                CaretPointer<SceneFile> sceneFile(new SceneFile());
+                try {
+                    sceneFile->readFile(sceneFileName);
+                }
+                catch (const DataFileException& dfe) {
+                    throw OperationException(dfe);
+                }
+                sceneFileIter = sceneFiles.insert(std::make_pair(sceneFileName,
+                                                                 sceneFile)).first;
+                result.m_sceneFileReadSeconds = readTimer.getElapsedTimeSeconds();
+            }
+            
+            renderSceneJob(job,
+                           sceneFileIter->second,
+                           useWindowSizeForImageSizeFlag,
+                           doNotUseSceneColorsFlag,
+                           mapYokingGroup,
+                           mapYokingMapIndex,
+                           offScreenContext,
+                           result);
+        }
+        catch (const CaretException& ce) {
+            if ( ! continueAfterFailureFlag) {
+                throw;
+            }
+            result.m_errorMessage = ce.whatString();
+        }
+        catch (const std::exception& e) {
+            /*
+             * Such as std::bad_alloc from a large image, the remaining jobs may still succeed
+             */
+            if ( ! continueAfterFailureFlag) {
+                throw;
+            }
+            result.m_errorMessage = e.what();
+        }
+        
+        result.m_totalSeconds = totalTimer.getElapsedTimeSeconds();
+    }
+}
+
+/**
+ * Find a scene in a scene file.
+ *
+ * @param sceneFile
+ *     The scene file.
+ * @param sceneNameOrNumber
+ *     Name or number (starting at one) of the scene.
+ * @return
+ *     The scene.
+ * @throw OperationException
+ *     If the scene is not found.
+ */
+Scene*
+OperationShowScene::findScene(SceneFile* sceneFile,
+                              const AString& sceneNameOrNumber)
+{
+    Scene* scene = sceneFile->getSceneWithName(sceneNameOrNumber);
     if (scene == NULL) {
         bool valid = false;
         const int32_t sceneIndexStartAtOne = sceneNameOrNumber.toInt(&valid);
         if (valid) {
             const int32_t sceneIndex = sceneIndexStartAtOne - 1;
             if ((sceneIndex >= 0)
-                && (sceneIndex < sceneFile.getNumberOfScenes())) {
-                scene = sceneFile.getSceneAtIndex(sceneIndex);
+                && (sceneIndex < sceneFile->getNumberOfScenes())) {
+                scene = sceneFile->getSceneAtIndex(sceneIndex);
             }
             else {
                 throw OperationException("Scene index is invalid");
@@ -244,12 +488,53 @@ OperationShowScene::useParameters(OperationParameters* myParams,
             throw OperationException("Scene name is invalid");
         }
     }
+    
+    return scene;
+}
 
-    /*
-     * Enable voxel coloring since it is defaulted off for commands
-     */
-    VolumeFile::setVoxelColoringEnabled(true);
+/**
+ * Restore a scene and render its windows into image files.
+ *
+ * @param job
+ *     The scene and its image file.
+ * @param sceneFile
+ *     Scene file containing the scene.
+ * @param useWindowSizeForImageSizeFlag
+ *     If true, use the window size in the scene for the image size.
+ * @param doNotUseSceneColorsFlag
+ *     If true, do not use the background and foreground colors in the scene.
+ * @param mapYokingGroup
+ *     Map yoking group whose selected map is overridden.
+ * @param mapYokingMapIndex
+ *     Map index for the map yoking group.
+ * @param offScreenContext
+ *     Context used for rendering.
+ * @param resultOut
+ *     Output with timing of the job.
+ * @throw OperationException
+ *     If the scene fails to render.
+ */
+void
+OperationShowScene::renderSceneJob(const SceneJob& job,
+                                   SceneFile* sceneFile,
+                                   const bool useWindowSizeForImageSizeFlag,
+                                   const bool doNotUseSceneColorsFlag,
+                                   const MapYokingGroupEnum::Enum mapYokingGroup,
+                                   const int32_t mapYokingMapIndex,
+                                   OffScreenContext& offScreenContext,
+                                   SceneJobResult& resultOut)
+{
+    const AString useWindowSizeSwitch("-use-window-size");
+    const AString imageFileName = FileInformation(job.m_imageFileName).getAbsoluteFilePath();
+    const int32_t userImageWidth  = job.m_imageWidth;
+    const int32_t userImageHeight = job.m_imageHeight;
+    
+    ElapsedTimer timer;
+    timer.start();
     
+    Scene* scene = findScene(sceneFile,
+                             job.m_sceneNameOrNumber);
+
     SceneAttributes sceneAttributes(SceneTypeEnum::SCENE_TYPE_FULL);
     
     if (doNotUseSceneColorsFlag) {
@@ -297,6 +582,8 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         EventManager::get()->sendEvent(yokeEvent.getPointer());
     }
     
+    resultOut.m_sceneRestoreSeconds = timer.getElapsedTimeSeconds();
+    
     /*
      * Restore windows
      */
@@ -304,6 +591,8 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     if (browserWindowArray != NULL) {
         const int32_t numBrowserClasses = browserWindowArray->getNumberOfArrayElements();
         for (int32_t i = 0; i < numBrowserClasses; i++) {
+            timer.reset();
+            
             const SceneClass* browserClass = browserWindowArray->getClassAtIndex(i);
             
             const bool restoreToTabTiles = browserClass->getBooleanValue("m_viewTileTabsAction",
@@ -332,7 +621,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     if ((imageWidth <= 0)
                         || (imageHeight <= 0)) {
                         const QString msg("Option "
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + useWindowSizeSwitch
                                           + " is used but window size not found in scene and width="
                                           + QString::number(imageWidth)
                                           + " height="
@@ -344,7 +633,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                     
                     if ( ! missingWindowMessageHasBeenDisplayed) {
                         const QString msg("Option \""
-                                          + useWindowSizeParam->m_optionSwitch
+                                          + useWindowSizeSwitch
                                           + "\" is used but window size not found in scene.\n"
                                           "   Scene was created prior to implementation of this option.\n"
                                           "   Image size will be width="
@@ -384,48 +673,22 @@ OperationShowScene::useParameters(OperationParameters* myParams,
             const int windowHeight = windowViewport[3];
             
             //
-            // Create the Mesa Context
+            // Make the Mesa Context current with a buffer for the image
             //
-            const int depthBits = 16;
-            const int stencilBits = 0;
-            const int accumBits = 0;
-            OSMesaContext mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
-                                                               depthBits,
-                                                               stencilBits,
-                                                               accumBits,
-                                                               NULL);
-            if (mesaContext == 0) {
-                throw ("Creating Mesa Context failed.");
-            }
+            offScreenContext.makeCurrent(imageWidth,
+                                         imageHeight);
+            BrainOpenGL* brainOpenGL = offScreenContext.m_brainOpenGL;
+            const unsigned char* imageBuffer = &offScreenContext.m_imageBuffer[0];
+            OSMesaContext mesaContext = offScreenContext.m_mesaContext;
             
-            //
-            // Allocate image buffer
-            //
-            const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
-            unsigned char* imageBuffer = new unsigned char[imageBufferSize];
-            if (imageBuffer == 0) {
-                throw OperationException("Allocating image buffer size="
-                                         + QString::number(imageBufferSize)
-                                         + " failed.");
-            }
-            
-            //
-            // Assign buffer to Mesa Context and make current
-            //
-            if (OSMesaMakeCurrent(mesaContext,
-                                  imageBuffer,
-                                  GL_UNSIGNED_BYTE,
-                                  imageWidth,
-                                  imageHeight) == 0) {
-                throw OperationException("Assigning buffer to context and make current failed.");
-            }
+            const int32_t outputImageIndex = ((numBrowserClasses > 1)
+                                              ? i
+                                              : -1);
             
             /*
              * If tile tabs was saved to the scene, restore it as the scenes tile tabs configuration
              */
             if (restoreToTabTiles) {
-                CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-                
                 const AString tileTabsConfigString = browserClass->getStringValue("m_sceneTileTabsConfiguration");
                 if ( ! tileTabsConfigString.isEmpty()) {
                     TileTabsConfiguration tileTabsConfiguration;
@@ -487,22 +750,24 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                 mesaContext,
                                                 viewports);
                         
-                        const int32_t outputImageIndex = ((numBrowserClasses > 1)
-                                                          ? i
-                                                          : -1);
+                        for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
+                             vpIter != viewports.end();
+                             vpIter++) {
+                            delete *vpIter;
+                        }
+                        viewports.clear();
+                        
+                        resultOut.m_renderSeconds += timer.getElapsedTimeSeconds();
+                        timer.reset();
                         
                         writeImage(imageFileName,
                                    outputImageIndex,
                                    imageBuffer,
                                    imageWidth,
                                    imageHeight);
+                        resultOut.m_numberOfImages++;
                         
-                        for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
-                             vpIter != viewports.end();
-                             vpIter++) {
-                            delete *vpIter;
-                        }
-                        viewports.clear();
+                        resultOut.m_imageWriteSeconds += timer.getElapsedTimeSeconds();
                     }
                 }
                 else {
@@ -510,8 +775,6 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                 }
             }
             else {
-                CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-                
                 /*
                  * Restore toolbar
                  */
@@ -545,24 +808,19 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                             mesaContext,
                                             viewportContents);
                     
-                    const int32_t outputImageIndex = ((numBrowserClasses > 1)
-                                                      ? i
-                                                      : -1);
+                    resultOut.m_renderSeconds += timer.getElapsedTimeSeconds();
+                    timer.reset();
                     
                     writeImage(imageFileName,
                                outputImageIndex,
                                imageBuffer,
                                imageWidth,
                                imageHeight);
+                    resultOut.m_numberOfImages++;
                     
+                    resultOut.m_imageWriteSeconds += timer.getElapsedTimeSeconds();
                 }
             }
-            
-            /*
-             * Free image memory and Mesa context
-             */
-            delete[] imageBuffer;
-            OSMesaDestroyContext(mesaContext);
         }
     }
 
@@ -22,11 +22,16 @@
 /*LICENSE_END*/
 
 
+#include <vector>
+
 #include "AbstractOperation.h"
+#include "MapYokingGroupEnum.h"
 
 namespace caret {
 
     class BrainOpenGLFixedPipeline;
+    class Scene;
+    class SceneFile;
     
     class OperationShowScene : public AbstractOperation {
 
@@ -42,7 +47,81 @@ namespace caret {
 
         static bool isShowSceneCommandAvailable();
         
+        /** A scene that is rendered into image file(s) */
+        struct SceneJob {
+            SceneJob(const AString& sceneFileName,
+                     const AString& sceneNameOrNumber,
+                     const AString& imageFileName,
+                     const int32_t imageWidth,
+                     const int32_t imageHeight)
+            : m_sceneFileName(sceneFileName),
+            m_sceneNameOrNumber(sceneNameOrNumber),
+            m_imageFileName(imageFileName),
+            m_imageWidth(imageWidth),
+            m_imageHeight(imageHeight) { }
+            
+            AString m_sceneFileName;
+            
+            AString m_sceneNameOrNumber;
+            
+            AString m_imageFileName;
+            
+            int32_t m_imageWidth;
+            
+            int32_t m_imageHeight;
+        };
+        
+        /** Time spent on and outcome of a scene job */
+        struct SceneJobResult {
+            SceneJobResult()
+            : m_sceneFileReadSeconds(0.0),
+            m_sceneRestoreSeconds(0.0),
+            m_renderSeconds(0.0),
+            m_imageWriteSeconds(0.0),
+            m_totalSeconds(0.0),
+            m_numberOfImages(0) { }
+            
+            /** Zero when the scene file was read by a previous job */
+            double m_sceneFileReadSeconds;
+            
+            /** Includes reading data files not in memory from a previous job */
+            double m_sceneRestoreSeconds;
+            
+            double m_renderSeconds;
+            
+            double m_imageWriteSeconds;
+            
+            double m_totalSeconds;
+            
+            int32_t m_numberOfImages;
+            
+            /** Empty if the job was successful */
+            AString m_errorMessage;
+        };
+        
+        static void renderSceneJobs(const std::vector<SceneJob>& jobs,
+                                    const bool useWindowSizeForImageSizeFlag,
+                                    const bool doNotUseSceneColorsFlag,
+                                    const MapYokingGroupEnum::Enum mapYokingGroup,
+                                    const int32_t mapYokingMapIndex,
+                                    const bool continueAfterFailureFlag,
+                                    std::vector<SceneJobResult>& resultsOut);
+        
     private:
+        struct OffScreenContext;
+        
+        static Scene* findScene(SceneFile* sceneFile,
+                                const AString& sceneNameOrNumber);
+        
+        static void renderSceneJob(const SceneJob& job,
+                                   SceneFile* sceneFile,
+                                   const bool useWindowSizeForImageSizeFlag,
+                                   const bool doNotUseSceneColorsFlag,
+                                   const MapYokingGroupEnum::Enum mapYokingGroup,
+                                   const int32_t mapYokingMapIndex,
+                                   OffScreenContext& offScreenContext,
+                                   SceneJobResult& resultOut);
+        
         static BrainOpenGLFixedPipeline* createBrainOpenGL();
         
         static void writeImage(const AString& imageFileName,
@@ -0,0 +1,255 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include <QStringList>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "FileInformation.h"
+#include "MapYokingGroupEnum.h"
+#include "OperationException.h"
+#include "OperationShowScene.h"
+#include "OperationShowSceneBatch.h"
+
+using namespace caret;
+
+/**
+ * \class caret::OperationShowSceneBatch 
+ * \brief Offscreen rendering of many scenes to image files
+ *
+ * Render a list of scenes into image files using the Offscreen Mesa Library
+ * while reusing data files, scene files, and the rendering context
+ * among the scenes.
+ */
+
+/**
+ * @return Command line switch
+ */
+AString
+OperationShowSceneBatch::getCommandSwitch()
+{
+    return "-show-scene-batch";
+}
+
+/**
+ * @return Short description of operation
+ */
+AString
+OperationShowSceneBatch::getShortDescription()
+{
+    return ("OFFSCREEN RENDERING OF MANY SCENES TO IMAGE FILES");
+}
+
+/**
+ * @return Parameters for operation
+ */
+OperationParameters*
+OperationShowSceneBatch::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    
+    ret->addStringParameter(1, "job-file", "text file listing the scenes to render");
+    
+    ret->createOptionalParameter(2, "-use-window-size", "Override image size with window size");
+    
+    ret->createOptionalParameter(3, "-no-scene-colors", "Do not use background and foreground colors in scene");
+    
+    OptionalParameter* reportOpt = ret->createOptionalParameter(4, "-timing-report", "write the time spent on each job to a file instead of the standard output");
+    reportOpt->addStringParameter(1, "report-file", "output - comma separated values text file");
+    
+    ret->setHelpText(AString("Render many scenes, as in -show-scene, with one command.  ")
+                     + "Each line of the job file describes one job with five fields separated by tabs: "
+                     + "scene file, scene name or number (starting at one), image file name, image width, and image height.  "
+                     + "Empty lines and lines starting with '#' are ignored.  "
+                     + "The image file name is handled as in -show-scene.\n\n"
+                     + "Jobs are rendered in the order listed.  "
+                     + "Each scene file is read once, and data files loaded for a scene are reused by "
+                     + "the next scene that uses the same files, so listing jobs that use the same data "
+                     + "next to each other is fastest.  "
+                     + "Since all jobs share the loaded data, jobs are rendered one at a time; "
+                     + "to use more processors, divide the jobs among job files and run a command for each.\n\n"
+                     + "A failed job does not stop the remaining jobs.  "
+                     + "The timing report contains, for each job, the seconds spent reading the scene file, "
+                     + "restoring the scene (including reading data files), rendering, and writing images, "
+                     + "and any error.  The command fails after all jobs finish if any job failed.");
+    
+    return ret;
+}
+
+/**
+ * Use Parameters and perform operation
+ */
+void
+OperationShowSceneBatch::useParameters(OperationParameters* myParams,
+                                       ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    const AString jobFileName = myParams->getString(1);
+    const bool useWindowSizeForImageSizeFlag = myParams->getOptionalParameter(2)->m_present;
+    const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(3)->m_present;
+    OptionalParameter* reportOpt = myParams->getOptionalParameter(4);
+    
+    if ( ! OperationShowScene::isShowSceneCommandAvailable()) {
+        throw OperationException("Show scene command not available due to this software version "
+                                 "not being built with the Mesa OffScreen Library");
+    }
+    
+    /*
+     * Read the jobs
+     */
+    std::ifstream jobFile(jobFileName.toLocal8Bit().constData());
+    if ( ! jobFile.good()) {
+        throw OperationException("failed to open job file '" + jobFileName + "'");
+    }
+    std::vector<OperationShowScene::SceneJob> jobs;
+    std::string jobLine;
+    int64_t lineNumber = 0;
+    while (std::getline(jobFile, jobLine)) {
+        lineNumber++;
+        const AString line = AString(jobLine.c_str()).trimmed();
+        if (line.isEmpty()
+            || line.startsWith("#")) {
+            continue;
+        }
+        
+        const QStringList fields = line.split('\t', QString::SkipEmptyParts);
+        if (fields.size() != 5) {
+            throw OperationException("job file line "
+                                     + AString::number(lineNumber)
+                                     + " has "
+                                     + AString::number(fields.size())
+                                     + " tab separated fields, 5 are required");
+        }
+        bool widthValid  = false;
+        bool heightValid = false;
+        const int32_t imageWidth  = fields[3].trimmed().toInt(&widthValid);
+        const int32_t imageHeight = fields[4].trimmed().toInt(&heightValid);
+        if (( ! widthValid)
+            || ( ! heightValid)) {
+            throw OperationException("job file line "
+                                     + AString::number(lineNumber)
+                                     + " has an invalid image width or height");
+        }
+        if ( ! useWindowSizeForImageSizeFlag) {
+            if ((imageWidth <= 0)
+                || (imageHeight <= 0)) {
+                throw OperationException("job file line "
+                                         + AString::number(lineNumber)
+                                         + " has invalid image size width="
+                                         + AString::number(imageWidth)
+                                         + " height="
+                                         + AString::number(imageHeight));
+            }
+        }
+        
+        jobs.push_back(OperationShowScene::SceneJob(FileInformation(fields[0].trimmed()).getAbsoluteFilePath(),
+                                                    fields[1].trimmed(),
+                                                    FileInformation(fields[2].trimmed()).getAbsoluteFilePath(),
+                                                    imageWidth,
+                                                    imageHeight));
+    }
+    if (jobs.empty()) {
+        throw OperationException("job file '" + jobFileName + "' contains no jobs");
+    }
+    
+    /*
+     * Render the jobs
+     */
+    std::vector<OperationShowScene::SceneJobResult> results;
+    OperationShowScene::renderSceneJobs(jobs,
+                                        useWindowSizeForImageSizeFlag,
+                                        doNotUseSceneColorsFlag,
+                                        MapYokingGroupEnum::MAP_YOKING_GROUP_OFF,
+                                        -1,
+                                        true,
+                                        results);
+    CaretAssert(results.size() == jobs.size());
+    
+    /*
+     * Report time spent on each job
+     */
+    std::ofstream reportFile;
+    if (reportOpt->m_present) {
+        const AString reportFileName = reportOpt->getString(1);
+        reportFile.open(reportFileName.toLocal8Bit().constData());
+        if ( ! reportFile.good()) {
+            throw OperationException("failed to open report file '" + reportFileName + "'");
+        }
+    }
+    std::ostream& report = (reportOpt->m_present
+                            ? static_cast<std::ostream&>(reportFile)
+                            : std::cout);
+    report << "job,scene file,scene,image file,images,read scene file seconds,restore scene seconds,"
+           << "render seconds,write image seconds,total seconds,error" << std::endl;
+    
+    int64_t numberOfFailedJobs = 0;
+    double totalSeconds = 0.0;
+    const int64_t numberOfJobs = static_cast<int64_t>(jobs.size());
+    for (int64_t i = 0; i < numberOfJobs; i++) {
+        const OperationShowScene::SceneJob& job = jobs[i];
+        const OperationShowScene::SceneJobResult& result = results[i];
+        
+        /*
+         * Quote text fields since they may contain commas
+         */
+        AString errorMessage = result.m_errorMessage;
+        errorMessage.replace("\"", "\"\"");
+        errorMessage.replace("\n", " ");
+        AString sceneName = job.m_sceneNameOrNumber;
+        sceneName.replace("\"", "\"\"");
+        report << (i + 1)
+               << ",\"" << job.m_sceneFileName << "\""
+               << ",\"" << sceneName << "\""
+               << ",\"" << job.m_imageFileName << "\""
+               << "," << result.m_numberOfImages
+               << "," << result.m_sceneFileReadSeconds
+               << "," << result.m_sceneRestoreSeconds
+               << "," << result.m_renderSeconds
+               << "," << result.m_imageWriteSeconds
+               << "," << result.m_totalSeconds
+               << ",\"" << errorMessage << "\"" << std::endl;
+        
+        if ( ! result.m_errorMessage.isEmpty()) {
+            numberOfFailedJobs++;
+            CaretLogWarning("Job "
+                            + AString::number(i + 1)
+                            + " failed: "
+                            + result.m_errorMessage);
+        }
+        totalSeconds += result.m_totalSeconds;
+    }
+    CaretLogInfo("Rendered "
+                 + AString::number(numberOfJobs - numberOfFailedJobs)
+                 + " of "
+                 + AString::number(numberOfJobs)
+                 + " jobs in "
+                 + AString::number(totalSeconds, 'f', 2)
+                 + " seconds");
+    
+    if (numberOfFailedJobs > 0) {
+        throw OperationException(AString::number(numberOfFailedJobs)
+                                 + " of "
+                                 + AString::number(numberOfJobs)
+                                 + " jobs failed");
+    }
+}
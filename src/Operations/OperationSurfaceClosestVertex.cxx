@@ -21,6 +21,7 @@
 #include "OperationSurfaceClosestVertex.h"
 #include "OperationException.h"
 
+#include "CaretPointLocator.h"
 #include "SurfaceFile.h"
 
 #include <fstream>
@@ -84,9 +85,10 @@ void OperationSurfaceClosestVertex::useParameters(OperationParameters* myParams,
     {
         throw OperationException("did not find any coordinates in file, make sure you use only whitespace to separate numbers");
     }
-    for (int i = 0; i < (int)coords.size(); i += 3)
+    vector<int64_t> nodes;
+    mySurf->getPointLocator()->closestPoints(coords.data(), coords.size() / 3, nodes);//all at once, in parallel
+    for (int i = 0; i < (int)nodes.size(); ++i)
     {
-        int node = mySurf->closestNode(coords.data() + i);
-        nodeFile << node << endl;
+        nodeFile << nodes[i] << endl;
     }
 }
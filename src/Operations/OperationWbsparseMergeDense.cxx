@@ -46,8 +46,12 @@ OperationParameters* OperationWbsparseMergeDense::getParameters()
     ParameterComponent* wbsparseOpt = ret->createRepeatableParameter(3, "-wbsparse", "specify an input wbsparse file");
     wbsparseOpt->addStringParameter(1, "wbsparse-in", "a wbsparse file to merge");
     
+    ret->createOptionalParameter(4, "-legacy-format", "write the larger version 1 format, for older versions of workbench");
+    
     ret->setHelpText(
-        AString("The input wbsparse files must have matching mappings along the direction not specified, and the mapping along the specified direction must be brain models.")
+        AString("The input wbsparse files must have matching mappings along the direction not specified, and the mapping along the specified direction must be brain models.  ") +
+        "The inputs can be in either wbsparse format version.  " +
+        "By default, the output uses the compact version 2 format, which older versions of workbench can't read."
     );
     return ret;
 }
@@ -152,7 +156,9 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     int numOutModels = (int)sourceWbsparse.size();
     CaretAssert(numOutModels == (int)newDenseMap.getModelInfo().size());
     int64_t outColSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    CaretSparseFileWriter myWriter(outputName, outXML);
+    int outVersion = 2;
+    if (myParams->getOptionalParameter(4)->m_present) outVersion = 1;
+    CaretSparseFileWriter myWriter(outputName, outXML, outVersion);
     vector<CiftiBrainModelsMap::ModelInfo> outModelInfo = newDenseMap.getModelInfo();
     switch (myDir)
     {
@@ -1600,39 +1600,11 @@ PaletteColorMapping::mapDataToPaletteNormalizedValues(const FastStatistics* stat
     float mappingLeastNegative = 0.0;
     float mappingLeastPositive  = 0.0;
     float mappingMostPositive  = 0.0;
-    switch (this->getScaleMode()) {
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE:
-            statistics->getNonzeroRanges(mappingMostNegative, mappingLeastNegative, mappingLeastPositive, mappingMostPositive);
-            break;
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE_ABSOLUTE_PERCENTAGE:
-        {
-            const float mostPercentage  = this->getAutoScaleAbsolutePercentageMaximum();
-            const float leastPercentage = this->getAutoScaleAbsolutePercentageMinimum();
-            mappingMostNegative  = -statistics->getApproxAbsolutePercentile(mostPercentage);
-            mappingLeastNegative = -statistics->getApproxAbsolutePercentile(leastPercentage);
-            mappingLeastPositive =  statistics->getApproxAbsolutePercentile(leastPercentage);
-            mappingMostPositive  =  statistics->getApproxAbsolutePercentile(mostPercentage);
-        }
-            break;
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE:
-        {
-            const float mostNegativePercentage  = this->getAutoScalePercentageNegativeMaximum();
-            const float leastNegativePercentage = this->getAutoScalePercentageNegativeMinimum();
-            const float leastPositivePercentage = this->getAutoScalePercentagePositiveMinimum();
-            const float mostPositivePercentage  = this->getAutoScalePercentagePositiveMaximum();
-            mappingMostNegative  = statistics->getApproxNegativePercentile(mostNegativePercentage);
-            mappingLeastNegative = statistics->getApproxNegativePercentile(leastNegativePercentage);
-            mappingLeastPositive = statistics->getApproxPositivePercentile(leastPositivePercentage);
-            mappingMostPositive  = statistics->getApproxPositivePercentile(mostPositivePercentage);
-        }
-            break;
-        case PaletteScaleModeEnum::MODE_USER_SCALE:
-            mappingMostNegative  = this->getUserScaleNegativeMaximum();
-            mappingLeastNegative = this->getUserScaleNegativeMinimum();
-            mappingLeastPositive = this->getUserScalePositiveMinimum();
-            mappingMostPositive  = this->getUserScalePositiveMaximum();
-            break;
-    }
+    getPaletteMappingValues(statistics,
+                            mappingMostNegative,
+                            mappingLeastNegative,
+                            mappingLeastPositive,
+                            mappingMostPositive);
     //TSC: the excluded zone of normalization is a SEPARATE issue to zero detection in the data
     //specifically, it is a HACK, in order for palettes to be able to specify a special color for data that is 0, which is not involved in color interpolation
     const float PALETTE_ZERO_COLOR_ZONE = 0.00001f;
@@ -1685,6 +1657,68 @@ PaletteColorMapping::mapDataToPaletteNormalizedValues(const FastStatistics* stat
     }
 }
 
+/**
+ * Get the data values that are mapped to the ends of the palette's
+ * negative and positive ranges using the settings in this palette
+ * color mapping.
+ *
+ * @param statistics
+ *    Statistics containing min.max values.
+ * @param mostNegativeOut
+ *    Value mapped to -1.0.
+ * @param leastNegativeOut
+ *    Value mapped to the negative end nearest zero.
+ * @param leastPositiveOut
+ *    Value mapped to the positive end nearest zero.
+ * @param mostPositiveOut
+ *    Value mapped to 1.0.
+ */
+void
+PaletteColorMapping::getPaletteMappingValues(const FastStatistics* statistics,
+                                             float& mostNegativeOut,
+                                             float& leastNegativeOut,
+                                             float& leastPositiveOut,
+                                             float& mostPositiveOut) const
+{
+    mostNegativeOut  = 0.0;
+    leastNegativeOut = 0.0;
+    leastPositiveOut = 0.0;
+    mostPositiveOut  = 0.0;
+    switch (this->getScaleMode()) {
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE:
+            statistics->getNonzeroRanges(mostNegativeOut, leastNegativeOut, leastPositiveOut, mostPositiveOut);
+            break;
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE_ABSOLUTE_PERCENTAGE:
+        {
+            const float mostPercentage  = this->getAutoScaleAbsolutePercentageMaximum();
+            const float leastPercentage = this->getAutoScaleAbsolutePercentageMinimum();
+            mostNegativeOut  = -statistics->getApproxAbsolutePercentile(mostPercentage);
+            leastNegativeOut = -statistics->getApproxAbsolutePercentile(leastPercentage);
+            leastPositiveOut =  statistics->getApproxAbsolutePercentile(leastPercentage);
+            mostPositiveOut  =  statistics->getApproxAbsolutePercentile(mostPercentage);
+        }
+            break;
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE:
+        {
+            const float mostNegativePercentage  = this->getAutoScalePercentageNegativeMaximum();
+            const float leastNegativePercentage = this->getAutoScalePercentageNegativeMinimum();
+            const float leastPositivePercentage = this->getAutoScalePercentagePositiveMinimum();
+            const float mostPositivePercentage  = this->getAutoScalePercentagePositiveMaximum();
+            mostNegativeOut  = statistics->getApproxNegativePercentile(mostNegativePercentage);
+            leastNegativeOut = statistics->getApproxNegativePercentile(leastNegativePercentage);
+            leastPositiveOut = statistics->getApproxPositivePercentile(leastPositivePercentage);
+            mostPositiveOut  = statistics->getApproxPositivePercentile(mostPositivePercentage);
+        }
+            break;
+        case PaletteScaleModeEnum::MODE_USER_SCALE:
+            mostNegativeOut  = this->getUserScaleNegativeMaximum();
+            leastNegativeOut = this->getUserScaleNegativeMinimum();
+            leastPositiveOut = this->getUserScalePositiveMinimum();
+            mostPositiveOut  = this->getUserScalePositiveMaximum();
+            break;
+    }
+}
+
 /**
  * Setup the numeric text for the annotation colorbar.
  *
@@ -269,6 +269,12 @@ namespace caret {
                                               float* normalizedValuesOut,
                                               const int64_t numberOfData) const;
         
+        void getPaletteMappingValues(const FastStatistics* statistics,
+                                     float& mostNegativeOut,
+                                     float& leastNegativeOut,
+                                     float& leastPositiveOut,
+                                     float& mostPositiveOut) const;
+        
         void getPaletteColorBarScaleText(const FastStatistics* statistics,
                                          std::vector<AnnotationColorBarNumericText*>& colorBarNumericTextOut) const;
         
@@ -0,0 +1,344 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Benchmarks.h"
+
+#include "AlgorithmCiftiCorrelation.h"
+#include "ByteOrderEnum.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "dot_wrapper.h"
+#include "ElapsedTimer.h"
+#include "StructureEnum.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <stdint.h>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int NUM_TRIALS = 3;//report the fastest of several trials, the others include noise from other processes
+    const int DOT_BATCH_SIZE = 64;
+
+    ///vector of random floats with at least 64 bytes of slack, so a 64 byte aligned start and a misaligned start can both be used
+    class BenchVector
+    {
+        vector<float> m_storage;
+    public:
+        BenchVector(const int& length) : m_storage(length + 32)
+        {
+            for (int i = 0; i < (int)m_storage.size(); ++i)
+            {
+                m_storage[i] = ((float)rand()) / RAND_MAX - 0.5f;
+            }
+        }
+        const float* get(const bool& aligned) const
+        {//find the aligned start each time, because copying the vector moves the storage
+            const float* ret = m_storage.data();
+            while (((uintptr_t)ret) % 64 != 0) ++ret;
+            return aligned ? ret : ret + 1;
+        }
+    };
+
+    AString jsonString(const AString& in)
+    {
+        AString ret = "\"";
+        for (int i = 0; i < in.size(); ++i)
+        {
+            QChar c = in[i];
+            if (c == '"' || c == '\\')
+            {
+                ret += '\\';
+                ret += c;
+            } else if (c.unicode() < 0x20) {
+                ret += "\\u" + AString::number(c.unicode(), 16).rightJustified(4, '0');
+            } else {
+                ret += c;
+            }
+        }
+        return ret + "\"";
+    }
+
+    AString jsonNumber(const double& value)
+    {
+        if (value != value || std::abs(value) > 1e300) return "null";//JSON has no nan or inf
+        return AString::number(value, 'g', 8);
+    }
+
+    CiftiXML makeDtseriesXML(const int64_t& rows, const int64_t& columns)
+    {
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        CiftiBrainModelsMap brainModels;
+        brainModels.addSurfaceModel(rows, StructureEnum::CORTEX_LEFT);
+        ret.setMap(CiftiXML::ALONG_COLUMN, brainModels);
+        ret.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(columns));
+        return ret;
+    }
+
+    void fillRandomRows(CiftiFile& file, const int64_t& rows, const int64_t& columns)
+    {
+        vector<float> scratch(columns);
+        for (int64_t i = 0; i < rows; ++i)
+        {
+            for (int64_t j = 0; j < columns; ++j)
+            {
+                scratch[j] = ((float)rand()) / RAND_MAX;
+            }
+            file.setRow(scratch.data(), i);
+        }
+    }
+
+    ///fastest of several trials of reading every row, in seconds
+    double timeReadAllRows(const CiftiFile& file)
+    {
+        int64_t rows = file.getNumberOfRows();
+        vector<float> scratch(file.getNumberOfColumns());
+        double best = -1.0;
+        for (int trial = 0; trial < NUM_TRIALS; ++trial)
+        {
+            ElapsedTimer myTimer;
+            myTimer.start();
+            for (int64_t i = 0; i < rows; ++i)
+            {
+                file.getRow(scratch.data(), i);
+            }
+            double seconds = myTimer.getElapsedTimeSeconds();
+            if (best < 0.0 || seconds < best) best = seconds;
+        }
+        return best;
+    }
+}
+
+Benchmarks::Benchmarks(const bool& quick)
+{
+    m_quick = quick;
+}
+
+void Benchmarks::runDot()
+{
+    vector<int> lengths;
+    if (m_quick)
+    {
+        lengths.push_back(100);
+        lengths.push_back(1203);
+    } else {
+        lengths.push_back(64);
+        lengths.push_back(300);//short time series
+        lengths.push_back(1200);//typical HCP resting state run
+        lengths.push_back(4800);//concatenated runs
+        lengths.push_back(65536);//larger than L1, tests streaming
+    }
+    const double targetElements = (m_quick ? 2e6 : 2e8);//per trial, so each trial takes a measurable time regardless of length
+    vector<DotSIMDEnum::Enum> simdTypes = DotSIMDEnum::getAllEnums();
+    map<AString, double> totalNanoseconds;
+    volatile double sink = 0.0;//keep the compiler from discarding the dot products
+    for (int len = 0; len < (int)lengths.size(); ++len)
+    {
+        int length = lengths[len];
+        BenchVector left(length);
+        vector<BenchVector> right;
+        for (int i = 0; i < DOT_BATCH_SIZE; ++i)
+        {
+            right.push_back(BenchVector(length));
+        }
+        vector<double> batchOut(DOT_BATCH_SIZE);
+        for (int t = 0; t < (int)simdTypes.size(); ++t)
+        {
+            if (simdTypes[t] == DOT_AUTO) continue;
+            if (dot_set_impl(simdTypes[t]) != simdTypes[t]) continue;//not supported on this cpu or build
+            AString simdName = DotSIMDEnum::toName(simdTypes[t]);
+            for (int alignPass = 0; alignPass < 2; ++alignPass)
+            {
+                bool aligned = (alignPass == 0);
+                const float* a = left.get(aligned);
+                vector<const float*> b(DOT_BATCH_SIZE);
+                for (int i = 0; i < DOT_BATCH_SIZE; ++i)
+                {
+                    b[i] = right[i].get(aligned);
+                }
+                int64_t pairCalls = max((int64_t)DOT_BATCH_SIZE, (int64_t)(targetElements / length));
+                int64_t batchCalls = max((int64_t)1, pairCalls / DOT_BATCH_SIZE);
+                double bestPair = -1.0, bestBatch = -1.0;
+                for (int trial = 0; trial < NUM_TRIALS; ++trial)
+                {
+                    double accum = 0.0;
+                    ElapsedTimer myTimer;
+                    myTimer.start();
+                    for (int64_t i = 0; i < pairCalls; ++i)
+                    {
+                        accum += sddot(a, b[i % DOT_BATCH_SIZE], length);
+                    }
+                    double seconds = myTimer.getElapsedTimeSeconds();
+                    if (bestPair < 0.0 || seconds < bestPair) bestPair = seconds;
+                    myTimer.start();
+                    for (int64_t i = 0; i < batchCalls; ++i)
+                    {
+                        sddot_batch(a, b.data(), DOT_BATCH_SIZE, length, batchOut.data());
+                        accum += batchOut[0];
+                    }
+                    seconds = myTimer.getElapsedTimeSeconds();
+                    if (bestBatch < 0.0 || seconds < bestBatch) bestBatch = seconds;
+                    sink = sink + accum;
+                }
+                for (int kernel = 0; kernel < 2; ++kernel)
+                {
+                    int64_t numDots = (kernel == 0 ? pairCalls : batchCalls * DOT_BATCH_SIZE);
+                    double seconds = (kernel == 0 ? bestPair : bestBatch);
+                    Record myRecord;
+                    myRecord.m_benchmark = "dot";
+                    myRecord.m_labels["simd"] = simdName;
+                    myRecord.m_labels["kernel"] = (kernel == 0 ? "sddot" : "sddot_batch");
+                    myRecord.m_flags["aligned"] = aligned;
+                    myRecord.m_values["length"] = length;
+                    myRecord.m_values["ns_per_dot"] = seconds * 1e9 / numDots;
+                    myRecord.m_values["gflops"] = 2.0 * length * numDots / seconds / 1e9;
+                    m_records.push_back(myRecord);
+                    if (kernel == 0) totalNanoseconds[simdName] += seconds * 1e9 / numDots;
+                }
+            }
+            cerr << "dot: " << simdName << " length " << length << " done" << endl;
+        }
+    }
+    dot_set_impl(DOT_AUTO);
+    double bestTotal = -1.0;
+    for (map<AString, double>::iterator iter = totalNanoseconds.begin(); iter != totalNanoseconds.end(); ++iter)
+    {
+        if (bestTotal < 0.0 || iter->second < bestTotal)
+        {
+            bestTotal = iter->second;
+            m_recommendedSimd = iter->first;
+        }
+    }
+}
+
+void Benchmarks::runCiftiRead(const AString& scratchDir)
+{
+    const int64_t rows = (m_quick ? 2000 : 32492), columns = (m_quick ? 100 : 1200);//full size is a 32k surface with a typical run length
+    CiftiXML myXML = makeDtseriesXML(rows, columns);
+    CiftiFile::ENDIAN otherEndian = (ByteOrderEnum::isSystemBigEndian() ? CiftiFile::LITTLE : CiftiFile::BIG);
+    //native float32 gets memory mapped, the other byte order has to go through the normal on-disk reading and swapping
+    AString nativeName = QDir(scratchDir).filePath("bench_native.dtseries.nii");
+    AString swappedName = QDir(scratchDir).filePath("bench_swapped.dtseries.nii");
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        CiftiFile writer;
+        writer.setWritingFile(pass == 0 ? nativeName : swappedName, CiftiVersion(), pass == 0 ? CiftiFile::NATIVE : otherEndian);
+        writer.setCiftiXML(myXML);
+        fillRandomRows(writer, rows, columns);
+        writer.close();
+    }
+    for (int impl = 0; impl < 3; ++impl)
+    {
+        CiftiFile reader(impl == 1 ? swappedName : nativeName);
+        AString implName = (reader.getRowPointer(0) != NULL ? "mmap" : "ondisk");//label by what actually happened, mapping can fail
+        if (impl == 2)
+        {
+            reader.convertToInMemory();
+            implName = "memory";
+        }
+        double seconds = timeReadAllRows(reader);
+        Record myRecord;
+        myRecord.m_benchmark = "cifti_read";
+        myRecord.m_labels["impl"] = implName;
+        myRecord.m_labels["byte_order"] = (impl == 1 ? "swapped" : "native");
+        myRecord.m_values["rows"] = rows;
+        myRecord.m_values["columns"] = columns;
+        myRecord.m_values["seconds"] = seconds;
+        myRecord.m_values["mb_per_second"] = rows * columns * sizeof(float) / seconds / (1024.0 * 1024.0);
+        m_records.push_back(myRecord);
+        cerr << "cifti_read: " << implName << " done" << endl;
+    }
+    QFile::remove(nativeName);
+    QFile::remove(swappedName);
+}
+
+void Benchmarks::runCorrelation()
+{
+    const int64_t rows = (m_quick ? 1000 : 8000), columns = (m_quick ? 100 : 400);//output is rows squared, so keep it in memory without being huge
+    CiftiFile input;
+    input.setCiftiXML(makeDtseriesXML(rows, columns));
+    fillRandomRows(input, rows, columns);
+    double seconds = -1.0;
+    for (int trial = 0; trial < NUM_TRIALS; ++trial)
+    {
+        CiftiFile output;
+        ElapsedTimer myTimer;
+        myTimer.start();
+        AlgorithmCiftiCorrelation(NULL, &input, &output);
+        double trialSeconds = myTimer.getElapsedTimeSeconds();
+        if (seconds < 0.0 || trialSeconds < seconds) seconds = trialSeconds;
+    }
+    Record myRecord;
+    myRecord.m_benchmark = "cifti_correlation";
+    myRecord.m_labels["input"] = "memory";
+    myRecord.m_values["rows"] = rows;
+    myRecord.m_values["columns"] = columns;
+    myRecord.m_values["seconds"] = seconds;
+    myRecord.m_values["million_pairs_per_second"] = rows * (double)rows / seconds / 1e6;
+    m_records.push_back(myRecord);
+    cerr << "cifti_correlation: done" << endl;
+}
+
+AString Benchmarks::toJson() const
+{
+    int threads = 1;
+#ifdef CARET_OMP
+    threads = omp_get_max_threads();
+#endif
+    AString autoSimd = DotSIMDEnum::toName(dot_set_impl(DOT_AUTO));
+    AString ret = "{\n";
+    ret += "  \"host\": {\"threads\": " + AString::number(threads) + ", \"simd_auto\": " + jsonString(autoSimd) +
+           ", \"quick\": " + (m_quick ? "true" : "false") + "},\n";
+    if (!m_recommendedSimd.isEmpty())
+    {
+        ret += "  \"recommended_simd\": " + jsonString(m_recommendedSimd) + ",\n";
+    }
+    ret += "  \"results\": [";
+    for (int i = 0; i < (int)m_records.size(); ++i)
+    {
+        const Record& myRecord = m_records[i];
+        ret += (i == 0 ? "\n    {" : ",\n    {");
+        ret += "\"benchmark\": " + jsonString(myRecord.m_benchmark);
+        for (map<AString, AString>::const_iterator iter = myRecord.m_labels.begin(); iter != myRecord.m_labels.end(); ++iter)
+        {
+            ret += ", " + jsonString(iter->first) + ": " + jsonString(iter->second);
+        }
+        for (map<AString, bool>::const_iterator iter = myRecord.m_flags.begin(); iter != myRecord.m_flags.end(); ++iter)
+        {
+            ret += ", " + jsonString(iter->first) + ": " + (iter->second ? "true" : "false");
+        }
+        for (map<AString, double>::const_iterator iter = myRecord.m_values.begin(); iter != myRecord.m_values.end(); ++iter)
+        {
+            ret += ", " + jsonString(iter->first) + ": " + jsonNumber(iter->second);
+        }
+        ret += "}";
+    }
+    ret += "\n  ]\n}\n";
+    return ret;
+}
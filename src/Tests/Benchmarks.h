@@ -0,0 +1,65 @@
+#ifndef __BENCHMARKS_H__
+#define __BENCHMARKS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <map>
+#include <vector>
+
+namespace caret {
+
+    ///timings for regression tracking and choosing -simd per host, collected as flat records and written as JSON
+    class Benchmarks
+    {
+    public:
+        ///one timed measurement, values are numbers, labels are strings, flags are booleans
+        struct Record
+        {
+            AString m_benchmark;
+            std::map<AString, AString> m_labels;
+            std::map<AString, bool> m_flags;
+            std::map<AString, double> m_values;
+        };
+
+        ///quick uses small sizes and few repeats, for checking that it runs rather than for numbers to compare
+        Benchmarks(const bool& quick);
+
+        ///every supported dot_flags tier, pairwise and batched, over several lengths, aligned and unaligned
+        void runDot();
+        ///row read throughput of a synthetic dtseries, for each CiftiFile read implementation
+        void runCiftiRead(const AString& scratchDir);
+        ///end-to-end -cifti-correlation on a synthetic dtseries, fastest of several trials
+        void runCorrelation();
+
+        const std::vector<Record>& getRecords() const { return m_records; }
+        ///includes host info, and the fastest dot tier as "recommended_simd" if runDot() was used
+        AString toJson() const;
+    private:
+        bool m_quick;
+        std::vector<Record> m_records;
+        AString m_recommendedSimd;
+    };
+
+}
+
+#endif //__BENCHMARKS_H__
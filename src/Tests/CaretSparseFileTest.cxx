@@ -0,0 +1,253 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CaretSparseFileTest.h"
+
+#include "CaretSparseFile.h"
+#include "CiftiScalarsMap.h"
+#include "CiftiXML.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CaretSparseFileTest::CaretSparseFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t ROW_LENGTH = 1000, NUM_ROWS = 40;
+    
+    CiftiXML makeXML()
+    {
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        CiftiScalarsMap rowMap, columnMap;
+        rowMap.setLength(ROW_LENGTH);
+        columnMap.setLength(NUM_ROWS);
+        ret.setMap(CiftiXML::ALONG_ROW, rowMap);
+        ret.setMap(CiftiXML::ALONG_COLUMN, columnMap);
+        return ret;
+    }
+    
+    AString tempFileName(const int& version, const AString& kind)
+    {
+        return QDir::temp().filePath("wb_sparse_test_" + AString::number(QCoreApplication::applicationPid()) + "_" + kind + "_v" + AString::number(version) + ".trajTEMP.wbsparse");
+    }
+    
+    //random sorted column indices, with both small gaps and gaps long enough to need multibyte varints, some rows are left empty
+    void makeIndices(const int64_t& row, vector<int64_t>& indicesOut)
+    {
+        indicesOut.clear();
+        if (row % 7 == 3) return;
+        for (int64_t i = rand() % 3; i < ROW_LENGTH; i += 1 + (rand() % 4 == 0 ? rand() % 300 : rand() % 3))
+        {
+            indicesOut.push_back(i);
+        }
+    }
+    
+    int64_t randomValue()
+    {
+        uint64_t ret = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        switch (rand() % 4)
+        {
+            case 0:
+                ret &= 0xFFFFFFFFULL;//high half zero
+                break;
+            case 1:
+                ret = ~ret;//high bit set, negative as int64
+                break;
+            default:
+                break;
+        }
+        if (ret == 0) ret = 1;//explicit zeros don't survive dense reads
+        return (int64_t)ret;
+    }
+    
+    FiberFractions randomFibers()
+    {
+        FiberFractions ret;
+        ret.totalCount = 1 + rand() % (rand() % 2 ? 20 : 100000);
+        int first = rand() % 1001, second = rand() % (1001 - first);//on the encoding's grid of thousandths
+        ret.fiberFractions.resize(3);
+        ret.fiberFractions[0] = first / 1000.0f;
+        ret.fiberFractions[1] = second / 1000.0f;
+        ret.fiberFractions[2] = 1.0f - ret.fiberFractions[0] - ret.fiberFractions[1];
+        ret.distance = (float)(rand() % 1024);
+        return ret;
+    }
+    
+    bool fibersMatch(const FiberFractions& written, const FiberFractions& read)
+    {
+        if (written.totalCount != read.totalCount || written.distance != read.distance || read.fiberFractions.size() != 3) return false;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (abs(written.fiberFractions[i] - read.fiberFractions[i]) > 0.0015f) return false;//third fraction is derived from the other two
+        }
+        return true;
+    }
+}
+
+void CaretSparseFileTest::testValues(const int& version)
+{
+    AString fileName = tempFileName(version, "values");
+    vector<vector<int64_t> > indices(NUM_ROWS), values(NUM_ROWS);
+    vector<int64_t> denseRow(ROW_LENGTH);
+    {
+        CaretSparseFileWriter myWriter(fileName, makeXML(), version);
+        for (int64_t row = 0; row < NUM_ROWS; ++row)
+        {
+            makeIndices(row, indices[row]);
+            for (size_t i = 0; i < indices[row].size(); ++i)
+            {
+                values[row].push_back(randomValue());
+            }
+            if (indices[row].empty()) continue;//skipped rows must read as empty
+            if (row % 2 == 0)
+            {
+                myWriter.writeRowSparse(row, indices[row], values[row]);
+            } else {
+                denseRow.assign(ROW_LENGTH, 0);
+                for (size_t i = 0; i < indices[row].size(); ++i)
+                {
+                    denseRow[indices[row][i]] = values[row][i];
+                }
+                myWriter.writeRow(row, denseRow.data());
+            }
+        }
+        myWriter.finish();
+    }
+    {
+        CaretSparseFile myReader(fileName);
+        if (myReader.getVersion() != version) setFailed("wbsparse version " + AString::number(version) + " file read back as version " + AString::number(myReader.getVersion()));
+        if (myReader.getDimensions()[0] != ROW_LENGTH || myReader.getDimensions()[1] != NUM_ROWS) setFailed("wbsparse version " + AString::number(version) + " file has wrong dimensions");
+        vector<int64_t> indicesRead, valuesRead;
+        for (int64_t row = 0; !failed() && row < NUM_ROWS; ++row)
+        {
+            myReader.getRowSparse(row, indicesRead, valuesRead);
+            if (indicesRead != indices[row] || valuesRead != values[row])
+            {
+                setFailed("wbsparse version " + AString::number(version) + " sparse row " + AString::number(row) + " doesn't match what was written");
+            }
+            myReader.getRow(row, denseRow.data());
+            size_t next = 0;
+            for (int64_t i = 0; i < ROW_LENGTH; ++i)
+            {
+                int64_t expected = 0;
+                if (next < indices[row].size() && indices[row][next] == i)
+                {
+                    expected = values[row][next];
+                    ++next;
+                }
+                if (denseRow[i] != expected)
+                {
+                    setFailed("wbsparse version " + AString::number(version) + " dense row " + AString::number(row) + " doesn't match what was written");
+                    break;
+                }
+            }
+        }
+    }
+    QFile::remove(fileName);
+}
+
+void CaretSparseFileTest::testFibers(const int& version)
+{
+    AString fileName = tempFileName(version, "fibers");
+    vector<vector<int64_t> > indices(NUM_ROWS);
+    vector<vector<FiberFractions> > fibers(NUM_ROWS);
+    vector<FiberFractions> denseRow(ROW_LENGTH);
+    {
+        CaretSparseFileWriter myWriter(fileName, makeXML(), version);
+        for (int64_t row = 0; row < NUM_ROWS; ++row)
+        {
+            makeIndices(row, indices[row]);
+            for (size_t i = 0; i < indices[row].size(); ++i)
+            {
+                fibers[row].push_back(randomFibers());
+            }
+            if (indices[row].empty()) continue;
+            if (row % 2 == 0)
+            {
+                myWriter.writeFibersRowSparse(row, indices[row], fibers[row]);
+            } else {
+                for (int64_t i = 0; i < ROW_LENGTH; ++i)
+                {
+                    denseRow[i].zero();
+                }
+                for (size_t i = 0; i < indices[row].size(); ++i)
+                {
+                    denseRow[indices[row][i]] = fibers[row][i];
+                }
+                myWriter.writeFibersRow(row, denseRow.data());
+            }
+        }
+        myWriter.finish();
+    }
+    {
+        CaretSparseFile myReader(fileName);
+        vector<int64_t> indicesRead;
+        vector<FiberFractions> fibersRead;
+        for (int64_t row = 0; !failed() && row < NUM_ROWS; ++row)
+        {
+            myReader.getFibersRowSparse(row, indicesRead, fibersRead);
+            bool match = (indicesRead == indices[row] && fibersRead.size() == fibers[row].size());
+            for (size_t i = 0; match && i < fibersRead.size(); ++i)
+            {
+                match = fibersMatch(fibers[row][i], fibersRead[i]);
+            }
+            if (!match) setFailed("wbsparse version " + AString::number(version) + " sparse fiber row " + AString::number(row) + " doesn't match what was written");
+            myReader.getFibersRow(row, denseRow.data());
+            size_t next = 0;
+            for (int64_t i = 0; i < ROW_LENGTH; ++i)
+            {
+                if (next < indices[row].size() && indices[row][next] == i)
+                {
+                    match = fibersMatch(fibers[row][next], denseRow[i]);
+                    ++next;
+                } else {
+                    match = (denseRow[i].totalCount == 0);
+                }
+                if (!match)
+                {
+                    setFailed("wbsparse version " + AString::number(version) + " dense fiber row " + AString::number(row) + " doesn't match what was written");
+                    break;
+                }
+            }
+        }
+    }
+    QFile::remove(fileName);
+}
+
+void CaretSparseFileTest::execute()
+{
+    for (int version = 1; version <= 2; ++version)
+    {
+        srand(7);//same rows for both versions
+        testValues(version);
+        testFibers(version);
+    }
+}
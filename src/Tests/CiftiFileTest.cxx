@@ -193,6 +193,17 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
             this->setFailed("Input and output Cifti file rows are not the same.");
             return;
         }
+        const float* mappedRow = test.getRowPointer(i);//native float32 output, so this should be memory mapped
+        if(mappedRow == NULL)
+        {
+            this->setFailed("Output Cifti file was not memory mapped.");
+            return;
+        }
+        if(memcmp((const void *)row,(const void *)mappedRow,rowSize*sizeof(float)))
+        {
+            this->setFailed("Input and memory mapped output Cifti file rows are not the same.");
+            return;
+        }
     }
     std::cout << "Reading and writing of Cifti was successful for all frames." << std::endl;
     delete [] row;
@@ -0,0 +1,170 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiResampleTest.h"
+
+#include "AlgorithmCiftiResample.h"
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "CiftiBrainModelsMap.h"
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiResampleTest::CiftiResampleTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //move the vertices around on the sphere, so the two meshes don't share vertex positions
+    void jitterSphere(SurfaceFile& mySurf, const float& amount)
+    {
+        int numNodes = mySurf.getNumberOfNodes();
+        float radius = Vector3D(mySurf.getCoordinate(0)).length();
+        for (int i = 0; i < numNodes; ++i)
+        {
+            Vector3D coord(mySurf.getCoordinate(i));
+            for (int j = 0; j < 3; ++j)
+            {
+                coord[j] += amount * (((float)rand()) / RAND_MAX - 0.5f);
+            }
+            coord = coord.normal() * radius;
+            mySurf.setCoordinate(i, coord[0], coord[1], coord[2]);
+        }
+    }
+    
+    void makeAreas(const SurfaceFile& mySurf, MetricFile& areasOut)
+    {
+        vector<float> areas;
+        mySurf.computeNodeAreas(areas);
+        areasOut.setNumberOfNodesAndColumns(mySurf.getNumberOfNodes(), 1);
+        areasOut.setValuesForColumn(0, areas.data());
+    }
+}
+
+void CiftiResampleTest::execute()
+{
+    SurfaceFile curSphere, newSphere;
+    AlgorithmSurfaceCreateSphere(NULL, 2562, &curSphere);
+    AlgorithmSurfaceCreateSphere(NULL, 642, &newSphere);
+    jitterSphere(curSphere, 2.0f);
+    jitterSphere(newSphere, 4.0f);
+    MetricFile curAreas, newAreas;
+    makeAreas(curSphere, curAreas);
+    makeAreas(newSphere, newAreas);
+    int curNodes = curSphere.getNumberOfNodes(), newNodes = newSphere.getNumberOfNodes();
+    vector<float> curRoi(curNodes), newRoi(newNodes);
+    for (int i = 0; i < curNodes; ++i)
+    {
+        curRoi[i] = (rand() % 5 == 0 ? 0.0f : 1.0f);//holes in the input, so some output nodes get partial or no weights
+    }
+    for (int i = 0; i < newNodes; ++i)
+    {
+        newRoi[i] = (rand() % 10 == 0 ? 0.0f : 1.0f);
+    }
+    const int NUM_MAPS = 7;
+    CiftiXML inXML, templateXML;
+    CiftiBrainModelsMap inModels, templateModels;
+    inModels.addSurfaceModel(curNodes, StructureEnum::CORTEX_LEFT, curRoi.data());
+    templateModels.addSurfaceModel(newNodes, StructureEnum::CORTEX_LEFT, newRoi.data());
+    CiftiScalarsMap scalarMap;
+    scalarMap.setLength(NUM_MAPS);
+    inXML.setNumberOfDimensions(2);
+    inXML.setMap(CiftiXML::ALONG_COLUMN, inModels);
+    inXML.setMap(CiftiXML::ALONG_ROW, scalarMap);
+    templateXML.setNumberOfDimensions(2);
+    templateXML.setMap(CiftiXML::ALONG_COLUMN, templateModels);
+    templateXML.setMap(CiftiXML::ALONG_ROW, scalarMap);
+    CiftiFile inFile, templateFile;
+    inFile.setCiftiXML(inXML);
+    templateFile.setCiftiXML(templateXML);
+    int64_t numInRows = inXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    vector<float> scratchRow(NUM_MAPS);
+    for (int64_t row = 0; row < numInRows; ++row)
+    {
+        for (int m = 0; m < NUM_MAPS; ++m)
+        {
+            scratchRow[m] = ((float)rand()) / RAND_MAX - 0.5f;
+        }
+        inFile.setRow(scratchRow.data(), row);
+    }
+    for (int64_t row = 0; row < templateXML.getDimensionLength(CiftiXML::ALONG_COLUMN); ++row)
+    {
+        templateFile.setRow(scratchRow.data(), row);
+    }
+    //the same data as one metric column per map, zero outside the cifti ROI, like cifti-separate would make
+    vector<CiftiBrainModelsMap::SurfaceMap> inMap = inModels.getSurfaceMap(StructureEnum::CORTEX_LEFT), outMap = templateModels.getSurfaceMap(StructureEnum::CORTEX_LEFT);
+    vector<vector<float> > inColumns(NUM_MAPS, vector<float>(curNodes, 0.0f));
+    for (size_t j = 0; j < inMap.size(); ++j)
+    {
+        inFile.getRow(scratchRow.data(), inMap[j].m_ciftiIndex);
+        for (int m = 0; m < NUM_MAPS; ++m)
+        {
+            inColumns[m][inMap[j].m_surfaceNode] = scratchRow[m];
+        }
+    }
+    for (int method = 0; method < 2; ++method)
+    {
+        SurfaceResamplingMethodEnum::Enum myMethod = (method == 0 ? SurfaceResamplingMethodEnum::BARYCENTRIC : SurfaceResamplingMethodEnum::ADAP_BARY_AREA);
+        const MetricFile* curAreasPtr = (method == 0 ? NULL : &curAreas), *newAreasPtr = (method == 0 ? NULL : &newAreas);
+        SurfaceResamplingHelper myHelper(myMethod, &curSphere, &newSphere,
+                                         (method == 0 ? NULL : curAreas.getValuePointerForColumn(0)), (method == 0 ? NULL : newAreas.getValuePointerForColumn(0)), curRoi.data());
+        for (int largest = 0; largest < 2; ++largest)
+        {
+            CiftiFile outFile;
+            AlgorithmCiftiResample(NULL, &inFile, CiftiXML::ALONG_COLUMN, &templateFile, CiftiXML::ALONG_COLUMN, myMethod, VolumeFile::TRILINEAR, &outFile, (largest != 0), 0.0f, 0.0f,
+                                   (const VolumeFile*)NULL, &curSphere, &newSphere, curAreasPtr, newAreasPtr, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+            vector<vector<float> > expected(NUM_MAPS, vector<float>(newNodes));
+            for (int m = 0; m < NUM_MAPS; ++m)
+            {
+                if (largest)
+                {
+                    myHelper.resampleLargest(inColumns[m].data(), expected[m].data());
+                } else {
+                    myHelper.resampleNormal(inColumns[m].data(), expected[m].data());
+                }
+            }
+            float maxDiff = 0.0f;
+            for (size_t j = 0; j < outMap.size(); ++j)
+            {
+                outFile.getRow(scratchRow.data(), outMap[j].m_ciftiIndex);
+                for (int m = 0; m < NUM_MAPS; ++m)
+                {
+                    float diff = abs(scratchRow[m] - expected[m][outMap[j].m_surfaceNode]);
+                    if (!(diff <= maxDiff)) maxDiff = diff;//catch NaN
+                }
+            }
+            if (!(maxDiff <= 1e-6f))//both accumulate in double, so only the final rounding to float can differ
+            {
+                setFailed("streaming cifti resample differs from resampling helper by " + AString::number(maxDiff) + " with method " +
+                          SurfaceResamplingMethodEnum::toName(myMethod) + (largest ? ", largest" : ""));
+            }
+        }
+    }
+}
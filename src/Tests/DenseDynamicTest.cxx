@@ -0,0 +1,186 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DenseDynamicTest.h"
+
+#include "CiftiBrainModelsMap.h"
+#include "CiftiBrainordinateDataSeriesFile.h"
+#include "CiftiConnectivityMatrixDenseDynamicFile.h"
+#include "CiftiFile.h"
+#include "CiftiSeriesMap.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+DenseDynamicTest::DenseDynamicTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int NUM_ROWS = 80;
+    const int NUM_TIMEPOINTS = 48;
+    const int CONSTANT_ROW = 7;//a row with no variance, correlation with it is defined as zero
+
+    //correlation of one row with every row over a window, computed directly from the time series
+    vector<float> directCorrelation(const vector<vector<float> >& data, const int& row, const int& first, const int& count)
+    {
+        vector<float> ret(data.size(), 0.0f);
+        vector<double> centered(data.size() * count);
+        vector<double> norms(data.size());
+        for (int i = 0; i < (int)data.size(); ++i)
+        {
+            double mean = 0.0;
+            for (int t = first; t < first + count; ++t) mean += data[i][t];
+            mean /= count;
+            double norm = 0.0;
+            for (int t = 0; t < count; ++t)
+            {
+                double val = data[i][first + t] - mean;
+                centered[i * count + t] = val;
+                norm += val * val;
+            }
+            norms[i] = sqrt(norm);
+        }
+        for (int i = 0; i < (int)data.size(); ++i)
+        {
+            if (i == row)
+            {
+                ret[i] = 1.0f;
+                continue;
+            }
+            if (!(norms[row] > 0.0 && norms[i] > 0.0)) continue;
+            double sum = 0.0;
+            for (int t = 0; t < count; ++t)
+            {
+                sum += centered[row * count + t] * centered[i * count + t];
+            }
+            ret[i] = sum / (norms[row] * norms[i]);
+        }
+        return ret;
+    }
+
+    float maxDifference(const vector<float>& first, const vector<float>& second)
+    {
+        if (first.size() != second.size()) return 1e30f;
+        float ret = 0.0f;
+        for (int i = 0; i < (int)first.size(); ++i)
+        {
+            float diff = abs(first[i] - second[i]);
+            if (!(diff <= ret)) ret = diff;//catches NaN
+        }
+        return ret;
+    }
+
+    vector<float> loadRow(CiftiConnectivityMatrixDenseDynamicFile* dynFile, const int& row)
+    {
+        int64_t rowIndex = -1, columnIndex = -1;
+        dynFile->loadMapDataForSurfaceNode(0, NUM_ROWS, StructureEnum::CORTEX_LEFT, row, rowIndex, columnIndex);
+        vector<float> ret;
+        dynFile->getMapData(0, ret);
+        return ret;
+    }
+}
+
+void DenseDynamicTest::execute()
+{
+    vector<vector<float> > data(NUM_ROWS, vector<float>(NUM_TIMEPOINTS));
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        float offset = 2.0f * rand() / RAND_MAX - 1.0f;//nonzero means, so sums over windows don't start centered, small because the full correlation uses float means
+        for (int t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            data[i][t] = (i == CONSTANT_ROW ? 3.0f : offset + ((float)rand()) / RAND_MAX - 0.5f);
+        }
+    }
+    CiftiXML myXML;
+    CiftiBrainModelsMap myModels;
+    myModels.addSurfaceModel(NUM_ROWS, StructureEnum::CORTEX_LEFT);
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, myModels);
+    myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(NUM_TIMEPOINTS));
+    AString fileName = QDir::temp().filePath("wb_dense_dynamic_test_" + QString::number(QCoreApplication::applicationPid()) + ".dtseries.nii");
+    {
+        CiftiFile outFile;
+        outFile.setCiftiXML(myXML);
+        for (int i = 0; i < NUM_ROWS; ++i)
+        {
+            outFile.setRow(data[i].data(), i);
+        }
+        outFile.writeFile(fileName);
+    }
+    {
+        CiftiBrainordinateDataSeriesFile seriesFile;
+        seriesFile.readFile(fileName);
+        CiftiConnectivityMatrixDenseDynamicFile* dynFile = seriesFile.getConnectivityMatrixDenseDynamicFile();
+        if (dynFile == NULL || !dynFile->isDataValid())
+        {
+            setFailed("unable to set up dense dynamic file");
+            QFile::remove(fileName);
+            return;
+        }
+        //sliding by small steps uses the running sums, large jumps and row changes recompute them, check every path against direct correlation
+        const int windows[][3] = { { 3, 0, 12 }, { 3, 1, 12 }, { 3, 4, 12 }, { 3, 4, 16 }, { 3, 6, 10 }, { 3, 30, 12 },
+                                   { 11, 30, 12 }, { 11, 31, 12 }, { CONSTANT_ROW, 31, 12 }, { CONSTANT_ROW, 33, 12 }, { 20, 0, 2 }, { 20, 1, 2 } };
+        for (int w = 0; w < (int)(sizeof(windows) / sizeof(windows[0])); ++w)
+        {
+            int row = windows[w][0], first = windows[w][1], count = windows[w][2];
+            dynFile->setTimeWindow(first, count);
+            if (!dynFile->isTimeWindowEnabled())
+            {
+                setFailed("time window was not enabled");
+                break;
+            }
+            float diff = maxDifference(loadRow(dynFile, row), directCorrelation(data, row, first, count));
+            if (diff > 1e-4f)
+            {
+                setFailed("windowed correlation for row " + AString::number(row) + ", window " + AString::number(first) + " to " +
+                          AString::number(first + count - 1) + " differs from direct correlation by " + AString::number(diff));
+            }
+        }
+        //full rank, so the low-rank factors should reproduce the full correlation
+        dynFile->setTimeWindow(0, 0);
+        if (dynFile->isTimeWindowEnabled()) setFailed("time window was not disabled");
+        const int checkRows[] = { 0, 5, CONSTANT_ROW, NUM_ROWS - 1 };
+        vector<vector<float> > fullCorrelation;
+        for (int r = 0; r < (int)(sizeof(checkRows) / sizeof(checkRows[0])); ++r)
+        {
+            fullCorrelation.push_back(loadRow(dynFile, checkRows[r]));
+            float diff = maxDifference(fullCorrelation.back(), directCorrelation(data, checkRows[r], 0, NUM_TIMEPOINTS));
+            if (diff > 1e-4f) setFailed("full correlation for row " + AString::number(checkRows[r]) + " differs from direct correlation by " + AString::number(diff));
+        }
+        dynFile->setLowRankApproximationRank(NUM_TIMEPOINTS);
+        dynFile->setLowRankApproximationEnabled(true);
+        for (int r = 0; r < (int)(sizeof(checkRows) / sizeof(checkRows[0])); ++r)
+        {
+            float diff = maxDifference(loadRow(dynFile, checkRows[r]), fullCorrelation[r]);
+            if (diff > 1e-3f) setFailed("full rank low-rank correlation for row " + AString::number(checkRows[r]) + " differs from full correlation by " + AString::number(diff));
+        }
+    }
+    QFile::remove(fileName);
+}
@@ -19,6 +19,7 @@
 /*LICENSE_END*/
 #include "DotTest.h"
 
+#include "BlockedDot.h"
 #include "CaretAssert.h"
 #include "dot_wrapper.h"
 
@@ -169,4 +170,75 @@ void DotTest::execute()
     } else {
         cout << "skipping AVXFMA, not supported" << endl;
     }
+    //avx2
+    impl_in_use = dot_set_impl(DOT_AVX2);
+    if (impl_in_use == DOT_AVX2)
+    {
+        checkVal(self_naive, correlate(rand1, rand1), "avx2 self-correlation");
+        checkVal(unrelated_naive, correlate(rand1, rand2), "avx2 unrelated correlation");
+        checkVal(lowsnr_naive, correlate(lowsnrA, lowsnrB), "avx2 low snr correlation");
+        checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avx2 mid snr correlation");
+        checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avx2 high snr correlation");
+        checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avx2 cross snr correlation");
+    } else {
+        cout << "skipping AVX2, not supported" << endl;
+    }
+    //avx512
+    impl_in_use = dot_set_impl(DOT_AVX512);
+    if (impl_in_use == DOT_AVX512)
+    {
+        checkVal(self_naive, correlate(rand1, rand1), "avx512 self-correlation");
+        checkVal(unrelated_naive, correlate(rand1, rand2), "avx512 unrelated correlation");
+        checkVal(lowsnr_naive, correlate(lowsnrA, lowsnrB), "avx512 low snr correlation");
+        checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avx512 mid snr correlation");
+        checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avx512 high snr correlation");
+        checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avx512 cross snr correlation");
+    } else {
+        cout << "skipping AVX512, not supported" << endl;
+    }
+    //blocked tiles, against naive pairwise
+    dot_set_impl(DOT_NAIVE);
+    const int BLOCKSIZE = 1203;//not a multiple of the flush span, to test the remainder
+    vector<vector<float> > leftRows(11), panelRows(5);//not multiples of tile rows or panel width, ditto
+    vector<const float*> leftPtrs, panelPtrs;
+    for (int i = 0; i < (int)leftRows.size(); ++i)
+    {
+        leftRows[i] = randVector01(BLOCKSIZE);
+        leftPtrs.push_back(leftRows[i].data());
+    }
+    for (int i = 0; i < (int)panelRows.size(); ++i)
+    {
+        panelRows[i] = randVector01(BLOCKSIZE);
+        panelPtrs.push_back(panelRows[i].data());
+    }
+    vector<float> packed(BlockedDot::packedPanelSize(BLOCKSIZE));
+    BlockedDot::packPanel(panelPtrs.data(), (int)panelPtrs.size(), BLOCKSIZE, packed.data());
+    vector<double> dots(leftRows.size() * BlockedDot::PANEL_WIDTH);
+    BlockedDot::panelDots(leftPtrs.data(), (int)leftPtrs.size(), packed.data(), BLOCKSIZE, dots.data());
+    for (int i = 0; i < (int)leftRows.size(); ++i)
+    {
+        for (int j = 0; j < BlockedDot::PANEL_WIDTH; ++j)
+        {
+            float correct = 0.0f;
+            if (j < (int)panelRows.size()) correct = sddot(leftRows[i].data(), panelRows[j].data(), BLOCKSIZE);
+            checkVal(correct, dots[i * BlockedDot::PANEL_WIDTH + j], "blocked dot row " + AString::number(i) + " column " + AString::number(j));
+        }
+    }
+    //one-vs-many batch, against naive pairwise, for every implementation that is supported
+    vector<double> correctBatch(leftRows.size()), batch(leftRows.size());
+    for (int i = 0; i < (int)leftRows.size(); ++i)
+    {
+        correctBatch[i] = sddot(panelRows[0].data(), leftRows[i].data(), BLOCKSIZE);
+    }
+    vector<DotSIMDEnum::Enum> simdTypes = DotSIMDEnum::getAllEnums();
+    for (int t = 0; t < (int)simdTypes.size(); ++t)
+    {
+        if (dot_set_impl(simdTypes[t]) != simdTypes[t]) continue;
+        sddot_batch(panelRows[0].data(), leftPtrs.data(), (int)leftPtrs.size(), BLOCKSIZE, batch.data());
+        for (int i = 0; i < (int)leftRows.size(); ++i)
+        {
+            checkVal(correctBatch[i], batch[i], DotSIMDEnum::toName(simdTypes[t]) + " batch dot row " + AString::number(i));
+        }
+    }
+    dot_set_impl(DOT_AUTO);
 }
@@ -0,0 +1,152 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GeodesicBucketsTest.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "GeodesicHelper.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+GeodesicBucketsTest::GeodesicBucketsTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //check a limited search against the unlimited heap search: same distances, every node within range found, output sorted by distance
+    bool checkLimited(const vector<int32_t>& nodes, const vector<float>& dists, const vector<float>& fullDists, const float& maxDist, AString& reasonOut)
+    {
+        const float TOLERANCE = 1e-4f;//ties between paths can round differently
+        vector<char> found(fullDists.size(), 0);
+        if (nodes.size() != dists.size())
+        {
+            reasonOut = "node and distance lists have different sizes";
+            return false;
+        }
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (found[nodes[i]])
+            {
+                reasonOut = "node " + AString::number(nodes[i]) + " returned twice";
+                return false;
+            }
+            found[nodes[i]] = 1;
+            if (abs(dists[i] - fullDists[nodes[i]]) > TOLERANCE || dists[i] > maxDist)
+            {
+                reasonOut = "node " + AString::number(nodes[i]) + " has distance " + AString::number(dists[i]) + ", expected " + AString::number(fullDists[nodes[i]]);
+                return false;
+            }
+            if (i > 0 && dists[i] < dists[i - 1])
+            {
+                reasonOut = "distances are not in increasing order";
+                return false;
+            }
+        }
+        for (size_t i = 0; i < fullDists.size(); ++i)
+        {
+            if (!found[i] && fullDists[i] < maxDist - TOLERANCE)
+            {
+                reasonOut = "node " + AString::number(i) + " at distance " + AString::number(fullDists[i]) + " was not found";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void GeodesicBucketsTest::execute()
+{
+    SurfaceFile mySurf;
+    AlgorithmSurfaceCreateSphere(NULL, 642, &mySurf);
+    int numNodes = mySurf.getNumberOfNodes();
+    for (int i = 0; i < numNodes; ++i)
+    {
+        const float* coord = mySurf.getCoordinate(i);
+        float scale = 1.0f + 0.2f * rand() / RAND_MAX;//irregular edge lengths
+        mySurf.setCoordinate(i, coord[0] * scale, coord[1] * scale, coord[2] * scale);
+    }
+    vector<int32_t> roots, nodes;
+    for (int i = 0; i < 5; ++i)
+    {//a few edges far shorter than the others, the bucket width is derived from the shortest
+        const int32_t* tri = mySurf.getTriangle(rand() % mySurf.getNumberOfTriangles());
+        roots.push_back(tri[0]);
+        Vector3D first(mySurf.getCoordinate(tri[0])), second(mySurf.getCoordinate(tri[1]));
+        Vector3D moved = second + (first - second) * (0.0005f * (i + 1));
+        mySurf.setCoordinate(tri[0], moved[0], moved[1], moved[2]);
+    }
+    float minEdge = -1.0f;//GeodesicHelperBase computes edge lengths the same way
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf.getTopologyHelper();
+    for (int i = 0; i < numNodes; ++i)
+    {
+        const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+        for (size_t j = 0; j < neighbors.size(); ++j)
+        {
+            float length = (Vector3D(mySurf.getCoordinate(i)) - Vector3D(mySurf.getCoordinate(neighbors[j]))).length();
+            if (minEdge < 0.0f || length < minEdge) minEdge = length;
+        }
+    }
+    const int32_t MAX_BUCKETS = 4096;//must match GeodesicHelper, the limited search uses the heap instead at this many buckets of half the shortest edge
+    vector<float> maxDists;
+    maxDists.push_back(minEdge * 0.75f);//only the first step
+    maxDists.push_back(15.0f);
+    maxDists.push_back(minEdge * 0.5f * (MAX_BUCKETS - 0.5f));//last bucket count that uses buckets, exercises the clamp into the last bucket
+    maxDists.push_back(minEdge * 0.5f * (MAX_BUCKETS + 0.5f));//first that uses the heap
+    maxDists.push_back(1000.0f);//whole surface
+    CaretPointer<GeodesicHelper> myGeoHelp = mySurf.getGeodesicHelper();
+    vector<float> dists, fullDists;
+    for (int i = 0; i < 20; ++i)
+    {
+        roots.push_back(rand() % numNodes);
+    }
+    for (int smooth = 0; smooth < 2; ++smooth)
+    {
+        for (size_t d = 0; d < maxDists.size(); ++d)
+        {
+            vector<vector<int32_t> > batchNodes;
+            vector<vector<float> > batchDists;
+            GeodesicHelper::getNodesToGeoDistBatch(&mySurf, roots, maxDists[d], batchNodes, batchDists, (smooth != 0));
+            for (size_t r = 0; r < roots.size(); ++r)
+            {
+                myGeoHelp->getGeoFromNode(roots[r], fullDists, (smooth != 0));
+                myGeoHelp->getNodesToGeoDist(roots[r], maxDists[d], nodes, dists, (smooth != 0));
+                AString reason;
+                if (!checkLimited(nodes, dists, fullDists, maxDists[d], reason))
+                {
+                    setFailed("limited geodesic search from node " + AString::number(roots[r]) + " to distance " + AString::number(maxDists[d]) +
+                              (smooth ? " with" : " without") + " smoothing: " + reason);
+                    return;
+                }
+                if (batchNodes[r] != nodes || batchDists[r] != dists)
+                {
+                    setFailed("batch geodesic search differs from single search from node " + AString::number(roots[r]) + " to distance " + AString::number(maxDists[d]));
+                    return;
+                }
+            }
+        }
+    }
+}
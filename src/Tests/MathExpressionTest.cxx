@@ -55,4 +55,43 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    //compiled evaluation over arrays must match per-element evaluation exactly, use enough elements for several blocks and a partial block
+    const char* batchExprs[] = { " sin ( - yip * 5 ) + x ^ 3 * ( clamp(1, 3, 5) + 2 ) + - 2 ^ - 2 ",
+                                 "x >= yip || !(x < 0) && yip != 1 - x",
+                                 "min(x, yip) / max(x, 0.5) - mod(x, yip) + round(x * 3) - floor(yip) * ceil(x)",
+                                 "x == yip * 2 + atan2(x, yip) - clamp(x, -1, yip) + abs(asinh(x)) + ln(abs(yip)) + exp(-x^2) + sqrt(x)",
+                                 "PI * x <= yip" };
+    const int NUM_ELEMS = 1000;
+    vector<float> xArray(NUM_ELEMS), yipArray(NUM_ELEMS), batchOut(NUM_ELEMS);
+    for (int i = 0; i < NUM_ELEMS; ++i)
+    {
+        xArray[i] = (i % 37) * 0.25f - 4.0f;
+        yipArray[i] = (i % 11) * 0.5f - 2.0f;
+    }
+    for (int e = 0; e < (int)(sizeof(batchExprs) / sizeof(batchExprs[0])); ++e)
+    {
+        CaretMathExpression batchExpr(batchExprs[e]);
+        vector<AString> batchNames = batchExpr.getVarNames();
+        vector<const float*> arrays(batchNames.size());
+        for (int v = 0; v < (int)batchNames.size(); ++v)
+        {
+            arrays[v] = (batchNames[v] == "x" ? xArray.data() : yipArray.data());
+        }
+        batchExpr.evaluate(arrays, NUM_ELEMS, batchOut.data());
+        vector<float> elemVars(batchNames.size());
+        for (int i = 0; i < NUM_ELEMS; ++i)
+        {
+            for (int v = 0; v < (int)batchNames.size(); ++v)
+            {
+                elemVars[v] = arrays[v][i];
+            }
+            float expected = (float)batchExpr.evaluate(elemVars);
+            if (!(expected == batchOut[i]) && !(expected != expected && batchOut[i] != batchOut[i]))//both NaN is fine
+            {
+                setFailed("compiled evaluation of '" + AString(batchExprs[e]) + "' differs at element " + AString::number(i) + ", expected " +
+                          AString::number(expected) + ", got " + AString::number(batchOut[i]));
+                break;
+            }
+        }
+    }
 }
@@ -0,0 +1,142 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "MetricSmoothingTest.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+#include "SystemUtilities.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+MetricSmoothingTest::MetricSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    int countCacheFiles(const QDir& cacheDir)
+    {
+        return (int)cacheDir.entryList(QStringList("*.wbsmoothing"), QDir::Files).size();
+    }
+
+    void removeCacheDir(const QDir& cacheDir)
+    {//QDir::removeRecursively is Qt5 only
+        QStringList entries = cacheDir.entryList(QDir::Files);
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            QFile::remove(cacheDir.filePath(entries[i]));
+        }
+        QDir().rmdir(cacheDir.path());
+    }
+
+    void smoothWith(const SurfaceFile* mySurf, const float& kernel, const MetricFile* input, MetricFile* output)
+    {
+        MetricSmoothingObject mySmooth(mySurf, kernel);
+        mySmooth.smoothMetric(input, output);
+    }
+
+    //compare every value, scaling the second file's values first
+    bool metricsMatch(const MetricFile& first, const MetricFile& second, const float& secondScale)
+    {
+        if (first.getNumberOfNodes() != second.getNumberOfNodes() || first.getNumberOfColumns() != second.getNumberOfColumns()) return false;
+        for (int col = 0; col < first.getNumberOfColumns(); ++col)
+        {
+            const float* firstData = first.getValuePointerForColumn(col), *secondData = second.getValuePointerForColumn(col);
+            for (int i = 0; i < first.getNumberOfNodes(); ++i)
+            {
+                if (firstData[i] != secondData[i] * secondScale) return false;
+            }
+        }
+        return true;
+    }
+}
+
+void MetricSmoothingTest::execute()
+{
+    const float KERNEL = 4.0f;
+    SurfaceFile mySurf;
+    AlgorithmSurfaceCreateSphere(NULL, 2562, &mySurf);
+    int numNodes = mySurf.getNumberOfNodes();
+    for (int i = 0; i < numNodes; ++i)
+    {//make edge lengths irregular
+        const float* coord = mySurf.getCoordinate(i);
+        float scale = 1.0f + 0.05f * rand() / RAND_MAX;
+        mySurf.setCoordinate(i, coord[0] * scale, coord[1] * scale, coord[2] * scale);
+    }
+    MetricFile input;
+    input.setNumberOfNodesAndColumns(numNodes, 3);
+    vector<float> scratch(numNodes);
+    for (int col = 0; col < 3; ++col)
+    {
+        for (int i = 0; i < numNodes; ++i)
+        {
+            scratch[i] = ((float)rand()) / RAND_MAX - 0.5f;
+        }
+        input.setValuesForColumn(col, scratch.data());
+    }
+    AString oldCacheDir = MetricSmoothingObject::getCacheDirectory();
+    QDir cacheDir(QDir::temp().filePath("wb_smoothing_cache_test_" + QString::number(QCoreApplication::applicationPid())));
+    removeCacheDir(cacheDir);//leftovers from an interrupted run
+    MetricSmoothingObject::setCacheDirectory("");
+    MetricFile computed;
+    smoothWith(&mySurf, KERNEL, &input, &computed);
+    MetricSmoothingObject::setCacheDirectory(cacheDir.path());
+    MetricFile saved, loaded;
+    smoothWith(&mySurf, KERNEL, &input, &saved);//computes the weights and writes them
+    if (countCacheFiles(cacheDir) != 1) setFailed("computing smoothing weights did not write exactly one cache file");
+    if (!metricsMatch(computed, saved, 1.0f)) setFailed("smoothing with the cache directory set changed the output");
+    QStringList cacheNames = cacheDir.entryList(QStringList("*.wbsmoothing"), QDir::Files);
+    QFileInfo cacheInfo(cacheDir.filePath(cacheNames.isEmpty() ? QString() : cacheNames[0]));
+    QDateTime written = cacheInfo.lastModified();
+    SystemUtilities::sleepSeconds(1.5f);//modification times may only have one second resolution
+    smoothWith(&mySurf, KERNEL, &input, &loaded);
+    if (countCacheFiles(cacheDir) != 1) setFailed("identical smoothing inputs did not reuse the cache file");
+    if (!metricsMatch(computed, loaded, 1.0f)) setFailed("smoothing with cached weights differs from computed weights");
+    cacheInfo.refresh();//weights that fail to load get recomputed and written again, so the file must not have changed
+    if (!cacheNames.isEmpty() && cacheInfo.lastModified() != written) setFailed("smoothing weights were not loaded from the cache file");
+    MetricFile otherKernel, otherKernelComputed;
+    smoothWith(&mySurf, KERNEL * 1.5f, &input, &otherKernel);
+    if (countCacheFiles(cacheDir) != 2) setFailed("changing the kernel did not make a new cache entry");
+    MetricSmoothingObject::setCacheDirectory("");
+    smoothWith(&mySurf, KERNEL * 1.5f, &input, &otherKernelComputed);
+    if (!metricsMatch(otherKernelComputed, otherKernel, 1.0f)) setFailed("smoothing with a different kernel used stale cached weights");
+    const float* moved = mySurf.getCoordinate(0);
+    mySurf.setCoordinate(0, moved[0] * 1.01f, moved[1] * 1.01f, moved[2] * 1.01f);
+    MetricFile otherSurf, otherSurfComputed;
+    smoothWith(&mySurf, KERNEL, &input, &otherSurfComputed);
+    MetricSmoothingObject::setCacheDirectory(cacheDir.path());
+    smoothWith(&mySurf, KERNEL, &input, &otherSurf);
+    if (countCacheFiles(cacheDir) != 3) setFailed("changing the surface did not make a new cache entry");
+    if (!metricsMatch(otherSurfComputed, otherSurf, 1.0f)) setFailed("smoothing on a changed surface used stale cached weights");
+    MetricSmoothingObject::setCacheDirectory(oldCacheDir);
+    removeCacheDir(cacheDir);
+}
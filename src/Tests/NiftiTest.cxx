@@ -20,9 +20,15 @@
 
 #include "NiftiTest.h"
 
+#include "CaretOMP.h"
+#include "ElapsedTimer.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
 #include <vector>
 
 using namespace std;
@@ -159,3 +165,164 @@ void NiftiHeaderTest::writeNifti2Header(AString filename, NiftiHeader &header)
     myFile.open(filename, CaretBinaryFile::WRITE_TRUNCATE);
     header.write(myFile, 2);
 }
+
+NiftiParallelReadTest::NiftiParallelReadTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float parallelTestValue(const int64_t& row, const int64_t& col)
+    {
+        return 0.5f * ((row * 31 + col) % 2000 - 1000);//exactly representable after int16 with 0.5 scaling
+    }
+}
+
+void NiftiParallelReadTest::execute()
+{
+    const int64_t ROW_LENGTH = 8192, NUM_ROWS = 2048;//int16, so 32MiB of data
+    AString fileName = QDir::tempPath() + "/wb_niftiparallelread_" + AString::number(QCoreApplication::applicationPid()) + ".nii";
+    NiftiHeader header;
+    vector<int64_t> dims(2);
+    dims[0] = ROW_LENGTH;
+    dims[1] = NUM_ROWS;
+    header.setDimensions(dims);
+    header.setDataType(NIFTI_TYPE_INT16);
+    header.setDataScaling(0.5, 0.0);
+    {
+        NiftiIO writer;
+        writer.writeNew(fileName, header);
+        bool writeFailed = false;
+#pragma omp CARET_PAR
+        {
+            vector<float> row(ROW_LENGTH);
+            vector<int64_t> select(1);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < NUM_ROWS; ++i)
+            {
+                for (int64_t j = 0; j < ROW_LENGTH; ++j)
+                {
+                    row[j] = parallelTestValue(i, j);
+                }
+                select[0] = i;
+                try
+                {
+                    writer.writeData(row.data(), 1, select);
+                } catch (CaretException&) {
+#pragma omp critical
+                    writeFailed = true;
+                }
+            }
+        }
+        writer.close();
+        if (writeFailed)
+        {
+            QFile::remove(fileName);
+            setFailed("exception while writing rows in parallel");
+            return;
+        }
+    }
+    NiftiIO reader;
+    reader.openRead(fileName);
+    int maxThreads = 1;
+#ifdef CARET_OMP
+    maxThreads = omp_get_max_threads();
+#endif
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        int64_t numBad = 0;
+        bool readFailed = false;
+        ElapsedTimer myTimer;
+        myTimer.start();
+#pragma omp CARET_PAR num_threads(numThreads)
+        {
+            vector<float> row(ROW_LENGTH);
+            vector<int64_t> select(1);
+#pragma omp CARET_FOR schedule(dynamic) reduction(+:numBad)
+            for (int64_t i = 0; i < NUM_ROWS; ++i)
+            {
+                select[0] = i;
+                try
+                {
+                    reader.readData(row.data(), 1, select);
+                } catch (CaretException&) {
+#pragma omp critical
+                    readFailed = true;
+                    continue;
+                }
+                for (int64_t j = 0; j < ROW_LENGTH; ++j)
+                {
+                    if (row[j] != parallelTestValue(i, j)) ++numBad;
+                }
+            }
+        }
+        double seconds = myTimer.getElapsedTimeSeconds();
+        if (readFailed || numBad != 0)
+        {
+            reader.close();
+            QFile::remove(fileName);
+            setFailed("rows read with " + AString::number(numThreads) + " threads did not match the written data");
+            return;
+        }
+        double mibRead = NUM_ROWS * ROW_LENGTH * sizeof(int16_t) / 1048576.0;
+        std::cout << numThreads << " thread(s): " << NUM_ROWS << " rows in " << seconds << "s, " << mibRead / seconds << " MiB/s" << std::endl;
+    }
+    reader.close();
+    QFile::remove(fileName);
+}
+
+NiftiGzipSeekTest::NiftiGzipSeekTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void NiftiGzipSeekTest::execute()
+{
+    const int64_t FRAME_SIZE = 64 * 64 * 32, NUM_FRAMES = 24;//float32, so 512KiB per frame, 12MiB total, enough for several access points
+    AString fileName = QDir::tempPath() + "/wb_niftigzipseek_" + AString::number(QCoreApplication::applicationPid()) + ".nii.gz";
+    NiftiHeader header;
+    vector<int64_t> dims(4);
+    dims[0] = 64;
+    dims[1] = 64;
+    dims[2] = 32;
+    dims[3] = NUM_FRAMES;
+    header.setDimensions(dims);
+    header.setDataType(NIFTI_TYPE_FLOAT32);
+    vector<float> frame(FRAME_SIZE);
+    vector<int64_t> select(1);
+    {
+        NiftiIO writer;
+        writer.writeNew(fileName, header);
+        for (int64_t t = 0; t < NUM_FRAMES; ++t)
+        {
+            for (int64_t i = 0; i < FRAME_SIZE; ++i)
+            {
+                frame[i] = (float)((i * 7 + t * 13) % 1009);
+            }
+            select[0] = t;
+            writer.writeData(frame.data(), 3, select);
+        }
+        writer.close();
+    }
+    NiftiIO reader;
+    reader.openRead(fileName);
+    int64_t order[] = { NUM_FRAMES - 1, 0, 5, 3, NUM_FRAMES - 2, 12, 11, 1 };//backwards seeks, forwards seeks past the index, and repeats
+    for (int k = 0; k < (int)(sizeof(order) / sizeof(order[0])); ++k)
+    {
+        int64_t t = order[k];
+        select[0] = t;
+        reader.readData(frame.data(), 3, select);
+        for (int64_t i = 0; i < FRAME_SIZE; ++i)
+        {
+            if (frame[i] != (float)((i * 7 + t * 13) % 1009))
+            {
+                reader.close();
+                QFile::remove(fileName);
+                setFailed("frame " + AString::number(t) + " read from compressed file does not match written data");
+                return;
+            }
+        }
+    }
+    reader.close();
+    QFile::remove(fileName);
+    std::cout << "Out of order frame reads from compressed nifti were correct." << std::endl;
+}
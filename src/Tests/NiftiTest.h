@@ -44,6 +44,22 @@ public:
     void writeNifti2Header(AString filename, NiftiHeader &header);
 };
 
+//checks that concurrent row reads and writes give correct data, and reports row read throughput for increasing thread counts
+class NiftiParallelReadTest : public TestInterface
+{
+public:
+    NiftiParallelReadTest(const AString& identifier);
+    virtual void execute();
+};
+
+//reads frames of a compressed file out of order, to exercise the gzip access point index
+class NiftiGzipSeekTest : public TestInterface
+{
+public:
+    NiftiGzipSeekTest(const AString& identifier);
+    virtual void execute();
+};
+
 
 }
 
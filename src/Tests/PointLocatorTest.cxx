@@ -0,0 +1,233 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PointLocatorTest.h"
+#include "CaretPointLocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+PointLocatorTest::PointLocatorTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    struct TestSet
+    {
+        int32_t m_whichSet;
+        vector<float> m_coords;
+    };
+
+    vector<float> randomCoords(const int& numPoints, const float& offset)
+    {
+        vector<float> ret(numPoints * 3);
+        for (int i = 0; i < numPoints * 3; ++i)
+        {
+            ret[i] = (rand() % 10000) / 200.0f + offset;
+        }
+        return ret;
+    }
+
+    //check single, limited, batch and range queries against brute force over the sets that should be in the locator, returns an error message or empty
+    AString checkSets(const CaretPointLocator& myLocator, const vector<TestSet>& sets, const vector<float>& targets, const float& maxDist)
+    {
+        int numTargets = (int)targets.size() / 3;
+        vector<int64_t> batchClosest, batchLimited;
+        vector<int32_t> batchSets, batchLimitedSets;
+        myLocator.closestPoints(targets.data(), numTargets, batchClosest, -1.0f, &batchSets);
+        myLocator.closestPoints(targets.data(), numTargets, batchLimited, maxDist, &batchLimitedSets);
+        vector<LocatorInfo> found;
+        for (int t = 0; t < numTargets; ++t)
+        {
+            Vector3D target(targets.data() + t * 3);
+            float bestDist2 = -1.0f;
+            vector<LocatorInfo> expected;
+            for (int s = 0; s < (int)sets.size(); ++s)
+            {
+                for (int i = 0; i < (int)sets[s].m_coords.size() / 3; ++i)
+                {
+                    Vector3D point(sets[s].m_coords.data() + i * 3);
+                    float dist2 = (point - target).lengthsquared();
+                    if (bestDist2 < 0.0f || dist2 < bestDist2) bestDist2 = dist2;
+                    if (dist2 <= maxDist * maxDist) expected.push_back(LocatorInfo(i, sets[s].m_whichSet, point));
+                }
+            }
+            sort(expected.begin(), expected.end());
+            LocatorInfo closestInfo(-2, -2, Vector3D()), limitedInfo(-2, -2, Vector3D());
+            int64_t closest = myLocator.closestPoint(target, &closestInfo);
+            int64_t limited = myLocator.closestPointLimited(target, maxDist, &limitedInfo);
+            if (sets.empty())
+            {
+                if (closest != -1 || closestInfo.whichSet != -1 || limited != -1 || batchClosest[t] != -1 || batchSets[t] != -1)
+                {
+                    return "empty locator found a point";
+                }
+                continue;
+            }
+            int whichTestSet = -1;
+            for (int s = 0; s < (int)sets.size(); ++s)
+            {
+                if (sets[s].m_whichSet == closestInfo.whichSet) whichTestSet = s;
+            }
+            if (whichTestSet < 0 || closest != closestInfo.index || closest < 0 || closest * 3 >= (int64_t)sets[whichTestSet].m_coords.size())
+            {
+                return "closest point for target " + AString::number(t) + " is not from a point set in the locator";
+            }
+            Vector3D closestCoords(sets[whichTestSet].m_coords.data() + closest * 3);
+            if ((closestCoords - target).lengthsquared() != bestDist2 || (closestInfo.coords - closestCoords).lengthsquared() != 0.0f)
+            {
+                return "closest point wrong for target " + AString::number(t);
+            }
+            if (batchClosest[t] != closest || batchSets[t] != closestInfo.whichSet)
+            {
+                return "single and batch closest point disagree for target " + AString::number(t);
+            }
+            if (limited < 0)
+            {//allow for rounding differences right at the limit
+                if (bestDist2 < maxDist * maxDist * 0.9999f || limitedInfo.whichSet != -1) return "limited closest point missed a point for target " + AString::number(t);
+            } else {
+                if (bestDist2 > maxDist * maxDist * 1.0001f || (limitedInfo.coords - target).lengthsquared() != bestDist2)
+                {
+                    return "limited closest point wrong for target " + AString::number(t);
+                }
+            }
+            if (batchLimited[t] != limited || batchLimitedSets[t] != limitedInfo.whichSet)
+            {
+                return "single and batch limited closest point disagree for target " + AString::number(t);
+            }
+            myLocator.pointsInRange(target, maxDist, found);
+            if (found.size() != expected.size())
+            {
+                return "wrong number of points in range for target " + AString::number(t);
+            }
+            for (int i = 0; i < (int)found.size(); ++i)
+            {
+                if (!(found[i] == expected[i])) return "wrong points in range for target " + AString::number(t);
+            }
+        }
+        return "";
+    }
+}
+
+void PointLocatorTest::execute()
+{
+    const int NUM_POINTS = 3000;
+    const int NUM_TARGETS = 500;
+    const float RANGE = 4.0f;
+    vector<float> coords(NUM_POINTS * 3), targets(NUM_TARGETS * 3);
+    for (int i = 0; i < NUM_POINTS * 3; ++i)
+    {
+        coords[i] = (rand() % 10000) / 200.0f;//include some duplicates
+    }
+    for (int i = 0; i < NUM_TARGETS * 3; ++i)
+    {
+        targets[i] = (rand() % 12000) / 200.0f - 5.0f;//some outside the bounding box
+    }
+    CaretPointLocator myLocator(coords.data(), NUM_POINTS);
+    vector<int64_t> closest, offsets;
+    vector<LocatorInfo> inRange, single;
+    myLocator.closestPoints(targets.data(), NUM_TARGETS, closest);
+    myLocator.pointsInRange(targets.data(), NUM_TARGETS, RANGE, offsets, inRange);
+    if ((int)closest.size() != NUM_TARGETS || (int)offsets.size() != NUM_TARGETS + 1)
+    {
+        setFailed("batch output has wrong size");
+        return;
+    }
+    for (int t = 0; t < NUM_TARGETS; ++t)
+    {
+        Vector3D target(targets.data() + t * 3);
+        float bestDist2 = -1.0f;
+        int rangeCount = 0;
+        for (int i = 0; i < NUM_POINTS; ++i)
+        {
+            float dist2 = (Vector3D(coords.data() + i * 3) - target).lengthsquared();
+            if (bestDist2 < 0.0f || dist2 < bestDist2) bestDist2 = dist2;
+            if (dist2 <= RANGE * RANGE) ++rangeCount;
+        }
+        if ((Vector3D(coords.data() + closest[t] * 3) - target).lengthsquared() != bestDist2)
+        {
+            setFailed("batch closest point wrong for target " + AString::number(t));
+        }
+        if (myLocator.closestPoint(target) != closest[t])
+        {
+            setFailed("single and batch closest point disagree for target " + AString::number(t));
+        }
+        myLocator.pointsInRange(target, RANGE, single);
+        if ((int)single.size() != rangeCount || offsets[t + 1] - offsets[t] != rangeCount)
+        {
+            setFailed("wrong number of points in range for target " + AString::number(t));
+            continue;
+        }
+        for (int i = 0; i < rangeCount; ++i)
+        {
+            if (!(single[i] == inRange[offsets[t] + i]))
+            {
+                setFailed("single and batch range query disagree for target " + AString::number(t));
+                break;
+            }
+        }
+    }
+    //multiple point sets, starting empty, with removal and reuse of set numbers
+    float minBounds[3] = { 0.0f, 0.0f, 0.0f }, maxBounds[3] = { 50.0f, 50.0f, 50.0f };
+    CaretPointLocator multiLocator(minBounds, maxBounds);
+    vector<TestSet> sets;
+    vector<float> multiTargets(targets.begin(), targets.begin() + 200 * 3);
+    AString error = checkSets(multiLocator, sets, multiTargets, RANGE);
+    if (!error.isEmpty()) setFailed("empty locator: " + error);
+    for (int s = 0; s < 3; ++s)
+    {
+        TestSet newSet;
+        newSet.m_coords = randomCoords(800 + 300 * s, 5.0f * s);//overlapping, but shifted so each set is closest in some places
+        newSet.m_whichSet = multiLocator.addPointSet(newSet.m_coords.data(), newSet.m_coords.size() / 3);
+        for (int i = 0; i < (int)sets.size(); ++i)
+        {
+            if (sets[i].m_whichSet == newSet.m_whichSet) setFailed("addPointSet returned a set number that is in use");
+        }
+        sets.push_back(newSet);
+        error = checkSets(multiLocator, sets, multiTargets, RANGE);
+        if (!error.isEmpty()) setFailed("after adding set " + AString::number(s) + ": " + error);
+    }
+    multiLocator.removePointSet(sets[1].m_whichSet);
+    sets.erase(sets.begin() + 1);
+    error = checkSets(multiLocator, sets, multiTargets, RANGE);
+    if (!error.isEmpty()) setFailed("after removing a set: " + error);
+    TestSet reusedSet;
+    reusedSet.m_coords = randomCoords(500, 2.5f);
+    reusedSet.m_whichSet = multiLocator.addPointSet(reusedSet.m_coords.data(), reusedSet.m_coords.size() / 3);
+    for (int i = 0; i < (int)sets.size(); ++i)
+    {
+        if (sets[i].m_whichSet == reusedSet.m_whichSet) setFailed("addPointSet after removal returned a set number that is in use");
+    }
+    sets.push_back(reusedSet);
+    error = checkSets(multiLocator, sets, multiTargets, RANGE);
+    if (!error.isEmpty()) setFailed("after adding a set following removal: " + error);
+    while (!sets.empty())
+    {
+        multiLocator.removePointSet(sets.back().m_whichSet);
+        sets.pop_back();
+    }
+    error = checkSets(multiLocator, sets, multiTargets, RANGE);
+    if (!error.isEmpty()) setFailed("after removing all sets: " + error);
+}
@@ -0,0 +1,186 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ProfileTraceTest.h"
+
+#include "AbstractAlgorithm.h"
+#include "CaretProfiler.h"
+#include "ProgressObject.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+ProfileTraceTest::ProfileTraceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const char* ROOT_NAME = "profile test root";
+
+    volatile double s_sink = 0.0;
+
+    void busyWork()
+    {//enough that spans have some duration
+        double accum = 0.0;
+        for (int i = 1; i < 200000; ++i)
+        {
+            accum += sqrt((double)i);
+        }
+        s_sink = s_sink + accum;
+    }
+
+    class TraceAlgorithm : public AbstractAlgorithm
+    {
+    public:
+        TraceAlgorithm(ProgressObject* myProgObj, const int& depth) : AbstractAlgorithm(myProgObj)
+        {
+            ProgressObject* subProgress = NULL;
+            if (myProgObj != NULL && depth > 0)
+            {
+                subProgress = myProgObj->addAlgorithm(1.0f);
+            }
+            LevelProgress myProgress(myProgObj);
+            myProgress.setTask("first task");
+            busyWork();
+            if (depth > 0)
+            {
+                myProgress.setTask("subalgorithm task");
+                TraceAlgorithm(subProgress, depth - 1);
+            }
+            myProgress.setTask("last task");
+            busyWork();
+        }
+    };
+
+    struct TraceSpan
+    {
+        AString m_name, m_category;
+        double m_start, m_end;
+        int m_thread;
+        bool contains(const TraceSpan& other) const { return m_start <= other.m_start && other.m_end <= m_end; }
+        bool disjoint(const TraceSpan& other) const { return m_end <= other.m_start || other.m_end <= m_start; }
+    };
+
+    int countSpans(const vector<TraceSpan>& spans, const AString& category, const AString& name)
+    {
+        int ret = 0;
+        for (int i = 0; i < (int)spans.size(); ++i)
+        {
+            if (spans[i].m_category == category && spans[i].m_name == name) ++ret;
+        }
+        return ret;
+    }
+}
+
+void ProfileTraceTest::execute()
+{
+    AString traceName = QDir::temp().filePath("wb_profile_trace_test_" + QString::number(QCoreApplication::applicationPid()) + ".json");
+    if (!CaretProfiler::enable(traceName))
+    {
+        setFailed("unable to open trace file '" + traceName + "'");
+        return;
+    }
+    {
+        CaretProfiler::Span commandSpan("command", "profile test");
+        ProgressObject myProgress(1.0f);
+        myProgress.setProfileName(ROOT_NAME);
+        for (int run = 0; run < 2; ++run)
+        {//like an operation that runs two algorithms with the progress object it was given
+            TraceAlgorithm(&myProgress, 1);
+        }
+    }
+    CaretProfiler::writeTrace();
+    QFile traceFile(traceName);
+    if (!traceFile.open(QIODevice::ReadOnly))
+    {
+        setFailed("trace file was not written");
+        return;
+    }
+    QByteArray contents = traceFile.readAll();
+    traceFile.close();
+    QFile::remove(traceName);
+    QJsonParseError parseError;
+    QJsonDocument myDoc = QJsonDocument::fromJson(contents, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !myDoc.isObject())
+    {
+        setFailed("trace file is not valid JSON: " + parseError.errorString());
+        return;
+    }
+    QJsonObject root = myDoc.object();
+    if (!root.value("traceEvents").isArray() || !root.value("otherData").isObject())
+    {
+        setFailed("trace file is missing traceEvents or otherData");
+        return;
+    }
+    QJsonArray events = root.value("traceEvents").toArray();
+    vector<TraceSpan> spans;
+    for (int i = 0; i < events.size(); ++i)
+    {
+        QJsonObject event = events.at(i).toObject();
+        if (!event.value("name").isString() || !event.value("ph").isString() || !event.value("pid").isDouble())
+        {
+            setFailed("trace event " + AString::number(i) + " is missing name, ph or pid");
+            continue;
+        }
+        if (event.value("ph").toString() != "X") continue;
+        if (!event.value("cat").isString() || !event.value("ts").isDouble() || !event.value("dur").isDouble() ||
+            !event.value("tid").isDouble() || !event.value("args").isObject())
+        {
+            setFailed("span event " + AString::number(i) + " is missing cat, ts, dur, tid or args");
+            continue;
+        }
+        TraceSpan mySpan;
+        mySpan.m_name = event.value("name").toString();
+        mySpan.m_category = event.value("cat").toString();
+        mySpan.m_start = event.value("ts").toDouble();
+        mySpan.m_end = mySpan.m_start + event.value("dur").toDouble();
+        mySpan.m_thread = event.value("tid").toInt();
+        if (mySpan.m_start < 0.0 || mySpan.m_end < mySpan.m_start) setFailed("span '" + mySpan.m_name + "' has a negative time or duration");
+        if (!event.value("args").toObject().value("cpu_ms").isDouble()) setFailed("span '" + mySpan.m_name + "' has no cpu time");
+        spans.push_back(mySpan);
+    }
+    if (countSpans(spans, "command", "profile test") != 1) setFailed("command span is missing");
+    if (countSpans(spans, "algorithm", ROOT_NAME) != 2) setFailed("expected a span for each algorithm run with the root progress object, found " +
+                                                                 AString::number(countSpans(spans, "algorithm", ROOT_NAME)));
+    if (countSpans(spans, "algorithm", "subalgorithm task") != 2) setFailed("expected a span for each subalgorithm, named by the parent's task");
+    if (countSpans(spans, "task", "first task") != 4 || countSpans(spans, "task", "last task") != 4) setFailed("task spans are missing");
+    for (int i = 0; i < (int)spans.size(); ++i)
+    {//spans on one thread have to nest, or trace viewers draw them wrong
+        for (int j = i + 1; j < (int)spans.size(); ++j)
+        {
+            if (spans[i].m_thread != spans[j].m_thread) continue;
+            if (!spans[i].disjoint(spans[j]) && !spans[i].contains(spans[j]) && !spans[j].contains(spans[i]))
+            {
+                setFailed("spans '" + spans[i].m_name + "' and '" + spans[j].m_name + "' overlap without nesting");
+            }
+        }
+    }
+}
@@ -18,6 +18,7 @@
  */
 /*LICENSE_END*/
 #include "StatisticsTest.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
 
@@ -76,4 +77,42 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    const int BLOCK_SIZE = 1000;//not a divisor, so the last block is short
+    FastStatistics::Partial myMergedPartial;
+    for (int start = 0; start < NUM_ELEMENTS; start += BLOCK_SIZE)
+    {
+        FastStatistics::Partial myBlockPartial;
+        myBlockPartial.add(myData.data() + start, min(BLOCK_SIZE, NUM_ELEMENTS - start));
+        myMergedPartial.merge(myBlockPartial);
+    }
+    FastStatistics myMergedStats, myOddBlocks;
+    myMergedStats.startStreaming(myMergedPartial);
+    myOddBlocks = myMergedStats;
+    for (int start = 0; start < NUM_ELEMENTS; start += BLOCK_SIZE)
+    {
+        ((start / BLOCK_SIZE) % 2 ? myOddBlocks : myMergedStats).addStreamingData(myData.data() + start, min(BLOCK_SIZE, NUM_ELEMENTS - start));
+    }
+    myMergedStats.mergeStreamingData(myOddBlocks);
+    myMergedStats.finishStreaming();
+    if (myMergedStats.getMin() != myFastStats.getMin() || myMergedStats.getMax() != myFastStats.getMax())
+    {
+        setFailed("mismatch in merged min or max");
+    }
+    if (abs(myMergedStats.getMean() - myFastStats.getMean()) > exacttolerance)
+    {
+        setFailed(AString("mismatch in merged mean, single: ") + AString::number(myFastStats.getMean()) + ", merged: " + AString::number(myMergedStats.getMean()));
+    }
+    if (abs(myMergedStats.getSampleStdDev() - myFastStats.getSampleStdDev()) > exacttolerance)
+    {
+        setFailed(AString("mismatch in merged sample stddev, single: ") + AString::number(myFastStats.getSampleStdDev()) + ", merged: " + AString::number(myMergedStats.getSampleStdDev()));
+    }
+    for (float percent = 5.0f; percent < 100.0f; percent += 5.0f)
+    {//histograms are exact counts, so the merged percentiles should be identical
+        if (myMergedStats.getApproxPositivePercentile(percent) != myFastStats.getApproxPositivePercentile(percent) ||
+            myMergedStats.getApproxNegativePercentile(percent) != myFastStats.getApproxNegativePercentile(percent) ||
+            myMergedStats.getApproxAbsolutePercentile(percent) != myFastStats.getApproxAbsolutePercentile(percent))
+        {
+            setFailed(AString("mismatch in merged percentile ") + AString::number(percent));
+        }
+    }
 }
@@ -0,0 +1,169 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceHelperCacheTest.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "CaretOMP.h"
+#include "SurfaceFile.h"
+#include "SurfaceHelperCache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SurfaceHelperCacheTest::SurfaceHelperCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const char* TEST_KIND = "wbcachetest";
+
+    void removeCacheDir(const QDir& cacheDir)
+    {//QDir::removeRecursively is Qt5 only
+        QStringList entries = cacheDir.entryList(QDir::Files);
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            QFile::remove(cacheDir.filePath(entries[i]));
+        }
+        QDir().rmdir(cacheDir.path());
+    }
+
+    struct TestData
+    {
+        int32_t m_value;
+        vector<float> m_flat;
+        vector<vector<int32_t> > m_nested;
+    };
+
+    bool writeData(const AString& fileName, const TestData& data)
+    {
+        SurfaceHelperCache myCache;
+        if (!myCache.openWrite(fileName)) return false;
+        myCache.writeValue(data.m_value);
+        myCache.writeVector(data.m_flat);
+        myCache.writeNested(data.m_nested);
+        return myCache.finish();
+    }
+
+    bool readData(const AString& fileName, TestData& data)
+    {
+        SurfaceHelperCache myCache;
+        if (!myCache.openRead(fileName)) return false;
+        return myCache.readValue(data.m_value) && myCache.readVector(data.m_flat) && myCache.readNested(data.m_nested) && myCache.finish();
+    }
+
+    bool dataMatches(const TestData& first, const TestData& second)
+    {
+        return first.m_value == second.m_value && first.m_flat == second.m_flat && first.m_nested == second.m_nested;
+    }
+}
+
+void SurfaceHelperCacheTest::execute()
+{
+    SurfaceFile mySurf;
+    AlgorithmSurfaceCreateSphere(NULL, 642, &mySurf);
+    int numNodes = mySurf.getNumberOfNodes();
+    TestData original;
+    original.m_value = 12345;
+    original.m_nested.resize(numNodes);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        original.m_flat.push_back(mySurf.getCoordinate(i)[0]);
+        for (int j = 0; j < i % 5; ++j)//includes empty lists
+        {
+            original.m_nested[i].push_back(i * 7 + j);
+        }
+    }
+    AString oldCacheDir = SurfaceHelperCache::getCacheDirectory();
+    QDir cacheDir(QDir::temp().filePath("wb_helper_cache_test_" + QString::number(QCoreApplication::applicationPid())));
+    removeCacheDir(cacheDir);//leftovers from an interrupted run
+    SurfaceHelperCache::setCacheDirectory(cacheDir.path());
+    int32_t extra = 1;
+    AString fileName = SurfaceHelperCache::getCacheFileName(&mySurf, TEST_KIND, 1, &extra, sizeof(extra));
+    if (SurfaceHelperCache::getCacheFileName(cacheDir.path(), &mySurf, TEST_KIND, 1, &extra, sizeof(extra)) != fileName)
+    {
+        setFailed("cache file name in an explicit directory differs from the cache directory one");
+    }
+    int32_t otherExtra = 2;
+    if (SurfaceHelperCache::getCacheFileName(&mySurf, TEST_KIND, 1, &otherExtra, sizeof(otherExtra)) == fileName ||
+        SurfaceHelperCache::getCacheFileName(&mySurf, TEST_KIND, 2, &extra, sizeof(extra)) == fileName)
+    {
+        setFailed("changing the extra data or kind version did not change the cache file name");
+    }
+    TestData loaded;
+    if (readData(fileName, loaded)) setFailed("read a cache file that was never written");
+    if (!writeData(fileName, original)) setFailed("unable to write cache file");
+    if (!readData(fileName, loaded) || !dataMatches(original, loaded)) setFailed("cache file round trip changed the data");
+    if (!cacheDir.entryList(QStringList("*.tmp"), QDir::Files).isEmpty()) setFailed("writing a cache file left a temporary file");
+    QFile cacheFile(fileName);
+    QByteArray contents;
+    if (cacheFile.open(QIODevice::ReadOnly))
+    {
+        contents = cacheFile.readAll();
+        cacheFile.close();
+    } else {
+        setFailed("unable to read cache file contents");
+    }
+    AString truncatedName = SurfaceHelperCache::getCacheFileName(&mySurf, TEST_KIND, 3, &extra, sizeof(extra));
+    QFile truncatedFile(truncatedName);//stored name has to match, so write it with the right header first
+    if (writeData(truncatedName, original) && truncatedFile.open(QIODevice::ReadWrite) && truncatedFile.resize(truncatedFile.size() - 3))
+    {
+        truncatedFile.close();
+        if (readData(truncatedName, loaded)) setFailed("truncated cache file was accepted");
+    } else {
+        setFailed("unable to make truncated cache file");
+    }
+    const float* moved = mySurf.getCoordinate(5);
+    mySurf.setCoordinate(5, moved[0] * 1.01f, moved[1], moved[2]);
+    AString movedName = SurfaceHelperCache::getCacheFileName(&mySurf, TEST_KIND, 1, &extra, sizeof(extra));
+    if (movedName == fileName) setFailed("moving a vertex did not change the cache file name");
+    if (readData(movedName, loaded)) setFailed("cache file was found for a changed surface");
+    QFile staleFile(movedName);//a file from another surface under this surface's name, as if copied or renamed
+    if (staleFile.open(QIODevice::WriteOnly | QIODevice::Truncate) && staleFile.write(contents) == contents.size())
+    {
+        staleFile.close();
+        if (readData(movedName, loaded)) setFailed("cache file stored under a different hash was accepted");
+    } else {
+        setFailed("unable to make stale cache file");
+    }
+    QFile::remove(movedName);
+    const int NUM_WRITERS = 16;
+    vector<char> writeOk(NUM_WRITERS, 0);
+#pragma omp CARET_PARFOR schedule(static, 1)
+    for (int i = 0; i < NUM_WRITERS; ++i)
+    {//several threads building the same helper at once must not share a temporary file
+        writeOk[i] = writeData(movedName, original);
+    }
+    for (int i = 0; i < NUM_WRITERS; ++i)
+    {
+        if (!writeOk[i]) setFailed("concurrent write of cache file failed");
+    }
+    if (!readData(movedName, loaded) || !dataMatches(original, loaded)) setFailed("concurrently written cache file is not valid");
+    if (!cacheDir.entryList(QStringList("*.tmp"), QDir::Files).isEmpty()) setFailed("concurrent writes left a temporary file");
+    SurfaceHelperCache::setCacheDirectory(oldCacheDir);
+    removeCacheDir(cacheDir);
+}
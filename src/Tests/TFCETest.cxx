@@ -0,0 +1,160 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TFCETest.h"
+#include "TFCEUnionFind.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TFCETest::TFCETest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int GRID_X = 30, GRID_Y = 20;
+
+    void gridNeighbors(const int& index, vector<int>& neighOut)
+    {
+        neighOut.clear();
+        int x = index % GRID_X, y = index / GRID_X;
+        if (x > 0) neighOut.push_back(index - 1);
+        if (x < GRID_X - 1) neighOut.push_back(index + 1);
+        if (y > 0) neighOut.push_back(index - GRID_X);
+        if (y < GRID_Y - 1) neighOut.push_back(index + GRID_X);
+    }
+
+    //integrate every threshold slice directly: between consecutive distinct values, each element gets its cluster's extent^E * integral of h^H
+    void bruteForce(const vector<float>& values, const vector<float>& areas, const float& param_e, const float& param_h, vector<double>& accumOut)
+    {
+        int numElems = (int)values.size();
+        accumOut.assign(numElems, 0.0);
+        vector<float> levels;
+        for (int i = 0; i < numElems; ++i)
+        {
+            if (values[i] > 0.0f) levels.push_back(values[i]);
+        }
+        sort(levels.begin(), levels.end());
+        levels.erase(unique(levels.begin(), levels.end()), levels.end());
+        double integrated_h = param_h + 1.0f;
+        vector<int> label(numElems), stack, neighbors, members;
+        for (int level = (int)levels.size() - 1; level >= 0; --level)
+        {
+            float top = levels[level], bottom = (level > 0 ? levels[level - 1] : 0.0f);
+            double slice = (pow((double)top, integrated_h) - pow((double)bottom, integrated_h)) / integrated_h;
+            label.assign(numElems, 0);
+            for (int seed = 0; seed < numElems; ++seed)
+            {
+                if (label[seed] != 0 || values[seed] < top) continue;
+                label[seed] = 1;
+                stack.assign(1, seed);
+                members.clear();
+                double extent = 0.0;
+                while (!stack.empty())
+                {
+                    int elem = stack.back();
+                    stack.pop_back();
+                    members.push_back(elem);
+                    extent += areas[elem];
+                    gridNeighbors(elem, neighbors);
+                    for (int n = 0; n < (int)neighbors.size(); ++n)
+                    {
+                        if (label[neighbors[n]] == 0 && values[neighbors[n]] >= top)
+                        {
+                            label[neighbors[n]] = 1;
+                            stack.push_back(neighbors[n]);
+                        }
+                    }
+                }
+                double contribution = pow(extent, (double)param_e) * slice;
+                for (int m = 0; m < (int)members.size(); ++m)
+                {
+                    accumOut[members[m]] += contribution;
+                }
+            }
+        }
+    }
+}
+
+void TFCETest::execute()
+{
+    const int numElems = GRID_X * GRID_Y;
+    const int NUM_TRIALS = 20;
+    TFCEUnionFind workspace;//reuse across all trials, like the algorithms do per thread
+    vector<float> values(numElems), areas(numElems);
+    vector<double> fast, slow;
+    vector<int> neighbors;
+    for (int trial = 0; trial < NUM_TRIALS; ++trial)
+    {
+        float param_e = (trial % 2 == 0 ? 0.5f : 1.0f), param_h = (trial % 3 == 0 ? 2.0f : 1.5f);
+        for (int i = 0; i < numElems; ++i)
+        {
+            values[i] = (rand() % 41 - 15) / 4.0f;//coarse values, to get lots of ties and zeros
+            areas[i] = 0.5f + (rand() % 100) / 100.0f;
+        }
+        workspace.reset(numElems, param_e, param_h);
+        for (int i = 0; i < numElems; ++i)
+        {
+            if (values[i] > 0.0f) workspace.addCandidate(i, values[i]);
+        }
+        const vector<pair<float, int64_t> >& order = workspace.sortCandidates();
+        for (int i = 0; i < (int)order.size(); ++i)
+        {
+            gridNeighbors((int)order[i].second, neighbors);
+            workspace.addElement(order[i].second, order[i].first, areas[order[i].second], neighbors.data(), (int)neighbors.size());
+        }
+        fast.assign(numElems, 0.0);
+        workspace.finish(fast.data());
+        bruteForce(values, areas, param_e, param_h, slow);
+        for (int i = 0; i < numElems; ++i)
+        {
+            if (abs(fast[i] - slow[i]) > 1e-9 * max(1.0, abs(slow[i])))
+            {
+                setFailed("union-find TFCE differs from brute force in trial " + AString::number(trial) + " at element " + AString::number(i) +
+                          ": " + AString::number(fast[i]) + " vs " + AString::number(slow[i]));
+                return;
+            }
+        }
+    }
+    const int NUM_SUBJECTS = 40, NUM_FLIPS = 100;//with 40 subjects, two independent flip sets should essentially never match
+    for (int seed = 0; seed < 5; ++seed)
+    {
+        vector<vector<char> > first(NUM_FLIPS, vector<char>(NUM_SUBJECTS)), second(NUM_FLIPS, vector<char>(NUM_SUBJECTS));
+        for (int flip = 0; flip < NUM_FLIPS; ++flip)
+        {
+            tfceSignFlips(seed, flip, first[flip]);
+            tfceSignFlips(seed + 1, flip, second[flip]);
+        }
+        sort(second.begin(), second.end());
+        for (int flip = 0; flip < NUM_FLIPS; ++flip)
+        {
+            if (binary_search(second.begin(), second.end(), first[flip]))
+            {
+                setFailed("seeds " + AString::number(seed) + " and " + AString::number(seed + 1) + " share a sign flip set");
+                return;
+            }
+        }
+    }
+}
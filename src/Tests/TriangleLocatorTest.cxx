@@ -0,0 +1,228 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TriangleLocatorTest.h"
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "CaretTriangleLocator.h"
+#include "SurfaceFile.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TriangleLocatorTest::TriangleLocatorTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float randFloat(const float& low, const float& high)
+    {
+        return low + (high - low) * rand() / RAND_MAX;
+    }
+    
+    //smallest hit distance over all triangles, or -1 for no hit, the barycentric test is widened by tolerance (negative shrinks it)
+    double bruteForceRay(const SurfaceFile& mySurf, const Vector3D& origin, const Vector3D& direction, const double& tolerance)
+    {
+        double best = -1.0;
+        int numTris = mySurf.getNumberOfTriangles();
+        for (int t = 0; t < numTris; ++t)
+        {
+            const int32_t* tri = mySurf.getTriangle(t);
+            Vector3D v0(mySurf.getCoordinate(tri[0])), v1(mySurf.getCoordinate(tri[1])), v2(mySurf.getCoordinate(tri[2]));
+            Vector3D normal = (v1 - v0).cross(v2 - v0);
+            double denom = normal.dot(direction);
+            if (denom == 0.0) continue;
+            double dist = normal.dot(v0 - origin) / denom;
+            if (dist < 0.0) continue;
+            Vector3D point = origin + direction * dist;
+            double area2 = normal.lengthsquared();//barycentric coordinates from signed sub-areas
+            double w0 = normal.dot((v1 - point).cross(v2 - point)) / area2;
+            double w1 = normal.dot((v2 - point).cross(v0 - point)) / area2;
+            double w2 = normal.dot((v0 - point).cross(v1 - point)) / area2;
+            if (w0 < -tolerance || w1 < -tolerance || w2 < -tolerance) continue;
+            if (best < 0.0 || dist < best) best = dist;
+        }
+        return best;
+    }
+    
+    Vector3D closestOnSegment(const Vector3D& a, const Vector3D& b, const Vector3D& p)
+    {
+        Vector3D ab = b - a;
+        float len2 = ab.lengthsquared();
+        if (len2 == 0.0f) return a;
+        float t = (p - a).dot(ab) / len2;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+        return a + ab * t;
+    }
+    
+    float bruteForceClosest(const SurfaceFile& mySurf, const Vector3D& target)
+    {
+        float best = -1.0f;
+        int numTris = mySurf.getNumberOfTriangles();
+        for (int t = 0; t < numTris; ++t)
+        {
+            const int32_t* tri = mySurf.getTriangle(t);
+            Vector3D v[3] = { Vector3D(mySurf.getCoordinate(tri[0])), Vector3D(mySurf.getCoordinate(tri[1])), Vector3D(mySurf.getCoordinate(tri[2])) };
+            Vector3D normal = (v[1] - v[0]).cross(v[2] - v[0]).normal();
+            Vector3D projected = target - normal * normal.dot(target - v[0]);
+            bool inside = true;
+            for (int i = 0; i < 3; ++i)
+            {
+                if ((v[(i + 1) % 3] - v[i]).cross(projected - v[i]).dot(normal) < 0.0f) inside = false;
+            }
+            float dist;
+            if (inside)
+            {
+                dist = (projected - target).length();
+            } else {
+                dist = -1.0f;
+                for (int i = 0; i < 3; ++i)
+                {
+                    float edgeDist = (closestOnSegment(v[i], v[(i + 1) % 3], target) - target).length();
+                    if (dist < 0.0f || edgeDist < dist) dist = edgeDist;
+                }
+            }
+            if (best < 0.0f || dist < best) best = dist;
+        }
+        return best;
+    }
+    
+    //the returned point must be the weighted sum of the triangle's vertices, and the nearest vertex must be nearest
+    bool infoConsistent(const SurfaceFile& mySurf, const TriangleLocatorInfo& info, const float& tolerance)
+    {
+        if (info.triangle < 0 || info.triangle >= mySurf.getNumberOfTriangles()) return false;
+        const int32_t* tri = mySurf.getTriangle(info.triangle);
+        Vector3D weighted;
+        float bestVertDist = -1.0f;
+        int32_t bestVert = -1;
+        for (int i = 0; i < 3; ++i)
+        {
+            Vector3D vert(mySurf.getCoordinate(tri[i]));
+            weighted += vert * info.weights[i];
+            float vertDist = (vert - info.point).length();
+            if (bestVert < 0 || vertDist < bestVertDist)
+            {
+                bestVertDist = vertDist;
+                bestVert = tri[i];
+            }
+        }
+        return (weighted - info.point).length() <= tolerance && bestVert == info.nearestVertex;
+    }
+}
+
+void TriangleLocatorTest::execute()
+{
+    SurfaceFile mySurf;
+    AlgorithmSurfaceCreateSphere(NULL, 2562, &mySurf);
+    int numNodes = mySurf.getNumberOfNodes(), numTris = mySurf.getNumberOfTriangles();
+    for (int i = 0; i < numNodes; ++i)
+    {//bumpy, so that rays can have more than one hit on the near side
+        const float* coord = mySurf.getCoordinate(i);
+        float scale = randFloat(0.98f, 1.02f);
+        mySurf.setCoordinate(i, coord[0] * scale, coord[1] * scale, coord[2] * scale);
+    }
+    CaretTriangleLocator myLocator(mySurf.getCoordinateData(), numNodes, mySurf.getTriangle(0), numTris);
+    const float TOLERANCE = 0.001f;//the sphere has radius 100, distances are computed in float
+    const int NUM_RAYS = 300;
+    for (int r = 0; r < NUM_RAYS; ++r)
+    {
+        Vector3D origin(randFloat(-150.0f, 150.0f), randFloat(-150.0f, 150.0f), randFloat(-150.0f, 150.0f));
+        Vector3D direction(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+        if (r % 10 == 0) direction = Vector3D(0.0f, 0.0f, (r % 20 == 0 ? 1.0f : -1.0f));//axis aligned, infinite inverse components
+        direction *= randFloat(0.5f, 2.0f);//distances are in units of direction's length
+        float maxDist = (r % 3 == 0 ? randFloat(10.0f, 200.0f) : -1.0f);
+        double strict = bruteForceRay(mySurf, origin, direction, -1e-5), loose = bruteForceRay(mySurf, origin, direction, 1e-5);
+        if (maxDist > 0.0f)
+        {
+            if (strict > maxDist) strict = -1.0;
+            if (loose > maxDist) loose = -1.0;
+        }
+        TriangleLocatorInfo info;
+        bool hit = myLocator.intersectRay(origin, direction, info, maxDist);
+        if (hit)
+        {
+            if (loose < 0.0 || (strict >= 0.0 && info.distance > strict + TOLERANCE) || info.distance < loose - TOLERANCE)
+            {
+                setFailed("intersectRay found the wrong hit for random ray " + AString::number(r));
+            } else if (!infoConsistent(mySurf, info, TOLERANCE) || (origin + direction * info.distance - info.point).length() > TOLERANCE) {
+                setFailed("intersectRay returned inconsistent hit information for random ray " + AString::number(r));
+            }
+        } else if (strict >= 0.0) {
+            setFailed("intersectRay missed random ray " + AString::number(r));
+        }
+    }
+    for (int i = 0; i < 200; ++i)
+    {//rays aimed exactly at vertices and edge midpoints must not slip through the cracks between triangles
+        const int32_t* tri = mySurf.getTriangle(rand() % numTris);
+        Vector3D target(mySurf.getCoordinate(tri[0]));
+        AString kind = "vertex";
+        if (i % 2 == 1)
+        {
+            target = (target + Vector3D(mySurf.getCoordinate(tri[1]))) / 2.0f;
+            kind = "edge";
+        }
+        Vector3D direction = -target.normal();
+        if (i % 4 >= 2)
+        {//axis aligned, exactly through the point in the other two coordinates, use the axis closest to the normal so the ray can't graze a fold of the bumps
+            int axis = 0;
+            for (int j = 1; j < 3; ++j)
+            {
+                if (abs(target[j]) > abs(target[axis])) axis = j;
+            }
+            direction = Vector3D();
+            direction[axis] = (target[axis] > 0.0f ? -1.0f : 1.0f);
+        }
+        Vector3D origin = target - direction * 200.0f;
+        double loose = bruteForceRay(mySurf, origin, direction, 1e-5);
+        TriangleLocatorInfo info;
+        if (!myLocator.intersectRay(origin, direction, info))
+        {
+            setFailed("intersectRay missed a ray through a " + kind);
+        } else if (loose < 0.0 || abs(info.distance - loose) > TOLERANCE || info.distance > 200.0f + TOLERANCE) {
+            setFailed("intersectRay found the wrong hit for a ray through a " + kind);
+        }
+    }
+    const int NUM_TARGETS = 300;
+    for (int t = 0; t < NUM_TARGETS; ++t)
+    {
+        Vector3D target(randFloat(-150.0f, 150.0f), randFloat(-150.0f, 150.0f), randFloat(-150.0f, 150.0f));
+        if (t % 10 == 0) target = Vector3D(mySurf.getCoordinate(rand() % numNodes));//exactly on a vertex
+        if (t % 10 == 1) target *= 0.01f;//near the center, all triangles at similar distance
+        float expected = bruteForceClosest(mySurf, target);
+        TriangleLocatorInfo info;
+        int64_t found = myLocator.closestTriangle(target, &info);
+        if (found < 0 || found != info.triangle)
+        {
+            setFailed("closestTriangle found nothing for target " + AString::number(t));
+        } else if (abs(info.distance - expected) > TOLERANCE || abs((info.point - target).length() - info.distance) > TOLERANCE) {
+            setFailed("closestTriangle has wrong distance for target " + AString::number(t) + ", expected " + AString::number(expected) + ", got " + AString::number(info.distance));
+        } else if (!infoConsistent(mySurf, info, TOLERANCE)) {
+            setFailed("closestTriangle returned inconsistent information for target " + AString::number(t));
+        } else if (myLocator.closestTriangle(target) != found) {
+            setFailed("closestTriangle with and without info disagree for target " + AString::number(t));
+        }
+    }
+}
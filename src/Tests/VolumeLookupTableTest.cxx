@@ -0,0 +1,192 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeLookupTableTest.h"
+
+#include "FastStatistics.h"
+#include "GraphicsOpenGLVolumeTextures.h"
+#include "GraphicsVolumeScalarCoding.h"
+#include "NodeAndVoxelColoring.h"
+#include "Palette.h"
+#include "PaletteColorMapping.h"
+#include "PaletteFile.h"
+#include "VolumeFile.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+VolumeLookupTableTest::VolumeLookupTableTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t DIM_I = 32, DIM_J = 24, DIM_K = 16;
+    
+    ///mostly values a few units from zero, with exact zeros, exact boundary values, NaNs, and outliers far outside the mapped range
+    vector<float> makeData(const vector<float>& exactValues)
+    {
+        const int64_t numVoxels = DIM_I * DIM_J * DIM_K;
+        vector<float> ret(numVoxels);
+        for (int64_t i = 0; i < numVoxels; ++i)
+        {
+            switch (rand() % 200)
+            {
+                case 0:
+                case 1:
+                    ret[i] = 0.0f;
+                    break;
+                case 2:
+                    ret[i] = 1.0e6f * (1.0f + ((float)rand()) / RAND_MAX);
+                    break;
+                case 3:
+                    ret[i] = -5.0e5f * (1.0f + ((float)rand()) / RAND_MAX);
+                    break;
+                case 4:
+                    ret[i] = numeric_limits<float>::quiet_NaN();
+                    break;
+                case 5:
+                case 6:
+                case 7:
+                    ret[i] = exactValues[rand() % exactValues.size()];
+                    break;
+                default:
+                    ret[i] = 8.0f * ((float)rand()) / RAND_MAX - 3.0f;
+                    break;
+            }
+        }
+        return ret;
+    }
+    
+    ///color every voxel from the lookup table through its code, and directly from its value, alpha must always agree, colors must be within the tolerance except for at most maxMismatchFraction of voxels
+    AString checkLookupTable(VolumeFile& volume, const PaletteFile& paletteFile, const vector<float>& data, const int colorTolerance, const float maxMismatchFraction)
+    {
+        volume.updateScalarColoringForMap(0, &paletteFile);
+        const int32_t tableSize = GraphicsOpenGLVolumeTextures::getLookupTableSize();
+        GraphicsVolumeScalarCoding coding;
+        if (!volume.getPaletteScalarCodingForMap(0, tableSize, coding)) return "failed to get scalar coding";
+        if (coding.getNumberOfEntries() != tableSize) return "scalar coding has " + AString::number(coding.getNumberOfEntries()) + " entries, expected " + AString::number(tableSize);
+        vector<uint8_t> table(tableSize * 4);
+        if (!volume.getPaletteLookupTableForMap(0, coding, table.data())) return "failed to get lookup table";
+        const PaletteColorMapping* mapping = volume.getMapPaletteColorMapping(0);
+        const Palette* palette = paletteFile.getPaletteByName(mapping->getSelectedPaletteName());
+        if (palette == NULL) return "missing palette " + mapping->getSelectedPaletteName();
+        const int64_t numVoxels = (int64_t)data.size();
+        vector<uint8_t> expected(numVoxels * 4);
+        NodeAndVoxelColoring::colorScalarsWithPalette(volume.getMapFastStatistics(0), mapping, palette, data.data(), data.data(), numVoxels, expected.data(), false);
+        int64_t mismatchCount = 0;
+        for (int64_t i = 0; i < numVoxels; ++i)
+        {
+            const uint16_t code = coding.getCodeForValue(data[i]);
+            if (code == GraphicsVolumeScalarCoding::NOT_A_NUMBER_CODE)
+            {
+                if (!std::isnan(data[i])) return "value " + AString::number(data[i]) + " was coded as not a number";
+                if (expected[i * 4 + 3] != 0) return "NaN is colored";
+                continue;
+            }
+            if (code > tableSize) return "code " + AString::number(code) + " is outside the lookup table";
+            const uint8_t* tableColor = &table[(code - 1) * 4];
+            const uint8_t* expectedColor = &expected[i * 4];
+            if ((tableColor[3] == 0) != (expectedColor[3] == 0))
+            {
+                return "value " + AString::number(data[i]) + " has lookup table alpha " + AString::number(tableColor[3]) + ", expected alpha " + AString::number(expectedColor[3]);
+            }
+            if (expectedColor[3] == 0) continue;
+            for (int c = 0; c < 3; ++c)
+            {
+                if (abs((int)tableColor[c] - (int)expectedColor[c]) > colorTolerance)
+                {
+                    ++mismatchCount;
+                    break;
+                }
+            }
+        }
+        if (mismatchCount > maxMismatchFraction * numVoxels)
+        {
+            return AString::number(mismatchCount) + " of " + AString::number(numVoxels) + " voxels have lookup table colors that differ from palette coloring by more than " + AString::number(colorTolerance);
+        }
+        return "";
+    }
+}
+
+void VolumeLookupTableTest::execute()
+{
+    PaletteFile paletteFile;
+    VolumeFile volume;
+    vector<int64_t> dims;
+    dims.push_back(DIM_I);
+    dims.push_back(DIM_J);
+    dims.push_back(DIM_K);
+    vector<vector<float> > indexToSpace(4, vector<float>(4, 0.0f));
+    for (int i = 0; i < 4; ++i) indexToSpace[i][i] = 1.0f;
+    volume.reinitialize(dims, indexToSpace, 1, SubvolumeAttributes::FUNCTIONAL);
+    volume.setPaletteNormalizationMode(PaletteNormalizationModeEnum::NORMALIZATION_SELECTED_MAP_DATA);
+    const float USER_NEG_MAX = -2.0f, USER_NEG_MIN = -0.5f, USER_POS_MIN = 0.5f, USER_POS_MAX = 4.0f, THRESH_MIN = 1.5f, THRESH_MAX = 3.0f;
+    vector<float> exactValues;
+    exactValues.push_back(USER_NEG_MAX);
+    exactValues.push_back(USER_NEG_MIN);
+    exactValues.push_back(USER_POS_MIN);
+    exactValues.push_back(USER_POS_MAX);
+    exactValues.push_back(THRESH_MIN);
+    exactValues.push_back(THRESH_MAX);
+    vector<float> data = makeData(exactValues);
+    volume.setFrame(data.data());
+    PaletteColorMapping* mapping = volume.getMapPaletteColorMapping(0);
+    mapping->setSelectedPaletteName(Palette::ROY_BIG_BL_PALETTE_NAME);
+    mapping->setInterpolatePaletteFlag(true);
+    mapping->setDisplayPositiveDataFlag(true);
+    mapping->setDisplayNegativeDataFlag(true);
+    mapping->setDisplayZeroDataFlag(false);
+    //percentile scaling with outliers, the outliers must not take the lookup table's resolution from the mapped range
+    mapping->setScaleMode(PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE);
+    mapping->setAutoScalePercentageNegativeMaximum(98.0f);
+    mapping->setAutoScalePercentageNegativeMinimum(2.0f);
+    mapping->setAutoScalePercentagePositiveMinimum(2.0f);
+    mapping->setAutoScalePercentagePositiveMaximum(98.0f);
+    mapping->setThresholdType(PaletteThresholdTypeEnum::THRESHOLD_TYPE_OFF);
+    AString error = checkLookupTable(volume, paletteFile, data, 4, 0.0f);
+    if (error != "") setFailed("percentile scale: " + error);
+    //user scale, thresholded inside a range, negative data hidden, zeros shown
+    mapping->setScaleMode(PaletteScaleModeEnum::MODE_USER_SCALE);
+    mapping->setUserScaleNegativeMaximum(USER_NEG_MAX);
+    mapping->setUserScaleNegativeMinimum(USER_NEG_MIN);
+    mapping->setUserScalePositiveMinimum(USER_POS_MIN);
+    mapping->setUserScalePositiveMaximum(USER_POS_MAX);
+    mapping->setDisplayNegativeDataFlag(false);
+    mapping->setDisplayZeroDataFlag(true);
+    mapping->setThresholdType(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL);
+    mapping->setThresholdTest(PaletteThresholdTestEnum::THRESHOLD_TEST_SHOW_INSIDE);
+    mapping->setThresholdMinimum(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL, THRESH_MIN);
+    mapping->setThresholdMaximum(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL, THRESH_MAX);
+    error = checkLookupTable(volume, paletteFile, data, 4, 0.0f);
+    if (error != "") setFailed("threshold inside: " + error);
+    //thresholded outside a range, all signs shown, palette not interpolated so colors step at palette scalars, which are not boundaries of the coding
+    mapping->setDisplayNegativeDataFlag(true);
+    mapping->setDisplayZeroDataFlag(false);
+    mapping->setInterpolatePaletteFlag(false);
+    mapping->setThresholdTest(PaletteThresholdTestEnum::THRESHOLD_TEST_SHOW_OUTSIDE);
+    error = checkLookupTable(volume, paletteFile, data, 0, 0.01f);
+    if (error != "") setFailed("threshold outside: " + error);
+}
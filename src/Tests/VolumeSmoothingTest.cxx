@@ -0,0 +1,90 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "VolumeSmoothingTest.h"
+
+#include "AlgorithmVolumeSmoothing.h"
+#include "FloatMatrix.h"
+#include "VolumeFile.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+VolumeSmoothingTest::VolumeSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumeSmoothingTest::execute()
+{
+    //the recursive filter doesn't truncate the kernel at 3 sigma and only approximates the gaussian shape, for kernels of 2 voxels and more
+    //the difference measured on uniform noise in [0, 1] is under 0.0005 everywhere, including next to the volume edges and ROI boundaries
+    const float TOLERANCE = 0.002f;
+    vector<int64_t> myDims(3);
+    myDims[0] = 40; myDims[1] = 36; myDims[2] = 32;
+    FloatMatrix indexSpace = FloatMatrix::identity(4);
+    indexSpace[0][0] = 1.5f;//anisotropic, orthogonal
+    indexSpace[2][2] = 2.0f;
+    VolumeFile inVol(myDims, indexSpace.getMatrix()), zerosVol(myDims, indexSpace.getMatrix()), roiVol(myDims, indexSpace.getMatrix());
+    for (int64_t k = 0; k < myDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < myDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < myDims[0]; ++i)
+            {
+                float value = ((float)rand()) / RAND_MAX;
+                inVol.setValue(value, i, j, k);
+                zerosVol.setValue((rand() % 4 == 0 ? 0.0f : value), i, j, k);
+                float di = 1.5f * (i - 20), dj = j - 18.0f, dk = 2.0f * (k - 8);//ROI sphere is cut off by the k = 0 edge
+                roiVol.setValue((di * di + dj * dj + dk * dk < 18.0f * 18.0f ? 1.0f : 0.0f), i, j, k);
+            }
+        }
+    }
+    const float kernels[] = { 4.0f, 6.0f };
+    for (int kern = 0; kern < 2; ++kern)
+    {
+        for (int useRoi = 0; useRoi < 2; ++useRoi)
+        {
+            for (int fixZeros = 0; fixZeros < 2; ++fixZeros)
+            {
+                const VolumeFile* input = (fixZeros ? &zerosVol : &inVol);
+                const VolumeFile* roi = (useRoi ? &roiVol : NULL);
+                VolumeFile directOut, recursiveOut;
+                AlgorithmVolumeSmoothing(NULL, input, kernels[kern], &directOut, roi, fixZeros, -1, AlgorithmVolumeSmoothing::DIRECT);
+                AlgorithmVolumeSmoothing(NULL, input, kernels[kern], &recursiveOut, roi, fixZeros, -1, AlgorithmVolumeSmoothing::RECURSIVE);
+                const float* directData = directOut.getFrame(), *recursiveData = recursiveOut.getFrame();
+                int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+                float maxDiff = 0.0f;
+                for (int64_t index = 0; index < frameSize; ++index)
+                {
+                    float diff = abs(directData[index] - recursiveData[index]);
+                    if (!(diff <= maxDiff)) maxDiff = diff;//catch NaN
+                }
+                if (!(maxDiff <= TOLERANCE))
+                {
+                    setFailed("RECURSIVE smoothing differs from DIRECT by " + AString::number(maxDiff) + " with kernel " + AString::number(kernels[kern]) +
+                              (useRoi ? ", ROI" : "") + (fixZeros ? ", fix zeros" : ""));
+                }
+            }
+        }
+    }
+}
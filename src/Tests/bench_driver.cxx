@@ -0,0 +1,117 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//program for running microbenchmarks, prints JSON to stdout (or the -json file), progress to stderr
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include "Benchmarks.h"
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+#include "SessionManager.h"
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    void printUsage()
+    {
+        cout << "usage: bench_driver [-quick] [-json <file>] [-scratch <directory>] <benchmark>..." << endl;
+        cout << "   benchmarks: dot, ciftiread, correlation, all" << endl;
+        cout << "   -quick: small sizes, to check that it runs" << endl;
+        cout << "   -scratch: where to write temporary files for ciftiread, default is the system temp directory" << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    srand(time(NULL));
+    int ret = 0;
+    {
+        QCoreApplication myApp(argc, argv);
+        caret_global_commandLine_init(argc, argv);
+        SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
+        bool quick = false;
+        AString jsonFile, scratchDir = QDir::tempPath();
+        bool runDot = false, runRead = false, runCorrelation = false;
+        for (int i = 1; i < argc; ++i)
+        {
+            AString arg(argv[i]);
+            if (arg == "-quick")
+            {
+                quick = true;
+            } else if (arg == "-json" && i + 1 < argc) {
+                jsonFile = argv[++i];
+            } else if (arg == "-scratch" && i + 1 < argc) {
+                scratchDir = argv[++i];
+            } else if (arg == "dot") {
+                runDot = true;
+            } else if (arg == "ciftiread") {
+                runRead = true;
+            } else if (arg == "correlation") {
+                runCorrelation = true;
+            } else if (arg == "all") {
+                runDot = runRead = runCorrelation = true;
+            } else {
+                cout << "unrecognized argument: " << arg << endl;
+                printUsage();
+                return 1;
+            }
+        }
+        if (!runDot && !runRead && !runCorrelation)
+        {
+            printUsage();
+            return 1;
+        }
+        Benchmarks myBench(quick);
+        try
+        {
+            if (runDot) myBench.runDot();
+            if (runRead) myBench.runCiftiRead(scratchDir);
+            if (runCorrelation) myBench.runCorrelation();
+        } catch (CaretException& e) {
+            cerr << "benchmark failed, exception: " << e.whatString() << endl;
+            ret = 1;
+        }
+        AString json = myBench.toJson();
+        if (jsonFile.isEmpty())
+        {
+            cout << json;
+        } else {
+            QFile outFile(jsonFile);
+            if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+            {
+                cerr << "unable to write '" << jsonFile << "'" << endl;
+                ret = 1;
+            } else {
+                outFile.write(json.toUtf8());
+            }
+        }
+        SessionManager::deleteSessionManager();
+    }
+    return ret;
+}
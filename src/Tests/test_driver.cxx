@@ -33,21 +33,33 @@
 #include "CaretException.h"
 
 //tests
+#include "CaretSparseFileTest.h"
 #include "CiftiFileTest.h"
+#include "CiftiResampleTest.h"
+#include "DenseDynamicTest.h"
 #include "DotTest.h"
+#include "GeodesicBucketsTest.h"
 #include "GeodesicHelperTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
+#include "MetricSmoothingTest.h"
 #include "NiftiTest.h"
 #include "PointerTest.h"
+#include "PointLocatorTest.h"
+#include "ProfileTraceTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
 #include "StatisticsTest.h"
+#include "SurfaceHelperCacheTest.h"
+#include "TFCETest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
+#include "TriangleLocatorTest.h"
 #include "VolumeFileTest.h"
+#include "VolumeLookupTableTest.h"
+#include "VolumeSmoothingTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -69,22 +81,36 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new CaretSparseFileTest("caretsparse"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CiftiResampleTest("ciftiresample"));
+        mytests.push_back(new DenseDynamicTest("densedynamic"));
         mytests.push_back(new DotTest("dotsimd"));
+        mytests.push_back(new GeodesicBucketsTest("geobuckets"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));
         mytests.push_back(new MathExpressionTest("mathexpression"));
+        mytests.push_back(new MetricSmoothingTest("metricsmoothing"));
         mytests.push_back(new NiftiFileTest("niftifile"));
+        mytests.push_back(new NiftiGzipSeekTest("niftigzipseek"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
+        mytests.push_back(new NiftiParallelReadTest("niftiparallelread"));
         mytests.push_back(new PointerTest("pointer"));
+        mytests.push_back(new PointLocatorTest("pointlocator"));
+        mytests.push_back(new ProfileTraceTest("profiletrace"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new SurfaceHelperCacheTest("surfacehelpercache"));
+        mytests.push_back(new TFCETest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
+        mytests.push_back(new TriangleLocatorTest("trianglelocator"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new VolumeLookupTableTest("volumelookuptable"));
+        mytests.push_back(new VolumeSmoothingTest("volumesmoothing"));
         mytests.push_back(new XnatTest("xnat"));
         if (argc < 2)
         {
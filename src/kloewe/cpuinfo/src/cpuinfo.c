@@ -5,6 +5,7 @@
 ----------------------------------------------------------------------------*/
 #ifdef _WIN32                       /* if Microsoft Windows system */
 #  include <windows.h>
+#  include <intrin.h>               /* needed for __cpuidex(), _xgetbv() */
 #else
 #  include <unistd.h>
 #  include <stdio.h>
@@ -43,12 +44,24 @@ typedef struct {                    /* --- processor ids --- */
   Global Variables
 ----------------------------------------------------------------------------*/
 static int cpuinfo[5];              /* cpu information */
+static int cpuinfo7[5];             /* extended features (leaf 7) */
 
 /*----------------------------------------------------------------------------
   Functions
 ----------------------------------------------------------------------------*/
 #ifdef _WIN32                       /* if Microsoft Windows system */
 #define cpuid   __cpuid             /* map existing function */
+
+static unsigned long long xgetbv (void)
+{                                   /* --- get extended control register */
+  return _xgetbv(0);                /* (XCR0, os support of registers) */
+}  /* xgetbv() */
+
+static void cpuid7 (int info[4])
+{                                   /* --- get extended features */
+  __cpuidex(info, 7, 0);            /* (leaf 7, subleaf 0) */
+}  /* cpuid7() */
+
 #else                               /* if Linux/Unix system */
 
 static void cpuid (int32_t info[4], int32_t type)
@@ -61,6 +74,18 @@ static void cpuid (int32_t info[4], int32_t type)
                         : "a" (type), "c" (0)); // : "a" (type));
 }  /* cpuid() */
 
+static unsigned long long xgetbv (void)
+{                                   /* --- get extended control register */
+  uint32_t eax, edx;                /* (XCR0, os support of registers) */
+  __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return ((unsigned long long)edx << 32) | eax;
+}  /* xgetbv() */
+
+static void cpuid7 (int32_t info[4])
+{                                   /* --- get extended features */
+  cpuid(info, 7);                   /* (leaf 7, subleaf 0) */
+}  /* cpuid7() */
+
 #endif  /* #ifdef _WIN32 .. #else .. */
 /*----------------------------------------------------------------------------
 References (cpuid):
@@ -326,6 +351,44 @@ int hasFMA3 (void)
 
 /*--------------------------------------------------------------------------*/
 
+static int osxsave (unsigned long long mask)
+{                                   /* --- check os support of registers */
+  if (!cpuinfo[4]) { cpuid(cpuinfo, 1); cpuinfo[4] = -1; }
+  if (!(cpuinfo[2] & (1 << 27)))    /* the os must have enabled xgetbv */
+    return 0;                       /* (OSXSAVE) to query XCR0 at all */
+  return (xgetbv() & mask) == mask;
+}  /* osxsave() */
+
+/*--------------------------------------------------------------------------*/
+
+static void getcpuinfo7 (void)
+{                                   /* --- get leaf 7, if it exists */
+  int32_t regs[4];
+  cpuid(regs, 0);                   /* EAX: highest supported leaf */
+  if (regs[0] >= 7) cpuid7(cpuinfo7);
+  cpuinfo7[4] = -1;
+}  /* getcpuinfo7() */
+
+/*--------------------------------------------------------------------------*/
+
+int hasAVX2 (void)
+{                                   /* --- check for AVX2 instructions */
+  if (!cpuinfo7[4]) getcpuinfo7();
+  return ((cpuinfo7[1] & (1 << 5)) != 0) && hasAVX()
+      && osxsave(0x6);              /* XMM and YMM state */
+}  /* hasAVX2() */
+
+/*--------------------------------------------------------------------------*/
+
+int hasAVX512F (void)
+{                                   /* --- check for AVX-512F instructions */
+  if (!cpuinfo7[4]) getcpuinfo7();
+  return ((cpuinfo7[1] & (1 << 16)) != 0)
+      && osxsave(0xe6);             /* XMM, YMM, opmask and ZMM state */
+}  /* hasAVX512F() */
+
+/*--------------------------------------------------------------------------*/
+
 void getVendorID (char *buf)
 {                                   /* --- get vendor id */
   /* the string is going to be exactly 12 characters long, allocate
@@ -362,6 +425,8 @@ int main (int argc, char* argv[])
   printf("POPCNT             %d\n", hasPOPCNT());
   printf("AVX                %d\n", hasAVX());
   printf("FMA3               %d\n", hasFMA3());
+  printf("AVX2               %d\n", hasAVX2());
+  printf("AVX512F            %d\n", hasAVX512F());
 
 /* corecnt    -> number of processor cores
    proccnt    -> number of logical processors
@@ -31,5 +31,7 @@ extern int hasSSE42      (void);
 extern int hasPOPCNT     (void);
 extern int hasAVX        (void);
 extern int hasFMA3       (void);
+extern int hasAVX2       (void);
+extern int hasAVX512F    (void);
 
 #endif  /* #ifndef CPUINFO_H */
@@ -12,6 +12,8 @@
 extern float  sdot  (const float  *a, const float  *b, int n);
 extern double ddot  (const double *a, const double *b, int n);
 extern double sddot (const float  *a, const float  *b, int n);
+extern void   sddot_batch (const float *a, const float *const *b,
+                           int m, int n, double *r);
 
 /*----------------------------------------------------------------------------
   Global Variables
@@ -19,6 +21,7 @@ extern double sddot (const float  *a, const float  *b, int n);
 sdot_func  *sdot_ptr  = &sdot_select;
 ddot_func  *ddot_ptr  = &ddot_select;
 sddot_func *sddot_ptr = &sddot_select;
+sddot_batch_func *sddot_batch_ptr = &sddot_batch_select;
 
 /*----------------------------------------------------------------------------
   Functions
@@ -39,32 +42,64 @@ double sddot_select (const float *a, const float *b, int n) {
   return (*sddot_ptr)(a,b,n);
 }
 
+void sddot_batch_select (const float *a, const float *const *b,
+                         int m, int n, double *r) {
+  dot_set_impl(DOT_AUTO);
+  (*sddot_batch_ptr)(a,b,m,n,r);
+}
+
 dot_flags    dot_set_impl (dot_flags impl) {
+  #ifndef DOT_NOAVX512
+  // AVX-512 lowers the clock frequency of the core on some processors,
+  // which also slows down the code around the dot products, so the
+  // AVX-512 implementations are only used if explicitly requested
+  if      (hasAVX512F()          && (impl == DOT_AVX512)) { // AVX-512
+    sdot_ptr        = &sdot_avx512;
+    ddot_ptr        = &ddot_avx512;
+    sddot_ptr       = &sddot_avx512;
+    sddot_batch_ptr = &sddot_batch_avx512;
+    return DOT_AVX512; }
+  else
+  #endif
+  #ifndef DOT_NOAVX2
+  // the AVX2 implementations use several independent sums, so unlike
+  // the AVX-FMA implementations, they are faster than the AVX ones
+  if      (hasAVX2() && hasFMA3() && (impl >= DOT_AVX2)) {  // AVX2
+    sdot_ptr        = &sdot_avx2;
+    ddot_ptr        = &ddot_avx2;
+    sddot_ptr       = &sddot_avx2;
+    sddot_batch_ptr = &sddot_batch_avx2;
+    return DOT_AVX2; }
+  else
+  #endif
   #ifndef DOT_NOFMA
   // the AVX-FMA implementations are currently slower than the AVX
   // implementations and are thus only used if explicitly requested
   if      (hasFMA3() && hasAVX() && (impl == DOT_AVXFMA)) { // AVX-FMA
-    sdot_ptr  = &sdot_avxfma;
-    ddot_ptr  = &ddot_avxfma;
-    sddot_ptr = &sddot_avxfma;
+    sdot_ptr        = &sdot_avxfma;
+    ddot_ptr        = &ddot_avxfma;
+    sddot_ptr       = &sddot_avxfma;
+    sddot_batch_ptr = &sddot_batch_avxfma;
     return DOT_AVXFMA; }
-  else if (hasAVX()              && (impl >= DOT_AVX)) {    // AVX
-  #else
-  if      (hasAVX()              && (impl >= DOT_AVX)) {    // AVX
+  else
   #endif
-    sdot_ptr  = &sdot_avx;
-    ddot_ptr  = &ddot_avx;
-    sddot_ptr = &sddot_avx;
+  if      (hasAVX()              && (impl >= DOT_AVX)) {    // AVX
+    sdot_ptr        = &sdot_avx;
+    ddot_ptr        = &ddot_avx;
+    sddot_ptr       = &sddot_avx;
+    sddot_batch_ptr = &sddot_batch_avx;
     return DOT_AVX; }
   else if (hasSSE2()             && (impl >= DOT_SSE2)) {   // SSE2
-    sdot_ptr  = &sdot_sse2;
-    ddot_ptr  = &ddot_sse2;
-    sddot_ptr = &sddot_sse2;
+    sdot_ptr        = &sdot_sse2;
+    ddot_ptr        = &ddot_sse2;
+    sddot_ptr       = &sddot_sse2;
+    sddot_batch_ptr = &sddot_batch_sse2;
     return DOT_SSE2; }
   else {                                                    // naive
-    sdot_ptr  = &sdot_naive;
-    ddot_ptr  = &ddot_naive;
-    sddot_ptr = &sddot_naive;
+    sdot_ptr        = &sdot_naive;
+    ddot_ptr        = &ddot_naive;
+    sddot_ptr       = &sddot_naive;
+    sddot_batch_ptr = &sddot_batch_naive;
     return DOT_NAIVE;
   }
 }
@@ -19,6 +19,8 @@ typedef enum {
     DOT_SSE2   = 2,   // SSE2
     DOT_AVX    = 3,   // AVX
     DOT_AVXFMA = 4,   // AVX+FMA3
+    DOT_AVX2   = 5,   // AVX2+FMA3
+    DOT_AVX512 = 6,   // AVX-512F
     DOT_AUTO   = 100  // automatic choice
 } dot_flags;
 // Using dot_set_impl(), these values are used to specify the set of
@@ -33,6 +35,8 @@ typedef enum {
 typedef float  (sdot_func)  (const float  *a, const float  *b, int n);
 typedef double (ddot_func)  (const double *a, const double *b, int n);
 typedef double (sddot_func) (const float  *a, const float  *b, int n);
+typedef void   (sddot_batch_func) (const float *a, const float *const *b,
+                                   int m, int n, double *r);
 
 /*----------------------------------------------------------------------------
   Global Variables
@@ -40,6 +44,7 @@ typedef double (sddot_func) (const float  *a, const float  *b, int n);
 extern sdot_func  *sdot_ptr;
 extern ddot_func  *ddot_ptr;
 extern sddot_func *sddot_ptr;
+extern sddot_batch_func *sddot_batch_ptr;
 
 /*----------------------------------------------------------------------------
   Function Prototypes
@@ -48,6 +53,18 @@ inline float  sdot         (const float  *a, const float  *b, int n);
 inline double ddot         (const double *a, const double *b, int n);
 inline double sddot        (const float  *a, const float  *b, int n);
 
+/* sddot_batch
+ * -----------
+ * dot products of one vector with each of several others,
+ * r[i] = sddot(a, b[i], n) for 0 <= i < m
+ *
+ * The elements of a are loaded once for a group of vectors in b, and
+ * each vector has its own sums, so this is faster than m calls to sddot
+ * when the vectors are short enough for a to stay in the cache.
+ */
+inline void   sddot_batch  (const float *a, const float *const *b,
+                            int m, int n, double *r);
+
 /* dot_set_impl
  * ------------
  * specify the set of implementations that is used
@@ -61,6 +78,8 @@ inline double sddot        (const float  *a, const float  *b, int n);
  *       DOT_SSE2   -> SSE2 implementations
  *       DOT_AVX    -> AVX implementations
  *       DOT_AVXFMA -> AVX+FMA3 implementations
+ *       DOT_AVX2   -> AVX2+FMA3 implementations
+ *       DOT_AVX512 -> AVX-512F implementations
  *       DOT_AUTO   -> automatically choose the best available set
  *       (see also the above enum)
  *
@@ -73,24 +92,50 @@ extern dot_flags    dot_set_impl (dot_flags   impl);
 extern float  sdot_select  (const float  *a, const float  *b, int n);
 extern double ddot_select  (const double *a, const double *b, int n);
 extern double sddot_select (const float  *a, const float  *b, int n);
+extern void   sddot_batch_select (const float *a, const float *const *b,
+                                  int m, int n, double *r);
+
+#ifndef DOT_NOAVX512
+extern float  sdot_avx512  (const float  *a, const float  *b, int n);
+extern double ddot_avx512  (const double *a, const double *b, int n);
+extern double sddot_avx512 (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avx512 (const float *a, const float *const *b,
+                                  int m, int n, double *r);
+#endif
+
+#ifndef DOT_NOAVX2
+extern float  sdot_avx2    (const float  *a, const float  *b, int n);
+extern double ddot_avx2    (const double *a, const double *b, int n);
+extern double sddot_avx2   (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avx2   (const float *a, const float *const *b,
+                                  int m, int n, double *r);
+#endif
 
 #ifndef DOT_NOFMA
 extern float  sdot_avxfma  (const float  *a, const float  *b, int n);
 extern double ddot_avxfma  (const double *a, const double *b, int n);
 extern double sddot_avxfma (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avxfma (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 #endif
 
 extern float  sdot_avx     (const float  *a, const float  *b, int n);
 extern double ddot_avx     (const double *a, const double *b, int n);
 extern double sddot_avx    (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avx    (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 
 extern float  sdot_sse2    (const float  *a, const float  *b, int n);
 extern double ddot_sse2    (const double *a, const double *b, int n);
 extern double sddot_sse2   (const float  *a, const float  *b, int n);
+extern void   sddot_batch_sse2   (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 
 extern float  sdot_naive   (const float  *a, const float  *b, int n);
 extern double ddot_naive   (const double *a, const double *b, int n);
 extern double sddot_naive  (const float  *a, const float  *b, int n);
+extern void   sddot_batch_naive  (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -108,6 +153,11 @@ inline double sddot (const float *a, const float *b, int n) {
   return (*sddot_ptr)(a,b,n);
 }
 
+inline void sddot_batch (const float *a, const float *const *b,
+                         int m, int n, double *r) {
+  (*sddot_batch_ptr)(a,b,m,n,r);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,8 +12,12 @@
 extern float  sdot_avxfma  (const float  *a, const float  *b, int n);
 extern double ddot_avxfma  (const double *a, const double *b, int n);
 extern double sddot_avxfma (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avxfma (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 #else
 extern float  sdot_avx     (const float  *a, const float  *b, int n);
 extern double ddot_avx     (const double *a, const double *b, int n);
 extern double sddot_avx    (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avx    (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 #endif
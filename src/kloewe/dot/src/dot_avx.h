@@ -19,10 +19,14 @@
 inline float  sdot_avxfma  (const float  *a, const float  *b, int n);
 inline double ddot_avxfma  (const double *a, const double *b, int n);
 inline double sddot_avxfma (const float  *a, const float  *b, int n);
+inline void   sddot_batch_avxfma (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 #else
 inline float  sdot_avx     (const float  *a, const float  *b, int n);
 inline double ddot_avx     (const double *a, const double *b, int n);
 inline double sddot_avx    (const float  *a, const float  *b, int n);
+inline void   sddot_batch_avx    (const float *a, const float *const *b,
+                                  int m, int n, double *r);
 #endif
 
 /*----------------------------------------------------------------------------
@@ -136,4 +140,64 @@ inline double sddot_avx    (const float *a, const float *b, int n)
   return s;
 }  // sddot_avx()
 
+/*--------------------------------------------------------------------------*/
+
+// --- dot products of one vector with several (input: single; output: double)
+#ifdef __FMA__
+inline void sddot_batch_avxfma (const float *a, const float *const *b,
+                                int m, int n, double *r)
+#else
+inline void sddot_batch_avx    (const float *a, const float *const *b,
+                                int m, int n, double *r)
+#endif
+{
+  int i = 0;
+  for ( ; i+4 <= m; i += 4) {
+    const float *b0 = b[i], *b1 = b[i+1], *b2 = b[i+2], *b3 = b[i+3];
+
+    // initialize 4 sums per vector
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+
+    // load and convert each element of a once for all 4 vectors
+    for (int k = 0, nq = 4*(n/4); k < nq; k += 4) {
+      __m256d a4 = _mm256_cvtps_pd(_mm_loadu_ps(a+k));
+      #ifdef __FMA__
+      s0 = _mm256_fmadd_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b0+k)), s0);
+      s1 = _mm256_fmadd_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b1+k)), s1);
+      s2 = _mm256_fmadd_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b2+k)), s2);
+      s3 = _mm256_fmadd_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b3+k)), s3);
+      #else
+      s0 = _mm256_add_pd(
+        _mm256_mul_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b0+k))), s0);
+      s1 = _mm256_add_pd(
+        _mm256_mul_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b1+k))), s1);
+      s2 = _mm256_add_pd(
+        _mm256_mul_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b2+k))), s2);
+      s3 = _mm256_add_pd(
+        _mm256_mul_pd(a4, _mm256_cvtps_pd(_mm_loadu_ps(b3+k))), s3);
+      #endif
+    }
+
+    // compute the 4 horizontal sums at once
+    __m256d h01 = _mm256_hadd_pd(s0, s1);
+    __m256d h23 = _mm256_hadd_pd(s2, s3);
+    __m256d s4  = _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20),
+                                _mm256_permute2f128_pd(h01, h23, 0x31));
+    _mm256_storeu_pd(r+i, s4);
+
+    // add the remaining products
+    for (int k = 4*(n/4); k < n; k++) {
+      r[i]   += a[k] * b0[k]; r[i+1] += a[k] * b1[k];
+      r[i+2] += a[k] * b2[k]; r[i+3] += a[k] * b3[k];
+    }
+  }
+  for ( ; i < m; i++)           // remaining vectors one at a time
+    #ifdef __FMA__
+    r[i] = sddot_avxfma(a, b[i], n);
+    #else
+    r[i] = sddot_avx(a, b[i], n);
+    #endif
+}  // sddot_batch_avx()
+
 #endif // DOT_AVX_H
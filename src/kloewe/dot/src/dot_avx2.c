@@ -0,0 +1,15 @@
+/*----------------------------------------------------------------------------
+  File    : dot_avx2.c
+  Contents: dot product (AVX2/FMA3-based implementations)
+  Author  : Kristian Loewe
+----------------------------------------------------------------------------*/
+#include "dot_avx2.h"
+
+/*----------------------------------------------------------------------------
+  Function Prototypes
+----------------------------------------------------------------------------*/
+extern float  sdot_avx2        (const float  *a, const float  *b, int n);
+extern double ddot_avx2        (const double *a, const double *b, int n);
+extern double sddot_avx2       (const float  *a, const float  *b, int n);
+extern void   sddot_batch_avx2 (const float  *a, const float  *const *b,
+                                int m, int n, double *r);
@@ -0,0 +1,186 @@
+/*----------------------------------------------------------------------------
+  File    : dot_avx2.h
+  Contents: dot product (AVX2/FMA3-based implementations)
+  Author  : Kristian Loewe, Christian Borgelt
+----------------------------------------------------------------------------*/
+#ifndef DOT_AVX2_H
+#define DOT_AVX2_H
+
+#if !defined __AVX2__ || !defined __FMA__
+#  error "AVX2 and FMA3 are not enabled"
+#endif
+
+#include <immintrin.h>
+
+/*----------------------------------------------------------------------------
+  Function Prototypes
+----------------------------------------------------------------------------*/
+inline float  sdot_avx2        (const float  *a, const float  *b, int n);
+inline double ddot_avx2        (const double *a, const double *b, int n);
+inline double sddot_avx2       (const float  *a, const float  *b, int n);
+inline void   sddot_batch_avx2 (const float  *a, const float  *const *b,
+                                int m, int n, double *r);
+
+/*----------------------------------------------------------------------------
+  Inline Functions
+----------------------------------------------------------------------------*/
+// Unlike the AVX-FMA implementations, these use several independent sums,
+// so consecutive fused multiply-adds do not wait for each other's results.
+
+static inline double hsum4_avx2 (__m256d s4)
+{
+  __m128d sh = _mm_add_pd(_mm256_castpd256_pd128(s4),
+                          _mm256_extractf128_pd(s4, 1));
+  sh = _mm_add_pd(sh, _mm_shuffle_pd(sh, sh, 1));
+  return _mm_cvtsd_f64(sh);     // extract horizontal sum from 1st elem.
+}  // hsum4_avx2()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (single precision)
+inline float sdot_avx2 (const float *a, const float *b, int n)
+{
+  // initialize 4 x 8 sums
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+
+  // in each iteration, add 1 product to each of the 32 sums in parallel
+  int k = 0;
+  for (int nq = 32*(n/32); k < nq; k += 32) {
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a+k),    _mm256_loadu_ps(b+k),    s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a+k+8),  _mm256_loadu_ps(b+k+8),  s1);
+    s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a+k+16), _mm256_loadu_ps(b+k+16), s2);
+    s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a+k+24), _mm256_loadu_ps(b+k+24), s3);
+  }
+  for (int nq = 8*(n/8); k < nq; k += 8)
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a+k), _mm256_loadu_ps(b+k), s0);
+  s0 = _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3));
+
+  // compute horizontal sum
+  __m128 sh = _mm_add_ps(_mm256_castps256_ps128(s0),
+                         _mm256_extractf128_ps(s0, 1));
+  sh = _mm_add_ps(sh, _mm_movehl_ps(sh, sh));
+  sh = _mm_add_ss(sh, _mm_shuffle_ps(sh, sh, 1));
+  float s = _mm_cvtss_f32(sh);  // extract horizontal sum from 1st elem.
+
+  // add the remaining products
+  for ( ; k < n; k++)
+    s += a[k] * b[k];
+
+  return s;
+}  // sdot_avx2()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (double precision)
+inline double ddot_avx2 (const double *a, const double *b, int n)
+{
+  // initialize 4 x 4 sums
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+
+  // in each iteration, add 1 product to each of the 16 sums in parallel
+  int k = 0;
+  for (int nq = 16*(n/16); k < nq; k += 16) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+k),    _mm256_loadu_pd(b+k),    s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a+k+4),  _mm256_loadu_pd(b+k+4),  s1);
+    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a+k+8),  _mm256_loadu_pd(b+k+8),  s2);
+    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a+k+12), _mm256_loadu_pd(b+k+12), s3);
+  }
+  for (int nq = 4*(n/4); k < nq; k += 4)
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a+k), _mm256_loadu_pd(b+k), s0);
+  double s = hsum4_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1),
+                                      _mm256_add_pd(s2, s3)));
+
+  // add the remaining products
+  for ( ; k < n; k++)
+    s += a[k] * b[k];
+
+  return s;
+}  // ddot_avx2()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (input: single; intermediate and output: double)
+inline double sddot_avx2 (const float *a, const float *b, int n)
+{
+  // initialize 4 x 4 sums
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+
+  // in each iteration, add 1 product to each of the 16 sums in parallel
+  int k = 0;
+  for (int nq = 16*(n/16); k < nq; k += 16) {
+    s0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a+k)),
+                         _mm256_cvtps_pd(_mm_loadu_ps(b+k)), s0);
+    s1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a+k+4)),
+                         _mm256_cvtps_pd(_mm_loadu_ps(b+k+4)), s1);
+    s2 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a+k+8)),
+                         _mm256_cvtps_pd(_mm_loadu_ps(b+k+8)), s2);
+    s3 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a+k+12)),
+                         _mm256_cvtps_pd(_mm_loadu_ps(b+k+12)), s3);
+  }
+  for (int nq = 4*(n/4); k < nq; k += 4)
+    s0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a+k)),
+                         _mm256_cvtps_pd(_mm_loadu_ps(b+k)), s0);
+  double s = hsum4_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1),
+                                      _mm256_add_pd(s2, s3)));
+
+  // add the remaining products
+  for ( ; k < n; k++)
+    s += a[k] * b[k];
+
+  return s;
+}  // sddot_avx2()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot products of one vector with several (input: single; output: double)
+inline void sddot_batch_avx2 (const float *a, const float *const *b,
+                              int m, int n, double *r)
+{
+  int i = 0;
+  for ( ; i+4 <= m; i += 4) {
+    const float *b0 = b[i], *b1 = b[i+1], *b2 = b[i+2], *b3 = b[i+3];
+
+    // initialize 2 x 4 sums per vector
+    __m256d s0 = _mm256_setzero_pd(), t0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd(), t1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), t2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd(), t3 = _mm256_setzero_pd();
+
+    // load and convert each element of a once for all 4 vectors
+    int k = 0;
+    for (int nq = 8*(n/8); k < nq; k += 8) {
+      __m256d al = _mm256_cvtps_pd(_mm_loadu_ps(a+k));
+      __m256d ah = _mm256_cvtps_pd(_mm_loadu_ps(a+k+4));
+      s0 = _mm256_fmadd_pd(al, _mm256_cvtps_pd(_mm_loadu_ps(b0+k)),   s0);
+      t0 = _mm256_fmadd_pd(ah, _mm256_cvtps_pd(_mm_loadu_ps(b0+k+4)), t0);
+      s1 = _mm256_fmadd_pd(al, _mm256_cvtps_pd(_mm_loadu_ps(b1+k)),   s1);
+      t1 = _mm256_fmadd_pd(ah, _mm256_cvtps_pd(_mm_loadu_ps(b1+k+4)), t1);
+      s2 = _mm256_fmadd_pd(al, _mm256_cvtps_pd(_mm_loadu_ps(b2+k)),   s2);
+      t2 = _mm256_fmadd_pd(ah, _mm256_cvtps_pd(_mm_loadu_ps(b2+k+4)), t2);
+      s3 = _mm256_fmadd_pd(al, _mm256_cvtps_pd(_mm_loadu_ps(b3+k)),   s3);
+      t3 = _mm256_fmadd_pd(ah, _mm256_cvtps_pd(_mm_loadu_ps(b3+k+4)), t3);
+    }
+    s0 = _mm256_add_pd(s0, t0); s1 = _mm256_add_pd(s1, t1);
+    s2 = _mm256_add_pd(s2, t2); s3 = _mm256_add_pd(s3, t3);
+
+    // compute the 4 horizontal sums at once
+    __m256d h01 = _mm256_hadd_pd(s0, s1);
+    __m256d h23 = _mm256_hadd_pd(s2, s3);
+    __m256d s4  = _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20),
+                                _mm256_permute2f128_pd(h01, h23, 0x31));
+    _mm256_storeu_pd(r+i, s4);
+
+    // add the remaining products
+    for ( ; k < n; k++) {
+      r[i]   += a[k] * b0[k]; r[i+1] += a[k] * b1[k];
+      r[i+2] += a[k] * b2[k]; r[i+3] += a[k] * b3[k];
+    }
+  }
+  for ( ; i < m; i++)           // remaining vectors one at a time
+    r[i] = sddot_avx2(a, b[i], n);
+}  // sddot_batch_avx2()
+
+#endif // DOT_AVX2_H
@@ -0,0 +1,190 @@
+/*----------------------------------------------------------------------------
+  File    : dot_avx512.h
+  Contents: dot product (AVX-512F-based implementations)
+  Author  : Kristian Loewe, Christian Borgelt
+----------------------------------------------------------------------------*/
+#ifndef DOT_AVX512_H
+#define DOT_AVX512_H
+
+#ifndef __AVX512F__
+#  error "AVX-512F is not enabled"
+#endif
+
+#include <immintrin.h>
+
+/*----------------------------------------------------------------------------
+  Function Prototypes
+----------------------------------------------------------------------------*/
+inline float  sdot_avx512        (const float  *a, const float  *b, int n);
+inline double ddot_avx512        (const double *a, const double *b, int n);
+inline double sddot_avx512       (const float  *a, const float  *b, int n);
+inline void   sddot_batch_avx512 (const float  *a, const float  *const *b,
+                                  int m, int n, double *r);
+
+/*----------------------------------------------------------------------------
+  Inline Functions
+----------------------------------------------------------------------------*/
+// The remaining elements are handled with masked loads, which only need
+// AVX-512F (masked 256 bit loads would need AVX-512VL), and which do not
+// touch memory outside of the masked elements.
+
+static inline double hsum8_avx512 (__m512d s8)
+{
+  __m256d s4 = _mm256_add_pd(_mm512_castpd512_pd256(s8),
+                             _mm512_extractf64x4_pd(s8, 1));
+  __m128d sh = _mm_add_pd(_mm256_castpd256_pd128(s4),
+                          _mm256_extractf128_pd(s4, 1));
+  sh = _mm_add_pd(sh, _mm_shuffle_pd(sh, sh, 1));
+  return _mm_cvtsd_f64(sh);     // extract horizontal sum from 1st elem.
+}  // hsum8_avx512()
+
+/*--------------------------------------------------------------------------*/
+
+static inline __m512d cvt8_avx512 (const float *p, int cnt)
+{                               // load and convert up to 8 floats
+  __mmask16 mask = (__mmask16)((1u << cnt) - 1u);
+  return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps(mask, p)));
+}  // cvt8_avx512()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (single precision)
+inline float sdot_avx512 (const float *a, const float *b, int n)
+{
+  // initialize 4 x 16 sums
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+  __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+
+  // in each iteration, add 1 product to each of the 64 sums in parallel
+  int k = 0;
+  for (int nq = 64*(n/64); k < nq; k += 64) {
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a+k),    _mm512_loadu_ps(b+k),    s0);
+    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a+k+16), _mm512_loadu_ps(b+k+16), s1);
+    s2 = _mm512_fmadd_ps(_mm512_loadu_ps(a+k+32), _mm512_loadu_ps(b+k+32), s2);
+    s3 = _mm512_fmadd_ps(_mm512_loadu_ps(a+k+48), _mm512_loadu_ps(b+k+48), s3);
+  }
+  for (int nq = 16*(n/16); k < nq; k += 16)
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a+k), _mm512_loadu_ps(b+k), s0);
+  if (k < n) {                  // add the remaining products
+    __mmask16 mask = (__mmask16)((1u << (n-k)) - 1u);
+    s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a+k),
+                         _mm512_maskz_loadu_ps(mask, b+k), s1);
+  }
+  s0 = _mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3));
+
+  // compute horizontal sum
+  __m256 s8 = _mm256_add_ps(_mm512_castps512_ps256(s0),
+    _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(s0), 1)));
+  __m128 sh = _mm_add_ps(_mm256_castps256_ps128(s8),
+                         _mm256_extractf128_ps(s8, 1));
+  sh = _mm_add_ps(sh, _mm_movehl_ps(sh, sh));
+  sh = _mm_add_ss(sh, _mm_shuffle_ps(sh, sh, 1));
+  return _mm_cvtss_f32(sh);     // extract horizontal sum from 1st elem.
+}  // sdot_avx512()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (double precision)
+inline double ddot_avx512 (const double *a, const double *b, int n)
+{
+  // initialize 4 x 8 sums
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+
+  // in each iteration, add 1 product to each of the 32 sums in parallel
+  int k = 0;
+  for (int nq = 32*(n/32); k < nq; k += 32) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a+k),    _mm512_loadu_pd(b+k),    s0);
+    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a+k+8),  _mm512_loadu_pd(b+k+8),  s1);
+    s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a+k+16), _mm512_loadu_pd(b+k+16), s2);
+    s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a+k+24), _mm512_loadu_pd(b+k+24), s3);
+  }
+  for (int nq = 8*(n/8); k < nq; k += 8)
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a+k), _mm512_loadu_pd(b+k), s0);
+  if (k < n) {                  // add the remaining products
+    __mmask8 mask = (__mmask8)((1u << (n-k)) - 1u);
+    s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a+k),
+                         _mm512_maskz_loadu_pd(mask, b+k), s1);
+  }
+  return hsum8_avx512(_mm512_add_pd(_mm512_add_pd(s0, s1),
+                                    _mm512_add_pd(s2, s3)));
+}  // ddot_avx512()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot product (input: single; intermediate and output: double)
+inline double sddot_avx512 (const float *a, const float *b, int n)
+{
+  // initialize 4 x 8 sums
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+
+  // in each iteration, add 1 product to each of the 32 sums in parallel
+  int k = 0;
+  for (int nq = 32*(n/32); k < nq; k += 32) {
+    s0 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a+k)),
+                         _mm512_cvtps_pd(_mm256_loadu_ps(b+k)), s0);
+    s1 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a+k+8)),
+                         _mm512_cvtps_pd(_mm256_loadu_ps(b+k+8)), s1);
+    s2 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a+k+16)),
+                         _mm512_cvtps_pd(_mm256_loadu_ps(b+k+16)), s2);
+    s3 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a+k+24)),
+                         _mm512_cvtps_pd(_mm256_loadu_ps(b+k+24)), s3);
+  }
+  for (int nq = 8*(n/8); k < nq; k += 8)
+    s0 = _mm512_fmadd_pd(_mm512_cvtps_pd(_mm256_loadu_ps(a+k)),
+                         _mm512_cvtps_pd(_mm256_loadu_ps(b+k)), s0);
+  if (k < n)                    // add the remaining products
+    s1 = _mm512_fmadd_pd(cvt8_avx512(a+k, n-k), cvt8_avx512(b+k, n-k), s1);
+  return hsum8_avx512(_mm512_add_pd(_mm512_add_pd(s0, s1),
+                                    _mm512_add_pd(s2, s3)));
+}  // sddot_avx512()
+
+/*--------------------------------------------------------------------------*/
+
+// --- dot products of one vector with several (input: single; output: double)
+inline void sddot_batch_avx512 (const float *a, const float *const *b,
+                                int m, int n, double *r)
+{
+  int i = 0;
+  for ( ; i+4 <= m; i += 4) {
+    const float *b0 = b[i], *b1 = b[i+1], *b2 = b[i+2], *b3 = b[i+3];
+
+    // initialize 2 x 8 sums per vector
+    __m512d s0 = _mm512_setzero_pd(), t0 = _mm512_setzero_pd();
+    __m512d s1 = _mm512_setzero_pd(), t1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), t2 = _mm512_setzero_pd();
+    __m512d s3 = _mm512_setzero_pd(), t3 = _mm512_setzero_pd();
+
+    // load and convert each element of a once for all 4 vectors
+    int k = 0;
+    for (int nq = 16*(n/16); k < nq; k += 16) {
+      __m512d al = _mm512_cvtps_pd(_mm256_loadu_ps(a+k));
+      __m512d ah = _mm512_cvtps_pd(_mm256_loadu_ps(a+k+8));
+      s0 = _mm512_fmadd_pd(al, _mm512_cvtps_pd(_mm256_loadu_ps(b0+k)),   s0);
+      t0 = _mm512_fmadd_pd(ah, _mm512_cvtps_pd(_mm256_loadu_ps(b0+k+8)), t0);
+      s1 = _mm512_fmadd_pd(al, _mm512_cvtps_pd(_mm256_loadu_ps(b1+k)),   s1);
+      t1 = _mm512_fmadd_pd(ah, _mm512_cvtps_pd(_mm256_loadu_ps(b1+k+8)), t1);
+      s2 = _mm512_fmadd_pd(al, _mm512_cvtps_pd(_mm256_loadu_ps(b2+k)),   s2);
+      t2 = _mm512_fmadd_pd(ah, _mm512_cvtps_pd(_mm256_loadu_ps(b2+k+8)), t2);
+      s3 = _mm512_fmadd_pd(al, _mm512_cvtps_pd(_mm256_loadu_ps(b3+k)),   s3);
+      t3 = _mm512_fmadd_pd(ah, _mm512_cvtps_pd(_mm256_loadu_ps(b3+k+8)), t3);
+    }
+    for ( ; k < n; k += 8) {    // add the remaining products
+      int cnt = (n-k < 8) ? n-k : 8;
+      __m512d al = cvt8_avx512(a+k, cnt);
+      s0 = _mm512_fmadd_pd(al, cvt8_avx512(b0+k, cnt), s0);
+      s1 = _mm512_fmadd_pd(al, cvt8_avx512(b1+k, cnt), s1);
+      s2 = _mm512_fmadd_pd(al, cvt8_avx512(b2+k, cnt), s2);
+      s3 = _mm512_fmadd_pd(al, cvt8_avx512(b3+k, cnt), s3);
+    }
+    r[i]   = hsum8_avx512(_mm512_add_pd(s0, t0));
+    r[i+1] = hsum8_avx512(_mm512_add_pd(s1, t1));
+    r[i+2] = hsum8_avx512(_mm512_add_pd(s2, t2));
+    r[i+3] = hsum8_avx512(_mm512_add_pd(s3, t3));
+  }
+  for ( ; i < m; i++)           // remaining vectors one at a time
+    r[i] = sddot_avx512(a, b[i], n);
+}  // sddot_batch_avx512()
+
+#endif // DOT_AVX512_H
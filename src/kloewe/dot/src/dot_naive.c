@@ -11,3 +11,5 @@
 extern float  sdot_naive  (const float  *a, const float  *b, int n);
 extern double ddot_naive  (const double *a, const double *b, int n);
 extern double sddot_naive (const float  *a, const float  *b, int n);
+extern void   sddot_batch_naive (const float *a, const float *const *b,
+                                 int m, int n, double *r);
@@ -12,6 +12,8 @@
 inline float  sdot_naive  (const float  *a, const float  *b, int n);
 inline double ddot_naive  (const double *a, const double *b, int n);
 inline double sddot_naive (const float  *a, const float  *b, int n);
+inline void   sddot_batch_naive (const float *a, const float *const *b,
+                                 int m, int n, double *r);
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -60,4 +62,14 @@ inline double sddot_naive (const float *a, const float *b, int n)
   return sum;
 }  // sddot_naive()
 
+/*--------------------------------------------------------------------------*/
+
+// --- dot products of one vector with several (input: single; output: double)
+inline void sddot_batch_naive (const float *a, const float *const *b,
+                               int m, int n, double *r)
+{
+  for (int i = 0; i < m; i++)
+    r[i] = sddot_naive(a, b[i], n);
+}  // sddot_batch_naive()
+
 #endif // DOT_NAIVE_H
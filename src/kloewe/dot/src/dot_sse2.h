@@ -39,6 +39,8 @@
 inline float  sdot_sse2  (const float  *a, const float  *b, int n);
 inline double ddot_sse2  (const double *a, const double *b, int n);
 inline double sddot_sse2 (const float  *a, const float  *b, int n);
+inline void   sddot_batch_sse2 (const float *a, const float *const *b,
+                                int m, int n, double *r);
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -188,4 +190,15 @@ inline double sddot_sse2 (const float *a, const float *b, int n)
   return s;
 }  // sddot_sse2()
 
+/*--------------------------------------------------------------------------*/
+
+// --- dot products of one vector with several (input: single; output: double)
+// (sddot_sse2 is limited by the alignment of each pair, so no shared loads)
+inline void sddot_batch_sse2 (const float *a, const float *const *b,
+                              int m, int n, double *r)
+{
+  for (int i = 0; i < m; i++)
+    r[i] = sddot_sse2(a, b[i], n);
+}  // sddot_batch_sse2()
+
 #endif // DOT_SSE2_H